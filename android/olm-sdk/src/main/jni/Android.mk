@@ -39,15 +39,22 @@ $(SRC_ROOT_DIR)/src/olm.cpp \
 $(SRC_ROOT_DIR)/src/pickle.cpp \
 $(SRC_ROOT_DIR)/src/ratchet.cpp \
 $(SRC_ROOT_DIR)/src/session.cpp \
+$(SRC_ROOT_DIR)/src/session_index.cpp \
 $(SRC_ROOT_DIR)/src/utility.cpp \
 $(SRC_ROOT_DIR)/src/pk.cpp \
 $(SRC_ROOT_DIR)/src/sas.c \
 $(SRC_ROOT_DIR)/src/ed25519.c \
+$(SRC_ROOT_DIR)/src/ed25519_batch.c \
+$(SRC_ROOT_DIR)/src/aes_hw.c \
+$(SRC_ROOT_DIR)/src/cpu_features.c \
 $(SRC_ROOT_DIR)/src/error.c \
+$(SRC_ROOT_DIR)/src/group_session_store.c \
 $(SRC_ROOT_DIR)/src/inbound_group_session.c \
 $(SRC_ROOT_DIR)/src/megolm.c \
 $(SRC_ROOT_DIR)/src/outbound_group_session.c \
 $(SRC_ROOT_DIR)/src/pickle_encoding.c \
+$(SRC_ROOT_DIR)/src/sha256_hw.c \
+$(SRC_ROOT_DIR)/src/sha256_mb.c \
 $(SRC_ROOT_DIR)/lib/crypto-algorithms/sha256.c \
 $(SRC_ROOT_DIR)/lib/crypto-algorithms/aes.c \
 $(SRC_ROOT_DIR)/lib/curve25519-donna/curve25519-donna.c \
@@ -0,0 +1,79 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Throughput of AES-256-CBC decryption with the portable block-at-a-time
+ * implementation and with the pipelined hardware implementation.
+ */
+
+#include "olm/crypto.h"
+
+#include "bench.hh"
+
+#include <vector>
+
+int main() {
+    static const std::size_t SIZES[] = {1024, 64 * 1024, 1024 * 1024};
+
+    _olm_aes256_key key;
+    _olm_aes256_iv iv;
+    for (std::size_t i = 0; i < sizeof(key.key); ++i) key.key[i] = i;
+    for (std::size_t i = 0; i < sizeof(iv.iv); ++i) iv.iv[i] = i;
+
+    if (!_olm_crypto_aes_hw_available()) {
+        std::printf("no hardware AES on this machine\n");
+    }
+
+    for (std::size_t size : SIZES) {
+        std::vector<std::uint8_t> plaintext(size, 0x5a);
+        std::size_t length = _olm_crypto_aes_encrypt_cbc_length(size);
+        std::vector<std::uint8_t> ciphertext(length);
+        std::vector<std::uint8_t> output(length);
+        _olm_crypto_aes_encrypt_cbc(
+            &key, &iv, plaintext.data(), size, ciphertext.data()
+        );
+
+        auto decrypt = [&]() {
+            _olm_crypto_aes_decrypt_cbc(
+                &key, &iv, ciphertext.data(), length, output.data()
+            );
+        };
+        auto encrypt = [&]() {
+            _olm_crypto_aes_encrypt_cbc(
+                &key, &iv, plaintext.data(), size, output.data()
+            );
+        };
+
+        int previous = _olm_crypto_aes_hw_enable(0);
+        bench::report_throughput(
+            "decrypt, portable", size, bench::time_per_call(decrypt)
+        );
+        bench::report_throughput(
+            "encrypt, portable", size, bench::time_per_call(encrypt)
+        );
+        if (_olm_crypto_aes_hw_available()) {
+            _olm_crypto_aes_hw_enable(1);
+            bench::report_throughput(
+                "decrypt, hardware (pipelined)", size,
+                bench::time_per_call(decrypt)
+            );
+            bench::report_throughput(
+                "encrypt, hardware", size, bench::time_per_call(encrypt)
+            );
+        }
+        _olm_crypto_aes_hw_enable(previous);
+    }
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Curve25519 key generation, which multiplies the fixed base point, and key
+ * agreement, which multiplies someone else's public key.
+ */
+
+#include "olm/crypto.h"
+
+#include "bench.hh"
+
+int main() {
+    std::uint8_t random[CURVE25519_RANDOM_LENGTH];
+    for (std::size_t i = 0; i < sizeof(random); ++i) random[i] = i * 7 + 3;
+
+    _olm_curve25519_key_pair our_pair, their_pair;
+    std::uint8_t shared_secret[CURVE25519_SHARED_SECRET_LENGTH];
+
+    bench::report_rate("curve25519 generate key", bench::time_per_call([&]() {
+        _olm_crypto_curve25519_generate_key(random, &our_pair);
+        random[0]++;
+    }));
+
+    _olm_crypto_curve25519_generate_key(random, &their_pair);
+    bench::report_rate("curve25519 shared secret", bench::time_per_call([&]() {
+        _olm_crypto_curve25519_shared_secret(
+            &our_pair, &their_pair.public_key, shared_secret
+        );
+    }));
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Ed25519 signing, and verification one at a time and in batches, per
+ * signature.
+ */
+
+#include "olm/crypto.h"
+
+#include "bench.hh"
+
+#include <vector>
+
+int main() {
+    static const std::size_t BATCH_SIZES[] = {2, 4, 16, 64};
+    static const std::size_t MAX_BATCH = 64;
+    static const std::size_t MESSAGE_LENGTH = 200;
+
+    std::vector<_olm_ed25519_key_pair> key_pairs(MAX_BATCH);
+    std::vector<std::uint8_t> messages(MAX_BATCH * MESSAGE_LENGTH, 0x5a);
+    std::vector<std::uint8_t> signatures(MAX_BATCH * ED25519_SIGNATURE_LENGTH);
+    std::vector<_olm_ed25519_verify_item> items(MAX_BATCH);
+    std::vector<std::uint8_t> results(MAX_BATCH);
+
+    for (std::size_t i = 0; i < MAX_BATCH; ++i) {
+        std::uint8_t seed[ED25519_RANDOM_LENGTH];
+        for (std::size_t j = 0; j < sizeof(seed); ++j) seed[j] = i + j;
+        _olm_crypto_ed25519_generate_key(seed, &key_pairs[i]);
+        messages[i * MESSAGE_LENGTH] = i;
+        _olm_crypto_ed25519_sign(
+            &key_pairs[i], &messages[i * MESSAGE_LENGTH], MESSAGE_LENGTH,
+            &signatures[i * ED25519_SIGNATURE_LENGTH]
+        );
+        items[i].key = &key_pairs[i].public_key;
+        items[i].message = &messages[i * MESSAGE_LENGTH];
+        items[i].message_length = MESSAGE_LENGTH;
+        items[i].signature = &signatures[i * ED25519_SIGNATURE_LENGTH];
+    }
+
+    std::uint8_t signature[ED25519_SIGNATURE_LENGTH];
+    bench::report_rate("ed25519 sign", bench::time_per_call([&]() {
+        _olm_crypto_ed25519_sign(
+            &key_pairs[0], &messages[0], MESSAGE_LENGTH, signature
+        );
+    }));
+
+    bench::report_rate("ed25519 verify", bench::time_per_call([&]() {
+        _olm_crypto_ed25519_verify(
+            items[0].key, items[0].message, items[0].message_length,
+            items[0].signature
+        );
+    }));
+
+    for (std::size_t batch : BATCH_SIZES) {
+        char label[64];
+        std::snprintf(
+            label, sizeof(label), "ed25519 verify batch of %zu, each", batch
+        );
+        double seconds = bench::time_per_call([&]() {
+            _olm_crypto_ed25519_verify_batch(items.data(), batch, results.data());
+        });
+        bench::report_rate(label, seconds / batch);
+    }
+
+    /* the shape of a backlog of group messages, all from the same sender */
+    for (std::size_t i = 0; i < MAX_BATCH; ++i) {
+        _olm_crypto_ed25519_sign(
+            &key_pairs[0], &messages[i * MESSAGE_LENGTH], MESSAGE_LENGTH,
+            &signatures[i * ED25519_SIGNATURE_LENGTH]
+        );
+        items[i].key = &key_pairs[0].public_key;
+    }
+    for (std::size_t batch : BATCH_SIZES) {
+        char label[64];
+        std::snprintf(
+            label, sizeof(label), "ed25519 verify batch of %zu, one key, each",
+            batch
+        );
+        double seconds = bench::time_per_call([&]() {
+            _olm_crypto_ed25519_verify_batch(items.data(), batch, results.data());
+        });
+        bench::report_rate(label, seconds / batch);
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The lists that hold one-time keys and skipped message keys, filled from the
+ * front as the account and the ratchet do, kept as a List, which moves every
+ * item along on each insert, and as a RingList, which doesn't. Then
+ * generating one-time keys through the API, where the curve25519 key
+ * generation dominates.
+ */
+
+#include "olm/account.hh"
+#include "olm/olm.h"
+#include "olm/ratchet.hh"
+
+#include "bench.hh"
+
+#include <vector>
+
+namespace {
+
+volatile std::uint32_t sink;
+
+template<typename ListType>
+void fill_one_time_keys() {
+    ListType keys;
+    for (std::uint32_t i = 0; i < olm::MAX_ONE_TIME_KEYS; ++i) {
+        olm::OneTimeKey & key = *keys.insert(keys.begin());
+        key.id = i;
+    }
+    sink = keys[olm::MAX_ONE_TIME_KEYS / 2].id;
+}
+
+template<typename ListType>
+void skip_message_keys(ListType & keys) {
+    /* keys for a run of skipped messages, pushing out the oldest ones */
+    for (std::uint32_t i = 0; i < 10; ++i) {
+        olm::SkippedMessageKey & key = *keys.insert();
+        key.message_key.index = i;
+    }
+    /* and one of the older ones used */
+    keys.erase(keys.begin() + 20);
+    sink = keys[0].message_key.index;
+}
+
+} // namespace
+
+int main() {
+    typedef olm::List<olm::OneTimeKey, olm::MAX_ONE_TIME_KEYS> KeyList;
+    typedef olm::RingList<olm::OneTimeKey, olm::MAX_ONE_TIME_KEYS> KeyRing;
+    bench::report_rate(
+        "List, 100 one-time keys",
+        bench::time_per_call(fill_one_time_keys<KeyList>)
+    );
+    bench::report_rate(
+        "RingList, 100 one-time keys",
+        bench::time_per_call(fill_one_time_keys<KeyRing>)
+    );
+
+    olm::List<olm::SkippedMessageKey, olm::MAX_SKIPPED_MESSAGE_KEYS> list;
+    olm::RingList<olm::SkippedMessageKey, olm::MAX_SKIPPED_MESSAGE_KEYS> ring;
+    for (std::size_t i = 0; i < olm::MAX_SKIPPED_MESSAGE_KEYS; ++i) {
+        list.insert();
+        ring.insert();
+    }
+    bench::report_rate(
+        "List, 10 skipped keys",
+        bench::time_per_call([&] { skip_message_keys(list); })
+    );
+    bench::report_rate(
+        "RingList, 10 skipped keys",
+        bench::time_per_call([&] { skip_message_keys(ring); })
+    );
+
+    std::vector<std::uint8_t> memory(olm_account_size());
+    OlmAccount * account = olm_account(memory.data());
+    std::vector<std::uint8_t> random(
+        olm_account_generate_one_time_keys_random_length(account, 100)
+    );
+    bench::report_rate(
+        "generate 100 one-time keys",
+        bench::time_per_call([&] {
+            olm_account_generate_one_time_keys(
+                account, 100, random.data(), random.size()
+            );
+        })
+    );
+    olm_clear_account(account);
+    return 0;
+}
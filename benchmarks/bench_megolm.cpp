@@ -0,0 +1,281 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Decrypting a backlog of group messages from one session, and encrypting
+ * group messages, one at a time and as a batch, per message; reading message
+ * indexes without decrypting; and advancing the ratchet on its own.
+ */
+
+#include "olm/inbound_group_session.h"
+#include "olm/megolm.h"
+#include "olm/outbound_group_session.h"
+
+#include "bench.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+/* How many bumps each part of the ratchet needs to get from `from` to `to`,
+ * as worked out by megolm_advance_to. */
+void advance_steps(
+    std::uint32_t from, std::uint32_t to,
+    unsigned int steps[MEGOLM_RATCHET_PARTS]
+) {
+    bool changed = false;
+    for (int j = 0; j < MEGOLM_RATCHET_PARTS; j++) {
+        int shift = (MEGOLM_RATCHET_PARTS - j - 1) * 8;
+        if (changed) {
+            steps[j] = (to >> shift) & 0xff;
+            continue;
+        }
+        steps[j] = ((to >> shift) - (from >> shift)) & 0xff;
+        if (steps[j] == 0 && to < from) steps[j] = 0x100;
+        changed = steps[j] != 0;
+    }
+}
+
+/* HMACs for an advance which rederives every lower part on the last bump of
+ * each part, as megolm_advance_to used to */
+std::size_t hmacs_rehashing_all(std::uint32_t from, std::uint32_t to) {
+    unsigned int steps[MEGOLM_RATCHET_PARTS];
+    advance_steps(from, to, steps);
+    std::size_t count = 0;
+    for (int j = 0; j < MEGOLM_RATCHET_PARTS; j++) {
+        if (steps[j]) count += steps[j] - 1 + MEGOLM_RATCHET_PARTS - j;
+    }
+    return count;
+}
+
+/* HMACs for an advance which only rederives lower parts as far as the next
+ * part to be bumped, as megolm_advance_to does now */
+std::size_t hmacs_rehashing_needed(std::uint32_t from, std::uint32_t to) {
+    unsigned int steps[MEGOLM_RATCHET_PARTS];
+    advance_steps(from, to, steps);
+    std::size_t count = 0;
+    for (int j = 0; j < MEGOLM_RATCHET_PARTS; j++) {
+        if (!steps[j]) continue;
+        int last = j + 1;
+        while (last < MEGOLM_RATCHET_PARTS - 1 && !steps[last]) last++;
+        if (last >= MEGOLM_RATCHET_PARTS) last = MEGOLM_RATCHET_PARTS - 1;
+        count += steps[j] - 1 + last - j + 1;
+    }
+    return count;
+}
+
+void report_hmacs(char const * name, double hmacs_per_call) {
+    std::printf("%-40s %12.1f HMACs/op\n", name, hmacs_per_call);
+}
+
+} // namespace
+
+int main() {
+    static const std::size_t BACKLOG = 200;
+    static const std::size_t PLAINTEXT_LENGTH = 200;
+
+    std::vector<std::uint8_t> outbound_memory(olm_outbound_group_session_size());
+    OlmOutboundGroupSession *outbound =
+        olm_outbound_group_session(outbound_memory.data());
+    std::vector<std::uint8_t> random(
+        olm_init_outbound_group_session_random_length(outbound), 0x42
+    );
+    olm_init_outbound_group_session(outbound, random.data(), random.size());
+
+    std::size_t key_length = olm_outbound_group_session_key_length(outbound);
+    std::vector<std::uint8_t> session_key(key_length);
+    olm_outbound_group_session_key(outbound, session_key.data(), key_length);
+
+    /* decrypting needs the signature on the key checked once, so start each
+     * run from an export instead */
+    std::vector<std::uint8_t> session_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *session =
+        olm_inbound_group_session(session_memory.data());
+    olm_init_inbound_group_session(session, session_key.data(), key_length);
+    std::size_t export_length = olm_export_inbound_group_session_length(session);
+    std::vector<std::uint8_t> exported(export_length);
+    olm_export_inbound_group_session(session, exported.data(), export_length, 0);
+
+    std::vector<std::uint8_t> plaintext(PLAINTEXT_LENGTH, 'x');
+    std::size_t message_length = olm_group_encrypt_message_length(
+        outbound, PLAINTEXT_LENGTH
+    );
+    std::vector<std::uint8_t> messages(BACKLOG * message_length);
+    for (std::size_t i = 0; i < BACKLOG; ++i) {
+        olm_group_encrypt(
+            outbound, plaintext.data(), PLAINTEXT_LENGTH,
+            &messages[i * message_length], message_length
+        );
+    }
+
+    std::vector<std::uint8_t> input(messages.size());
+    std::vector<std::uint8_t> output(messages.size());
+    std::vector<std::uint8_t> export_copy(export_length);
+    auto start = [&]() {
+        export_copy = exported;
+        olm_import_inbound_group_session(
+            session, export_copy.data(), export_length
+        );
+        input = messages;
+    };
+
+    double seconds = bench::time_per_call([&]() {
+        start();
+        for (std::size_t i = 0; i < BACKLOG; ++i) {
+            std::uint32_t index;
+            olm_group_decrypt(
+                session, &input[i * message_length], message_length,
+                &output[i * message_length], message_length, &index
+            );
+        }
+    });
+    bench::report_rate("group decrypt, each", seconds / BACKLOG);
+
+    std::vector<std::uint8_t *> message_ptrs(BACKLOG), plaintext_ptrs(BACKLOG);
+    std::vector<std::size_t> message_lengths(BACKLOG, message_length);
+    std::vector<std::size_t> max_plaintext_lengths(BACKLOG, message_length);
+    std::vector<std::size_t> plaintext_lengths(BACKLOG);
+    for (std::size_t i = 0; i < BACKLOG; ++i) {
+        message_ptrs[i] = &input[i * message_length];
+        plaintext_ptrs[i] = &output[i * message_length];
+    }
+    seconds = bench::time_per_call([&]() {
+        start();
+        olm_group_decrypt_batch(
+            session, BACKLOG,
+            message_ptrs.data(), message_lengths.data(),
+            plaintext_ptrs.data(), max_plaintext_lengths.data(),
+            plaintext_lengths.data(), nullptr, nullptr
+        );
+    });
+    bench::report_rate("group decrypt batch, each", seconds / BACKLOG);
+
+    /* scrolling back: the session has already seen the latest message */
+    auto start_late = [&]() {
+        start();
+        std::uint32_t index;
+        std::vector<std::uint8_t> last(
+            messages.end() - message_length, messages.end()
+        );
+        olm_group_decrypt(
+            session, last.data(), message_length,
+            output.data(), message_length, &index
+        );
+        input = messages;
+    };
+    seconds = bench::time_per_call([&]() {
+        start_late();
+        for (std::size_t i = 0; i < BACKLOG; ++i) {
+            std::uint32_t index;
+            olm_group_decrypt(
+                session, &input[i * message_length], message_length,
+                &output[i * message_length], message_length, &index
+            );
+        }
+    });
+    bench::report_rate("group decrypt history, each", seconds / BACKLOG);
+
+    seconds = bench::time_per_call([&]() {
+        start_late();
+        olm_group_decrypt_batch(
+            session, BACKLOG,
+            message_ptrs.data(), message_lengths.data(),
+            plaintext_ptrs.data(), max_plaintext_lengths.data(),
+            plaintext_lengths.data(), nullptr, nullptr
+        );
+    });
+    bench::report_rate("group decrypt history batch, each", seconds / BACKLOG);
+
+    seconds = bench::time_per_call([&]() {
+        for (std::size_t i = 0; i < BACKLOG; ++i) {
+            std::uint8_t version;
+            std::uint32_t index;
+            olm_group_message_peek(
+                &messages[i * message_length], message_length,
+                &version, &index
+            );
+        }
+    });
+    bench::report_rate("group message peek, each", seconds / BACKLOG);
+
+    /* the batch may need a few more bytes per message as the index grows */
+    std::size_t max_message_length = message_length + 8;
+    std::vector<std::uint8_t> encrypted(BACKLOG * max_message_length);
+    seconds = bench::time_per_call([&]() {
+        for (std::size_t i = 0; i < BACKLOG; ++i) {
+            olm_group_encrypt(
+                outbound, plaintext.data(), PLAINTEXT_LENGTH,
+                &encrypted[i * max_message_length], max_message_length
+            );
+        }
+    });
+    bench::report_rate("group encrypt, each", seconds / BACKLOG);
+
+    std::vector<std::uint8_t const *> plaintext_in(BACKLOG, plaintext.data());
+    std::vector<std::size_t> plaintext_in_lengths(BACKLOG, PLAINTEXT_LENGTH);
+    std::vector<std::uint8_t *> encrypted_ptrs(BACKLOG);
+    std::vector<std::size_t> max_encrypted_lengths(BACKLOG, max_message_length);
+    std::vector<std::size_t> encrypted_lengths(BACKLOG);
+    for (std::size_t i = 0; i < BACKLOG; ++i) {
+        encrypted_ptrs[i] = &encrypted[i * max_message_length];
+    }
+    seconds = bench::time_per_call([&]() {
+        olm_group_encrypt_batch(
+            outbound, BACKLOG,
+            plaintext_in.data(), plaintext_in_lengths.data(),
+            encrypted_ptrs.data(), max_encrypted_lengths.data(),
+            encrypted_lengths.data()
+        );
+    });
+    bench::report_rate("group encrypt batch, each", seconds / BACKLOG);
+
+    /* the worst case bumps every part 255 times; the average is over counters
+     * spread across the whole range */
+    static const std::size_t ADVANCES = 1000;
+    std::vector<std::uint32_t> from(ADVANCES), to(ADVANCES);
+    std::uint32_t state = 0x2545f491;
+    double before = 0, after = 0;
+    for (std::size_t i = 0; i < ADVANCES; ++i) {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+        from[i] = state;
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+        to[i] = state;
+        before += hmacs_rehashing_all(from[i], to[i]);
+        after += hmacs_rehashing_needed(from[i], to[i]);
+    }
+    report_hmacs("megolm advance worst, before", hmacs_rehashing_all(0, 0xffffffff));
+    report_hmacs("megolm advance worst", hmacs_rehashing_needed(0, 0xffffffff));
+    report_hmacs("megolm advance average, before", before / ADVANCES);
+    report_hmacs("megolm advance average", after / ADVANCES);
+
+    Megolm megolm;
+    std::vector<std::uint8_t> ratchet_random(MEGOLM_RATCHET_LENGTH, 0x42);
+    seconds = bench::time_per_call([&]() {
+        megolm_init(&megolm, ratchet_random.data(), 0);
+        megolm_advance_to(&megolm, 0xffffffff);
+    });
+    bench::report_rate("megolm advance worst", seconds);
+
+    seconds = bench::time_per_call([&]() {
+        for (std::size_t i = 0; i < ADVANCES; ++i) {
+            megolm_init(&megolm, ratchet_random.data(), from[i]);
+            megolm_advance_to(&megolm, to[i]);
+        }
+    });
+    bench::report_rate("megolm advance average", seconds / ADVANCES);
+
+    return 0;
+}
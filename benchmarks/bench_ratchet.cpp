@@ -0,0 +1,123 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Olm ratchet decryption of a message that skips over earlier ones, on the
+ * chain the receiver already has and on a new chain. A ratchet can't be
+ * copied, so each call sets up the receiver again; the cost of that is
+ * measured on its own and taken off.
+ */
+
+#include "olm/cipher.h"
+#include "olm/ratchet.hh"
+
+#include "bench.hh"
+
+#include <vector>
+
+namespace {
+
+std::uint8_t root_info[] = "Olm";
+std::uint8_t ratchet_info[] = "OlmRatchet";
+std::uint8_t message_info[] = "OlmMessageKeys";
+
+olm::KdfInfo kdf_info = {
+    root_info, sizeof(root_info) - 1,
+    ratchet_info, sizeof(ratchet_info) - 1
+};
+
+_olm_cipher_aes_sha_256 cipher0 = OLM_CIPHER_INIT_AES_SHA_256(message_info);
+_olm_cipher *cipher = OLM_CIPHER_BASE(&cipher0);
+
+std::uint8_t shared_secret[] = "A secret";
+std::uint8_t plaintext[] = "Message";
+std::uint8_t random_bytes[] = "This is a random 32 byte string";
+
+std::vector<std::uint8_t> encrypt(olm::Ratchet & ratchet) {
+    std::vector<std::uint8_t> message(ratchet.encrypt_output_length(7));
+    ratchet.encrypt(plaintext, 7, random_bytes, 32, message.data(), message.size());
+    return message;
+}
+
+void decrypt(olm::Ratchet & ratchet, std::vector<std::uint8_t> const & message) {
+    std::vector<std::uint8_t> output(
+        ratchet.decrypt_max_plaintext_length(message.data(), message.size())
+    );
+    ratchet.decrypt(
+        message.data(), message.size(), output.data(), output.size()
+    );
+}
+
+} // namespace
+
+int main() {
+    _olm_curve25519_key_pair alice_key;
+    _olm_crypto_curve25519_generate_key(random_bytes, &alice_key);
+
+    for (unsigned gap : {0u, 40u, 1000u}) {
+        /* Alice's messages are on the chain that Bob starts with, and Bob's
+         * are on a new chain for Alice */
+        olm::Ratchet alice(kdf_info, cipher), bob(kdf_info, cipher);
+        alice.initialise_as_alice(
+            shared_secret, sizeof(shared_secret) - 1, alice_key
+        );
+        bob.initialise_as_bob(
+            shared_secret, sizeof(shared_secret) - 1, alice_key.public_key
+        );
+        for (unsigned i = 0; i < gap; ++i) {
+            encrypt(alice);
+            encrypt(bob);
+        }
+        std::vector<std::uint8_t> to_bob = encrypt(alice);
+        std::vector<std::uint8_t> to_alice = encrypt(bob);
+
+        auto start_bob = [&](olm::Ratchet & receiver) {
+            receiver.initialise_as_bob(
+                shared_secret, sizeof(shared_secret) - 1, alice_key.public_key
+            );
+        };
+        auto start_alice = [&](olm::Ratchet & receiver) {
+            receiver.initialise_as_alice(
+                shared_secret, sizeof(shared_secret) - 1, alice_key
+            );
+        };
+
+        char name[64];
+        double setup = bench::time_per_call([&]() {
+            olm::Ratchet receiver(kdf_info, cipher);
+            start_bob(receiver);
+        });
+        double with_decrypt = bench::time_per_call([&]() {
+            olm::Ratchet receiver(kdf_info, cipher);
+            start_bob(receiver);
+            decrypt(receiver, to_bob);
+        });
+        std::snprintf(name, sizeof(name), "decrypt, existing chain, gap %u", gap);
+        bench::report_rate(name, with_decrypt - setup);
+
+        setup = bench::time_per_call([&]() {
+            olm::Ratchet receiver(kdf_info, cipher);
+            start_alice(receiver);
+        });
+        with_decrypt = bench::time_per_call([&]() {
+            olm::Ratchet receiver(kdf_info, cipher);
+            start_alice(receiver);
+            decrypt(receiver, to_alice);
+        });
+        std::snprintf(name, sizeof(name), "decrypt, new chain, gap %u", gap);
+        bench::report_rate(name, with_decrypt - setup);
+    }
+
+    return 0;
+}
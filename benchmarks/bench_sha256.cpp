@@ -0,0 +1,97 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* SHA-256, HMAC-SHA-256 and HKDF with the portable and hardware compression
+ * functions.
+ */
+
+#include "olm/crypto.h"
+
+#include "bench.hh"
+
+#include <vector>
+
+int main() {
+    static const std::size_t SIZES[] = {64, 1024, 64 * 1024};
+
+    std::uint8_t key[32] = {1};
+    std::uint8_t output[64];
+
+    if (!_olm_crypto_sha256_hw_available()) {
+        std::printf("no hardware SHA-256 on this machine\n");
+    }
+
+    int previous = _olm_crypto_sha256_hw_enable(1);
+
+    for (int use_hw = 0; use_hw <= _olm_crypto_sha256_hw_available(); ++use_hw) {
+        _olm_crypto_sha256_hw_enable(use_hw);
+        std::printf("%s:\n", use_hw ? "hardware" : "portable");
+
+        for (std::size_t size : SIZES) {
+            std::vector<std::uint8_t> input(size, 0x5a);
+            bench::report_throughput("  sha256", size, bench::time_per_call([&]() {
+                _olm_crypto_sha256(input.data(), size, output);
+            }));
+        }
+
+        /* the shape of a megolm ratchet step */
+        std::uint8_t seed = 0;
+        bench::report_rate("  hmac-sha256, 32 byte key, 1 byte", bench::time_per_call([&]() {
+            _olm_crypto_hmac_sha256(key, sizeof(key), &seed, 1, output);
+        }));
+
+        _olm_hmac_sha256_ctx hmac;
+        _olm_crypto_hmac_sha256_init(&hmac, key, sizeof(key));
+        bench::report_rate("  hmac-sha256, prepared key, 1 byte", bench::time_per_call([&]() {
+            _olm_crypto_hmac_sha256_compute(&hmac, &seed, 1, output);
+        }));
+
+        /* megolm rehashing the parts of its ratchet after the one it
+         * advanced, with and without the multi-buffer code, which is only
+         * used when the SHA instructions aren't */
+        int mb_available = !use_hw && _olm_crypto_sha256_mb_available();
+        for (int use_mb = 0; use_mb <= mb_available; ++use_mb) {
+            int previous_mb = _olm_crypto_sha256_mb_enable(use_mb);
+            for (std::size_t count = 2; count <= 8; count *= 2) {
+                _olm_hmac_sha256_lane lanes[8];
+                std::uint8_t lane_output[8][32];
+                for (std::size_t i = 0; i < count; ++i) {
+                    lanes[i] = {&hmac, &seed, 1, lane_output[i]};
+                }
+                char label[64];
+                std::snprintf(
+                    label, sizeof(label), "  hmac-sha256 lanes x%zu%s",
+                    count, use_mb ? ", multi-buffer" : ""
+                );
+                bench::report_rate(label, bench::time_per_call([&]() {
+                    _olm_crypto_hmac_sha256_lanes(lanes, count);
+                }));
+            }
+            _olm_crypto_sha256_mb_enable(previous_mb);
+        }
+
+        /* the shape of the message key derivation in the cipher */
+        static const std::uint8_t INFO[] = "MEGOLM_KEYS";
+        bench::report_rate("  hkdf-sha256, 80 bytes", bench::time_per_call([&]() {
+            _olm_crypto_hkdf_sha256(
+                key, sizeof(key), nullptr, 0, INFO, sizeof(INFO) - 1,
+                output, 64
+            );
+        }));
+    }
+
+    _olm_crypto_sha256_hw_enable(previous);
+    return 0;
+}
@@ -0,0 +1,62 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+namespace bench {
+
+/** Run the function repeatedly for at least min_seconds, and return the
+ * average number of seconds per call. */
+template<typename F>
+double time_per_call(F && f, double min_seconds = 0.5) {
+    typedef std::chrono::steady_clock clock;
+    /* warm up the caches and the branch predictor */
+    f();
+    std::size_t iterations = 1;
+    for (;;) {
+        clock::time_point start = clock::now();
+        for (std::size_t i = 0; i < iterations; ++i) {
+            f();
+        }
+        std::chrono::duration<double> elapsed = clock::now() - start;
+        if (elapsed.count() >= min_seconds) {
+            return elapsed.count() / iterations;
+        }
+        iterations *= 2;
+    }
+}
+
+/** Print a throughput figure for processing `bytes` bytes per call */
+inline void report_throughput(
+    char const * name, std::size_t bytes, double seconds_per_call
+) {
+    std::printf(
+        "%-40s %10zu bytes %12.1f MiB/s\n",
+        name, bytes, bytes / seconds_per_call / (1024.0 * 1024.0)
+    );
+}
+
+/** Print a per-operation figure */
+inline void report_rate(char const * name, double seconds_per_call) {
+    std::printf(
+        "%-40s %12.0f ns/op %14.0f ops/s\n",
+        name, seconds_per_call * 1e9, 1.0 / seconds_per_call
+    );
+}
+
+} // namespace bench
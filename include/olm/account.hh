@@ -42,7 +42,7 @@ static std::size_t const MAX_ONE_TIME_KEYS = 100;
 struct Account {
     Account();
     IdentityKeys identity_keys;
-    List<OneTimeKey, MAX_ONE_TIME_KEYS> one_time_keys;
+    RingList<OneTimeKey, MAX_ONE_TIME_KEYS> one_time_keys;
     std::uint8_t num_fallback_keys;
     OneTimeKey current_fallback_key;
     OneTimeKey prev_fallback_key;
@@ -0,0 +1,81 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* AES-256 using the CPU's AES instructions. Callers must check
+ * _olm_aes256_hw_supported() before using any of the other functions.
+ */
+
+#ifndef OLM_AES_HW_H_
+#define OLM_AES_HW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** number of round keys in an AES-256 key schedule */
+#define OLM_AES256_ROUND_KEYS 15
+
+/** number of bytes in an AES block */
+#define OLM_AES_BLOCK_LENGTH 16
+
+/** An expanded AES-256 key schedule, as a sequence of 16-byte round keys in
+ * the order the hardware instructions consume them. */
+struct _olm_aes256_hw_key {
+    uint8_t round_keys[OLM_AES256_ROUND_KEYS][OLM_AES_BLOCK_LENGTH];
+};
+
+/** Returns non-zero if the hardware AES implementation can be used */
+int _olm_aes256_hw_supported(void);
+
+/** Expand a 32 byte key into a key schedule for encryption */
+void _olm_aes256_hw_setup_encrypt(
+    struct _olm_aes256_hw_key *schedule,
+    uint8_t const *key
+);
+
+/** Expand a 32 byte key into a key schedule for decryption */
+void _olm_aes256_hw_setup_decrypt(
+    struct _olm_aes256_hw_key *schedule,
+    uint8_t const *key
+);
+
+/** Encrypt a whole number of blocks in CBC mode. On return iv holds the last
+ * block of ciphertext so that further blocks can be chained on. The output
+ * may be the same buffer as the input. */
+void _olm_aes256_hw_encrypt_cbc(
+    struct _olm_aes256_hw_key const *schedule,
+    uint8_t *iv,
+    uint8_t const *input, size_t blocks,
+    uint8_t *output
+);
+
+/** Decrypt a whole number of blocks in CBC mode. On return iv holds the last
+ * block of ciphertext. The output may be the same buffer as the input, but
+ * must not otherwise overlap it. */
+void _olm_aes256_hw_decrypt_cbc(
+    struct _olm_aes256_hw_key const *schedule,
+    uint8_t *iv,
+    uint8_t const *input, size_t blocks,
+    uint8_t *output
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* OLM_AES_HW_H_ */
@@ -19,6 +19,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "olm/crypto.h"
+
 // Note: exports in this file are only for unit tests.  Nobody else should be
 // using this externally
 #include "olm/olm_export.h"
@@ -117,6 +119,51 @@ struct _olm_cipher_aes_sha_256 {
 
 OLM_EXPORT extern const struct _olm_cipher_ops _olm_cipher_aes_sha_256_ops;
 
+/** The keys an _olm_cipher_aes_sha_256 derives from the key material passed
+ * to encrypt/decrypt. Deriving them runs the HKDF, so callers that use the
+ * same key material for many messages can derive them once and use the
+ * _with_keys functions below. This is key material, so wipe it with
+ * olm::unset or _olm_unset once done. */
+struct _olm_cipher_aes_sha_256_keys {
+    struct _olm_aes256_key aes_key;
+    struct _olm_hmac_sha256_ctx mac_key;
+    struct _olm_aes256_iv aes_iv;
+};
+
+/** Derives the keys the cipher would use for the given key material. */
+OLM_EXPORT void _olm_cipher_aes_sha_256_derive_keys(
+    const struct _olm_cipher_aes_sha_256 *cipher,
+    uint8_t const * key, size_t key_length,
+    struct _olm_cipher_aes_sha_256_keys *keys
+);
+
+/** Derives the keys the cipher would use for each of count pieces of key
+ * material of the same length. This is faster than deriving them one at a
+ * time. */
+OLM_EXPORT void _olm_cipher_aes_sha_256_derive_keys_many(
+    const struct _olm_cipher_aes_sha_256 *cipher,
+    uint8_t const * const * keys, size_t key_length,
+    struct _olm_cipher_aes_sha_256_keys *derived_keys, size_t count
+);
+
+/** The same as the cipher's encrypt op, with keys from
+ * _olm_cipher_aes_sha_256_derive_keys. */
+OLM_EXPORT size_t _olm_cipher_aes_sha_256_encrypt_with_keys(
+    const struct _olm_cipher_aes_sha_256_keys *keys,
+    uint8_t const * plaintext, size_t plaintext_length,
+    uint8_t * ciphertext, size_t ciphertext_length,
+    uint8_t * output, size_t output_length
+);
+
+/** The same as the cipher's decrypt op, with keys from
+ * _olm_cipher_aes_sha_256_derive_keys. */
+OLM_EXPORT size_t _olm_cipher_aes_sha_256_decrypt_with_keys(
+    const struct _olm_cipher_aes_sha_256_keys *keys,
+    uint8_t const * input, size_t input_length,
+    uint8_t const * ciphertext, size_t ciphertext_length,
+    uint8_t * plaintext, size_t max_plaintext_length
+);
+
 /**
  * get an initializer for an instance of struct _olm_cipher_aes_sha_256.
  *
@@ -0,0 +1,51 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Runtime detection of the CPU features used by the accelerated crypto
+ * backends.
+ */
+
+#ifndef OLM_CPU_FEATURES_H_
+#define OLM_CPU_FEATURES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) \
+    || defined(__i386__) || defined(_M_IX86)
+#define OLM_CPU_X86 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define OLM_CPU_AARCH64 1
+#endif
+
+/** Returns non-zero if the CPU has instructions for the AES round function
+ * (AES-NI on x86, the ARMv8 cryptography extensions on aarch64) and the
+ * library was built with support for using them. */
+int _olm_cpu_has_aes(void);
+
+/** Returns non-zero if the CPU has instructions for the SHA-256 compression
+ * function (the SHA extensions on x86, the ARMv8 SHA2 instructions on
+ * aarch64) and the library was built with support for using them. */
+int _olm_cpu_has_sha256(void);
+
+/** Returns non-zero if the CPU and operating system support AVX2 */
+int _olm_cpu_has_avx2(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* OLM_CPU_FEATURES_H_ */
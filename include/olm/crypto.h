@@ -34,6 +34,9 @@ extern "C" {
 /** length of a sha256 hash */
 #define SHA256_OUTPUT_LENGTH 32
 
+/** number of 32-bit words in the SHA-256 chaining state */
+#define SHA256_STATE_WORDS 8
+
 /** length of a public or private Curve25519 key */
 #define CURVE25519_KEY_LENGTH 32
 
@@ -61,6 +64,23 @@ extern "C" {
 /** length of an aes256 initialisation vector */
 #define AES256_IV_LENGTH 16
 
+/** An HMAC-SHA-256 key prepared for computing many MACs. It holds the
+ * SHA-256 states after absorbing the inner and outer padded keys, which saves
+ * two compression function calls per MAC. This is key material, so wipe it
+ * with olm::unset or _olm_unset once done. */
+struct _olm_hmac_sha256_ctx {
+    uint32_t inner_state[SHA256_STATE_WORDS];
+    uint32_t outer_state[SHA256_STATE_WORDS];
+};
+
+/** One of several independent HMAC-SHA-256 computations to run together. */
+struct _olm_hmac_sha256_lane {
+    const struct _olm_hmac_sha256_ctx *key;
+    const uint8_t *input;
+    size_t input_length;
+    uint8_t *output;
+};
+
 struct _olm_aes256_key {
     uint8_t key[AES256_KEY_LENGTH];
 };
@@ -87,6 +107,15 @@ struct _olm_ed25519_public_key {
     uint8_t public_key[ED25519_PUBLIC_KEY_LENGTH];
 };
 
+/** One of several ed25519 signatures to verify together. The signature is
+ * ED25519_SIGNATURE_LENGTH (64) bytes long. */
+struct _olm_ed25519_verify_item {
+    const struct _olm_ed25519_public_key *key;
+    const uint8_t *message;
+    size_t message_length;
+    const uint8_t *signature;
+};
+
 struct _olm_ed25519_private_key {
     uint8_t private_key[ED25519_PRIVATE_KEY_LENGTH];
 };
@@ -123,6 +152,16 @@ OLM_EXPORT size_t _olm_crypto_aes_decrypt_cbc(
 );
 
 
+/** Returns non-zero if AES can use the CPU's AES instructions on this
+ * machine. */
+OLM_EXPORT int _olm_crypto_aes_hw_available(void);
+
+/** Enables or disables the hardware AES implementation. It is used by
+ * default whenever it is available; turning it off is mostly useful for
+ * testing the portable implementation. Returns the previous setting. */
+OLM_EXPORT int _olm_crypto_aes_hw_enable(int enable);
+
+
 /** Computes SHA-256 of the input. The output buffer must be a least
  * SHA256_OUTPUT_LENGTH (32) bytes long. */
 OLM_EXPORT void _olm_crypto_sha256(
@@ -130,6 +169,16 @@ OLM_EXPORT void _olm_crypto_sha256(
     uint8_t * output
 );
 
+/** Returns non-zero if SHA-256 can use the CPU's SHA instructions on this
+ * machine. */
+OLM_EXPORT int _olm_crypto_sha256_hw_available(void);
+
+/** Enables or disables the hardware SHA-256 implementation, which also backs
+ * HMAC and HKDF. It is used by default whenever it is available; turning it
+ * off is mostly useful for testing the portable implementation. Returns the
+ * previous setting. */
+OLM_EXPORT int _olm_crypto_sha256_hw_enable(int enable);
+
 /** HMAC: Keyed-Hashing for Message Authentication
  * http://tools.ietf.org/html/rfc2104
  * Computes HMAC-SHA-256 of the input for the key. The output buffer must
@@ -140,6 +189,38 @@ OLM_EXPORT void _olm_crypto_hmac_sha256(
     uint8_t * output
 );
 
+/** Prepares an HMAC-SHA-256 context for the key. */
+OLM_EXPORT void _olm_crypto_hmac_sha256_init(
+    struct _olm_hmac_sha256_ctx *ctx,
+    uint8_t const * key, size_t key_length
+);
+
+/** Computes HMAC-SHA-256 of the input with a prepared key. The output is the
+ * same as _olm_crypto_hmac_sha256 with the key the context was prepared for.
+ * The output buffer must be at least SHA256_OUTPUT_LENGTH (32) bytes long,
+ * and may overlap the key the context was prepared from. */
+OLM_EXPORT void _olm_crypto_hmac_sha256_compute(
+    const struct _olm_hmac_sha256_ctx *ctx,
+    uint8_t const * input, size_t input_length,
+    uint8_t * output
+);
+
+/** Computes HMAC-SHA-256 for each of count independent lanes. The outputs
+ * are the same as calling _olm_crypto_hmac_sha256_compute for each lane in
+ * turn, but short inputs are hashed side by side when the CPU supports it.
+ * No lane's output may overlap any lane's input. */
+OLM_EXPORT void _olm_crypto_hmac_sha256_lanes(
+    const struct _olm_hmac_sha256_lane *lanes, size_t count
+);
+
+/** Returns non-zero if _olm_crypto_hmac_sha256_lanes can hash several lanes
+ * at once on this machine. */
+OLM_EXPORT int _olm_crypto_sha256_mb_available(void);
+
+/** Enables or disables the multi-buffer SHA-256 implementation used by
+ * _olm_crypto_hmac_sha256_lanes. Returns the previous setting. */
+OLM_EXPORT int _olm_crypto_sha256_mb_enable(int enable);
+
 
 /** HMAC-based Key Derivation Function (HKDF)
  * https://tools.ietf.org/html/rfc5869
@@ -152,6 +233,18 @@ OLM_EXPORT void _olm_crypto_hkdf_sha256(
 );
 
 
+/** Computes HKDF-SHA-256 with no salt for each of count inputs, using the
+ * same info for each. The outputs are the same as calling
+ * _olm_crypto_hkdf_sha256 with a NULL salt for each input, but the expand
+ * steps are hashed side by side with _olm_crypto_hmac_sha256_lanes. */
+OLM_EXPORT void _olm_crypto_hkdf_sha256_lanes(
+    uint8_t const * const * inputs, size_t input_length,
+    uint8_t const * info, size_t info_length,
+    uint8_t * const * outputs, size_t output_length,
+    size_t count
+);
+
+
 /** Generate a curve25519 key pair
  * random_32_bytes should be CURVE25519_RANDOM_LENGTH (32) bytes long.
  */
@@ -197,6 +290,15 @@ OLM_EXPORT int _olm_crypto_ed25519_verify(
     const uint8_t * signature
 );
 
+/** Verify count ed25519 signatures, setting results[i] to 1 if the i-th
+ * signature is valid and to 0 if it isn't. Returns the number of valid
+ * signatures. Each result is the same as _olm_crypto_ed25519_verify gives for
+ * that signature. */
+OLM_EXPORT size_t _olm_crypto_ed25519_verify_batch(
+    const struct _olm_ed25519_verify_item *items, size_t count,
+    uint8_t *results
+);
+
 
 
 #ifdef __cplusplus
@@ -0,0 +1,55 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Batch verification of ed25519 signatures. Rather than checking
+ * S * B = R + h * A for each signature, pick a 128-bit coefficient z for each
+ * and check the single equation
+ *
+ *     (sum z * S) * B - sum z * R - sum (z * h) * A = 0,
+ *
+ * sharing the doublings of one multi-scalar multiplication between all the
+ * points. The coefficients are derived by hashing the whole batch, so they
+ * can't be predicted before the signatures are fixed and no random input is
+ * needed. If the equation doesn't hold, the signatures are checked one at a
+ * time with ed25519_verify to find out which ones are bad.
+ *
+ * The batch is only a fast path: every R and A in it must have no
+ * small-order part, since small-order errors in two signatures can cancel
+ * out. If any of them has one, the signatures are checked one at a time.
+ * Either way, a signature is accepted exactly when ed25519_verify accepts it.
+ * Checking for a small-order part takes a scalar multiplication per point, so
+ * a batch only saves time when many of its signatures share a key.
+ */
+
+#ifndef OLM_ED25519_BATCH_H_
+#define OLM_ED25519_BATCH_H_
+
+#include "olm/crypto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Implements _olm_crypto_ed25519_verify_batch */
+size_t _olm_ed25519_verify_batch(
+    const struct _olm_ed25519_verify_item *items, size_t count,
+    uint8_t *results
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* OLM_ED25519_BATCH_H_ */
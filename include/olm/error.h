@@ -66,6 +66,16 @@ enum OlmErrorCode {
      */
     OLM_PICKLE_EXTRA_DATA = 17,
 
+    /**
+     * The group session isn't in the session store.
+     */
+    OLM_UNKNOWN_GROUP_SESSION = 18,
+
+    /**
+     * The checksum of a chunk of exported group sessions was wrong.
+     */
+    OLM_BAD_CHECKSUM = 19,
+
     /* remember to update the list of string constants in error.c when updating
      * this list. */
 };
@@ -0,0 +1,198 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OLM_GROUP_SESSION_STORE_H_
+#define OLM_GROUP_SESSION_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "olm/error.h"
+#include "olm/inbound_group_session.h"
+#include "olm/pickle_key.h"
+
+#include "olm/olm_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A store of encrypted inbound group sessions, indexed by session id.
+ *
+ * The store lives entirely in memory supplied by the application, which is
+ * typically a shared mapping of a file, so that the store persists without
+ * the sessions being pickled to and from a database one by one. It holds a
+ * fixed number of fixed-size records, each one a session id and a binary
+ * pickle from olm_pickle_inbound_group_session_binary(), and a hash index
+ * from session ids to records. Only the record for the session asked for is
+ * decrypted.
+ *
+ * Records are only ever appended: storing a session again appends a new
+ * record and points the index at it, and removing a session only removes it
+ * from the index. The space taken by the old records is reclaimed by
+ * compacting the store into a fresh one.
+ *
+ * All of the numbers in the store are big-endian, and nothing in it needs to
+ * be aligned, so a store file can be moved between machines.
+ *
+ * Looking sessions up, and compacting, only read the store, so they can run
+ * on several threads at once. Storing and removing sessions change it, so
+ * the application must make sure that nothing else uses the store while they
+ * run.
+ */
+typedef struct OlmGroupSessionStore OlmGroupSessionStore;
+
+/**
+ * The record size needed to store sessions with up to the given number of
+ * checkpoints. */
+OLM_EXPORT size_t olm_group_session_store_record_size(size_t checkpoints);
+
+/**
+ * The number of bytes of memory needed for a store of the given number of
+ * records of the given size. */
+OLM_EXPORT size_t olm_group_session_store_length(
+    size_t record_size, size_t capacity
+);
+
+/** The number of random bytes needed to start a new store */
+OLM_EXPORT size_t olm_group_session_store_init_random_length(void);
+
+/**
+ * Start a new, empty store in the supplied memory, which must be at least
+ * olm_group_session_store_length(record_size, capacity) bytes. Any existing
+ * contents of the memory are overwritten. The random bytes key the hash of
+ * the session ids, so that senders can't choose session ids that collide in
+ * the index; they are wiped afterwards.
+ *
+ * Returns NULL if the memory is too small, if the records are too small to
+ * hold a session, if the capacity is zero or more than 2^28, or if there are
+ * fewer than olm_group_session_store_init_random_length() random bytes.
+ */
+OLM_EXPORT OlmGroupSessionStore * olm_group_session_store_init(
+    void *memory, size_t memory_length,
+    size_t record_size, size_t capacity,
+    uint8_t *random, size_t random_length
+);
+
+/**
+ * Use a store that was started with olm_group_session_store_init(), for
+ * example after mapping the file that holds it again.
+ *
+ * Returns NULL if the memory doesn't hold a store, or is too small for it.
+ */
+OLM_EXPORT OlmGroupSessionStore * olm_group_session_store_open(
+    void *memory, size_t memory_length
+);
+
+/** The number of sessions in the store */
+OLM_EXPORT size_t olm_group_session_store_session_count(
+    const OlmGroupSessionStore *store
+);
+
+/**
+ * The number of records that have been used, including ones for sessions
+ * that have since been stored again or removed. Once this reaches the
+ * capacity of the store, the store has to be compacted before any more
+ * sessions can be stored. */
+OLM_EXPORT size_t olm_group_session_store_record_count(
+    const OlmGroupSessionStore *store
+);
+
+/** The number of records that the store has room for */
+OLM_EXPORT size_t olm_group_session_store_capacity(
+    const OlmGroupSessionStore *store
+);
+
+/**
+ * Store a group session, encrypted with a pickle key from olm_pickle_key(),
+ * replacing any earlier copy of the same session. The session is pickled in
+ * the scratch buffer, so that it is never in the store unencrypted, so the
+ * buffer must be at least the record size of the store; it is wiped
+ * afterwards.
+ *
+ * Returns OLM_SUCCESS on success, or OLM_OUTPUT_BUFFER_TOO_SMALL if the
+ * store is full, if the session's pickle doesn't fit in a record, or if the
+ * scratch buffer is too small.
+ */
+OLM_EXPORT enum OlmErrorCode olm_group_session_store_put(
+    OlmGroupSessionStore *store,
+    OlmPickleKey const * pickle_key,
+    OlmInboundGroupSession *session,
+    void *scratch, size_t scratch_length
+);
+
+/**
+ * Load the group session with the given base64 session id from the store
+ * into an inbound group session object, decrypting it with a pickle key from
+ * olm_pickle_key(). The encrypted record is copied to the scratch buffer and
+ * decrypted there, so the buffer must be at least the record size of the
+ * store; it is wiped afterwards.
+ *
+ * Returns OLM_SUCCESS on success. Otherwise returns OLM_UNKNOWN_GROUP_SESSION
+ * if the session isn't in the store, OLM_INVALID_BASE64 if the session id
+ * isn't valid base64, OLM_OUTPUT_BUFFER_TOO_SMALL if the scratch buffer is
+ * too small, or any of the errors from
+ * olm_unpickle_inbound_group_session_binary().
+ */
+OLM_EXPORT enum OlmErrorCode olm_group_session_store_get(
+    const OlmGroupSessionStore *store,
+    OlmPickleKey const * pickle_key,
+    uint8_t const * session_id, size_t session_id_length,
+    OlmInboundGroupSession *session,
+    void *scratch, size_t scratch_length
+);
+
+/**
+ * Remove the group session with the given base64 session id from the store.
+ *
+ * Returns OLM_SUCCESS on success, OLM_UNKNOWN_GROUP_SESSION if the session
+ * isn't in the store, or OLM_INVALID_BASE64 if the session id isn't valid
+ * base64.
+ */
+OLM_EXPORT enum OlmErrorCode olm_group_session_store_remove(
+    OlmGroupSessionStore *store,
+    uint8_t const * session_id, size_t session_id_length
+);
+
+/**
+ * Copy the sessions in one store into another, freshly started, store,
+ * leaving behind the records that are no longer used. The records are copied
+ * as they are, without being decrypted.
+ *
+ * The copy is done a step at a time so that it can be spread out: each call
+ * looks at up to max_records records of the old store, starting from
+ * *position, which should be 0 for the first call, and moves *position on.
+ * The copy is complete once *position reaches
+ * olm_group_session_store_record_count(from). Since the old store is only
+ * read, sessions can still be looked up in it while the copy is made, for
+ * example with the steps run on a background thread. Sessions stored in the
+ * old store between steps are copied by the later steps, but sessions
+ * removed from it must be removed from the new store as well.
+ *
+ * Returns OLM_SUCCESS on success, OLM_OUTPUT_BUFFER_TOO_SMALL if the new
+ * store is full or its records are too small, or OLM_CORRUPTED_PICKLE if a
+ * record in the old store is corrupted.
+ */
+OLM_EXPORT enum OlmErrorCode olm_group_session_store_compact(
+    const OlmGroupSessionStore *from,
+    OlmGroupSessionStore *to,
+    size_t *position, size_t max_records
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* OLM_GROUP_SESSION_STORE_H_ */
@@ -19,6 +19,7 @@
 #include <stdint.h>
 
 #include "olm/error.h"
+#include "olm/pickle_key.h"
 
 #include "olm/olm_export.h"
 
@@ -59,6 +60,80 @@ OLM_EXPORT size_t olm_clear_inbound_group_session(
     OlmInboundGroupSession *session
 );
 
+/** The number of bytes each entry in the checkpoint table takes */
+OLM_EXPORT size_t olm_inbound_group_session_checkpoint_size(void);
+
+/**
+ * Give the group session memory for a table of ratchet checkpoints.
+ *
+ * Decrypting a message that is older than the latest one decrypted normally
+ * means advancing the ratchet from the first known index, which costs up to
+ * 1020 HMAC-SHA-256 operations. With a checkpoint table, the session keeps
+ * the ratchet values at the R(1) and R(2) boundaries (every 65536 and every
+ * 256 messages) that it passes, and starts from the nearest one instead.
+ * When the table is full, R(2) checkpoints are dropped before R(1) ones, and
+ * earlier ones before later ones.
+ *
+ * The memory must be suitably aligned for a uint32_t, and holds
+ * memory_length / olm_inbound_group_session_checkpoint_size() checkpoints.
+ * It must stay valid until the table is replaced or the session is cleared,
+ * which wipes it. Checkpoints already in the session are moved to the new
+ * memory, as far as they fit, and the rest of the old memory is wiped. The new
+ * memory may overlap the old. Pass NULL to remove the table.
+ *
+ * The checkpoints are included when the session is pickled. Set the table
+ * before unpickling to restore them; without one they are skipped.
+ *
+ * Returns the number of checkpoints the table can hold.
+ */
+OLM_EXPORT size_t olm_inbound_group_session_set_checkpoints(
+    OlmInboundGroupSession *session,
+    void *memory, size_t memory_length
+);
+
+/** The number of bytes each entry in the derived key cache takes */
+OLM_EXPORT size_t olm_inbound_group_session_key_cache_entry_size(void);
+
+/**
+ * Give the group session memory for a cache of derived message keys.
+ *
+ * Decrypting a message means advancing a copy of the ratchet to its index
+ * and deriving the AES and HMAC keys from it. With a key cache, the session
+ * keeps the keys for the messages it has decrypted most recently, so that
+ * decrypting one of them again skips both. When the cache is full, the
+ * least recently used keys are wiped to make room.
+ *
+ * The memory must be suitably aligned for a uint64_t, and holds
+ * memory_length / olm_inbound_group_session_key_cache_entry_size() entries.
+ * It must stay valid until the cache is replaced or the session is cleared,
+ * which wipes it. Any keys already cached are wiped, and the hit and miss
+ * counts are reset. Pass NULL to remove the cache.
+ *
+ * The cache is not pickled.
+ *
+ * Returns the number of entries the cache can hold.
+ */
+OLM_EXPORT size_t olm_inbound_group_session_set_key_cache(
+    OlmInboundGroupSession *session,
+    void *memory, size_t memory_length
+);
+
+/**
+ * The number of decryptions that found their keys in the key cache since it
+ * was set.
+ */
+OLM_EXPORT size_t olm_inbound_group_session_key_cache_hits(
+    const OlmInboundGroupSession *session
+);
+
+/**
+ * The number of decryptions that had to derive their keys since the key
+ * cache was set.
+ */
+OLM_EXPORT size_t olm_inbound_group_session_key_cache_misses(
+    const OlmInboundGroupSession *session
+);
+
 /** Returns the number of bytes needed to store an inbound group session */
 OLM_EXPORT size_t olm_pickle_inbound_group_session_length(
     const OlmInboundGroupSession *session
@@ -94,6 +169,75 @@ OLM_EXPORT size_t olm_unpickle_inbound_group_session(
     void * pickled, size_t pickled_length
 );
 
+/**
+ * The same as olm_pickle_inbound_group_session, using a pickle key from
+ * olm_pickle_key()
+ */
+OLM_EXPORT size_t olm_pickle_inbound_group_session_with_key(
+    OlmInboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
+/**
+ * The same as olm_unpickle_inbound_group_session, using a pickle key from
+ * olm_pickle_key()
+ */
+OLM_EXPORT size_t olm_unpickle_inbound_group_session_with_key(
+    OlmInboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
+/**
+ * Returns the number of bytes needed to store an inbound group session with
+ * olm_pickle_inbound_group_session_binary
+ */
+OLM_EXPORT size_t olm_pickle_inbound_group_session_binary_length(
+    const OlmInboundGroupSession *session
+);
+
+/**
+ * The largest that olm_pickle_inbound_group_session_binary_length() can be
+ * for a session with up to the given number of checkpoints, for applications
+ * that keep binary pickles in fixed-size slots.
+ */
+OLM_EXPORT size_t olm_pickle_inbound_group_session_binary_max_length(
+    size_t checkpoints
+);
+
+/**
+ * Stores a group session as encrypted binary data rather than a base64
+ * string, which takes about a quarter less space, for applications that
+ * store pickles somewhere that can hold binary data. Encrypts the session
+ * using a pickle key from olm_pickle_key(). Returns the length of the
+ * pickle on success.
+ *
+ * Returns olm_error() on failure. If the pickle output buffer
+ * is smaller than olm_pickle_inbound_group_session_binary_length() then
+ * olm_inbound_group_session_last_error() will be "OUTPUT_BUFFER_TOO_SMALL"
+ */
+OLM_EXPORT size_t olm_pickle_inbound_group_session_binary(
+    OlmInboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
+/**
+ * Loads a group session from a pickle made by
+ * olm_pickle_inbound_group_session_binary. Decrypts the session using a
+ * pickle key from olm_pickle_key().
+ *
+ * Returns olm_error() on failure, with the same errors as
+ * olm_unpickle_inbound_group_session apart from "INVALID_BASE64". The input
+ * pickled buffer is destroyed
+ */
+OLM_EXPORT size_t olm_unpickle_inbound_group_session_binary(
+    OlmInboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
 
 /**
  * Start a new inbound group session, from a key exported from
@@ -142,6 +286,31 @@ OLM_EXPORT size_t olm_group_decrypt_max_plaintext_length(
     uint8_t * message, size_t message_length
 );
 
+/**
+ * The same as olm_group_decrypt_max_plaintext_length, but the input message
+ * buffer is left untouched. Only the start of the message is decoded.
+ *
+ * If the message has fields that this version of olm does not know about
+ * after the ciphertext, the result may be larger than
+ * olm_group_decrypt_max_plaintext_length would give.
+ */
+OLM_EXPORT size_t olm_group_decrypt_max_plaintext_length_const(
+    OlmInboundGroupSession *session,
+    uint8_t const * message, size_t message_length
+);
+
+/**
+ * Get an upper bound on the number of bytes of plain-text the decrypt method
+ * will write for a message that has already been base64-decoded, as passed
+ * to olm_group_decrypt_raw. The input message buffer is left untouched.
+ *
+ * Returns olm_error() on failure.
+ */
+OLM_EXPORT size_t olm_group_decrypt_raw_max_plaintext_length(
+    OlmInboundGroupSession *session,
+    uint8_t const * message, size_t message_length
+);
+
 /**
  * Decrypt a message.
  *
@@ -173,6 +342,76 @@ OLM_EXPORT size_t olm_group_decrypt(
     uint32_t * message_index
 );
 
+/**
+ * Decrypt a message that has already been base64-decoded. The input message
+ * buffer is left untouched, so bindings can pass their own copy of the
+ * message straight in.
+ *
+ * Returns the length of the decrypted plain-text, or olm_error() on failure,
+ * with the same errors as olm_group_decrypt apart from OLM_INVALID_BASE64.
+ */
+OLM_EXPORT size_t olm_group_decrypt_raw(
+    OlmInboundGroupSession *session,
+    uint8_t const * message, size_t message_length,
+    uint8_t * plaintext, size_t max_plaintext_length,
+    uint32_t * message_index
+);
+
+/**
+ * Decrypt count messages, which is faster than calling olm_group_decrypt for
+ * each of them. The messages, and the plain-text buffers with their lengths,
+ * are given as arrays of count pointers and lengths.
+ *
+ * The messages are decrypted in order of their message index, carrying the
+ * ratchet forward from one to the next, and their signatures are checked
+ * together. They need not be in order, but it is most efficient to pass all
+ * the messages to hand for the session at once.
+ *
+ * The input message buffers are destroyed.
+ *
+ * For each message, plaintext_lengths[i] is set to the length of the
+ * decrypted plain-text, or to olm_error() if it couldn't be decrypted.
+ * message_indexes[i] is set to its message index if that could be read, and
+ * errors[i] to OLM_SUCCESS or the error olm_group_decrypt would give for that
+ * message. message_indexes and errors may be NULL.
+ *
+ * Returns the number of messages decrypted.
+ */
+OLM_EXPORT size_t olm_group_decrypt_batch(
+    OlmInboundGroupSession *session,
+    size_t count,
+
+    /* input; note that they will be overwritten with the base64-decoded
+       messages. */
+    uint8_t * const * messages, size_t const * message_lengths,
+
+    /* output */
+    uint8_t * const * plaintexts, size_t const * max_plaintext_lengths,
+    size_t * plaintext_lengths,
+    uint32_t * message_indexes,
+    enum OlmErrorCode * errors
+);
+
+/**
+ * Read the protocol version and the message index of a base64 group message,
+ * without decrypting it or checking its signature, for example to sort
+ * messages before decrypting them. Only the first few characters of the
+ * message are decoded, and the input message buffer is left untouched.
+ *
+ * Nothing here is authenticated: a message whose index is read successfully
+ * may still fail to decrypt.
+ *
+ * Returns OLM_SUCCESS, with the version and index written to the output
+ * parameters, or else:
+ *   * OLM_INVALID_BASE64 if the message is not the length of any base-64
+ *     string
+ *   * OLM_BAD_MESSAGE_FORMAT if the message index could not be read
+ */
+OLM_EXPORT enum OlmErrorCode olm_group_message_peek(
+    uint8_t const * message, size_t message_length,
+    uint8_t * version, uint32_t * message_index
+);
+
 
 /**
  * Get the number of bytes returned by olm_inbound_group_session_id()
@@ -238,6 +477,78 @@ OLM_EXPORT size_t olm_export_inbound_group_session(
     uint8_t * key, size_t key_length, uint32_t message_index
 );
 
+/**
+ * Sessions can also be exported and imported in bulk, as a binary stream of
+ * chunks. Each chunk holds the exports of a number of sessions, each with
+ * its length before it, and ends with a SHA-256 checksum of the chunk. The
+ * checksum catches corruption, not tampering: like the exports from
+ * olm_export_inbound_group_session(), the chunks are not encrypted or
+ * authenticated, so they should be protected in the same way.
+ *
+ * The application reads and writes the stream itself, one chunk at a time,
+ * so the memory needed depends only on the number of sessions it puts in
+ * each chunk. Each chunk stands alone, and its length can be found from its
+ * header without checking the rest of it, so a stream can be split into
+ * chunks and the chunks made or imported by several threads at once, in any
+ * order.
+ */
+
+/** The number of bytes in a chunk of the given number of sessions */
+OLM_EXPORT size_t olm_export_inbound_group_sessions_chunk_length(
+    size_t session_count
+);
+
+/**
+ * Export a chunk of sessions, each at its first known index, in a format
+ * which can be used by olm_import_inbound_group_sessions_chunk().
+ *
+ * Returns OLM_SUCCESS on success, or OLM_OUTPUT_BUFFER_TOO_SMALL if the output
+ * buffer is smaller than olm_export_inbound_group_sessions_chunk_length().
+ */
+OLM_EXPORT enum OlmErrorCode olm_export_inbound_group_sessions_chunk(
+    OlmInboundGroupSession * const * sessions, size_t session_count,
+    uint8_t * output, size_t output_length
+);
+
+/**
+ * The number of bytes at the start of a chunk that
+ * olm_inbound_group_sessions_chunk_info() needs */
+OLM_EXPORT size_t olm_inbound_group_sessions_chunk_header_length(void);
+
+/**
+ * Read the header at the start of a chunk, to find the number of sessions
+ * in it and the length of the whole chunk. Only
+ * olm_inbound_group_sessions_chunk_header_length() bytes are needed.
+ *
+ * Returns OLM_SUCCESS on success. Otherwise returns
+ * OLM_INPUT_BUFFER_TOO_SMALL if the input is too short to hold the header,
+ * OLM_BAD_MESSAGE_VERSION if the chunk is in an unknown format, or
+ * OLM_BAD_MESSAGE_FORMAT if the header is invalid.
+ */
+OLM_EXPORT enum OlmErrorCode olm_inbound_group_sessions_chunk_info(
+    uint8_t const * input, size_t input_length,
+    size_t * session_count, size_t * chunk_length
+);
+
+/**
+ * Import the sessions in a chunk from olm_export_inbound_group_sessions_chunk()
+ * into the given sessions, in order. There must be at least as many
+ * sessions as the chunk holds. The input is not changed. Each session is
+ * set up as olm_import_inbound_group_session() would, replacing whatever it
+ * held before, and is not verified.
+ *
+ * Returns OLM_SUCCESS on success. Otherwise returns any of the errors from
+ * olm_inbound_group_sessions_chunk_info(), OLM_INPUT_BUFFER_TOO_SMALL if the
+ * input is shorter than the chunk, OLM_OUTPUT_BUFFER_TOO_SMALL if there are
+ * too few sessions, OLM_BAD_CHECKSUM if the chunk is corrupted, or
+ * OLM_BAD_SESSION_KEY if it holds a session export in an unknown format. If
+ * there is an error, none of the sessions are changed.
+ */
+OLM_EXPORT enum OlmErrorCode olm_import_inbound_group_sessions_chunk(
+    uint8_t const * input, size_t input_length,
+    OlmInboundGroupSession * const * sessions, size_t session_count
+);
+
 
 #ifdef __cplusplus
 } // extern "C"
@@ -16,6 +16,7 @@
 #define OLM_LIST_HH_
 
 #include <cstddef>
+#include <cstdint>
 
 namespace olm {
 
@@ -114,6 +115,166 @@ private:
     T _data[max_size];
 };
 
+
+/**
+ * A list with the same interface and order as List, kept in a ring buffer so
+ * that inserting or erasing at either end doesn't move the other items.
+ * Inserting or erasing in the middle moves whichever side is shorter.
+ */
+template<typename T, std::size_t max_size>
+class RingList {
+public:
+    RingList() : _first(0), _size(0) {}
+
+    template<typename V, typename D>
+    class Iterator {
+    public:
+        Iterator(D * data, std::size_t first, std::size_t index)
+            : _data(data), _first(first), _index(index) {}
+
+        V & operator*() const {
+            std::size_t pos = _first + _index;
+            if (pos >= max_size) {
+                pos -= max_size;
+            }
+            return _data[pos];
+        }
+        V * operator->() const { return &**this; }
+
+        Iterator & operator++() { ++_index; return *this; }
+        Iterator & operator--() { --_index; return *this; }
+        Iterator operator+(std::size_t n) const {
+            return Iterator(_data, _first, _index + n);
+        }
+        Iterator operator-(std::size_t n) const {
+            return Iterator(_data, _first, _index - n);
+        }
+
+        bool operator==(Iterator const & other) const {
+            return _index == other._index;
+        }
+        bool operator!=(Iterator const & other) const {
+            return _index != other._index;
+        }
+
+    private:
+        friend class RingList;
+        D * _data;
+        std::size_t _first;
+        std::size_t _index;
+    };
+
+    typedef Iterator<T, T> iterator;
+    typedef Iterator<T const, T const> const_iterator;
+
+    iterator begin() { return iterator(_data, _first, 0); }
+    iterator end() { return iterator(_data, _first, _size); }
+    const_iterator begin() const { return const_iterator(_data, _first, 0); }
+    const_iterator end() const {
+        return const_iterator(_data, _first, _size);
+    }
+
+    /**
+     * Is the list empty?
+     */
+    bool empty() const { return _size == 0; }
+
+    /**
+     * The number of items in the list.
+     */
+    std::size_t size() const { return _size; }
+
+    T & operator[](std::size_t index) { return _data[position(index)]; }
+
+    T const & operator[](std::size_t index) const {
+        return _data[position(index)];
+    }
+
+    /**
+     * Erase the item from the list at the given position.
+     */
+    void erase(iterator pos) { erase_at(pos._index); }
+
+    /**
+     * Erase the given item from the list.
+     */
+    void erase(T * item) {
+        std::size_t pos = item - _data;
+        erase_at(pos >= _first ? pos - _first : pos + max_size - _first);
+    }
+
+    /**
+     * Make space for an item in the list at a given position.
+     * If inserting the item makes the list longer than max_size then
+     * the end of the list is discarded.
+     * Returns the where the item is inserted.
+     */
+    T * insert(iterator pos) {
+        std::size_t index = pos._index;
+        if (_size == max_size) {
+            if (index == _size) {
+                /* nothing after it to discard, so it replaces the last item */
+                return &(*this)[index - 1];
+            }
+            --_size;
+        }
+        if (index < _size - index) {
+            _first = _first ? _first - 1 : max_size - 1;
+            ++_size;
+            for (std::size_t i = 0; i < index; ++i) {
+                (*this)[i] = (*this)[i + 1];
+            }
+        } else {
+            ++_size;
+            for (std::size_t i = _size - 1; i > index; --i) {
+                (*this)[i] = (*this)[i - 1];
+            }
+        }
+        return &(*this)[index];
+    }
+
+    /**
+     * Make space for an item in the list at the start of the list
+     */
+    T * insert() { return insert(begin()); }
+
+    /**
+     * Insert an item into the list at a given position.
+     * If inserting the item makes the list longer than max_size then
+     * the end of the list is discarded.
+     * Returns the where the item is inserted.
+     */
+    T * insert(iterator pos, T const & value) {
+        T * item = insert(pos);
+        *item = value;
+        return item;
+    }
+
+private:
+    std::size_t position(std::size_t index) const {
+        std::size_t pos = _first + index;
+        return pos >= max_size ? pos - max_size : pos;
+    }
+
+    void erase_at(std::size_t index) {
+        if (index < _size - 1 - index) {
+            for (std::size_t i = index; i > 0; --i) {
+                (*this)[i] = (*this)[i - 1];
+            }
+            _first = position(1);
+        } else {
+            for (std::size_t i = index; i + 1 < _size; ++i) {
+                (*this)[i] = (*this)[i + 1];
+            }
+        }
+        --_size;
+    }
+
+    std::uint32_t _first;
+    std::uint32_t _size;
+    T _data[max_size];
+};
+
 } // namespace olm
 
 #endif /* OLM_LIST_HH_ */
@@ -88,6 +88,21 @@ OLM_EXPORT void _olm_decode_group_message(
     struct _OlmDecodeGroupMessageResults *results
 );
 
+/**
+ * Reads the message headers from the first input_length bytes of a group
+ * message which is message_length bytes long, without needing the rest of
+ * it. Reading stops at the ciphertext: results->ciphertext is set to where
+ * it starts in the input, but only the bytes of it that are in the input may
+ * be read, and any fields after it are not seen.
+ */
+OLM_EXPORT void _olm_decode_group_message_header(
+    const uint8_t *input, size_t input_length,
+    size_t message_length, size_t mac_length, size_t signature_length,
+
+    /* output structure: updated with results */
+    struct _OlmDecodeGroupMessageResults *results
+);
+
 
 
 #ifdef __cplusplus
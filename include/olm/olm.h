@@ -20,6 +20,7 @@
 #include <stdint.h>
 
 #include "olm/error.h"
+#include "olm/pickle_key.h"
 #include "olm/inbound_group_session.h"
 #include "olm/outbound_group_session.h"
 
@@ -35,6 +36,41 @@ static const size_t OLM_MESSAGE_TYPE_MESSAGE = 1;
 typedef struct OlmAccount OlmAccount;
 typedef struct OlmSession OlmSession;
 typedef struct OlmUtility OlmUtility;
+typedef struct OlmSessionIndex OlmSessionIndex;
+
+/**
+ * Functions that a compact session uses to get memory for skipped message
+ * keys, which it only needs while messages are missing.
+ */
+typedef struct OlmAllocator {
+    /** Allocate the given number of bytes, aligned for a uint32_t. Returns
+     * NULL if the memory can't be allocated. */
+    void * (*allocate)(void * context, size_t length);
+    /** Free memory returned by allocate(). The memory has been wiped. */
+    void (*deallocate)(void * context, void * memory, size_t length);
+    /** Passed to allocate() and deallocate() */
+    void * context;
+} OlmAllocator;
+
+/**
+ * The memory used by a session, from olm_session_memory_usage()
+ */
+typedef struct OlmSessionMemoryUsage {
+    /** The size of the session object: olm_session_size() or
+     * olm_compact_session_size() */
+    size_t session;
+    /** The part of the session object holding the sending and receiving
+     * chains */
+    size_t chains;
+    /** The part of the session object holding skipped message keys */
+    size_t embedded_skipped_message_keys;
+    /** The memory outside the session object for skipped message keys, either
+     * from olm_session_set_skipped_message_keys() or from the session's
+     * allocator */
+    size_t external_skipped_message_keys;
+    /** The number of skipped message keys the session holds */
+    size_t skipped_message_key_count;
+} OlmSessionMemoryUsage;
 
 /** Get the version number of the library.
  * Arguments will be updated if non-null.
@@ -62,6 +98,27 @@ OLM_EXPORT OlmSession * olm_session(
     void * memory
 );
 
+/** The size of a compact session object in bytes */
+OLM_EXPORT size_t olm_compact_session_size(void);
+
+/** Initialise a compact session object using the supplied memory, which must
+ * be at least olm_compact_session_size() bytes. A compact session is the same
+ * as any other, except that it doesn't have room in the object for the keys of
+ * messages that have been skipped over, which take up most of a session made
+ * by olm_session(). Instead it gets memory for them from the allocator when it
+ * needs it, which is only when messages are missing, and frees it again once
+ * they have all arrived. The allocator must stay valid for as long as the
+ * session is used. If the allocator is NULL, or can't allocate the memory, the
+ * keys for skipped messages are not kept, so those messages can't be
+ * decrypted when they arrive, unless the session is given memory for them with
+ * olm_session_set_skipped_message_keys().
+ *
+ * A compact session must be cleared with olm_clear_session() to free any
+ * memory it has allocated. */
+OLM_EXPORT OlmSession * olm_compact_session(
+    void * memory, OlmAllocator const * allocator
+);
+
 /** Initialise a utility object using the supplied memory
  *  The supplied memory must be at least olm_utility_size() bytes */
 OLM_EXPORT OlmUtility * olm_utility(
@@ -109,7 +166,9 @@ OLM_EXPORT size_t olm_clear_account(
     OlmAccount * account
 );
 
-/** Clears the memory used to back this session */
+/** Clears the memory used to back this session, including any memory for
+ * skipped message keys, and frees any memory that a compact session has
+ * allocated. Returns the size of the session object. */
 OLM_EXPORT size_t olm_clear_session(
     OlmSession * session
 );
@@ -175,6 +234,36 @@ OLM_EXPORT size_t olm_unpickle_session(
     void * pickled, size_t pickled_length
 );
 
+/** The same as olm_pickle_account, using a pickle key from olm_pickle_key() */
+OLM_EXPORT size_t olm_pickle_account_with_key(
+    OlmAccount * account,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
+/** The same as olm_pickle_session, using a pickle key from olm_pickle_key() */
+OLM_EXPORT size_t olm_pickle_session_with_key(
+    OlmSession * session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
+/** The same as olm_unpickle_account, using a pickle key from
+ * olm_pickle_key() */
+OLM_EXPORT size_t olm_unpickle_account_with_key(
+    OlmAccount * account,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
+/** The same as olm_unpickle_session, using a pickle key from
+ * olm_pickle_key() */
+OLM_EXPORT size_t olm_unpickle_session_with_key(
+    OlmSession * session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
 /** The number of random bytes needed to create an account.*/
 OLM_EXPORT size_t olm_create_account_random_length(
     OlmAccount const * account
@@ -385,6 +474,45 @@ OLM_EXPORT int olm_session_has_received_message(
     OlmSession const *session
 );
 
+/** The number of bytes of memory needed for each key in a skipped message key
+ * table. */
+OLM_EXPORT size_t olm_session_skipped_message_key_size(void);
+
+/**
+ * Keep the message keys for messages that have been skipped over in a table in
+ * the supplied memory, rather than in the session itself. A session keeps the
+ * keys for the latest 40 skipped messages; a table can keep up to 65535, so
+ * that messages that arrive very late or out of order can still be decrypted.
+ * The oldest keys are dropped when the table is full.
+ *
+ * The memory must stay valid, and must not be used for anything else, until
+ * the table is replaced, the session is cleared with olm_clear_session(), or
+ * this is called with a NULL memory to go back to keeping the latest 40 keys
+ * in the session object, or in memory from the allocator for a compact
+ * session. It must be aligned for a uint32_t, and must not overlap the
+ * current table. The keys already skipped are moved to the new table, as many
+ * of the latest ones as fit, and the memory for the old table is wiped.
+ *
+ * The table is not part of the session's pickle, so it should be set before
+ * olm_unpickle_session() to keep all of the keys in the pickle. Pickles of
+ * sessions with a table have the same format as other session pickles, and
+ * can be read by sessions without one, which keep the latest 40 keys.
+ *
+ * Returns the number of keys that the session can now keep.
+ */
+OLM_EXPORT size_t olm_session_set_skipped_message_keys(
+    OlmSession * session,
+    void * memory, size_t memory_length
+);
+
+/** Report how the memory used by a session is made up, if usage is not NULL.
+ * Returns the total number of bytes of memory that the session uses, in the
+ * object and outside it. */
+OLM_EXPORT size_t olm_session_memory_usage(
+    OlmSession const * session,
+    OlmSessionMemoryUsage * usage
+);
+
 /**
  * Write a null-terminated string describing the internal state of an olm
  * session to the buffer provided for debugging and logging purposes. If the
@@ -431,6 +559,151 @@ OLM_EXPORT size_t olm_remove_one_time_keys(
     OlmSession * session
 );
 
+/** The size of a session index object that can hold up to capacity sessions,
+ * in bytes */
+OLM_EXPORT size_t olm_session_index_size(size_t capacity);
+
+/** The number of random bytes needed to initialise a session index */
+OLM_EXPORT size_t olm_session_index_random_length(void);
+
+/**
+ * Initialise a session index object using the supplied memory, which must be
+ * at least olm_session_index_size(capacity) bytes and aligned for a uint64_t.
+ * The random bytes key the hash of the session keys, so that the senders of
+ * pre-key messages can't choose keys that collide in the index; they are
+ * wiped afterwards.
+ *
+ * A session index finds the inbound session that a pre-key message is for
+ * without calling olm_matches_inbound_session() for every session. It maps
+ * the keys that identify each session to a handle chosen by the application,
+ * such as the number of the row that the session is stored in. The index
+ * doesn't keep the sessions themselves, so it must be kept up to date with
+ * olm_session_index_insert() and olm_session_index_remove() as sessions are
+ * made and thrown away.
+ *
+ * Returns NULL if the capacity is zero or more than 2^24, or if there are
+ * fewer than olm_session_index_random_length() random bytes.
+ */
+OLM_EXPORT OlmSessionIndex * olm_session_index(
+    void * memory, size_t capacity,
+    void * random, size_t random_length
+);
+
+/** A null terminated string describing the most recent error to happen to a
+ * session index */
+OLM_EXPORT const char * olm_session_index_last_error(
+    OlmSessionIndex const * index
+);
+
+/** An error code describing the most recent error to happen to a session
+ * index */
+OLM_EXPORT enum OlmErrorCode olm_session_index_last_error_code(
+    OlmSessionIndex const * index
+);
+
+/** Clears the memory used to back this session index, including its hash
+ * key. Returns the size of the session index object. */
+OLM_EXPORT size_t olm_clear_session_index(
+    OlmSessionIndex * index
+);
+
+/** The number of sessions in the index */
+OLM_EXPORT size_t olm_session_index_count(
+    OlmSessionIndex const * index
+);
+
+/** Adds a session to the index with the given handle, or changes the handle
+ * if the session is already in the index. Returns olm_error() on failure. If
+ * the index is full then olm_session_index_last_error() will be
+ * "OUTPUT_BUFFER_TOO_SMALL". */
+OLM_EXPORT size_t olm_session_index_insert(
+    OlmSessionIndex * index,
+    OlmSession const * session,
+    uint64_t handle
+);
+
+/** Removes a session from the index. Returns 1 if the session was removed, or
+ * 0 if it wasn't in the index. */
+OLM_EXPORT size_t olm_session_index_remove(
+    OlmSessionIndex * index,
+    OlmSession const * session
+);
+
+/** Finds the session that a PRE_KEY message is for, decoding the message
+ * once. Matches sessions in the same way as olm_matches_inbound_session(), so
+ * a message without an identity key never matches. The
+ * one_time_key_message buffer is destroyed. Returns 1 and writes the session's
+ * handle to *handle if there is a matching session. Returns 0 if there isn't
+ * one, or if the message couldn't be decoded. Returns olm_error() on failure.
+ * If the base64 couldn't be decoded then olm_session_index_last_error() will
+ * be "INVALID_BASE64". */
+OLM_EXPORT size_t olm_session_index_find(
+    OlmSessionIndex * index,
+    void * one_time_key_message, size_t message_length,
+    uint64_t * handle
+);
+
+/** Finds the session that a PRE_KEY message from the given identity key is
+ * for, decoding the message once. Matches sessions in the same way as
+ * olm_matches_inbound_session_from(). The one_time_key_message buffer is
+ * destroyed. Returns 1 and writes the session's handle to *handle if there is
+ * a matching session. Returns 0 if there isn't one, or if the message
+ * couldn't be decoded. Returns olm_error() on failure. If either of the base64
+ * inputs couldn't be decoded then olm_session_index_last_error() will be
+ * "INVALID_BASE64". */
+OLM_EXPORT size_t olm_session_index_find_from(
+    OlmSessionIndex * index,
+    void const * their_identity_key, size_t their_identity_key_length,
+    void * one_time_key_message, size_t message_length,
+    uint64_t * handle
+);
+
+/** Returns the number of bytes needed to store a session index */
+OLM_EXPORT size_t olm_pickle_session_index_length(
+    OlmSessionIndex const * index
+);
+
+/** Stores a session index as a base64 string. Encrypts the index using the
+ * supplied key. Returns the length of the pickled index on success. Returns
+ * olm_error() on failure. If the pickle output buffer is smaller than
+ * olm_pickle_session_index_length() then olm_session_index_last_error() will
+ * be "OUTPUT_BUFFER_TOO_SMALL" */
+OLM_EXPORT size_t olm_pickle_session_index(
+    OlmSessionIndex * index,
+    void const * key, size_t key_length,
+    void * pickled, size_t pickled_length
+);
+
+/** The same as olm_pickle_session_index, using a pickle key from
+ * olm_pickle_key() */
+OLM_EXPORT size_t olm_pickle_session_index_with_key(
+    OlmSessionIndex * index,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
+/** Loads a session index from a pickled base64 string, replacing the sessions
+ * in it. Decrypts the index using the supplied key. Returns olm_error() on
+ * failure. If the key doesn't match the one used to encrypt the index then
+ * olm_session_index_last_error() will be "BAD_ACCOUNT_KEY". If the base64
+ * couldn't be decoded then olm_session_index_last_error() will be
+ * "INVALID_BASE64". If the index holds more sessions than the capacity of
+ * this one then olm_session_index_last_error() will be
+ * "OUTPUT_BUFFER_TOO_SMALL". The input pickled buffer is destroyed */
+OLM_EXPORT size_t olm_unpickle_session_index(
+    OlmSessionIndex * index,
+    void const * key, size_t key_length,
+    void * pickled, size_t pickled_length
+);
+
+/** The same as olm_unpickle_session_index, using a pickle key from
+ * olm_pickle_key() */
+OLM_EXPORT size_t olm_unpickle_session_index_with_key(
+    OlmSessionIndex * index,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
 /** The type of the next message that olm_encrypt() will return. Returns
  * OLM_MESSAGE_TYPE_PRE_KEY if the message will be a PRE_KEY message.
  * Returns OLM_MESSAGE_TYPE_MESSAGE if the message will be a normal message.
@@ -520,6 +793,23 @@ OLM_EXPORT size_t olm_ed25519_verify(
     void * signature, size_t signature_length
 );
 
+/** Verify count ed25519 signatures, which is faster than calling
+ * olm_ed25519_verify for each of them. The keys, messages and signatures are
+ * given as arrays of count pointers, with arrays of their lengths. As with
+ * olm_ed25519_verify, the keys and signatures are base64 encoded, and the
+ * signatures are decoded in place. Sets results[i] to 1 if the i-th signature
+ * is valid and to 0 if it isn't, or if its key or signature couldn't be
+ * decoded. Returns the number of valid signatures. A signature is accepted
+ * exactly when olm_ed25519_verify would accept it. */
+OLM_EXPORT size_t olm_ed25519_verify_batch(
+    OlmUtility * utility,
+    size_t count,
+    void const * const * keys, size_t const * key_lengths,
+    void const * const * messages, size_t const * message_lengths,
+    void * const * signatures, size_t const * signature_lengths,
+    uint8_t * results
+);
+
 #ifdef __cplusplus
 }
 #endif
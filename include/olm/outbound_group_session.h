@@ -19,6 +19,7 @@
 #include <stdint.h>
 
 #include "olm/error.h"
+#include "olm/pickle_key.h"
 
 #include "olm/olm_export.h"
 
@@ -94,6 +95,26 @@ OLM_EXPORT size_t olm_unpickle_outbound_group_session(
     void * pickled, size_t pickled_length
 );
 
+/**
+ * The same as olm_pickle_outbound_group_session, using a pickle key from
+ * olm_pickle_key()
+ */
+OLM_EXPORT size_t olm_pickle_outbound_group_session_with_key(
+    OlmOutboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
+/**
+ * The same as olm_unpickle_outbound_group_session, using a pickle key from
+ * olm_pickle_key()
+ */
+OLM_EXPORT size_t olm_unpickle_outbound_group_session_with_key(
+    OlmOutboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+);
+
 
 /** The number of random bytes needed to create an outbound group session */
 OLM_EXPORT size_t olm_init_outbound_group_session_random_length(
@@ -130,6 +151,30 @@ OLM_EXPORT size_t olm_group_encrypt(
     uint8_t * message, size_t message_length
 );
 
+/**
+ * Encrypt count plain-texts, which is faster than calling olm_group_encrypt
+ * for each of them. The plain-texts and message buffers are given as arrays
+ * of count pointers and lengths. The messages are the same as calling
+ * olm_group_encrypt for each plain-text in turn, and message_lengths[i] is
+ * set to the length of the i-th message.
+ *
+ * Each message buffer must be long enough for the message at its index.
+ * olm_group_encrypt_message_length() gives the length for the first message;
+ * later ones can be up to 6 bytes longer, as their message index takes more
+ * bytes to encode.
+ *
+ * Returns count, or olm_error() on failure, in which case nothing is
+ * encrypted. On failure last_error will be set with an error code. The
+ * last_error will be OUTPUT_BUFFER_TOO_SMALL if a message buffer is too small.
+ */
+OLM_EXPORT size_t olm_group_encrypt_batch(
+    OlmOutboundGroupSession *session,
+    size_t count,
+    uint8_t const * const * plaintexts, size_t const * plaintext_lengths,
+    uint8_t * const * messages, size_t const * max_message_lengths,
+    size_t * message_lengths
+);
+
 
 /**
  * Get the number of bytes returned by olm_outbound_group_session_id()
@@ -50,6 +50,14 @@ uint8_t const * _olm_unpickle_uint32(
 );
 
 
+#define _olm_pickle_uint8_length(value) 1
+uint8_t * _olm_pickle_uint8(uint8_t * pos, uint8_t value);
+uint8_t const * _olm_unpickle_uint8(
+    uint8_t const * pos, uint8_t const * end,
+    uint8_t *value
+);
+
+
 #define _olm_pickle_bool_length(value) 1
 uint8_t * _olm_pickle_bool(uint8_t * pos, int value);
 uint8_t const * _olm_unpickle_bool(
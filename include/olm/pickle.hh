@@ -80,9 +80,14 @@ std::uint8_t const * unpickle(
 );
 
 
-template<typename T, std::size_t max_size>
+/* Lists, either List or RingList, are pickled as their length followed by
+ * their items in order */
+template<
+    template<typename, std::size_t> class ListType,
+    typename T, std::size_t max_size
+>
 std::size_t pickle_length(
-    olm::List<T, max_size> const & list
+    ListType<T, max_size> const & list
 ) {
     std::size_t length = pickle_length(std::uint32_t(list.size()));
     for (auto const & value : list) {
@@ -92,10 +97,13 @@ std::size_t pickle_length(
 }
 
 
-template<typename T, std::size_t max_size>
+template<
+    template<typename, std::size_t> class ListType,
+    typename T, std::size_t max_size
+>
 std::uint8_t * pickle(
     std::uint8_t * pos,
-    olm::List<T, max_size> const & list
+    ListType<T, max_size> const & list
 ) {
     pos = pickle(pos, std::uint32_t(list.size()));
     for (auto const & value : list) {
@@ -105,10 +113,13 @@ std::uint8_t * pickle(
 }
 
 
-template<typename T, std::size_t max_size>
+template<
+    template<typename, std::size_t> class ListType,
+    typename T, std::size_t max_size
+>
 std::uint8_t const * unpickle(
     std::uint8_t const * pos, std::uint8_t const * end,
-    olm::List<T, max_size> & list
+    ListType<T, max_size> & list
 ) {
     std::uint32_t size;
 
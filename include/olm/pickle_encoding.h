@@ -21,7 +21,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "olm/cipher.h"
 #include "olm/error.h"
+#include "olm/pickle_key.h"
 
 // Note: exports in this file are only for unit tests.  Nobody else should be
 // using this externally
@@ -31,6 +33,18 @@
 extern "C" {
 #endif
 
+struct OlmPickleKey {
+    /** the keys the pickle cipher derives from the pickle key */
+    struct _olm_cipher_aes_sha_256_keys keys;
+};
+
+/**
+ * Derive the keys for encrypting pickles with the given key.
+ */
+OLM_EXPORT void _olm_pickle_key_init(
+    OlmPickleKey * pickle_key,
+    uint8_t const * key, size_t key_length
+);
 
 /**
  * Get the number of bytes needed to encode a pickle of the length given
@@ -60,6 +74,14 @@ OLM_EXPORT size_t _olm_enc_output(
     uint8_t *pickle, size_t raw_length
 );
 
+/**
+ * The same as _olm_enc_output, with keys already derived from the pickle key.
+ */
+OLM_EXPORT size_t _olm_enc_output_with_key(
+    OlmPickleKey const * pickle_key,
+    uint8_t *pickle, size_t raw_length
+);
+
 /**
  * Decode and decrypt the given pickle in-situ.
  *
@@ -72,6 +94,44 @@ OLM_EXPORT size_t _olm_enc_input(
     enum OlmErrorCode * last_error
 );
 
+/**
+ * The same as _olm_enc_input, with keys already derived from the pickle key.
+ */
+OLM_EXPORT size_t _olm_enc_input_with_key(
+    OlmPickleKey const * pickle_key,
+    uint8_t * input, size_t b64_length,
+    enum OlmErrorCode * last_error
+);
+
+/**
+ * Get the number of bytes needed for a pickle of the length given, encrypted
+ * but not base64-encoded
+ */
+OLM_EXPORT size_t _olm_enc_output_binary_length(size_t raw_length);
+
+/**
+ * Encrypt the given pickle in-situ, without base64-encoding it. The raw
+ * pickle should have been written to the start of the buffer.
+ *
+ * Returns the number of bytes in the encrypted pickle.
+ */
+OLM_EXPORT size_t _olm_enc_output_binary_with_key(
+    OlmPickleKey const * pickle_key,
+    uint8_t *pickle, size_t raw_length
+);
+
+/**
+ * Decrypt the given pickle from _olm_enc_output_binary_with_key in-situ.
+ *
+ * Returns the number of bytes in the decrypted pickle, or olm_error() on
+ * error, in which case *last_error will be updated, if last_error is
+ * non-NULL.
+ */
+OLM_EXPORT size_t _olm_enc_input_binary_with_key(
+    OlmPickleKey const * pickle_key,
+    uint8_t * input, size_t enc_length,
+    enum OlmErrorCode * last_error
+);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,57 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OLM_PICKLE_KEY_H_
+#define OLM_PICKLE_KEY_H_
+
+#include <stddef.h>
+
+#include "olm/olm_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A pickle key with the encryption keys already derived from it.
+ *
+ * Pickling or unpickling with a key derives an AES key, HMAC key and IV from
+ * it each time. Applications that pickle many objects with the same key can
+ * derive them once into an OlmPickleKey and use the olm_pickle_*_with_key and
+ * olm_unpickle_*_with_key functions instead. The pickles are the same as the
+ * ones made with the key itself, so either kind of function can read them.
+ */
+typedef struct OlmPickleKey OlmPickleKey;
+
+/** The size of a pickle key object in bytes */
+OLM_EXPORT size_t olm_pickle_key_size(void);
+
+/** Initialise a pickle key object using the supplied memory, deriving the
+ * encryption keys from the supplied key. The supplied memory must be at least
+ * olm_pickle_key_size() bytes */
+OLM_EXPORT OlmPickleKey * olm_pickle_key(
+    void * memory,
+    void const * key, size_t key_length
+);
+
+/** Clears the memory used to back this pickle key */
+OLM_EXPORT size_t olm_clear_pickle_key(
+    OlmPickleKey * pickle_key
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* OLM_PICKLE_KEY_H_ */
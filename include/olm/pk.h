@@ -20,6 +20,7 @@
 #include <stdint.h>
 
 #include "olm/error.h"
+#include "olm/pickle_key.h"
 
 #include "olm/olm_export.h"
 
@@ -190,6 +191,23 @@ OLM_EXPORT size_t olm_unpickle_pk_decryption(
     void *pubkey, size_t pubkey_length
 );
 
+/** The same as olm_pickle_pk_decryption, using a pickle key from
+ * olm_pickle_key() */
+OLM_EXPORT size_t olm_pickle_pk_decryption_with_key(
+    OlmPkDecryption * decryption,
+    OlmPickleKey const * pickle_key,
+    void *pickled, size_t pickled_length
+);
+
+/** The same as olm_unpickle_pk_decryption, using a pickle key from
+ * olm_pickle_key() */
+OLM_EXPORT size_t olm_unpickle_pk_decryption_with_key(
+    OlmPkDecryption * decryption,
+    OlmPickleKey const * pickle_key,
+    void *pickled, size_t pickled_length,
+    void *pubkey, size_t pubkey_length
+);
+
 /** Get the length of the plaintext that will correspond to a ciphertext of the
  * given length. */
 OLM_EXPORT size_t olm_pk_max_plaintext_length(
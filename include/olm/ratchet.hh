@@ -24,6 +24,7 @@
 #include "olm/olm_export.h"
 
 struct _olm_cipher;
+struct OlmAllocator;
 
 namespace olm {
 
@@ -66,6 +67,51 @@ struct SkippedMessageKey {
 
 static std::size_t const MAX_RECEIVER_CHAINS = 5;
 static std::size_t const MAX_SKIPPED_MESSAGE_KEYS = 40;
+static std::size_t const MAX_SKIPPED_MESSAGE_KEY_TABLE_SIZE = 0xffff;
+
+
+/**
+ * A larger store for skipped message keys, in memory supplied by the
+ * application. The keys are kept in a ring in the order that they were
+ * skipped, and the oldest is dropped to make room when it is full. Used keys
+ * leave gaps in the ring, which are closed up before dropping any. They are
+ * found through an open-addressed hash index on the ratchet key and message
+ * index, which holds one more than the key's position in the ring, or 0 for
+ * an empty slot.
+ */
+struct SkippedMessageKeyTable {
+    SkippedMessageKey * keys;
+    std::uint16_t * index;
+    std::uint32_t max_keys;
+    std::uint32_t index_slots;
+    /** the position of the oldest key in the ring */
+    std::uint32_t first;
+    /** the number of positions in use from first, including the ones for
+     * keys that have since been used and wiped */
+    std::uint32_t count;
+    /** the number of keys held */
+    std::uint32_t size;
+    /** whether the memory came from the ratchet's allocator */
+    bool allocated;
+    /** whether the memory is the room for keys in the object holding the
+     * ratchet, in which case keys and index are set again from the ratchet's
+     * embedded_keys_offset before they are used */
+    bool embedded;
+
+    /** Whether the key at the given position in the ring is still held,
+     * rather than having been used. */
+    bool holds(std::size_t pos) const;
+};
+
+
+/**
+ * Memory for a skipped message key table with room for the keys of the latest
+ * MAX_SKIPPED_MESSAGE_KEYS skipped messages.
+ */
+struct SkippedMessageKeyStorage {
+    SkippedMessageKey keys[MAX_SKIPPED_MESSAGE_KEYS];
+    std::uint16_t index[2 * MAX_SKIPPED_MESSAGE_KEYS];
+};
 
 
 struct KdfInfo {
@@ -76,13 +122,21 @@ struct KdfInfo {
 };
 
 
-struct OLM_EXPORT Ratchet {
+/**
+ * A ratchet without room in the object for skipped message keys. It keeps
+ * them in memory that it is given, or that it gets from its allocator, or in
+ * room in the object holding it, and otherwise keeps none.
+ */
+struct OLM_EXPORT CompactRatchet {
 
-    Ratchet(
+    CompactRatchet(
         KdfInfo const & kdf_info,
         _olm_cipher const *ratchet_cipher
     );
 
+    CompactRatchet(CompactRatchet const &) = delete;
+    CompactRatchet & operator=(CompactRatchet const &) = delete;
+
     /** A some strings identifying the application to feed into the KDF. */
     KdfInfo const & kdf_info;
 
@@ -104,11 +158,55 @@ struct OLM_EXPORT Ratchet {
     /** The receiver chain is used to decrypt received messages. We store the
      * last few chains so we can decrypt any out of order messages we haven't
      * received yet. */
-    List<ReceiverChain, MAX_RECEIVER_CHAINS> receiver_chains;
+    RingList<ReceiverChain, MAX_RECEIVER_CHAINS> receiver_chains;
+
+    /** The message keys we've skipped over when advancing the receiver
+     * chain. The table has no memory until it is given some, or until it is
+     * needed if there is an allocator; without memory no keys are kept. Use
+     * skipped_message_keys() to read it from outside the ratchet. */
+    SkippedMessageKeyTable skipped_message_key_table;
+
+    /** If not zero, the offset in bytes from this ratchet to room for
+     * MAX_SKIPPED_MESSAGE_KEYS skipped message keys in the object holding it,
+     * which the table uses unless it is given other memory. This is an offset
+     * rather than a pointer so that it stays right if the object is moved. */
+    std::uint32_t embedded_keys_offset;
+
+    /** If not null, used to allocate memory for the keys of the latest
+     * MAX_SKIPPED_MESSAGE_KEYS skipped messages when there are any to keep
+     * and the table has no memory. The memory is freed again once the keys
+     * have all been used. */
+    OlmAllocator const * allocator;
+
+    /** The number of bytes that each key in a skipped message key table
+     * takes. */
+    static std::size_t skipped_message_key_table_entry_size();
+
+    /** Keep skipped message keys in room in the object holding the ratchet,
+     * unless the table is given other memory. The storage must be part of the
+     * same object as the ratchet. */
+    void set_embedded_skipped_message_keys(SkippedMessageKeyStorage & storage);
+
+    /** Use the supplied memory for the table of skipped message keys, or if
+     * memory is null the room in the object holding the ratchet if there is
+     * any, or else the allocator. The keys already skipped are moved over,
+     * newest first, as far as they fit, and the memory for the old table is
+     * wiped. The memory must be suitably aligned for a uint32_t. Returns the
+     * number of keys that the new table can hold. */
+    std::size_t set_skipped_message_key_table(
+        void * memory, std::size_t memory_length
+    );
 
-    /** List of message keys we've skipped over when advancing the receiver
-     * chain. */
-    List<SkippedMessageKey, MAX_SKIPPED_MESSAGE_KEYS> skipped_message_keys;
+    /** Wipe the skipped message keys, and free their memory if it came from
+     * the allocator, leaving the table without memory. */
+    void release_skipped_message_keys();
+
+    /** The number of skipped message keys being kept. */
+    std::size_t skipped_message_key_count() const;
+
+    /** A copy of the table of skipped message keys, pointing at the memory
+     * that holds them. */
+    SkippedMessageKeyTable skipped_message_keys() const;
 
     /** Initialise the session using a shared secret and the public part of the
      * remote's first ratchet key */
@@ -167,20 +265,36 @@ struct OLM_EXPORT Ratchet {
 };
 
 
+/**
+ * A ratchet with room in the object for the keys of the latest
+ * MAX_SKIPPED_MESSAGE_KEYS skipped messages, which it uses unless it is given
+ * other memory for them.
+ */
+struct OLM_EXPORT Ratchet : CompactRatchet {
+
+    Ratchet(
+        KdfInfo const & kdf_info,
+        _olm_cipher const *ratchet_cipher
+    );
+
+    SkippedMessageKeyStorage skipped_keys;
+};
+
+
 std::size_t pickle_length(
-    Ratchet const & value
+    CompactRatchet const & value
 );
 
 
 std::uint8_t * pickle(
     std::uint8_t * pos,
-    Ratchet const & value
+    CompactRatchet const & value
 );
 
 
 std::uint8_t const * unpickle(
     std::uint8_t const * pos, std::uint8_t const * end,
-    Ratchet & value,
+    CompactRatchet & value,
     bool includes_chain_index
 );
 
@@ -0,0 +1,58 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OLM_SCALARMULT_BASE_H_
+#define OLM_SCALARMULT_BASE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Multiplication of the base point by secret scalars, for generating keys and
+ * signing. These use the precomputed multiples of the ed25519 base point, with
+ * 64-bit field arithmetic when the compiler supports 128-bit integers. They
+ * run in constant time.
+ */
+
+/** Computes the curve25519 public key for a private key, giving the same
+ * result as curve25519_donna with the base point 9. The ed25519 base point is
+ * the same point on the birationally equivalent Edwards curve, so this is
+ * several times faster than the Montgomery ladder. */
+void _olm_curve25519_scalarmult_base(
+    uint8_t * public_key, uint8_t const * private_key
+);
+
+/** The same as ed25519_create_keypair, using the faster fixed-base
+ * multiplication where it is available. */
+void _olm_ed25519_create_keypair(
+    uint8_t * public_key, uint8_t * private_key, uint8_t const * seed
+);
+
+/** The same as ed25519_sign, using the faster fixed-base multiplication
+ * where it is available. */
+void _olm_ed25519_sign(
+    uint8_t * signature,
+    uint8_t const * message, size_t message_length,
+    uint8_t const * public_key, uint8_t const * private_key
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* OLM_SCALARMULT_BASE_H_ */
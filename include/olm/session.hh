@@ -34,11 +34,15 @@ struct OLM_EXPORT Session {
 
     Session();
 
-    Ratchet ratchet;
+    CompactRatchet ratchet;
     OlmErrorCode last_error;
 
     bool received_message;
 
+    /** Whether this is a SessionWithSkippedKeys, with room for its skipped
+     * message keys in the object. */
+    bool embedded_skipped_keys;
+
     _olm_curve25519_public_key alice_identity_key;
     _olm_curve25519_public_key alice_base_key;
     _olm_curve25519_public_key bob_one_time_key;
@@ -146,12 +150,29 @@ struct OLM_EXPORT Session {
 };
 
 
-std::size_t pickle_length(
+/**
+ * A session with room in the object for the keys of the latest
+ * MAX_SKIPPED_MESSAGE_KEYS skipped messages, as made by olm_session(). A plain
+ * Session, as made by olm_compact_session(), only keeps skipped message keys
+ * if it is given memory for them or an allocator.
+ */
+struct OLM_EXPORT SessionWithSkippedKeys : Session {
+
+    SessionWithSkippedKeys();
+
+    SessionWithSkippedKeys(SessionWithSkippedKeys const &) = delete;
+    SessionWithSkippedKeys & operator=(SessionWithSkippedKeys const &) = delete;
+
+    SkippedMessageKeyStorage skipped_keys;
+};
+
+
+OLM_EXPORT std::size_t pickle_length(
     Session const & value
 );
 
 
-std::uint8_t * pickle(
+OLM_EXPORT std::uint8_t * pickle(
     std::uint8_t * pos,
     Session const & value
 );
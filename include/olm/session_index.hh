@@ -0,0 +1,160 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OLM_SESSION_INDEX_HH_
+#define OLM_SESSION_INDEX_HH_
+
+#include "olm/crypto.h"
+#include "olm/error.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Note: exports in this file are only for unit tests.  Nobody else should be
+// using this externally
+#include "olm/olm_export.h"
+
+namespace olm {
+
+struct Session;
+
+/** The most sessions that a session index can hold */
+static const std::size_t MAX_SESSION_INDEX_CAPACITY = 1 << 24;
+
+/** The length of the random key for the hash of the session keys */
+static const std::size_t SESSION_INDEX_HASH_KEY_LENGTH = 32;
+
+/** The keys that identify an inbound session, and the application's handle
+ * for it */
+struct SessionIndexEntry {
+    _olm_curve25519_public_key alice_identity_key;
+    _olm_curve25519_public_key alice_base_key;
+    _olm_curve25519_public_key bob_one_time_key;
+    std::uint64_t handle;
+};
+
+
+/**
+ * An index from the keys of sessions to handles chosen by the application, so
+ * that the session a pre-key message is for can be found without checking it
+ * against every session.
+ *
+ * The entries, and a hash index of them, follow the object in the memory that
+ * it is made in, which must be at least memory_length(capacity) bytes. The
+ * entries are kept together at the start, so that removing a session moves the
+ * last entry into its place. They are found from where the object is, so the
+ * memory can be copied or moved as a whole.
+ */
+struct OLM_EXPORT SessionIndex {
+
+    /** The number of bytes of memory needed for an index of up to capacity
+     * sessions */
+    static std::size_t memory_length(std::size_t capacity);
+
+    /** Start an empty index in memory of at least memory_length(capacity)
+     * bytes. The capacity must be between 1 and MAX_SESSION_INDEX_CAPACITY.
+     * The hash_key is SESSION_INDEX_HASH_KEY_LENGTH random bytes, which key the
+     * hash of the session keys so that senders can't choose keys that collide
+     * in the index. */
+    SessionIndex(std::size_t capacity, std::uint8_t const * hash_key);
+
+    OlmErrorCode last_error;
+
+    std::uint32_t capacity;
+    std::uint32_t count;
+    std::uint32_t index_slots;
+    std::uint8_t hash_key[SESSION_INDEX_HASH_KEY_LENGTH];
+
+    /** Add a session to the index, or change the handle of a session that is
+     * already in it. Returns std::size_t(-1) on failure. On failure last_error
+     * will be set with an error code. The last_error will be
+     * OUTPUT_BUFFER_TOO_SMALL if the index is full. */
+    std::size_t insert(Session const & session, std::uint64_t handle);
+
+    /** Add a session to the index by its keys */
+    std::size_t insert(
+        std::uint8_t const * identity_key,
+        std::uint8_t const * base_key,
+        std::uint8_t const * one_time_key,
+        std::uint64_t handle
+    );
+
+    /** Remove a session from the index. Returns false if it wasn't there. */
+    bool remove(Session const & session);
+
+    /** Find the session that a pre-key message is for, decoding the message
+     * once. Checks the same keys as Session::matches_inbound_session(), and
+     * returns false if there isn't a matching session or if the message can't
+     * be decoded. As with Session::matches_inbound_session(), a message
+     * without an identity key only matches if their_identity_key is given. */
+    bool find(
+        _olm_curve25519_public_key const * their_identity_key,
+        std::uint8_t const * pre_key_message, std::size_t message_length,
+        std::uint64_t & handle
+    ) const;
+
+    /** Remove all of the sessions. The hash key is kept. */
+    void clear();
+
+    /** The slot of the hash index holding the entry with the given keys, or
+     * std::size_t(-1) if there isn't one */
+    std::size_t find_slot(
+        std::uint8_t const * identity_key,
+        std::uint8_t const * base_key,
+        std::uint8_t const * one_time_key
+    ) const;
+
+    /** Empty a slot of the hash index, moving later entries back to keep them
+     * reachable */
+    void empty_slot(std::size_t slot);
+
+private:
+    /** The entries, which follow the object */
+    SessionIndexEntry * entries();
+    SessionIndexEntry const * entries() const;
+
+    /** Slots of the hash index, which follow the entries: 0 if the slot is
+     * empty, otherwise the position of the entry in entries() plus one */
+    std::uint32_t * index();
+    std::uint32_t const * index() const;
+
+    friend std::size_t pickle_length(SessionIndex const & value);
+    friend std::uint8_t * pickle(
+        std::uint8_t * pos, SessionIndex const & value
+    );
+};
+
+
+OLM_EXPORT std::size_t pickle_length(
+    SessionIndex const & value
+);
+
+
+OLM_EXPORT std::uint8_t * pickle(
+    std::uint8_t * pos,
+    SessionIndex const & value
+);
+
+
+/** Replaces the contents of the index with the pickled sessions. Fails with
+ * OUTPUT_BUFFER_TOO_SMALL if there are more of them than the index can hold. */
+OLM_EXPORT std::uint8_t const * unpickle(
+    std::uint8_t const * pos, std::uint8_t const * end,
+    SessionIndex & value
+);
+
+
+} // namespace olm
+
+#endif /* OLM_SESSION_INDEX_HH_ */
@@ -0,0 +1,54 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The SHA-256 compression function using the CPU's SHA instructions. The
+ * hashing in crypto.cpp uses it in place of the portable crypto-algorithms
+ * code whenever _olm_sha256_hw_active() says so.
+ */
+
+#ifndef OLM_SHA256_HW_H_
+#define OLM_SHA256_HW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Returns non-zero if the CPU supports the hardware implementation */
+int _olm_sha256_hw_supported(void);
+
+/** Returns non-zero if the hardware implementation is supported and has not
+ * been disabled with _olm_sha256_hw_enable() */
+int _olm_sha256_hw_active(void);
+
+/** Enables or disables the hardware implementation. Returns the previous
+ * setting. */
+int _olm_sha256_hw_enable(int enable);
+
+/** Run the compression function over a number of consecutive 64 byte blocks,
+ * updating the eight state words in place. Must only be called if
+ * _olm_sha256_hw_supported() returns non-zero. */
+void _olm_sha256_hw_compress(
+    uint32_t state[8],
+    uint8_t const *data, size_t blocks
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* OLM_SHA256_HW_H_ */
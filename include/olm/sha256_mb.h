@@ -0,0 +1,56 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Multi-buffer SHA-256: runs the compression function for several
+ * independent hashes side by side in the lanes of a SIMD register (8 lanes
+ * with AVX2, 4 with NEON).
+ */
+
+#ifndef OLM_SHA256_MB_H_
+#define OLM_SHA256_MB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Returns the number of lanes the multi-buffer implementation processes at
+ * once, or 0 if it can't be used on this CPU. */
+size_t _olm_sha256_mb_supported(void);
+
+/** Returns non-zero if the multi-buffer implementation is supported and has
+ * not been disabled with _olm_sha256_mb_enable() */
+int _olm_sha256_mb_active(void);
+
+/** Enables or disables the multi-buffer implementation. Returns the previous
+ * setting. */
+int _olm_sha256_mb_enable(int enable);
+
+/** Run the compression function over one 64 byte block for each of count
+ * independent hashes, updating each set of eight state words in place. Must
+ * only be called if _olm_sha256_mb_supported() returns non-zero. */
+void _olm_sha256_mb_compress(
+    uint32_t * const * states,
+    uint8_t const * const * blocks,
+    size_t count
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* OLM_SHA256_MB_H_ */
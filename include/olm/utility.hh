@@ -22,6 +22,7 @@
 #include <cstdint>
 
 struct _olm_ed25519_public_key;
+struct _olm_ed25519_verify_item;
 
 namespace olm {
 
@@ -53,6 +54,15 @@ struct Utility {
         std::uint8_t const * signature, std::size_t signature_length
     );
 
+    /** Verify several ed25519 signatures at once, which is faster than
+     * verifying them one at a time. Sets results[i] to 1 if the i-th
+     * signature is valid and to 0 if it isn't. Returns the number of valid
+     * signatures. */
+    std::size_t ed25519_verify_batch(
+        _olm_ed25519_verify_item const * items, std::size_t count,
+        std::uint8_t * results
+    );
+
 };
 
 
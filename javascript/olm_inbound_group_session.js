@@ -107,12 +107,9 @@ InboundGroupSession.prototype['decrypt'] = restore_stack(function(
         writeAsciiToMemory(message, message_buffer, true);
 
         var max_plaintext_length = inbound_group_session_method(
-            Module['_olm_group_decrypt_max_plaintext_length']
+            Module['_olm_group_decrypt_max_plaintext_length_const']
         )(this.ptr, message_buffer, message.length);
 
-        // caculating the length destroys the input buffer, so we need to re-copy it.
-        writeAsciiToMemory(message, message_buffer, true);
-
         plaintext_buffer = malloc(max_plaintext_length + NULL_BYTE_PADDING_LENGTH);
         var message_index = stack(4);
 
@@ -210,15 +210,16 @@ class InboundGroupSession(object):
 
         byte_ciphertext = to_bytes(ciphertext)
 
-        # copy because max_plaintext_length will destroy the buffer
-        ciphertext_buffer = ffi.new("char[]", byte_ciphertext)
-
-        max_plaintext_length = lib.olm_group_decrypt_max_plaintext_length(
-            self._session, ciphertext_buffer, len(byte_ciphertext)
+        # this leaves the ciphertext as it is, so it doesn't need copying
+        max_plaintext_length = (
+            lib.olm_group_decrypt_max_plaintext_length_const(
+                self._session, ffi.from_buffer(byte_ciphertext),
+                len(byte_ciphertext)
+            )
         )
         self._check_error(max_plaintext_length)
         plaintext_buffer = ffi.new("char[]", max_plaintext_length)
-        # copy because max_plaintext_length will destroy the buffer
+        # copy because decrypting will destroy the buffer
         ciphertext_buffer = ffi.new("char[]", byte_ciphertext)
 
         message_index = ffi.new("uint32_t*")
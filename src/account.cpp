@@ -53,8 +53,7 @@ olm::OneTimeKey const * olm::Account::lookup_key(
 std::size_t olm::Account::remove_key(
     _olm_curve25519_public_key const & public_key
 ) {
-    OneTimeKey * i;
-    for (i = one_time_keys.begin(); i != one_time_keys.end(); ++i) {
+    for (auto i = one_time_keys.begin(); i != one_time_keys.end(); ++i) {
         if (olm::array_equal(i->key.public_key.public_key, public_key.public_key)) {
             std::uint32_t id = i->id;
             one_time_keys.erase(i);
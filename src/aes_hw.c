@@ -0,0 +1,398 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "olm/aes_hw.h"
+#include "olm/cpu_features.h"
+#include "olm/memory.h"
+
+#include <string.h>
+
+#include "crypto-algorithms/aes.h"
+
+#if defined(OLM_CPU_X86) && (defined(__GNUC__) || defined(_MSC_VER))
+#  define OLM_AES_HW_X86 1
+#  include <emmintrin.h>
+#  include <wmmintrin.h>
+#  if defined(__GNUC__)
+#    define TARGET_AES __attribute__((target("aes,sse2")))
+#  else
+#    define TARGET_AES
+#  endif
+#elif defined(OLM_CPU_AARCH64) \
+    && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#  define OLM_AES_HW_ARM 1
+#  include <arm_neon.h>
+#endif
+
+#define AES_KEY_SCHEDULE_WORDS (4 * OLM_AES256_ROUND_KEYS)
+
+/* Use the portable key expansion from crypto-algorithms, and convert its
+ * big-endian words into the byte order that the instructions expect. The key
+ * schedule is only computed once per message so there is little to gain from
+ * doing this with the hardware.
+ */
+static void expand_key(
+    struct _olm_aes256_hw_key *schedule,
+    uint8_t const *key
+) {
+    WORD words[AES_KEY_SCHEDULE_WORDS];
+    int i;
+
+    aes_key_setup(key, words, 256);
+    for (i = 0; i < AES_KEY_SCHEDULE_WORDS; i++) {
+        uint8_t *pos = &schedule->round_keys[i / 4][4 * (i % 4)];
+        pos[0] = (uint8_t)(words[i] >> 24);
+        pos[1] = (uint8_t)(words[i] >> 16);
+        pos[2] = (uint8_t)(words[i] >> 8);
+        pos[3] = (uint8_t)(words[i]);
+    }
+    _olm_unset(words, sizeof(words));
+}
+
+int _olm_aes256_hw_supported(void) {
+#if defined(OLM_AES_HW_X86) || defined(OLM_AES_HW_ARM)
+    return _olm_cpu_has_aes();
+#else
+    return 0;
+#endif
+}
+
+void _olm_aes256_hw_setup_encrypt(
+    struct _olm_aes256_hw_key *schedule,
+    uint8_t const *key
+) {
+    expand_key(schedule, key);
+}
+
+/* Decrypt PARALLEL_BLOCKS blocks at a time. Unlike encryption, CBC
+ * decryption has no dependency between blocks, so interleaving the rounds of
+ * several blocks hides the latency of the AES instructions.
+ */
+#define PARALLEL_BLOCKS 8
+
+#define FOR_EACH_LANE(OP) \
+    OP(0) OP(1) OP(2) OP(3) OP(4) OP(5) OP(6) OP(7)
+
+#if defined(OLM_AES_HW_X86)
+
+#define LOAD(p) _mm_loadu_si128((__m128i const *)(p))
+#define STORE(p, v) _mm_storeu_si128((__m128i *)(p), (v))
+
+TARGET_AES
+void _olm_aes256_hw_setup_decrypt(
+    struct _olm_aes256_hw_key *schedule,
+    uint8_t const *key
+) {
+    /* The decryption instructions implement the "equivalent inverse cipher",
+     * which needs the round keys in reverse order with InvMixColumns applied
+     * to all but the first and last.
+     */
+    struct _olm_aes256_hw_key forward;
+    int i;
+
+    expand_key(&forward, key);
+    memcpy(
+        schedule->round_keys[0],
+        forward.round_keys[OLM_AES256_ROUND_KEYS - 1],
+        OLM_AES_BLOCK_LENGTH
+    );
+    for (i = 1; i < OLM_AES256_ROUND_KEYS - 1; i++) {
+        STORE(
+            schedule->round_keys[i],
+            _mm_aesimc_si128(
+                LOAD(forward.round_keys[OLM_AES256_ROUND_KEYS - 1 - i])
+            )
+        );
+    }
+    memcpy(
+        schedule->round_keys[OLM_AES256_ROUND_KEYS - 1],
+        forward.round_keys[0],
+        OLM_AES_BLOCK_LENGTH
+    );
+    _olm_unset(&forward, sizeof(forward));
+}
+
+TARGET_AES
+void _olm_aes256_hw_encrypt_cbc(
+    struct _olm_aes256_hw_key const *schedule,
+    uint8_t *iv,
+    uint8_t const *input, size_t blocks,
+    uint8_t *output
+) {
+    __m128i rk[OLM_AES256_ROUND_KEYS];
+    __m128i state = LOAD(iv);
+    int i;
+
+    for (i = 0; i < OLM_AES256_ROUND_KEYS; i++) {
+        rk[i] = LOAD(schedule->round_keys[i]);
+    }
+
+    while (blocks--) {
+        state = _mm_xor_si128(state, LOAD(input));
+        state = _mm_xor_si128(state, rk[0]);
+        for (i = 1; i < OLM_AES256_ROUND_KEYS - 1; i++) {
+            state = _mm_aesenc_si128(state, rk[i]);
+        }
+        state = _mm_aesenclast_si128(state, rk[OLM_AES256_ROUND_KEYS - 1]);
+        STORE(output, state);
+        input += OLM_AES_BLOCK_LENGTH;
+        output += OLM_AES_BLOCK_LENGTH;
+    }
+
+    STORE(iv, state);
+    _olm_unset(rk, sizeof(rk));
+}
+
+TARGET_AES
+void _olm_aes256_hw_decrypt_cbc(
+    struct _olm_aes256_hw_key const *schedule,
+    uint8_t *iv,
+    uint8_t const *input, size_t blocks,
+    uint8_t *output
+) {
+    __m128i rk[OLM_AES256_ROUND_KEYS];
+    __m128i previous = LOAD(iv);
+    int i;
+
+    for (i = 0; i < OLM_AES256_ROUND_KEYS; i++) {
+        rk[i] = LOAD(schedule->round_keys[i]);
+    }
+
+    while (blocks >= PARALLEL_BLOCKS) {
+        __m128i s0, s1, s2, s3, s4, s5, s6, s7;
+        __m128i next_previous;
+
+#define FIRST_ROUND(n) \
+        s##n = _mm_xor_si128(LOAD(input + n * OLM_AES_BLOCK_LENGTH), rk[0]);
+#define MIDDLE_ROUND(n) s##n = _mm_aesdec_si128(s##n, rk[i]);
+#define LAST_ROUND(n) \
+        s##n = _mm_aesdeclast_si128(s##n, rk[OLM_AES256_ROUND_KEYS - 1]);
+
+        FOR_EACH_LANE(FIRST_ROUND)
+        for (i = 1; i < OLM_AES256_ROUND_KEYS - 1; i++) {
+            FOR_EACH_LANE(MIDDLE_ROUND)
+        }
+        FOR_EACH_LANE(LAST_ROUND)
+
+#undef FIRST_ROUND
+#undef MIDDLE_ROUND
+#undef LAST_ROUND
+
+        /* XOR each block with the ciphertext before it. We work backwards,
+         * reloading the ciphertext as we go, so that this also works when
+         * decrypting in place.
+         */
+        next_previous = LOAD(input + 7 * OLM_AES_BLOCK_LENGTH);
+
+#define CHAIN(n, p) STORE( \
+            output + n * OLM_AES_BLOCK_LENGTH, \
+            _mm_xor_si128(s##n, LOAD(input + p * OLM_AES_BLOCK_LENGTH)) \
+        );
+        CHAIN(7, 6) CHAIN(6, 5) CHAIN(5, 4) CHAIN(4, 3)
+        CHAIN(3, 2) CHAIN(2, 1) CHAIN(1, 0)
+#undef CHAIN
+        STORE(output, _mm_xor_si128(s0, previous));
+
+        previous = next_previous;
+        input += PARALLEL_BLOCKS * OLM_AES_BLOCK_LENGTH;
+        output += PARALLEL_BLOCKS * OLM_AES_BLOCK_LENGTH;
+        blocks -= PARALLEL_BLOCKS;
+    }
+
+    while (blocks--) {
+        __m128i block = LOAD(input);
+        __m128i state = _mm_xor_si128(block, rk[0]);
+        for (i = 1; i < OLM_AES256_ROUND_KEYS - 1; i++) {
+            state = _mm_aesdec_si128(state, rk[i]);
+        }
+        state = _mm_aesdeclast_si128(state, rk[OLM_AES256_ROUND_KEYS - 1]);
+        STORE(output, _mm_xor_si128(state, previous));
+        previous = block;
+        input += OLM_AES_BLOCK_LENGTH;
+        output += OLM_AES_BLOCK_LENGTH;
+    }
+
+    STORE(iv, previous);
+    _olm_unset(rk, sizeof(rk));
+}
+
+#elif defined(OLM_AES_HW_ARM)
+
+/* AESE/AESD perform AddRoundKey before SubBytes/ShiftRows, so the last round
+ * key is applied with a plain XOR.
+ */
+
+void _olm_aes256_hw_setup_decrypt(
+    struct _olm_aes256_hw_key *schedule,
+    uint8_t const *key
+) {
+    struct _olm_aes256_hw_key forward;
+    int i;
+
+    expand_key(&forward, key);
+    memcpy(
+        schedule->round_keys[0],
+        forward.round_keys[OLM_AES256_ROUND_KEYS - 1],
+        OLM_AES_BLOCK_LENGTH
+    );
+    for (i = 1; i < OLM_AES256_ROUND_KEYS - 1; i++) {
+        vst1q_u8(
+            schedule->round_keys[i],
+            vaesimcq_u8(
+                vld1q_u8(forward.round_keys[OLM_AES256_ROUND_KEYS - 1 - i])
+            )
+        );
+    }
+    memcpy(
+        schedule->round_keys[OLM_AES256_ROUND_KEYS - 1],
+        forward.round_keys[0],
+        OLM_AES_BLOCK_LENGTH
+    );
+    _olm_unset(&forward, sizeof(forward));
+}
+
+void _olm_aes256_hw_encrypt_cbc(
+    struct _olm_aes256_hw_key const *schedule,
+    uint8_t *iv,
+    uint8_t const *input, size_t blocks,
+    uint8_t *output
+) {
+    uint8x16_t rk[OLM_AES256_ROUND_KEYS];
+    uint8x16_t state = vld1q_u8(iv);
+    int i;
+
+    for (i = 0; i < OLM_AES256_ROUND_KEYS; i++) {
+        rk[i] = vld1q_u8(schedule->round_keys[i]);
+    }
+
+    while (blocks--) {
+        state = veorq_u8(state, vld1q_u8(input));
+        for (i = 0; i < OLM_AES256_ROUND_KEYS - 2; i++) {
+            state = vaesmcq_u8(vaeseq_u8(state, rk[i]));
+        }
+        state = vaeseq_u8(state, rk[OLM_AES256_ROUND_KEYS - 2]);
+        state = veorq_u8(state, rk[OLM_AES256_ROUND_KEYS - 1]);
+        vst1q_u8(output, state);
+        input += OLM_AES_BLOCK_LENGTH;
+        output += OLM_AES_BLOCK_LENGTH;
+    }
+
+    vst1q_u8(iv, state);
+    _olm_unset(rk, sizeof(rk));
+}
+
+void _olm_aes256_hw_decrypt_cbc(
+    struct _olm_aes256_hw_key const *schedule,
+    uint8_t *iv,
+    uint8_t const *input, size_t blocks,
+    uint8_t *output
+) {
+    uint8x16_t rk[OLM_AES256_ROUND_KEYS];
+    uint8x16_t previous = vld1q_u8(iv);
+    int i;
+
+    for (i = 0; i < OLM_AES256_ROUND_KEYS; i++) {
+        rk[i] = vld1q_u8(schedule->round_keys[i]);
+    }
+
+    while (blocks >= PARALLEL_BLOCKS) {
+        uint8x16_t s0, s1, s2, s3, s4, s5, s6, s7;
+        uint8x16_t next_previous;
+
+#define LOAD_LANE(n) s##n = vld1q_u8(input + n * OLM_AES_BLOCK_LENGTH);
+#define MIDDLE_ROUND(n) s##n = vaesimcq_u8(vaesdq_u8(s##n, rk[i]));
+#define LAST_ROUND(n) \
+        s##n = veorq_u8( \
+            vaesdq_u8(s##n, rk[OLM_AES256_ROUND_KEYS - 2]), \
+            rk[OLM_AES256_ROUND_KEYS - 1] \
+        );
+
+        FOR_EACH_LANE(LOAD_LANE)
+        for (i = 0; i < OLM_AES256_ROUND_KEYS - 2; i++) {
+            FOR_EACH_LANE(MIDDLE_ROUND)
+        }
+        FOR_EACH_LANE(LAST_ROUND)
+
+#undef LOAD_LANE
+#undef MIDDLE_ROUND
+#undef LAST_ROUND
+
+        next_previous = vld1q_u8(input + 7 * OLM_AES_BLOCK_LENGTH);
+
+#define CHAIN(n, p) vst1q_u8( \
+            output + n * OLM_AES_BLOCK_LENGTH, \
+            veorq_u8(s##n, vld1q_u8(input + p * OLM_AES_BLOCK_LENGTH)) \
+        );
+        CHAIN(7, 6) CHAIN(6, 5) CHAIN(5, 4) CHAIN(4, 3)
+        CHAIN(3, 2) CHAIN(2, 1) CHAIN(1, 0)
+#undef CHAIN
+        vst1q_u8(output, veorq_u8(s0, previous));
+
+        previous = next_previous;
+        input += PARALLEL_BLOCKS * OLM_AES_BLOCK_LENGTH;
+        output += PARALLEL_BLOCKS * OLM_AES_BLOCK_LENGTH;
+        blocks -= PARALLEL_BLOCKS;
+    }
+
+    while (blocks--) {
+        uint8x16_t block = vld1q_u8(input);
+        uint8x16_t state = block;
+        for (i = 0; i < OLM_AES256_ROUND_KEYS - 2; i++) {
+            state = vaesimcq_u8(vaesdq_u8(state, rk[i]));
+        }
+        state = vaesdq_u8(state, rk[OLM_AES256_ROUND_KEYS - 2]);
+        state = veorq_u8(state, rk[OLM_AES256_ROUND_KEYS - 1]);
+        vst1q_u8(output, veorq_u8(state, previous));
+        previous = block;
+        input += OLM_AES_BLOCK_LENGTH;
+        output += OLM_AES_BLOCK_LENGTH;
+    }
+
+    vst1q_u8(iv, previous);
+    _olm_unset(rk, sizeof(rk));
+}
+
+#else
+
+/* No hardware support on this platform: _olm_aes256_hw_supported() always
+ * returns 0, so these are never called.
+ */
+
+void _olm_aes256_hw_setup_decrypt(
+    struct _olm_aes256_hw_key *schedule,
+    uint8_t const *key
+) {
+    expand_key(schedule, key);
+}
+
+void _olm_aes256_hw_encrypt_cbc(
+    struct _olm_aes256_hw_key const *schedule,
+    uint8_t *iv,
+    uint8_t const *input, size_t blocks,
+    uint8_t *output
+) {
+    (void)schedule; (void)iv; (void)input; (void)blocks; (void)output;
+}
+
+void _olm_aes256_hw_decrypt_cbc(
+    struct _olm_aes256_hw_key const *schedule,
+    uint8_t *iv,
+    uint8_t const *input, size_t blocks,
+    uint8_t *output
+) {
+    (void)schedule; (void)iv; (void)input; (void)blocks; (void)output;
+}
+
+#endif
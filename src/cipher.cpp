@@ -21,34 +21,6 @@ const std::size_t HMAC_KEY_LENGTH = 32;
 
 namespace {
 
-struct DerivedKeys {
-    _olm_aes256_key aes_key;
-    std::uint8_t mac_key[HMAC_KEY_LENGTH];
-    _olm_aes256_iv aes_iv;
-};
-
-
-static void derive_keys(
-    std::uint8_t const * kdf_info, std::size_t kdf_info_length,
-    std::uint8_t const * key, std::size_t key_length,
-    DerivedKeys & keys
-) {
-    std::uint8_t derived_secrets[
-        AES256_KEY_LENGTH + HMAC_KEY_LENGTH + AES256_IV_LENGTH
-    ];
-    _olm_crypto_hkdf_sha256(
-        key, key_length,
-        nullptr, 0,
-        kdf_info, kdf_info_length,
-        derived_secrets, sizeof(derived_secrets)
-    );
-    std::uint8_t const * pos = derived_secrets;
-    pos = olm::load_array(keys.aes_key.key, pos);
-    pos = olm::load_array(keys.mac_key, pos);
-    pos = olm::load_array(keys.aes_iv.iv, pos);
-    olm::unset(derived_secrets);
-}
-
 static const std::size_t MAC_LENGTH = 8;
 
 size_t aes_sha_256_cipher_mac_length(const struct _olm_cipher *cipher) {
@@ -76,23 +48,18 @@ size_t aes_sha_256_cipher_encrypt(
         return std::size_t(-1);
     }
 
-    struct DerivedKeys keys;
-    std::uint8_t mac[SHA256_OUTPUT_LENGTH];
-
-    derive_keys(c->kdf_info, c->kdf_info_length, key, key_length, keys);
-
-    _olm_crypto_aes_encrypt_cbc(
-        &keys.aes_key, &keys.aes_iv, plaintext, plaintext_length, ciphertext
-    );
+    struct _olm_cipher_aes_sha_256_keys keys;
+    _olm_cipher_aes_sha_256_derive_keys(c, key, key_length, &keys);
 
-    _olm_crypto_hmac_sha256(
-        keys.mac_key, HMAC_KEY_LENGTH, output, output_length - MAC_LENGTH, mac
+    std::size_t result = _olm_cipher_aes_sha_256_encrypt_with_keys(
+        &keys,
+        plaintext, plaintext_length,
+        ciphertext, ciphertext_length,
+        output, output_length
     );
 
-    std::memcpy(output + output_length - MAC_LENGTH, mac, MAC_LENGTH);
-
     olm::unset(keys);
-    return output_length;
+    return result;
 }
 
 
@@ -118,27 +85,18 @@ size_t aes_sha_256_cipher_decrypt(
 
     auto *c = reinterpret_cast<const _olm_cipher_aes_sha_256 *>(cipher);
 
-    DerivedKeys keys;
-    std::uint8_t mac[SHA256_OUTPUT_LENGTH];
-
-    derive_keys(c->kdf_info, c->kdf_info_length, key, key_length, keys);
+    struct _olm_cipher_aes_sha_256_keys keys;
+    _olm_cipher_aes_sha_256_derive_keys(c, key, key_length, &keys);
 
-    _olm_crypto_hmac_sha256(
-        keys.mac_key, HMAC_KEY_LENGTH, input, input_length - MAC_LENGTH, mac
-    );
-
-    std::uint8_t const * input_mac = input + input_length - MAC_LENGTH;
-    if (!olm::is_equal(input_mac, mac, MAC_LENGTH)) {
-        olm::unset(keys);
-        return std::size_t(-1);
-    }
-
-    std::size_t plaintext_length = _olm_crypto_aes_decrypt_cbc(
-        &keys.aes_key, &keys.aes_iv, ciphertext, ciphertext_length, plaintext
+    std::size_t result = _olm_cipher_aes_sha_256_decrypt_with_keys(
+        &keys,
+        input, input_length,
+        ciphertext, ciphertext_length,
+        plaintext, max_plaintext_length
     );
 
     olm::unset(keys);
-    return plaintext_length;
+    return result;
 }
 
 } // namespace
@@ -150,3 +108,115 @@ const struct _olm_cipher_ops _olm_cipher_aes_sha_256_ops = {
   aes_sha_256_cipher_decrypt_max_plaintext_length,
   aes_sha_256_cipher_decrypt,
 };
+
+
+void _olm_cipher_aes_sha_256_derive_keys(
+    const struct _olm_cipher_aes_sha_256 *cipher,
+    uint8_t const * key, size_t key_length,
+    struct _olm_cipher_aes_sha_256_keys *keys
+) {
+    std::uint8_t derived_secrets[
+        AES256_KEY_LENGTH + HMAC_KEY_LENGTH + AES256_IV_LENGTH
+    ];
+    _olm_crypto_hkdf_sha256(
+        key, key_length,
+        nullptr, 0,
+        cipher->kdf_info, cipher->kdf_info_length,
+        derived_secrets, sizeof(derived_secrets)
+    );
+    std::uint8_t const * pos = derived_secrets;
+    pos = olm::load_array(keys->aes_key.key, pos);
+    _olm_crypto_hmac_sha256_init(&keys->mac_key, pos, HMAC_KEY_LENGTH);
+    pos += HMAC_KEY_LENGTH;
+    pos = olm::load_array(keys->aes_iv.iv, pos);
+    olm::unset(derived_secrets);
+}
+
+
+void _olm_cipher_aes_sha_256_derive_keys_many(
+    const struct _olm_cipher_aes_sha_256 *cipher,
+    uint8_t const * const * keys, size_t key_length,
+    struct _olm_cipher_aes_sha_256_keys *derived_keys, size_t count
+) {
+    static const std::size_t GROUP = 8;
+    std::uint8_t derived_secrets[GROUP][
+        AES256_KEY_LENGTH + HMAC_KEY_LENGTH + AES256_IV_LENGTH
+    ];
+    std::uint8_t * outputs[GROUP];
+    for (std::size_t i = 0; i < GROUP; ++i) {
+        outputs[i] = derived_secrets[i];
+    }
+
+    for (std::size_t start = 0; start < count; start += GROUP) {
+        std::size_t n = count - start < GROUP ? count - start : GROUP;
+        _olm_crypto_hkdf_sha256_lanes(
+            keys + start, key_length,
+            cipher->kdf_info, cipher->kdf_info_length,
+            outputs, sizeof(derived_secrets[0]), n
+        );
+        for (std::size_t i = 0; i < n; ++i) {
+            struct _olm_cipher_aes_sha_256_keys *k = &derived_keys[start + i];
+            std::uint8_t const * pos = derived_secrets[i];
+            pos = olm::load_array(k->aes_key.key, pos);
+            _olm_crypto_hmac_sha256_init(&k->mac_key, pos, HMAC_KEY_LENGTH);
+            pos += HMAC_KEY_LENGTH;
+            pos = olm::load_array(k->aes_iv.iv, pos);
+        }
+    }
+    olm::unset(derived_secrets);
+}
+
+
+size_t _olm_cipher_aes_sha_256_encrypt_with_keys(
+    const struct _olm_cipher_aes_sha_256_keys *keys,
+    uint8_t const * plaintext, size_t plaintext_length,
+    uint8_t * ciphertext, size_t ciphertext_length,
+    uint8_t * output, size_t output_length
+) {
+    if (ciphertext_length < _olm_crypto_aes_encrypt_cbc_length(plaintext_length)
+            || output_length < MAC_LENGTH) {
+        return std::size_t(-1);
+    }
+
+    std::uint8_t mac[SHA256_OUTPUT_LENGTH];
+
+    _olm_crypto_aes_encrypt_cbc(
+        &keys->aes_key, &keys->aes_iv, plaintext, plaintext_length, ciphertext
+    );
+
+    _olm_crypto_hmac_sha256_compute(
+        &keys->mac_key, output, output_length - MAC_LENGTH, mac
+    );
+
+    std::memcpy(output + output_length - MAC_LENGTH, mac, MAC_LENGTH);
+
+    return output_length;
+}
+
+
+size_t _olm_cipher_aes_sha_256_decrypt_with_keys(
+    const struct _olm_cipher_aes_sha_256_keys *keys,
+    uint8_t const * input, size_t input_length,
+    uint8_t const * ciphertext, size_t ciphertext_length,
+    uint8_t * plaintext, size_t max_plaintext_length
+) {
+    if (max_plaintext_length < ciphertext_length
+            || input_length < MAC_LENGTH) {
+        return std::size_t(-1);
+    }
+
+    std::uint8_t mac[SHA256_OUTPUT_LENGTH];
+
+    _olm_crypto_hmac_sha256_compute(
+        &keys->mac_key, input, input_length - MAC_LENGTH, mac
+    );
+
+    std::uint8_t const * input_mac = input + input_length - MAC_LENGTH;
+    if (!olm::is_equal(input_mac, mac, MAC_LENGTH)) {
+        return std::size_t(-1);
+    }
+
+    return _olm_crypto_aes_decrypt_cbc(
+        &keys->aes_key, &keys->aes_iv, ciphertext, ciphertext_length, plaintext
+    );
+}
@@ -0,0 +1,165 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "olm/cpu_features.h"
+
+#if defined(OLM_CPU_X86)
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif
+#elif defined(OLM_CPU_AARCH64) && defined(__linux__)
+#  include <sys/auxv.h>
+#  include <asm/hwcap.h>
+#endif
+
+/* bits of the feature mask we cache */
+#define FEATURE_AES 0x01
+#define FEATURE_SHA256 0x02
+#define FEATURE_AVX2 0x04
+
+/* the cached result of the feature detection. -1 means we haven't looked
+ * yet. Racing threads all compute the same value, so there is no need for
+ * any locking.
+ */
+static volatile int cpu_features = -1;
+
+#if defined(OLM_CPU_X86)
+
+static void cpuid(unsigned int leaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, (int)leaf, 0);
+    regs[0] = (unsigned int)info[0];
+    regs[1] = (unsigned int)info[1];
+    regs[2] = (unsigned int)info[2];
+    regs[3] = (unsigned int)info[3];
+#else
+    regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* Returns the low word of XCR0, which says which register sets the OS saves
+ * on a context switch. Only valid if CPUID reports OSXSAVE. */
+static unsigned int xcr0(void) {
+#if defined(_MSC_VER)
+    return (unsigned int)_xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+#endif
+}
+
+static int detect_features(void) {
+    unsigned int regs[4];
+    unsigned int max_leaf;
+    int has_sse41;
+    int has_avx;
+    int features = 0;
+
+    cpuid(0, regs);
+    max_leaf = regs[0];
+    if (max_leaf < 1) {
+        return 0;
+    }
+
+    cpuid(1, regs);
+    /* ECX bit 25: AES-NI, EDX bit 26: SSE2 */
+    if ((regs[2] & (1u << 25)) && (regs[3] & (1u << 26))) {
+        features |= FEATURE_AES;
+    }
+    /* ECX bit 9: SSSE3, ECX bit 19: SSE4.1 */
+    has_sse41 = (regs[2] & (1u << 9)) && (regs[2] & (1u << 19));
+    /* ECX bit 27: OSXSAVE, ECX bit 28: AVX, and the OS must save the XMM and
+     * YMM registers (XCR0 bits 1 and 2) */
+    has_avx = (regs[2] & (1u << 27)) && (regs[2] & (1u << 28))
+        && (xcr0() & 0x6) == 0x6;
+
+    if (max_leaf >= 7) {
+        cpuid(7, regs);
+        /* EBX bit 29: SHA extensions */
+        if (has_sse41 && (regs[1] & (1u << 29))) {
+            features |= FEATURE_SHA256;
+        }
+        /* EBX bit 5: AVX2 */
+        if (has_avx && (regs[1] & (1u << 5))) {
+            features |= FEATURE_AVX2;
+        }
+    }
+    return features;
+}
+
+#elif defined(OLM_CPU_AARCH64)
+
+/* We only use the ARMv8 crypto instructions if the compiler was told that
+ * they are there, in which case all we need to check is that the kernel
+ * agrees.
+ */
+#if defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES)
+#  define COMPILED_FEATURE_AES FEATURE_AES
+#else
+#  define COMPILED_FEATURE_AES 0
+#endif
+#if defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2)
+#  define COMPILED_FEATURE_SHA256 FEATURE_SHA256
+#else
+#  define COMPILED_FEATURE_SHA256 0
+#endif
+
+static int detect_features(void) {
+    int features = COMPILED_FEATURE_AES | COMPILED_FEATURE_SHA256;
+#if defined(__linux__) && defined(HWCAP_AES) && defined(HWCAP_SHA2)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    if (!(hwcap & HWCAP_AES)) {
+        features &= ~FEATURE_AES;
+    }
+    if (!(hwcap & HWCAP_SHA2)) {
+        features &= ~FEATURE_SHA256;
+    }
+#endif
+    return features;
+}
+
+#else
+
+static int detect_features(void) {
+    return 0;
+}
+
+#endif
+
+static int get_features(void) {
+    int features = cpu_features;
+    if (features < 0) {
+        features = detect_features();
+        cpu_features = features;
+    }
+    return features;
+}
+
+int _olm_cpu_has_aes(void) {
+    return (get_features() & FEATURE_AES) != 0;
+}
+
+int _olm_cpu_has_sha256(void) {
+    return (get_features() & FEATURE_SHA256) != 0;
+}
+
+int _olm_cpu_has_avx2(void) {
+    return (get_features() & FEATURE_AVX2) != 0;
+}
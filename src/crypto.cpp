@@ -13,8 +13,14 @@
  * limitations under the License.
  */
 #include "olm/crypto.h"
+#include "olm/aes_hw.h"
+#include "olm/scalarmult_base.h"
+#include "olm/ed25519_batch.h"
 #include "olm/memory.hh"
+#include "olm/sha256_hw.h"
+#include "olm/sha256_mb.h"
 
+#include <algorithm>
 #include <cstring>
 
 extern "C" {
@@ -29,13 +35,25 @@ extern "C" {
 
 namespace {
 
-static const std::uint8_t CURVE25519_BASEPOINT[32] = {9};
 static const std::size_t AES_KEY_SCHEDULE_LENGTH = 60;
 static const std::size_t AES_KEY_BITS = 8 * AES256_KEY_LENGTH;
 static const std::size_t AES_BLOCK_LENGTH = 16;
 static const std::size_t SHA256_BLOCK_LENGTH = 64;
+/* The most input that fits in one block along with the SHA-256 padding. */
+static const std::size_t SHA256_MAX_SINGLE_BLOCK = SHA256_BLOCK_LENGTH - 9;
+/* How many HMAC lanes to hash together. With fewer than three lanes the
+ * multi-buffer code is no faster than hashing them one at a time. */
+static const std::size_t HMAC_MIN_LANES = 3;
+static const std::size_t HMAC_MAX_LANES = 8;
 static const std::uint8_t HKDF_DEFAULT_SALT[32] = {};
 
+static bool aes_hw_enabled = true;
+
+
+inline static bool use_aes_hw() {
+    return aes_hw_enabled && _olm_aes256_hw_supported();
+}
+
 
 template<std::size_t block_size>
 inline static void xor_block(
@@ -48,6 +66,81 @@ inline static void xor_block(
 }
 
 
+/* The SHA-256 in crypto-algorithms compresses one block at a time in portable
+ * C. When the CPU has SHA instructions, sha256_add() and sha256_finish() do
+ * the buffering and padding themselves, on the same context, and send whole
+ * blocks to _olm_sha256_hw_compress() instead. */
+static void sha256_add(
+    ::SHA256_CTX * context,
+    std::uint8_t const * input, std::size_t input_length
+) {
+    if (!_olm_sha256_hw_active()) {
+        ::sha256_update(context, input, input_length);
+        return;
+    }
+
+    /* Top up a partially filled block first */
+    if (context->datalen) {
+        std::size_t fill = SHA256_BLOCK_LENGTH - context->datalen;
+        if (input_length < fill) {
+            std::memcpy(context->data + context->datalen, input, input_length);
+            context->datalen += input_length;
+            return;
+        }
+        std::memcpy(context->data + context->datalen, input, fill);
+        _olm_sha256_hw_compress(context->state, context->data, 1);
+        context->bitlen += 8 * SHA256_BLOCK_LENGTH;
+        context->datalen = 0;
+        input += fill;
+        input_length -= fill;
+    }
+
+    /* Then compress whole blocks straight from the input */
+    std::size_t blocks = input_length / SHA256_BLOCK_LENGTH;
+    if (blocks) {
+        _olm_sha256_hw_compress(context->state, input, blocks);
+        context->bitlen += 8 * SHA256_BLOCK_LENGTH * (unsigned long long)blocks;
+        input += SHA256_BLOCK_LENGTH * blocks;
+        input_length -= SHA256_BLOCK_LENGTH * blocks;
+    }
+
+    std::memcpy(context->data, input, input_length);
+    context->datalen = input_length;
+}
+
+
+static void sha256_finish(
+    ::SHA256_CTX * context,
+    std::uint8_t * output
+) {
+    if (!_olm_sha256_hw_active()) {
+        ::sha256_final(context, output);
+        return;
+    }
+
+    std::size_t pos = context->datalen;
+    unsigned long long bitlen = context->bitlen + 8 * pos;
+    context->data[pos++] = 0x80;
+    if (pos > SHA256_BLOCK_LENGTH - 8) {
+        std::memset(context->data + pos, 0, SHA256_BLOCK_LENGTH - pos);
+        _olm_sha256_hw_compress(context->state, context->data, 1);
+        pos = 0;
+    }
+    std::memset(context->data + pos, 0, SHA256_BLOCK_LENGTH - 8 - pos);
+    for (std::size_t i = 0; i < 8; ++i) {
+        context->data[SHA256_BLOCK_LENGTH - 1 - i] = std::uint8_t(bitlen >> (8 * i));
+    }
+    _olm_sha256_hw_compress(context->state, context->data, 1);
+
+    for (std::size_t i = 0; i < 8; ++i) {
+        output[4 * i] = std::uint8_t(context->state[i] >> 24);
+        output[4 * i + 1] = std::uint8_t(context->state[i] >> 16);
+        output[4 * i + 2] = std::uint8_t(context->state[i] >> 8);
+        output[4 * i + 3] = std::uint8_t(context->state[i]);
+    }
+}
+
+
 inline static void hmac_sha256_key(
     std::uint8_t const * input_key, std::size_t input_key_length,
     std::uint8_t * hmac_key
@@ -56,50 +149,225 @@ inline static void hmac_sha256_key(
     if (input_key_length > SHA256_BLOCK_LENGTH) {
         ::SHA256_CTX context;
         ::sha256_init(&context);
-        ::sha256_update(&context, input_key, input_key_length);
-        ::sha256_final(&context, hmac_key);
+        sha256_add(&context, input_key, input_key_length);
+        sha256_finish(&context, hmac_key);
     } else {
         std::memcpy(hmac_key, input_key, input_key_length);
     }
 }
 
 
-inline static void hmac_sha256_init(
-    ::SHA256_CTX * context,
-    std::uint8_t const * hmac_key
+inline static void xor_pad(
+    std::uint8_t * hmac_key, std::uint8_t pad
 ) {
-    std::uint8_t i_pad[SHA256_BLOCK_LENGTH];
-    std::memcpy(i_pad, hmac_key, SHA256_BLOCK_LENGTH);
     for (std::size_t i = 0; i < SHA256_BLOCK_LENGTH; ++i) {
-        i_pad[i] ^= 0x36;
+        hmac_key[i] ^= pad;
     }
+}
+
+
+/* Absorb one block of the padded key, and save the resulting state. */
+inline static void hmac_sha256_pad_state(
+    ::SHA256_CTX * context,
+    std::uint8_t const * padded_key,
+    std::uint32_t * state
+) {
     ::sha256_init(context);
-    ::sha256_update(context, i_pad, SHA256_BLOCK_LENGTH);
-    olm::unset(i_pad);
+    sha256_add(context, padded_key, SHA256_BLOCK_LENGTH);
+    std::memcpy(state, context->state, sizeof(context->state));
+}
+
+
+/* Set up a SHA-256 context as if it had just absorbed one block, leaving it
+ * with the given state. */
+inline static void sha256_resume(
+    ::SHA256_CTX * context,
+    std::uint32_t const * state
+) {
+    ::sha256_init(context);
+    std::memcpy(context->state, state, sizeof(context->state));
+    context->bitlen = 8 * SHA256_BLOCK_LENGTH;
+}
+
+
+inline static void hmac_sha256_init(
+    ::SHA256_CTX * context,
+    _olm_hmac_sha256_ctx const * hmac
+) {
+    sha256_resume(context, hmac->inner_state);
 }
 
 
 inline static void hmac_sha256_final(
     ::SHA256_CTX * context,
-    std::uint8_t const * hmac_key,
+    _olm_hmac_sha256_ctx const * hmac,
     std::uint8_t * output
 ) {
-    std::uint8_t o_pad[SHA256_BLOCK_LENGTH + SHA256_OUTPUT_LENGTH];
-    std::memcpy(o_pad, hmac_key, SHA256_BLOCK_LENGTH);
-    for (std::size_t i = 0; i < SHA256_BLOCK_LENGTH; ++i) {
-        o_pad[i] ^= 0x5C;
-    }
-    ::sha256_final(context, o_pad + SHA256_BLOCK_LENGTH);
+    std::uint8_t inner_hash[SHA256_OUTPUT_LENGTH];
+    sha256_finish(context, inner_hash);
     ::SHA256_CTX final_context;
-    ::sha256_init(&final_context);
-    ::sha256_update(&final_context, o_pad, sizeof(o_pad));
-    ::sha256_final(&final_context, output);
+    sha256_resume(&final_context, hmac->outer_state);
+    sha256_add(&final_context, inner_hash, sizeof(inner_hash));
+    sha256_finish(&final_context, output);
     olm::unset(final_context);
-    olm::unset(o_pad);
+    olm::unset(inner_hash);
+}
+
+
+/* Fill in the last block of a message, whose final length_bytes bytes
+ * (including any full blocks before this one) are followed by SHA-256's
+ * padding. The message bytes must already be in the block. */
+inline static void sha256_pad_block(
+    std::uint8_t * block, std::size_t used, std::uint64_t length_bytes
+) {
+    std::uint64_t bitlen = length_bytes * 8;
+    block[used] = 0x80;
+    std::memset(block + used + 1, 0, SHA256_BLOCK_LENGTH - 8 - used - 1);
+    for (unsigned i = 0; i < 8; ++i) {
+        block[SHA256_BLOCK_LENGTH - 1 - i] = std::uint8_t(bitlen >> (8 * i));
+    }
+}
+
+
+inline static void sha256_state_bytes(
+    std::uint32_t const * state, std::uint8_t * output
+) {
+    for (unsigned i = 0; i < SHA256_STATE_WORDS; ++i) {
+        output[4 * i] = std::uint8_t(state[i] >> 24);
+        output[4 * i + 1] = std::uint8_t(state[i] >> 16);
+        output[4 * i + 2] = std::uint8_t(state[i] >> 8);
+        output[4 * i + 3] = std::uint8_t(state[i]);
+    }
+}
+
+
+/* HMAC-SHA-256 for up to HMAC_MAX_LANES lanes whose inputs all fit in a
+ * single block. Both the inner and the outer hash are then just one call to
+ * the compression function, which we can do for all the lanes at once. */
+static void hmac_sha256_short_lanes(
+    _olm_hmac_sha256_lane const * const * lanes, std::size_t count
+) {
+    std::uint32_t states[HMAC_MAX_LANES][SHA256_STATE_WORDS];
+    std::uint8_t blocks[HMAC_MAX_LANES][SHA256_BLOCK_LENGTH];
+    std::uint32_t * state_ptrs[HMAC_MAX_LANES];
+    std::uint8_t const * block_ptrs[HMAC_MAX_LANES];
+
+    for (std::size_t i = 0; i < HMAC_MAX_LANES; ++i) {
+        state_ptrs[i] = states[i];
+        block_ptrs[i] = blocks[i];
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        _olm_hmac_sha256_lane const & lane = *lanes[i];
+        std::memcpy(states[i], lane.key->inner_state, sizeof(states[i]));
+        std::memcpy(blocks[i], lane.input, lane.input_length);
+        sha256_pad_block(
+            blocks[i], lane.input_length,
+            SHA256_BLOCK_LENGTH + lane.input_length
+        );
+    }
+    _olm_sha256_mb_compress(state_ptrs, block_ptrs, count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        sha256_state_bytes(states[i], blocks[i]);
+        sha256_pad_block(
+            blocks[i], SHA256_OUTPUT_LENGTH,
+            SHA256_BLOCK_LENGTH + SHA256_OUTPUT_LENGTH
+        );
+        std::memcpy(states[i], lanes[i]->key->outer_state, sizeof(states[i]));
+    }
+    _olm_sha256_mb_compress(state_ptrs, block_ptrs, count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        sha256_state_bytes(states[i], lanes[i]->output);
+    }
+    olm::unset(states, count * sizeof(states[0]));
+    olm::unset(blocks, count * sizeof(blocks[0]));
+}
+
+
+/* The HMAC key used for HKDF-Extract when no salt is given. It is the same
+ * every time, so only prepare it once. */
+static _olm_hmac_sha256_ctx const & hkdf_default_salt() {
+    static _olm_hmac_sha256_ctx const ctx = []() {
+        _olm_hmac_sha256_ctx result;
+        _olm_crypto_hmac_sha256_init(
+            &result, HKDF_DEFAULT_SALT, sizeof(HKDF_DEFAULT_SALT)
+        );
+        return result;
+    }();
+    return ctx;
 }
 
 } // namespace
 
+void _olm_crypto_hkdf_sha256_lanes(
+    std::uint8_t const * const * inputs, std::size_t input_length,
+    std::uint8_t const * info, std::size_t info_length,
+    std::uint8_t * const * outputs, std::size_t output_length,
+    std::size_t count
+) {
+    if (SHA256_OUTPUT_LENGTH + info_length + 1 > SHA256_BLOCK_LENGTH) {
+        for (std::size_t i = 0; i < count; ++i) {
+            _olm_crypto_hkdf_sha256(
+                inputs[i], input_length, nullptr, 0, info, info_length,
+                outputs[i], output_length
+            );
+        }
+        return;
+    }
+
+    _olm_hmac_sha256_ctx prks[HMAC_MAX_LANES];
+    _olm_hmac_sha256_lane lanes[HMAC_MAX_LANES];
+    std::uint8_t blocks[HMAC_MAX_LANES][SHA256_BLOCK_LENGTH];
+    std::uint8_t step_results[HMAC_MAX_LANES][SHA256_OUTPUT_LENGTH];
+
+    for (std::size_t start = 0; start < count; start += HMAC_MAX_LANES) {
+        std::size_t n = std::min(count - start, HMAC_MAX_LANES);
+
+        /* Extract */
+        for (std::size_t i = 0; i < n; ++i) {
+            _olm_crypto_hmac_sha256_compute(
+                &hkdf_default_salt(), inputs[start + i], input_length,
+                step_results[i]
+            );
+            _olm_crypto_hmac_sha256_init(
+                &prks[i], step_results[i], SHA256_OUTPUT_LENGTH
+            );
+        }
+
+        /* Expand, one block of output for all the lanes at a time */
+        std::size_t offset = 0;
+        std::uint8_t iteration = 1;
+        while (offset < output_length) {
+            std::size_t prefix = iteration == 1 ? 0 : SHA256_OUTPUT_LENGTH;
+            for (std::size_t i = 0; i < n; ++i) {
+                std::memcpy(blocks[i], step_results[i], prefix);
+                std::memcpy(blocks[i] + prefix, info, info_length);
+                blocks[i][prefix + info_length] = iteration;
+                lanes[i].key = &prks[i];
+                lanes[i].input = blocks[i];
+                lanes[i].input_length = prefix + info_length + 1;
+                lanes[i].output = step_results[i];
+            }
+            _olm_crypto_hmac_sha256_lanes(lanes, n);
+
+            std::size_t length = std::min(
+                output_length - offset, std::size_t(SHA256_OUTPUT_LENGTH)
+            );
+            for (std::size_t i = 0; i < n; ++i) {
+                std::memcpy(outputs[start + i] + offset, step_results[i], length);
+            }
+            offset += length;
+            iteration++;
+        }
+    }
+    olm::unset(prks);
+    olm::unset(blocks);
+    olm::unset(step_results);
+}
+
+
 void _olm_crypto_curve25519_generate_key(
     uint8_t const * random_32_bytes,
     struct _olm_curve25519_key_pair *key_pair
@@ -108,10 +376,9 @@ void _olm_crypto_curve25519_generate_key(
         key_pair->private_key.private_key, random_32_bytes,
         CURVE25519_KEY_LENGTH
     );
-    ::curve25519_donna(
+    _olm_curve25519_scalarmult_base(
         key_pair->public_key.public_key,
-        key_pair->private_key.private_key,
-        CURVE25519_BASEPOINT
+        key_pair->private_key.private_key
     );
 }
 
@@ -129,7 +396,7 @@ void _olm_crypto_ed25519_generate_key(
     std::uint8_t const * random_32_bytes,
     struct _olm_ed25519_key_pair *key_pair
 ) {
-    ::ed25519_create_keypair(
+    _olm_ed25519_create_keypair(
         key_pair->public_key.public_key, key_pair->private_key.private_key,
         random_32_bytes
     );
@@ -141,7 +408,7 @@ void _olm_crypto_ed25519_sign(
     std::uint8_t const * message, std::size_t message_length,
     std::uint8_t * output
 ) {
-    ::ed25519_sign(
+    _olm_ed25519_sign(
         output,
         message, message_length,
         our_key->public_key.public_key,
@@ -163,6 +430,14 @@ int _olm_crypto_ed25519_verify(
 }
 
 
+std::size_t _olm_crypto_ed25519_verify_batch(
+    _olm_ed25519_verify_item const * items, std::size_t count,
+    std::uint8_t * results
+) {
+    return _olm_ed25519_verify_batch(items, count, results);
+}
+
+
 std::size_t _olm_crypto_aes_encrypt_cbc_length(
     std::size_t input_length
 ) {
@@ -170,12 +445,51 @@ std::size_t _olm_crypto_aes_encrypt_cbc_length(
 }
 
 
+int _olm_crypto_aes_hw_available(void) {
+    return _olm_aes256_hw_supported();
+}
+
+
+int _olm_crypto_aes_hw_enable(int enable) {
+    int previous = aes_hw_enabled;
+    aes_hw_enabled = enable != 0;
+    return previous;
+}
+
+
 void _olm_crypto_aes_encrypt_cbc(
     _olm_aes256_key const *key,
     _olm_aes256_iv const *iv,
     std::uint8_t const * input, std::size_t input_length,
     std::uint8_t * output
 ) {
+    if (use_aes_hw()) {
+        _olm_aes256_hw_key key_schedule;
+        _olm_aes256_hw_setup_encrypt(&key_schedule, key->key);
+        std::uint8_t chain[AES_BLOCK_LENGTH];
+        std::uint8_t final_block[AES_BLOCK_LENGTH];
+        std::size_t blocks = input_length / AES_BLOCK_LENGTH;
+        std::size_t remainder = input_length % AES_BLOCK_LENGTH;
+        std::memcpy(chain, iv->iv, AES_BLOCK_LENGTH);
+        _olm_aes256_hw_encrypt_cbc(
+            &key_schedule, chain, input, blocks, output
+        );
+        input += blocks * AES_BLOCK_LENGTH;
+        output += blocks * AES_BLOCK_LENGTH;
+        std::memcpy(final_block, input, remainder);
+        std::memset(
+            final_block + remainder, AES_BLOCK_LENGTH - remainder,
+            AES_BLOCK_LENGTH - remainder
+        );
+        _olm_aes256_hw_encrypt_cbc(
+            &key_schedule, chain, final_block, 1, output
+        );
+        olm::unset(key_schedule);
+        olm::unset(chain);
+        olm::unset(final_block);
+        return;
+    }
+
     std::uint32_t key_schedule[AES_KEY_SCHEDULE_LENGTH];
     ::aes_key_setup(key->key, key_schedule, AES_KEY_BITS);
     std::uint8_t input_block[AES_BLOCK_LENGTH];
@@ -207,6 +521,22 @@ std::size_t _olm_crypto_aes_decrypt_cbc(
     std::uint8_t const * input, std::size_t input_length,
     std::uint8_t * output
 ) {
+    if (use_aes_hw()) {
+        _olm_aes256_hw_key key_schedule;
+        _olm_aes256_hw_setup_decrypt(&key_schedule, key->key);
+        std::uint8_t chain[AES_BLOCK_LENGTH];
+        std::memcpy(chain, iv->iv, AES_BLOCK_LENGTH);
+        _olm_aes256_hw_decrypt_cbc(
+            &key_schedule, chain,
+            input, input_length / AES_BLOCK_LENGTH,
+            output
+        );
+        olm::unset(key_schedule);
+        olm::unset(chain);
+        std::size_t padding = output[input_length - 1];
+        return (padding > input_length) ? std::size_t(-1) : (input_length - padding);
+    }
+
     std::uint32_t key_schedule[AES_KEY_SCHEDULE_LENGTH];
     ::aes_key_setup(key->key, key_schedule, AES_KEY_BITS);
     std::uint8_t block1[AES_BLOCK_LENGTH];
@@ -232,28 +562,110 @@ void _olm_crypto_sha256(
 ) {
     ::SHA256_CTX context;
     ::sha256_init(&context);
-    ::sha256_update(&context, input, input_length);
-    ::sha256_final(&context, output);
+    sha256_add(&context, input, input_length);
+    sha256_finish(&context, output);
     olm::unset(context);
 }
 
 
-void _olm_crypto_hmac_sha256(
-    std::uint8_t const * key, std::size_t key_length,
+int _olm_crypto_sha256_hw_available(void) {
+    return _olm_sha256_hw_supported();
+}
+
+
+int _olm_crypto_sha256_hw_enable(int enable) {
+    return _olm_sha256_hw_enable(enable);
+}
+
+
+void _olm_crypto_hmac_sha256_init(
+    _olm_hmac_sha256_ctx * ctx,
+    std::uint8_t const * key, std::size_t key_length
+) {
+    std::uint8_t padded_key[SHA256_BLOCK_LENGTH];
+    ::SHA256_CTX context;
+    hmac_sha256_key(key, key_length, padded_key);
+    xor_pad(padded_key, 0x36);
+    hmac_sha256_pad_state(&context, padded_key, ctx->inner_state);
+    xor_pad(padded_key, 0x36 ^ 0x5C);
+    hmac_sha256_pad_state(&context, padded_key, ctx->outer_state);
+    olm::unset(padded_key);
+    olm::unset(context);
+}
+
+
+void _olm_crypto_hmac_sha256_compute(
+    _olm_hmac_sha256_ctx const * ctx,
     std::uint8_t const * input, std::size_t input_length,
     std::uint8_t * output
 ) {
-    std::uint8_t hmac_key[SHA256_BLOCK_LENGTH];
     ::SHA256_CTX context;
-    hmac_sha256_key(key, key_length, hmac_key);
-    hmac_sha256_init(&context, hmac_key);
-    ::sha256_update(&context, input, input_length);
-    hmac_sha256_final(&context, hmac_key, output);
-    olm::unset(hmac_key);
+    hmac_sha256_init(&context, ctx);
+    sha256_add(&context, input, input_length);
+    hmac_sha256_final(&context, ctx, output);
     olm::unset(context);
 }
 
 
+void _olm_crypto_hmac_sha256_lanes(
+    _olm_hmac_sha256_lane const * lanes, std::size_t count
+) {
+    /* The SHA instructions are faster one lane at a time than the
+     * multi-buffer code is for a whole group. */
+    bool batch = count >= HMAC_MIN_LANES && _olm_sha256_mb_active()
+        && !_olm_sha256_hw_active();
+    _olm_hmac_sha256_lane const * pending[HMAC_MAX_LANES];
+    std::size_t pending_count = 0;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        if (batch && lanes[i].input_length <= SHA256_MAX_SINGLE_BLOCK) {
+            pending[pending_count++] = &lanes[i];
+            if (pending_count == HMAC_MAX_LANES) {
+                hmac_sha256_short_lanes(pending, pending_count);
+                pending_count = 0;
+            }
+        } else {
+            _olm_crypto_hmac_sha256_compute(
+                lanes[i].key, lanes[i].input, lanes[i].input_length,
+                lanes[i].output
+            );
+        }
+    }
+    if (pending_count >= HMAC_MIN_LANES) {
+        hmac_sha256_short_lanes(pending, pending_count);
+    } else {
+        for (std::size_t i = 0; i < pending_count; ++i) {
+            _olm_crypto_hmac_sha256_compute(
+                pending[i]->key, pending[i]->input, pending[i]->input_length,
+                pending[i]->output
+            );
+        }
+    }
+}
+
+
+int _olm_crypto_sha256_mb_available(void) {
+    return _olm_sha256_mb_supported() != 0;
+}
+
+
+int _olm_crypto_sha256_mb_enable(int enable) {
+    return _olm_sha256_mb_enable(enable);
+}
+
+
+void _olm_crypto_hmac_sha256(
+    std::uint8_t const * key, std::size_t key_length,
+    std::uint8_t const * input, std::size_t input_length,
+    std::uint8_t * output
+) {
+    _olm_hmac_sha256_ctx hmac;
+    _olm_crypto_hmac_sha256_init(&hmac, key, key_length);
+    _olm_crypto_hmac_sha256_compute(&hmac, input, input_length, output);
+    olm::unset(hmac);
+}
+
+
 void _olm_crypto_hkdf_sha256(
     std::uint8_t const * input, std::size_t input_length,
     std::uint8_t const * salt, std::size_t salt_length,
@@ -261,39 +673,41 @@ void _olm_crypto_hkdf_sha256(
     std::uint8_t * output, std::size_t output_length
 ) {
     ::SHA256_CTX context;
-    std::uint8_t hmac_key[SHA256_BLOCK_LENGTH];
+    _olm_hmac_sha256_ctx hmac;
     std::uint8_t step_result[SHA256_OUTPUT_LENGTH];
     std::size_t bytes_remaining = output_length;
     std::uint8_t iteration = 1;
-    if (!salt) {
-        salt = HKDF_DEFAULT_SALT;
-        salt_length = sizeof(HKDF_DEFAULT_SALT);
-    }
     /* Extract */
-    hmac_sha256_key(salt, salt_length, hmac_key);
-    hmac_sha256_init(&context, hmac_key);
-    ::sha256_update(&context, input, input_length);
-    hmac_sha256_final(&context, hmac_key, step_result);
-    hmac_sha256_key(step_result, SHA256_OUTPUT_LENGTH, hmac_key);
+    if (salt) {
+        _olm_crypto_hmac_sha256_init(&hmac, salt, salt_length);
+        _olm_crypto_hmac_sha256_compute(
+            &hmac, input, input_length, step_result
+        );
+    } else {
+        _olm_crypto_hmac_sha256_compute(
+            &hkdf_default_salt(), input, input_length, step_result
+        );
+    }
+    _olm_crypto_hmac_sha256_init(&hmac, step_result, SHA256_OUTPUT_LENGTH);
 
     /* Expand */
-    hmac_sha256_init(&context, hmac_key);
-    ::sha256_update(&context, info, info_length);
-    ::sha256_update(&context, &iteration, 1);
-    hmac_sha256_final(&context, hmac_key, step_result);
+    hmac_sha256_init(&context, &hmac);
+    sha256_add(&context, info, info_length);
+    sha256_add(&context, &iteration, 1);
+    hmac_sha256_final(&context, &hmac, step_result);
     while (bytes_remaining > SHA256_OUTPUT_LENGTH) {
         std::memcpy(output, step_result, SHA256_OUTPUT_LENGTH);
         output += SHA256_OUTPUT_LENGTH;
         bytes_remaining -= SHA256_OUTPUT_LENGTH;
         iteration ++;
-        hmac_sha256_init(&context, hmac_key);
-        ::sha256_update(&context, step_result, SHA256_OUTPUT_LENGTH);
-        ::sha256_update(&context, info, info_length);
-        ::sha256_update(&context, &iteration, 1);
-        hmac_sha256_final(&context, hmac_key, step_result);
+        hmac_sha256_init(&context, &hmac);
+        sha256_add(&context, step_result, SHA256_OUTPUT_LENGTH);
+        sha256_add(&context, info, info_length);
+        sha256_add(&context, &iteration, 1);
+        hmac_sha256_final(&context, &hmac, step_result);
     }
     std::memcpy(output, step_result, bytes_remaining);
     olm::unset(context);
-    olm::unset(hmac_key);
+    olm::unset(hmac);
     olm::unset(step_result);
 }
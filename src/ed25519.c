@@ -20,3 +20,462 @@
 #include "ed25519/src/sha512.c"
 #include "ed25519/src/verify.c"
 #include "ed25519/src/sign.c"
+
+#include "olm/scalarmult_base.h"
+#include "olm/memory.h"
+
+#include <string.h>
+
+/* Fixed-base scalar multiplication for ed25519 keys and signatures, and for
+ * curve25519 keys, using the table of multiples of the ed25519 base point
+ * that ge_scalarmult_base uses. The curve25519 base point u = 9 corresponds
+ * to that base point, and a point (x, y) on the Edwards curve corresponds to
+ * u = (1 + y) / (1 - y).
+ */
+
+#if defined(__SIZEOF_INT128__)
+
+/* With 128-bit multiplication available we can work in radix 2^51, which is
+ * several times faster than ref10's radix 2^25.5. The table entries are
+ * picked in constant time in ref10's representation, then converted.
+ */
+
+__extension__ typedef unsigned __int128 fe51_uint128;
+typedef uint64_t fe51[5];
+
+typedef struct {
+    fe51 X, Y, Z, T;
+} ge51_p3;
+
+typedef struct {
+    fe51 X, Y, Z, T;
+} ge51_p1p1;
+
+typedef struct {
+    fe51 yplusx, yminusx, xy2d;
+} ge51_precomp;
+
+#define FE51_MASK ((((uint64_t)1) << 51) - 1)
+
+/* Limbs are kept below 2^52, so that sums of two of them can go straight
+ * into a multiplication. */
+static void fe51_carry(fe51 h) {
+    uint64_t c;
+    c = h[0] >> 51; h[0] &= FE51_MASK; h[1] += c;
+    c = h[1] >> 51; h[1] &= FE51_MASK; h[2] += c;
+    c = h[2] >> 51; h[2] &= FE51_MASK; h[3] += c;
+    c = h[3] >> 51; h[3] &= FE51_MASK; h[4] += c;
+    c = h[4] >> 51; h[4] &= FE51_MASK; h[0] += 19 * c;
+}
+
+/* Convert from ref10's signed limbs, adding 2p to keep the result positive. */
+static void fe51_from_fe(fe51 h, const fe f) {
+    static const uint64_t two_p[5] = {
+        0xfffffffffffdaULL, 0xffffffffffffeULL, 0xffffffffffffeULL,
+        0xffffffffffffeULL, 0xffffffffffffeULL
+    };
+    int i;
+    for (i = 0; i < 5; i++) {
+        int64_t limb = (int64_t)f[2 * i] + (int64_t)f[2 * i + 1] * (1 << 26);
+        h[i] = (uint64_t)limb + two_p[i];
+    }
+    fe51_carry(h);
+}
+
+static void fe51_1(fe51 h) {
+    h[0] = 1; h[1] = 0; h[2] = 0; h[3] = 0; h[4] = 0;
+}
+
+static void fe51_0(fe51 h) {
+    h[0] = 0; h[1] = 0; h[2] = 0; h[3] = 0; h[4] = 0;
+}
+
+static void fe51_add(fe51 h, const fe51 f, const fe51 g) {
+    int i;
+    for (i = 0; i < 5; i++) {
+        h[i] = f[i] + g[i];
+    }
+    fe51_carry(h);
+}
+
+/* f - g, adding 4p so that the limbs don't go negative */
+static void fe51_sub(fe51 h, const fe51 f, const fe51 g) {
+    h[0] = f[0] + 0x1fffffffffffb4ULL - g[0];
+    h[1] = f[1] + 0x1ffffffffffffcULL - g[1];
+    h[2] = f[2] + 0x1ffffffffffffcULL - g[2];
+    h[3] = f[3] + 0x1ffffffffffffcULL - g[3];
+    h[4] = f[4] + 0x1ffffffffffffcULL - g[4];
+    fe51_carry(h);
+}
+
+static void fe51_reduce(fe51 h, const fe51_uint128 t[5]) {
+    fe51_uint128 t0 = t[0], t1 = t[1], t2 = t[2], t3 = t[3], t4 = t[4];
+    uint64_t c;
+    t1 += (uint64_t)(t0 >> 51); h[0] = (uint64_t)t0 & FE51_MASK;
+    t2 += (uint64_t)(t1 >> 51); h[1] = (uint64_t)t1 & FE51_MASK;
+    t3 += (uint64_t)(t2 >> 51); h[2] = (uint64_t)t2 & FE51_MASK;
+    t4 += (uint64_t)(t3 >> 51); h[3] = (uint64_t)t3 & FE51_MASK;
+    c = (uint64_t)(t4 >> 51); h[4] = (uint64_t)t4 & FE51_MASK;
+    t0 = (fe51_uint128)c * 19 + h[0];
+    h[0] = (uint64_t)t0 & FE51_MASK;
+    h[1] += (uint64_t)(t0 >> 51);
+}
+
+static void fe51_mul(fe51 h, const fe51 f, const fe51 g) {
+    fe51_uint128 t[5];
+    uint64_t g1_19 = 19 * g[1], g2_19 = 19 * g[2];
+    uint64_t g3_19 = 19 * g[3], g4_19 = 19 * g[4];
+
+    t[0] = (fe51_uint128)f[0] * g[0] + (fe51_uint128)f[1] * g4_19
+        + (fe51_uint128)f[2] * g3_19 + (fe51_uint128)f[3] * g2_19
+        + (fe51_uint128)f[4] * g1_19;
+    t[1] = (fe51_uint128)f[0] * g[1] + (fe51_uint128)f[1] * g[0]
+        + (fe51_uint128)f[2] * g4_19 + (fe51_uint128)f[3] * g3_19
+        + (fe51_uint128)f[4] * g2_19;
+    t[2] = (fe51_uint128)f[0] * g[2] + (fe51_uint128)f[1] * g[1]
+        + (fe51_uint128)f[2] * g[0] + (fe51_uint128)f[3] * g4_19
+        + (fe51_uint128)f[4] * g3_19;
+    t[3] = (fe51_uint128)f[0] * g[3] + (fe51_uint128)f[1] * g[2]
+        + (fe51_uint128)f[2] * g[1] + (fe51_uint128)f[3] * g[0]
+        + (fe51_uint128)f[4] * g4_19;
+    t[4] = (fe51_uint128)f[0] * g[4] + (fe51_uint128)f[1] * g[3]
+        + (fe51_uint128)f[2] * g[2] + (fe51_uint128)f[3] * g[1]
+        + (fe51_uint128)f[4] * g[0];
+    fe51_reduce(h, t);
+}
+
+/* h = f^2, or 2 f^2 if doubled is set */
+static void fe51_sq_generic(fe51 h, const fe51 f, int doubled) {
+    fe51_uint128 t[5];
+    uint64_t d0 = 2 * f[0], d1 = 2 * f[1], d3 = 2 * f[3];
+    uint64_t f3_19 = 19 * f[3], f4_19 = 19 * f[4];
+    int i;
+
+    t[0] = (fe51_uint128)f[0] * f[0] + (fe51_uint128)d1 * f4_19
+        + (fe51_uint128)(2 * f[2]) * f3_19;
+    t[1] = (fe51_uint128)d0 * f[1] + (fe51_uint128)(2 * f[2]) * f4_19
+        + (fe51_uint128)f[3] * f3_19;
+    t[2] = (fe51_uint128)d0 * f[2] + (fe51_uint128)f[1] * f[1]
+        + (fe51_uint128)d3 * f4_19;
+    t[3] = (fe51_uint128)d0 * f[3] + (fe51_uint128)d1 * f[2]
+        + (fe51_uint128)f[4] * f4_19;
+    t[4] = (fe51_uint128)d0 * f[4] + (fe51_uint128)d1 * f[3]
+        + (fe51_uint128)f[2] * f[2];
+    if (doubled) {
+        for (i = 0; i < 5; i++) {
+            t[i] <<= 1;
+        }
+    }
+    fe51_reduce(h, t);
+}
+
+static void fe51_sq(fe51 h, const fe51 f) {
+    fe51_sq_generic(h, f, 0);
+}
+
+static void fe51_sq2(fe51 h, const fe51 f) {
+    fe51_sq_generic(h, f, 1);
+}
+
+static void fe51_sq_times(fe51 h, const fe51 f, int count) {
+    fe51_sq(h, f);
+    while (--count) {
+        fe51_sq(h, h);
+    }
+}
+
+/* z^(p - 2), with the same chain as fe_invert */
+static void fe51_invert(fe51 out, const fe51 z) {
+    fe51 t0, t1, t2, t3;
+
+    fe51_sq(t0, z);
+    fe51_sq_times(t1, t0, 2);
+    fe51_mul(t1, z, t1);
+    fe51_mul(t0, t0, t1);
+    fe51_sq(t2, t0);
+    fe51_mul(t1, t1, t2);
+    fe51_sq_times(t2, t1, 5);
+    fe51_mul(t1, t2, t1);
+    fe51_sq_times(t2, t1, 10);
+    fe51_mul(t2, t2, t1);
+    fe51_sq_times(t3, t2, 20);
+    fe51_mul(t2, t3, t2);
+    fe51_sq_times(t2, t2, 10);
+    fe51_mul(t1, t2, t1);
+    fe51_sq_times(t2, t1, 50);
+    fe51_mul(t2, t2, t1);
+    fe51_sq_times(t3, t2, 100);
+    fe51_mul(t2, t3, t2);
+    fe51_sq_times(t2, t2, 50);
+    fe51_mul(t1, t2, t1);
+    fe51_sq_times(t1, t1, 5);
+    fe51_mul(out, t1, t0);
+}
+
+static void fe51_tobytes(unsigned char *s, const fe51 f) {
+    uint64_t t[5];
+    uint64_t w;
+    int i;
+
+    /* the same full reduction as fcontract in curve25519-donna-c64 */
+    memcpy(t, f, sizeof(t));
+    fe51_carry(t);
+    fe51_carry(t);
+    /* now t is between 0 and 2^255-1, properly carried. Adding 19 wraps
+     * around if and only if t >= p. */
+    t[0] += 19;
+    fe51_carry(t);
+    /* subtract the 19 again by adding 2^255 - 19 and dropping the top bit */
+    t[0] += (((uint64_t)1) << 51) - 19;
+    t[1] += (((uint64_t)1) << 51) - 1;
+    t[2] += (((uint64_t)1) << 51) - 1;
+    t[3] += (((uint64_t)1) << 51) - 1;
+    t[4] += (((uint64_t)1) << 51) - 1;
+    t[1] += t[0] >> 51; t[0] &= FE51_MASK;
+    t[2] += t[1] >> 51; t[1] &= FE51_MASK;
+    t[3] += t[2] >> 51; t[2] &= FE51_MASK;
+    t[4] += t[3] >> 51; t[3] &= FE51_MASK;
+    t[4] &= FE51_MASK;
+
+    w = t[0] | (t[1] << 51);
+    for (i = 0; i < 8; i++) s[i] = (unsigned char)(w >> (8 * i));
+    w = (t[1] >> 13) | (t[2] << 38);
+    for (i = 0; i < 8; i++) s[8 + i] = (unsigned char)(w >> (8 * i));
+    w = (t[2] >> 26) | (t[3] << 25);
+    for (i = 0; i < 8; i++) s[16 + i] = (unsigned char)(w >> (8 * i));
+    w = (t[3] >> 39) | (t[4] << 12);
+    for (i = 0; i < 8; i++) s[24 + i] = (unsigned char)(w >> (8 * i));
+
+    _olm_unset(t, sizeof(t));
+}
+
+static void ge51_p3_0(ge51_p3 *h) {
+    fe51_0(h->X);
+    fe51_1(h->Y);
+    fe51_1(h->Z);
+    fe51_0(h->T);
+}
+
+static void ge51_p1p1_to_p3(ge51_p3 *r, const ge51_p1p1 *p) {
+    fe51_mul(r->X, p->X, p->T);
+    fe51_mul(r->Y, p->Y, p->Z);
+    fe51_mul(r->Z, p->Z, p->T);
+    fe51_mul(r->T, p->X, p->Y);
+}
+
+/* doubling, ignoring T, which the formula doesn't use */
+static void ge51_p3_dbl(ge51_p1p1 *r, const ge51_p3 *p) {
+    fe51 t0;
+    fe51_sq(r->X, p->X);
+    fe51_sq(r->Z, p->Y);
+    fe51_sq2(r->T, p->Z);
+    fe51_add(r->Y, p->X, p->Y);
+    fe51_sq(t0, r->Y);
+    fe51_add(r->Y, r->Z, r->X);
+    fe51_sub(r->Z, r->Z, r->X);
+    fe51_sub(r->X, t0, r->Y);
+    fe51_sub(r->T, r->T, r->Z);
+}
+
+static void ge51_madd(ge51_p1p1 *r, const ge51_p3 *p, const ge51_precomp *q) {
+    fe51 t0;
+    fe51_add(r->X, p->Y, p->X);
+    fe51_sub(r->Y, p->Y, p->X);
+    fe51_mul(r->Z, r->X, q->yplusx);
+    fe51_mul(r->Y, r->Y, q->yminusx);
+    fe51_mul(r->T, q->xy2d, p->T);
+    fe51_add(t0, p->Z, p->Z);
+    fe51_sub(r->X, r->Z, r->Y);
+    fe51_add(r->Y, r->Z, r->Y);
+    fe51_add(r->Z, t0, r->T);
+    fe51_sub(r->T, t0, r->T);
+}
+
+/* Add the table entry for b * 16^(2 * pos) * B, in constant time */
+static void ge51_madd_base(ge51_p3 *h, int pos, signed char b) {
+    ge_precomp t;
+    ge51_precomp t51;
+    ge51_p1p1 r;
+
+    ed25519_select(&t, pos, b);
+    fe51_from_fe(t51.yplusx, t.yplusx);
+    fe51_from_fe(t51.yminusx, t.yminusx);
+    fe51_from_fe(t51.xy2d, t.xy2d);
+    ge51_madd(&r, h, &t51);
+    ge51_p1p1_to_p3(h, &r);
+}
+
+/* h = a * B, where a[31] <= 127, as ge_scalarmult_base */
+static void ge51_scalarmult_base(ge51_p3 *h, const unsigned char *a) {
+    signed char e[64];
+    signed char carry;
+    ge51_p1p1 r;
+    int i;
+
+    for (i = 0; i < 32; ++i) {
+        e[2 * i + 0] = (a[i] >> 0) & 15;
+        e[2 * i + 1] = (a[i] >> 4) & 15;
+    }
+    carry = 0;
+    for (i = 0; i < 63; ++i) {
+        e[i] += carry;
+        carry = e[i] + 8;
+        carry >>= 4;
+        e[i] -= carry << 4;
+    }
+    e[63] += carry;
+
+    ge51_p3_0(h);
+    for (i = 1; i < 64; i += 2) {
+        ge51_madd_base(h, i / 2, e[i]);
+    }
+    /* multiply by 16 */
+    for (i = 0; i < 4; ++i) {
+        ge51_p3_dbl(&r, h);
+        ge51_p1p1_to_p3(h, &r);
+    }
+    for (i = 0; i < 64; i += 2) {
+        ge51_madd_base(h, i / 2, e[i]);
+    }
+
+    _olm_unset(e, sizeof(e));
+    _olm_unset(&r, sizeof(r));
+}
+
+static void ge51_p3_tobytes(unsigned char *s, const ge51_p3 *h) {
+    fe51 recip, x, y;
+    unsigned char x_bytes[32];
+
+    fe51_invert(recip, h->Z);
+    fe51_mul(x, h->X, recip);
+    fe51_mul(y, h->Y, recip);
+    fe51_tobytes(s, y);
+    fe51_tobytes(x_bytes, x);
+    s[31] ^= (x_bytes[0] & 1) << 7;
+}
+
+void _olm_curve25519_scalarmult_base(
+    uint8_t * public_key, uint8_t const * private_key
+) {
+    unsigned char a[32];
+    ge51_p3 h;
+    fe51 numerator, denominator;
+
+    /* clamp the scalar the same way curve25519_donna does */
+    memcpy(a, private_key, sizeof(a));
+    a[0] &= 248;
+    a[31] &= 127;
+    a[31] |= 64;
+
+    ge51_scalarmult_base(&h, a);
+
+    /* u = (1 + y) / (1 - y), and in projective coordinates y = Y / Z, so
+     * u = (Z + Y) / (Z - Y) */
+    fe51_add(numerator, h.Z, h.Y);
+    fe51_sub(denominator, h.Z, h.Y);
+    fe51_invert(denominator, denominator);
+    fe51_mul(numerator, numerator, denominator);
+    fe51_tobytes(public_key, numerator);
+
+    _olm_unset(a, sizeof(a));
+    _olm_unset(&h, sizeof(h));
+    _olm_unset(numerator, sizeof(numerator));
+    _olm_unset(denominator, sizeof(denominator));
+}
+
+/* as ed25519_create_keypair */
+void _olm_ed25519_create_keypair(
+    uint8_t * public_key, uint8_t * private_key, uint8_t const * seed
+) {
+    ge51_p3 A;
+
+    sha512(seed, 32, private_key);
+    private_key[0] &= 248;
+    private_key[31] &= 63;
+    private_key[31] |= 64;
+
+    ge51_scalarmult_base(&A, private_key);
+    ge51_p3_tobytes(public_key, &A);
+    _olm_unset(&A, sizeof(A));
+}
+
+/* as ed25519_sign */
+void _olm_ed25519_sign(
+    uint8_t * signature,
+    uint8_t const * message, size_t message_length,
+    uint8_t const * public_key, uint8_t const * private_key
+) {
+    sha512_context hash;
+    unsigned char hram[64];
+    unsigned char r[64];
+    ge51_p3 R;
+
+    sha512_init(&hash);
+    sha512_update(&hash, private_key + 32, 32);
+    sha512_update(&hash, message, message_length);
+    sha512_final(&hash, r);
+
+    sc_reduce(r);
+    ge51_scalarmult_base(&R, r);
+    ge51_p3_tobytes(signature, &R);
+
+    sha512_init(&hash);
+    sha512_update(&hash, signature, 32);
+    sha512_update(&hash, public_key, 32);
+    sha512_update(&hash, message, message_length);
+    sha512_final(&hash, hram);
+
+    sc_reduce(hram);
+    sc_muladd(signature + 32, hram, private_key, r);
+
+    _olm_unset(&hash, sizeof(hash));
+    _olm_unset(r, sizeof(r));
+    _olm_unset(&R, sizeof(R));
+}
+
+#else
+
+void _olm_curve25519_scalarmult_base(
+    uint8_t * public_key, uint8_t const * private_key
+) {
+    unsigned char e[32];
+    ge_p3 A;
+    fe numerator, denominator;
+
+    /* clamp the scalar the same way curve25519_donna does */
+    memcpy(e, private_key, sizeof(e));
+    e[0] &= 248;
+    e[31] &= 127;
+    e[31] |= 64;
+
+    ge_scalarmult_base(&A, e);
+
+    /* u = (1 + y) / (1 - y), and in projective coordinates y = Y / Z, so
+     * u = (Z + Y) / (Z - Y) */
+    fe_add(numerator, A.Z, A.Y);
+    fe_sub(denominator, A.Z, A.Y);
+    fe_invert(denominator, denominator);
+    fe_mul(numerator, numerator, denominator);
+    fe_tobytes(public_key, numerator);
+
+    _olm_unset(e, sizeof(e));
+    _olm_unset(&A, sizeof(A));
+    _olm_unset(numerator, sizeof(numerator));
+    _olm_unset(denominator, sizeof(denominator));
+}
+
+void _olm_ed25519_create_keypair(
+    uint8_t * public_key, uint8_t * private_key, uint8_t const * seed
+) {
+    ed25519_create_keypair(public_key, private_key, seed);
+}
+
+void _olm_ed25519_sign(
+    uint8_t * signature,
+    uint8_t const * message, size_t message_length,
+    uint8_t const * public_key, uint8_t const * private_key
+) {
+    ed25519_sign(signature, message, message_length, public_key, private_key);
+}
+
+#endif
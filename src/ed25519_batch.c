@@ -0,0 +1,339 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "olm/ed25519_batch.h"
+
+#include "ed25519/src/ed25519.h"
+#include "ed25519/src/ge.h"
+#include "ed25519/src/sc.h"
+#include "ed25519/src/sha512.h"
+
+#include <string.h>
+
+/* The most signatures to check with one equation. The tables for each one
+ * take up to 3.5K of stack, and there is little to gain from sharing the
+ * doublings between more of them. */
+#define BATCH_MAX 16
+
+/* Each signature contributes at most two points, R and A */
+#define POINTS_MAX (2 * BATCH_MAX)
+
+/* Length of the coefficients z, in bytes */
+#define COEFFICIENT_LENGTH 16
+
+/* Sliding window recoding of a scalar into odd digits between -15 and 15,
+ * as in ge.c */
+static void slide(signed char *r, const unsigned char *a) {
+    int i;
+    int b;
+    int k;
+
+    for (i = 0; i < 256; ++i) {
+        r[i] = 1 & (a[i >> 3] >> (i & 7));
+    }
+
+    for (i = 0; i < 256; ++i) {
+        if (r[i]) {
+            for (b = 1; b <= 6 && i + b < 256; ++b) {
+                if (r[i + b]) {
+                    if (r[i] + (r[i + b] << b) <= 15) {
+                        r[i] += r[i + b] << b;
+                        r[i + b] = 0;
+                    } else if (r[i] - (r[i + b] << b) >= -15) {
+                        r[i] -= r[i + b] << b;
+
+                        for (k = i + b; k < 256; ++k) {
+                            if (!r[k]) {
+                                r[k] = 1;
+                                break;
+                            }
+
+                            r[k] = 0;
+                        }
+                    } else {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* P, 3P, 5P, ..., 15P */
+static void odd_multiples(ge_cached *table, const ge_p3 *p) {
+    ge_p1p1 t;
+    ge_p3 u;
+    ge_p3 p2;
+    int i;
+
+    ge_p3_to_cached(&table[0], p);
+    ge_p3_dbl(&t, p);
+    ge_p1p1_to_p3(&p2, &t);
+    for (i = 1; i < 8; ++i) {
+        ge_add(&t, &p2, &table[i - 1]);
+        ge_p1p1_to_p3(&u, &t);
+        ge_p3_to_cached(&table[i], &u);
+    }
+}
+
+/* Check whether
+ *     s * B + sum scalars[i] * points[i] = 0
+ * by Straus' method: one pass of doublings, adding in each point's table
+ * entries as its digits come up. */
+static int is_identity_combination(
+    const unsigned char *s,
+    const ge_p3 *points, unsigned char (*scalars)[32], size_t count
+) {
+    ge_cached tables[POINTS_MAX][8];
+    signed char digits[POINTS_MAX][256];
+    ge_cached sB_cached;
+    ge_p3 sB;
+    ge_p2 r;
+    ge_p1p1 t;
+    ge_p3 u;
+    fe check;
+    size_t j;
+    int i, top = -1;
+
+    for (j = 0; j < count; ++j) {
+        odd_multiples(tables[j], &points[j]);
+        slide(digits[j], scalars[j]);
+        for (i = 255; i > top; --i) {
+            if (digits[j][i]) {
+                top = i;
+                break;
+            }
+        }
+    }
+
+    ge_p3_0(&u);
+    ge_p2_0(&r);
+    for (i = top; i >= 0; --i) {
+        ge_p2_dbl(&t, &r);
+        for (j = 0; j < count; ++j) {
+            signed char d = digits[j][i];
+            if (d > 0) {
+                ge_p1p1_to_p3(&u, &t);
+                ge_add(&t, &u, &tables[j][d / 2]);
+            } else if (d < 0) {
+                ge_p1p1_to_p3(&u, &t);
+                ge_sub(&t, &u, &tables[j][(-d) / 2]);
+            }
+        }
+        if (i) {
+            ge_p1p1_to_p2(&r, &t);
+        } else {
+            ge_p1p1_to_p3(&u, &t);
+        }
+    }
+
+    ge_scalarmult_base(&sB, s);
+    ge_p3_to_cached(&sB_cached, &sB);
+    ge_add(&t, &u, &sB_cached);
+    ge_p1p1_to_p2(&r, &t);
+
+    /* the identity is (0, 1) */
+    fe_sub(check, r.Y, r.Z);
+    return !fe_isnonzero(r.X) && !fe_isnonzero(check);
+}
+
+/* Whether s is the only encoding of its point: y must be less than p, and x
+ * can't be given a sign if it is zero, which happens when y = 1 or y = -1.
+ */
+static int is_canonical_point(const unsigned char *s) {
+    static const unsigned char ONE[32] = {1};
+    static const unsigned char MINUS_ONE[32] = {
+        0xec, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f
+    };
+    unsigned char y[32];
+    int i;
+
+    memcpy(y, s, sizeof(y));
+    y[31] &= 0x7f;
+
+    /* p = 2^255 - 19, so y >= p when all the bits above the lowest byte
+     * are set and the lowest byte is at least 0xed */
+    for (i = 31; i > 0; --i) {
+        if (y[i] != (i == 31 ? 0x7f : 0xff)) {
+            break;
+        }
+    }
+    if (i == 0 && y[0] >= 0xed) {
+        return 0;
+    }
+
+    if ((s[31] & 0x80)
+            && (memcmp(y, ONE, 32) == 0 || memcmp(y, MINUS_ONE, 32) == 0)) {
+        return 0;
+    }
+    return 1;
+}
+
+/* Whether p is in the subgroup generated by B, that is whether L * p = 0.
+ * Points with a small-order part can satisfy the batch equation without
+ * satisfying S * B - h * A = R exactly, so they are left to ed25519_verify. */
+static int is_torsion_free(const ge_p3 *p) {
+    static const unsigned char L[32] = {
+        0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+        0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+    };
+    static const unsigned char ZERO[32] = {0};
+    ge_p2 r;
+    fe check;
+
+    ge_double_scalarmult_vartime(&r, L, p, ZERO);
+    fe_sub(check, r.Y, r.Z);
+    return !fe_isnonzero(r.X) && !fe_isnonzero(check);
+}
+
+/* Try to verify all the signatures with one equation. Returns 1 if they are
+ * all valid, and 0 if some might not be. */
+static int verify_together(
+    const struct _olm_ed25519_verify_item *items, size_t count
+) {
+    ge_p3 points[POINTS_MAX];
+    unsigned char scalars[POINTS_MAX][32];
+    size_t r_points[BATCH_MAX];
+    size_t key_points[BATCH_MAX];
+    size_t point_count = 0;
+    unsigned char h[BATCH_MAX][64];
+    unsigned char s[32];
+    unsigned char seed[64];
+    unsigned char digest[64];
+    unsigned char z[32];
+    sha512_context hash;
+    size_t i, j;
+
+    for (i = 0; i < count; ++i) {
+        const uint8_t *signature = items[i].signature;
+        const uint8_t *public_key = items[i].key->public_key;
+
+        if (signature[63] & 224) {
+            return 0;
+        }
+        /* the single verification compares R's encoding rather than the
+         * point, so only accept R here if it was encoded canonically */
+        if (!is_canonical_point(signature)) {
+            return 0;
+        }
+
+        /* decoding gives us -R and -A. Several of the signatures are often
+         * from the same key, in which case they can share its point. */
+        r_points[i] = point_count;
+        if (ge_frombytes_negate_vartime(&points[point_count], signature) != 0
+                || !is_torsion_free(&points[point_count])) {
+            return 0;
+        }
+        point_count++;
+        for (j = 0; j < i; ++j) {
+            if (memcmp(items[j].key->public_key, public_key,
+                       ED25519_PUBLIC_KEY_LENGTH) == 0) {
+                break;
+            }
+        }
+        if (j < i) {
+            key_points[i] = key_points[j];
+        } else {
+            key_points[i] = point_count;
+            if (ge_frombytes_negate_vartime(&points[point_count], public_key) != 0
+                    || !is_torsion_free(&points[point_count])) {
+                return 0;
+            }
+            point_count++;
+        }
+
+        sha512_init(&hash);
+        sha512_update(&hash, signature, 32);
+        sha512_update(&hash, public_key, 32);
+        sha512_update(&hash, items[i].message, items[i].message_length);
+        sha512_final(&hash, h[i]);
+        sc_reduce(h[i]);
+    }
+
+    /* derive the coefficients from everything in the batch */
+    sha512_init(&hash);
+    for (i = 0; i < count; ++i) {
+        sha512_update(&hash, items[i].signature, ED25519_SIGNATURE_LENGTH);
+        sha512_update(&hash, items[i].key->public_key, ED25519_PUBLIC_KEY_LENGTH);
+        sha512_update(&hash, h[i], 32);
+    }
+    sha512_final(&hash, seed);
+
+    memset(s, 0, sizeof(s));
+    memset(z, 0, sizeof(z));
+    memset(scalars, 0, sizeof(scalars));
+    for (i = 0; i < count; ++i) {
+        unsigned char index[4];
+        index[0] = (unsigned char)i;
+        index[1] = (unsigned char)(i >> 8);
+        index[2] = (unsigned char)(i >> 16);
+        index[3] = (unsigned char)(i >> 24);
+        sha512_init(&hash);
+        sha512_update(&hash, seed, sizeof(seed));
+        sha512_update(&hash, index, sizeof(index));
+        sha512_final(&hash, digest);
+        memcpy(z, digest, COEFFICIENT_LENGTH);
+
+        /* s += z * S; the coefficient of -R is z, and z * h is added to the
+         * coefficient of -A */
+        sc_muladd(s, z, items[i].signature + 32, s);
+        memcpy(scalars[r_points[i]], z, 32);
+        sc_muladd(
+            scalars[key_points[i]], z, h[i], scalars[key_points[i]]
+        );
+    }
+
+    return is_identity_combination(s, points, scalars, point_count);
+}
+
+size_t _olm_ed25519_verify_batch(
+    const struct _olm_ed25519_verify_item *items, size_t count,
+    uint8_t *results
+) {
+    size_t valid = 0;
+
+    while (count) {
+        size_t batch = count < BATCH_MAX ? count : BATCH_MAX;
+        size_t i;
+
+        if (batch > 1 && verify_together(items, batch)) {
+            for (i = 0; i < batch; ++i) {
+                results[i] = 1;
+            }
+        } else {
+            for (i = 0; i < batch; ++i) {
+                results[i] = ed25519_verify(
+                    items[i].signature,
+                    items[i].message, items[i].message_length,
+                    items[i].key->public_key
+                ) ? 1 : 0;
+            }
+        }
+        for (i = 0; i < batch; ++i) {
+            valid += results[i];
+        }
+
+        items += batch;
+        results += batch;
+        count -= batch;
+    }
+
+    return valid;
+}
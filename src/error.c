@@ -33,7 +33,9 @@ static const char * ERRORS[] = {
     "BAD_SIGNATURE",
     "OLM_INPUT_BUFFER_TOO_SMALL",
     "OLM_SAS_THEIR_KEY_NOT_SET",
-    "OLM_PICKLE_EXTRA_DATA"
+    "OLM_PICKLE_EXTRA_DATA",
+    "UNKNOWN_GROUP_SESSION",
+    "BAD_CHECKSUM"
 };
 
 const char * _olm_error_to_string(enum OlmErrorCode error)
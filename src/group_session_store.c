@@ -0,0 +1,456 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "olm/group_session_store.h"
+
+#include <string.h>
+
+#include "olm/base64.h"
+#include "olm/crypto.h"
+#include "olm/memory.h"
+#include "olm/pickle.h"
+
+/*
+ * The store is laid out as a header, the index, then the records.
+ *
+ * The header is:
+ *     "OLMS"
+ *     uint32 version
+ *     uint32 record size
+ *     uint32 capacity (the number of records there is room for)
+ *     uint32 number of index slots, a power of two at least twice the capacity
+ *     uint32 number of records used
+ *     uint32 number of sessions
+ *     32 byte key for hashing session ids, chosen at random
+ *
+ * Each index slot is a uint32: 0 if it is empty, REMOVED_SLOT if the session
+ * in it was removed, or else one more than the number of the session's
+ * record. Sessions are found by linear probing from the slot given by a hash
+ * of their session id. Session ids are public keys chosen by whoever sent us
+ * the session, so the hash is keyed with a secret of the store's: otherwise
+ * a sender could pick keys that all land in the same slots, and make every
+ * lookup probe through them.
+ *
+ * Each record is the session id, the uint32 length of the pickle, the
+ * pickle, and then padding up to the record size.
+ */
+
+#define STORE_MAGIC              "OLMS"
+#define STORE_VERSION            2
+#define STORE_HEADER_LENGTH      60
+#define RECORD_SIZE_OFFSET       8
+#define CAPACITY_OFFSET          12
+#define INDEX_SLOTS_OFFSET       16
+#define RECORD_COUNT_OFFSET      20
+#define SESSION_COUNT_OFFSET     24
+#define HASH_KEY_OFFSET          28
+#define HASH_KEY_LENGTH          32
+#define INDEX_SLOT_LENGTH        4
+#define REMOVED_SLOT             0xffffffff
+#define MAX_CAPACITY             (1 << 28)
+
+#define GROUP_SESSION_ID_LENGTH  ED25519_PUBLIC_KEY_LENGTH
+#define RECORD_HEADER_LENGTH     (GROUP_SESSION_ID_LENGTH + 4)
+
+static uint32_t _load_uint32(const uint8_t *pos) {
+    uint32_t value;
+    _olm_unpickle_uint32(pos, pos + 4, &value);
+    return value;
+}
+
+static uint32_t _header_field(
+    const OlmGroupSessionStore *store, size_t offset
+) {
+    return _load_uint32((const uint8_t *)store + offset);
+}
+
+static void _set_header_field(
+    OlmGroupSessionStore *store, size_t offset, uint32_t value
+) {
+    _olm_pickle_uint32((uint8_t *)store + offset, value);
+}
+
+static size_t _index_slots(size_t capacity) {
+    size_t slots = 2;
+    while (slots < 2 * capacity && slots <= MAX_CAPACITY) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+static uint8_t *_index_slot(const OlmGroupSessionStore *store, size_t slot) {
+    return (uint8_t *)store + STORE_HEADER_LENGTH + slot * INDEX_SLOT_LENGTH;
+}
+
+static uint8_t *_record(const OlmGroupSessionStore *store, size_t record) {
+    size_t index_slots = _header_field(store, INDEX_SLOTS_OFFSET);
+    return (uint8_t *)store + STORE_HEADER_LENGTH
+        + index_slots * INDEX_SLOT_LENGTH
+        + record * _header_field(store, RECORD_SIZE_OFFSET);
+}
+
+/** The slot that the search for a session id starts from */
+static size_t _home_slot(
+    const OlmGroupSessionStore *store, uint8_t const *session_id
+) {
+    uint8_t hash[SHA256_OUTPUT_LENGTH];
+    size_t slot;
+
+    _olm_crypto_hmac_sha256(
+        (const uint8_t *)store + HASH_KEY_OFFSET, HASH_KEY_LENGTH,
+        session_id, GROUP_SESSION_ID_LENGTH, hash
+    );
+    slot = _load_uint32(hash) & (_header_field(store, INDEX_SLOTS_OFFSET) - 1);
+    _olm_unset(hash, sizeof(hash));
+    return slot;
+}
+
+/**
+ * Find the index slot for a session id. If the session is in the store, this
+ * is the slot that points at its record. Otherwise, it is the first slot that
+ * a new record for it could go in, which may be one left by a removed
+ * session, and *found is set to 0.
+ */
+static size_t _find_slot(
+    const OlmGroupSessionStore *store, uint8_t const *session_id, int *found
+) {
+    size_t mask = _header_field(store, INDEX_SLOTS_OFFSET) - 1;
+    size_t record_count = _header_field(store, RECORD_COUNT_OFFSET);
+    size_t slot = _home_slot(store, session_id);
+    size_t free_slot = (size_t)-1;
+    size_t probes;
+
+    /* there is always an empty slot, since there are at least twice as many
+     * slots as records, but a corrupted store might not have one */
+    for (probes = 0; probes <= mask; probes++, slot = (slot + 1) & mask) {
+        uint32_t entry = _load_uint32(_index_slot(store, slot));
+        if (entry == 0) {
+            break;
+        }
+        if (entry == REMOVED_SLOT) {
+            if (free_slot == (size_t)-1) {
+                free_slot = slot;
+            }
+        } else if (entry <= record_count && !memcmp(
+                _record(store, entry - 1), session_id,
+                GROUP_SESSION_ID_LENGTH)) {
+            *found = 1;
+            return slot;
+        }
+    }
+    *found = 0;
+    return free_slot != (size_t)-1 ? free_slot : slot;
+}
+
+/**
+ * Decode a base64 session id. Returns OLM_SUCCESS, OLM_INVALID_BASE64, or
+ * OLM_UNKNOWN_GROUP_SESSION if it is the wrong length to be a session id.
+ */
+static enum OlmErrorCode _decode_session_id(
+    uint8_t const * session_id, size_t session_id_length,
+    uint8_t *output
+) {
+    size_t length = _olm_decode_base64_length(session_id_length);
+    if (length == (size_t)-1) {
+        return OLM_INVALID_BASE64;
+    }
+    if (length != GROUP_SESSION_ID_LENGTH) {
+        return OLM_UNKNOWN_GROUP_SESSION;
+    }
+    _olm_decode_base64(session_id, session_id_length, output);
+    return OLM_SUCCESS;
+}
+
+/** The record that the next session will be written to */
+static uint8_t *_next_record(const OlmGroupSessionStore *store) {
+    return _record(store, _header_field(store, RECORD_COUNT_OFFSET));
+}
+
+/**
+ * Take the next record, once the caller has written it, and point the index
+ * slot at it. The caller checks that there is a record free.
+ */
+static void _append_record(
+    OlmGroupSessionStore *store, size_t slot, int found
+) {
+    uint32_t record_count = _header_field(store, RECORD_COUNT_OFFSET);
+
+    /* the record is counted before the index points at it, so that the
+     * index never points past the records */
+    _set_header_field(store, RECORD_COUNT_OFFSET, record_count + 1);
+    _olm_pickle_uint32(_index_slot(store, slot), record_count + 1);
+    if (!found) {
+        _set_header_field(
+            store, SESSION_COUNT_OFFSET,
+            _header_field(store, SESSION_COUNT_OFFSET) + 1
+        );
+    }
+}
+
+size_t olm_group_session_store_record_size(size_t checkpoints) {
+    return RECORD_HEADER_LENGTH
+        + olm_pickle_inbound_group_session_binary_max_length(checkpoints);
+}
+
+size_t olm_group_session_store_init_random_length(void) {
+    return HASH_KEY_LENGTH;
+}
+
+size_t olm_group_session_store_length(size_t record_size, size_t capacity) {
+    return STORE_HEADER_LENGTH
+        + _index_slots(capacity) * INDEX_SLOT_LENGTH
+        + capacity * record_size;
+}
+
+OlmGroupSessionStore * olm_group_session_store_init(
+    void *memory, size_t memory_length,
+    size_t record_size, size_t capacity,
+    uint8_t *random, size_t random_length
+) {
+    OlmGroupSessionStore *store = memory;
+    size_t index_slots = _index_slots(capacity);
+
+    if (random_length < HASH_KEY_LENGTH
+            || capacity == 0 || capacity > MAX_CAPACITY
+            || record_size < olm_group_session_store_record_size(0)
+            || (uint64_t)record_size > 0xffffffff
+            || capacity > ((size_t)-1 - STORE_HEADER_LENGTH
+                - index_slots * INDEX_SLOT_LENGTH) / record_size
+            || memory_length
+                < olm_group_session_store_length(record_size, capacity)) {
+        return NULL;
+    }
+
+    memcpy(memory, STORE_MAGIC, 4);
+    _olm_pickle_uint32((uint8_t *)memory + 4, STORE_VERSION);
+    _set_header_field(store, RECORD_SIZE_OFFSET, (uint32_t)record_size);
+    _set_header_field(store, CAPACITY_OFFSET, (uint32_t)capacity);
+    _set_header_field(store, INDEX_SLOTS_OFFSET, (uint32_t)index_slots);
+    _set_header_field(store, RECORD_COUNT_OFFSET, 0);
+    _set_header_field(store, SESSION_COUNT_OFFSET, 0);
+    memcpy((uint8_t *)memory + HASH_KEY_OFFSET, random, HASH_KEY_LENGTH);
+    _olm_unset(random, random_length);
+    memset(_index_slot(store, 0), 0, index_slots * INDEX_SLOT_LENGTH);
+    return store;
+}
+
+OlmGroupSessionStore * olm_group_session_store_open(
+    void *memory, size_t memory_length
+) {
+    OlmGroupSessionStore *store = memory;
+    size_t record_size, capacity;
+
+    if (memory_length < STORE_HEADER_LENGTH
+            || memcmp(memory, STORE_MAGIC, 4)
+            || _load_uint32((uint8_t *)memory + 4) != STORE_VERSION) {
+        return NULL;
+    }
+
+    record_size = _header_field(store, RECORD_SIZE_OFFSET);
+    capacity = _header_field(store, CAPACITY_OFFSET);
+    if (capacity == 0 || capacity > MAX_CAPACITY
+            || record_size < olm_group_session_store_record_size(0)
+            || _header_field(store, INDEX_SLOTS_OFFSET)
+                != _index_slots(capacity)
+            || _header_field(store, RECORD_COUNT_OFFSET) > capacity
+            || _header_field(store, SESSION_COUNT_OFFSET)
+                > _header_field(store, RECORD_COUNT_OFFSET)
+            || capacity > ((size_t)-1 - STORE_HEADER_LENGTH
+                - _index_slots(capacity) * INDEX_SLOT_LENGTH) / record_size
+            || memory_length
+                < olm_group_session_store_length(record_size, capacity)) {
+        return NULL;
+    }
+    return store;
+}
+
+size_t olm_group_session_store_session_count(
+    const OlmGroupSessionStore *store
+) {
+    return _header_field(store, SESSION_COUNT_OFFSET);
+}
+
+size_t olm_group_session_store_record_count(
+    const OlmGroupSessionStore *store
+) {
+    return _header_field(store, RECORD_COUNT_OFFSET);
+}
+
+size_t olm_group_session_store_capacity(
+    const OlmGroupSessionStore *store
+) {
+    return _header_field(store, CAPACITY_OFFSET);
+}
+
+enum OlmErrorCode olm_group_session_store_put(
+    OlmGroupSessionStore *store,
+    OlmPickleKey const * pickle_key,
+    OlmInboundGroupSession *session,
+    void *scratch, size_t scratch_length
+) {
+    size_t record_size = _header_field(store, RECORD_SIZE_OFFSET);
+    uint8_t session_id[GROUP_SESSION_ID_LENGTH];
+    /* room for the base64 session id */
+    uint8_t encoded_id[2 * GROUP_SESSION_ID_LENGTH];
+    size_t encoded_id_length, pickle_length, slot;
+    uint8_t *record;
+    int found;
+
+    if (_header_field(store, RECORD_COUNT_OFFSET)
+            >= _header_field(store, CAPACITY_OFFSET)
+            || olm_pickle_inbound_group_session_binary_length(session)
+                > record_size - RECORD_HEADER_LENGTH
+            || scratch_length < record_size) {
+        return OLM_OUTPUT_BUFFER_TOO_SMALL;
+    }
+
+    encoded_id_length = olm_inbound_group_session_id(
+        session, encoded_id, sizeof(encoded_id)
+    );
+    _olm_decode_base64(encoded_id, encoded_id_length, session_id);
+
+    /* the pickle is only encrypted once it has been written, so it is made
+     * in the scratch buffer rather than in the store */
+    pickle_length = olm_pickle_inbound_group_session_binary(
+        session, pickle_key, scratch, scratch_length
+    );
+
+    record = _next_record(store);
+    memcpy(record, session_id, GROUP_SESSION_ID_LENGTH);
+    _olm_pickle_uint32(record + GROUP_SESSION_ID_LENGTH, (uint32_t)pickle_length);
+    memcpy(record + RECORD_HEADER_LENGTH, scratch, pickle_length);
+    memset(
+        record + RECORD_HEADER_LENGTH + pickle_length, 0,
+        record_size - RECORD_HEADER_LENGTH - pickle_length
+    );
+    _olm_unset(scratch, pickle_length);
+
+    slot = _find_slot(store, session_id, &found);
+    _append_record(store, slot, found);
+    return OLM_SUCCESS;
+}
+
+enum OlmErrorCode olm_group_session_store_get(
+    const OlmGroupSessionStore *store,
+    OlmPickleKey const * pickle_key,
+    uint8_t const * session_id, size_t session_id_length,
+    OlmInboundGroupSession *session,
+    void *scratch, size_t scratch_length
+) {
+    size_t record_size = _header_field(store, RECORD_SIZE_OFFSET);
+    uint8_t decoded_id[GROUP_SESSION_ID_LENGTH];
+    enum OlmErrorCode error;
+    uint8_t const *record;
+    uint32_t pickle_length;
+    size_t slot, result;
+    int found;
+
+    error = _decode_session_id(session_id, session_id_length, decoded_id);
+    if (error != OLM_SUCCESS) {
+        return error;
+    }
+    slot = _find_slot(store, decoded_id, &found);
+    if (!found) {
+        return OLM_UNKNOWN_GROUP_SESSION;
+    }
+    if (scratch_length < record_size) {
+        return OLM_OUTPUT_BUFFER_TOO_SMALL;
+    }
+
+    record = _record(store, _load_uint32(_index_slot(store, slot)) - 1);
+    pickle_length = _load_uint32(record + GROUP_SESSION_ID_LENGTH);
+    if (pickle_length > record_size - RECORD_HEADER_LENGTH) {
+        return OLM_CORRUPTED_PICKLE;
+    }
+
+    memcpy(scratch, record + RECORD_HEADER_LENGTH, pickle_length);
+    result = olm_unpickle_inbound_group_session_binary(
+        session, pickle_key, scratch, pickle_length
+    );
+    _olm_unset(scratch, pickle_length);
+    if (result == (size_t)-1) {
+        return olm_inbound_group_session_last_error_code(session);
+    }
+    return OLM_SUCCESS;
+}
+
+enum OlmErrorCode olm_group_session_store_remove(
+    OlmGroupSessionStore *store,
+    uint8_t const * session_id, size_t session_id_length
+) {
+    uint8_t decoded_id[GROUP_SESSION_ID_LENGTH];
+    enum OlmErrorCode error;
+    size_t slot;
+    int found;
+
+    error = _decode_session_id(session_id, session_id_length, decoded_id);
+    if (error != OLM_SUCCESS) {
+        return error;
+    }
+    slot = _find_slot(store, decoded_id, &found);
+    if (!found) {
+        return OLM_UNKNOWN_GROUP_SESSION;
+    }
+
+    _olm_pickle_uint32(_index_slot(store, slot), REMOVED_SLOT);
+    _set_header_field(
+        store, SESSION_COUNT_OFFSET,
+        _header_field(store, SESSION_COUNT_OFFSET) - 1
+    );
+    return OLM_SUCCESS;
+}
+
+enum OlmErrorCode olm_group_session_store_compact(
+    const OlmGroupSessionStore *from,
+    OlmGroupSessionStore *to,
+    size_t *position, size_t max_records
+) {
+    size_t from_record_size = _header_field(from, RECORD_SIZE_OFFSET);
+    size_t to_record_size = _header_field(to, RECORD_SIZE_OFFSET);
+    size_t record_count = _header_field(from, RECORD_COUNT_OFFSET);
+
+    while (max_records-- && *position < record_count) {
+        uint8_t const *record = _record(from, *position);
+        uint32_t pickle_length = _load_uint32(record + GROUP_SESSION_ID_LENGTH);
+        size_t slot;
+        int found;
+
+        /* only copy the record if it's the one the index points at */
+        slot = _find_slot(from, record, &found);
+        if (!found || _load_uint32(_index_slot(from, slot)) != *position + 1) {
+            ++*position;
+            continue;
+        }
+
+        if (pickle_length > from_record_size - RECORD_HEADER_LENGTH) {
+            return OLM_CORRUPTED_PICKLE;
+        }
+        if (_header_field(to, RECORD_COUNT_OFFSET)
+                >= _header_field(to, CAPACITY_OFFSET)
+                || pickle_length > to_record_size - RECORD_HEADER_LENGTH) {
+            return OLM_OUTPUT_BUFFER_TOO_SMALL;
+        }
+
+        memcpy(_next_record(to), record, RECORD_HEADER_LENGTH + pickle_length);
+        memset(
+            _next_record(to) + RECORD_HEADER_LENGTH + pickle_length, 0,
+            to_record_size - RECORD_HEADER_LENGTH - pickle_length
+        );
+        slot = _find_slot(to, record, &found);
+        _append_record(to, slot, found);
+        ++*position;
+    }
+    return OLM_SUCCESS;
+}
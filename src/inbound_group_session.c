@@ -30,10 +30,19 @@
 
 #define OLM_PROTOCOL_VERSION     3
 #define GROUP_SESSION_ID_LENGTH  ED25519_PUBLIC_KEY_LENGTH
-#define PICKLE_VERSION           2
+#define PICKLE_VERSION           4
 #define SESSION_KEY_VERSION      2
 #define SESSION_EXPORT_VERSION   1
 
+/** An entry in the derived key cache */
+struct _key_cache_entry {
+    /** the keys derived from the ratchet value at message_index */
+    struct _olm_cipher_aes_sha_256_keys keys;
+    uint32_t message_index;
+    /** the value of key_cache_clock when the entry was last used */
+    uint32_t last_used;
+};
+
 struct OlmInboundGroupSession {
     /** our earliest known ratchet value */
     Megolm initial_ratchet;
@@ -55,6 +64,29 @@ struct OlmInboundGroupSession {
      */
     int signing_key_verified;
 
+    /**
+     * Optional table of ratchet values at R(1) and R(2) boundaries that we
+     * have passed, ordered by index from initial_ratchet, so that decrypting
+     * an old message can start from the nearest one rather than from
+     * initial_ratchet. The memory is supplied by the application.
+     */
+    Megolm *checkpoints;
+    size_t checkpoints_count;
+    size_t checkpoints_max;
+
+    /**
+     * Optional cache of the keys derived for recently decrypted messages, so
+     * that decrypting one again skips the ratchet and the HKDF. The least
+     * recently used entry is replaced when it is full. The memory is
+     * supplied by the application.
+     */
+    struct _key_cache_entry *key_cache;
+    size_t key_cache_count;
+    size_t key_cache_max;
+    uint32_t key_cache_clock;
+    size_t key_cache_hits;
+    size_t key_cache_misses;
+
     enum OlmErrorCode last_error;
 };
 
@@ -66,7 +98,7 @@ OlmInboundGroupSession * olm_inbound_group_session(
     void *memory
 ) {
     OlmInboundGroupSession *session = memory;
-    olm_clear_inbound_group_session(session);
+    _olm_unset(session, sizeof(OlmInboundGroupSession));
     return session;
 }
 
@@ -85,10 +117,390 @@ enum OlmErrorCode olm_inbound_group_session_last_error_code(
 size_t olm_clear_inbound_group_session(
     OlmInboundGroupSession *session
 ) {
+    if (session->checkpoints) {
+        _olm_unset(
+            session->checkpoints, session->checkpoints_max * sizeof(Megolm)
+        );
+    }
+    if (session->key_cache) {
+        _olm_unset(
+            session->key_cache,
+            session->key_cache_max * sizeof(struct _key_cache_entry)
+        );
+    }
     _olm_unset(session, sizeof(OlmInboundGroupSession));
     return sizeof(OlmInboundGroupSession);
 }
 
+size_t olm_inbound_group_session_checkpoint_size(void) {
+    return sizeof(Megolm);
+}
+
+/** Wipe the bytes of old that aren't also part of keep. The two ranges may
+ * overlap, if a table is moved within the same buffer. */
+static void _unset_outside(
+    void *old, size_t old_length, const void *keep, size_t keep_length
+) {
+    uintptr_t old_start = (uintptr_t)old;
+    uintptr_t old_end = old_start + old_length;
+    uintptr_t keep_start = (uintptr_t)keep;
+    uintptr_t keep_end = keep_start + keep_length;
+
+    if (keep_length == 0 || keep_end <= old_start || keep_start >= old_end) {
+        _olm_unset(old, old_length);
+        return;
+    }
+    if (keep_start > old_start) {
+        _olm_unset(old, keep_start - old_start);
+    }
+    if (keep_end < old_end) {
+        _olm_unset((uint8_t *)old + (keep_end - old_start), old_end - keep_end);
+    }
+}
+
+size_t olm_inbound_group_session_set_checkpoints(
+    OlmInboundGroupSession *session,
+    void *memory, size_t memory_length
+) {
+    Megolm *checkpoints = memory;
+    size_t checkpoints_max = memory ? memory_length / sizeof(Megolm) : 0;
+    size_t keep = session->checkpoints_count;
+
+    /* move over as many of the latest checkpoints as will fit */
+    if (keep > checkpoints_max) {
+        keep = checkpoints_max;
+    }
+    if (keep) {
+        memmove(
+            checkpoints,
+            session->checkpoints + session->checkpoints_count - keep,
+            keep * sizeof(Megolm)
+        );
+    }
+    if (session->checkpoints) {
+        _unset_outside(
+            session->checkpoints, session->checkpoints_max * sizeof(Megolm),
+            checkpoints, checkpoints_max * sizeof(Megolm)
+        );
+    }
+
+    session->checkpoints = checkpoints_max ? checkpoints : NULL;
+    session->checkpoints_count = keep;
+    session->checkpoints_max = checkpoints_max;
+    return checkpoints_max;
+}
+
+size_t olm_inbound_group_session_key_cache_entry_size(void) {
+    return sizeof(struct _key_cache_entry);
+}
+
+/** Wipe the entries in the key cache, if there is one. */
+static void _clear_key_cache(OlmInboundGroupSession *session) {
+    if (session->key_cache) {
+        _olm_unset(
+            session->key_cache,
+            session->key_cache_count * sizeof(struct _key_cache_entry)
+        );
+    }
+    session->key_cache_count = 0;
+}
+
+size_t olm_inbound_group_session_set_key_cache(
+    OlmInboundGroupSession *session,
+    void *memory, size_t memory_length
+) {
+    size_t key_cache_max = memory
+        ? memory_length / sizeof(struct _key_cache_entry) : 0;
+
+    _clear_key_cache(session);
+    session->key_cache = key_cache_max ? memory : NULL;
+    session->key_cache_max = key_cache_max;
+    session->key_cache_clock = 0;
+    session->key_cache_hits = 0;
+    session->key_cache_misses = 0;
+    return key_cache_max;
+}
+
+size_t olm_inbound_group_session_key_cache_hits(
+    const OlmInboundGroupSession *session
+) {
+    return session->key_cache_hits;
+}
+
+size_t olm_inbound_group_session_key_cache_misses(
+    const OlmInboundGroupSession *session
+) {
+    return session->key_cache_misses;
+}
+
+/**
+ * Look up the keys for a message index in the key cache, counting a hit or a
+ * miss. Returns NULL on a miss, or if there is no cache.
+ */
+static const struct _olm_cipher_aes_sha_256_keys *_find_cached_keys(
+    OlmInboundGroupSession *session, uint32_t message_index
+) {
+    size_t i;
+
+    if (!session->key_cache) {
+        return NULL;
+    }
+    for (i = 0; i < session->key_cache_count; i++) {
+        struct _key_cache_entry *entry = &session->key_cache[i];
+        if (entry->message_index == message_index) {
+            entry->last_used = ++session->key_cache_clock;
+            session->key_cache_hits++;
+            return &entry->keys;
+        }
+    }
+    session->key_cache_misses++;
+    return NULL;
+}
+
+/**
+ * Add the keys for a message index to the key cache, if there is one,
+ * replacing the least recently used entry if it is full.
+ */
+static void _cache_keys(
+    OlmInboundGroupSession *session, uint32_t message_index,
+    const struct _olm_cipher_aes_sha_256_keys *keys
+) {
+    struct _key_cache_entry *entry;
+    size_t i;
+
+    if (!session->key_cache) {
+        return;
+    }
+    if (session->key_cache_count < session->key_cache_max) {
+        entry = &session->key_cache[session->key_cache_count++];
+    } else {
+        /* ages are measured from the clock so that wraparound is harmless */
+        entry = &session->key_cache[0];
+        for (i = 1; i < session->key_cache_count; i++) {
+            if (session->key_cache_clock - session->key_cache[i].last_used
+                    > session->key_cache_clock - entry->last_used) {
+                entry = &session->key_cache[i];
+            }
+        }
+        _olm_unset(entry, sizeof(*entry));
+    }
+    entry->keys = *keys;
+    entry->message_index = message_index;
+    entry->last_used = ++session->key_cache_clock;
+}
+
+/**
+ * Check the mac and decrypt a message with the keys derived from a ratchet
+ * value, caching the keys if it succeeds.
+ */
+static size_t _decrypt_with_megolm(
+    OlmInboundGroupSession *session, const Megolm *megolm,
+    uint8_t const * message, size_t message_length,
+    uint8_t const * ciphertext, size_t ciphertext_length,
+    uint8_t * plaintext, size_t max_plaintext_length
+) {
+    struct _olm_cipher_aes_sha_256_keys keys;
+    size_t r;
+
+    _olm_cipher_aes_sha_256_derive_keys(
+        (const struct _olm_cipher_aes_sha_256 *)megolm_cipher,
+        megolm_get_data(megolm), MEGOLM_RATCHET_LENGTH, &keys
+    );
+    r = _olm_cipher_aes_sha_256_decrypt_with_keys(
+        &keys, message, message_length, ciphertext, ciphertext_length,
+        plaintext, max_plaintext_length
+    );
+    if (r != (size_t)-1) {
+        _cache_keys(session, megolm->counter, &keys);
+    }
+    _olm_unset(&keys, sizeof(keys));
+    return r;
+}
+
+/**
+ * Add a ratchet value at an R(1) or R(2) boundary to the checkpoint table,
+ * keeping the table in order. If the table is full, the earliest checkpoint
+ * that is not at an R(1) boundary is dropped, or the earliest of all if they
+ * all are.
+ */
+static void _add_checkpoint(
+    OlmInboundGroupSession *session, const Megolm *megolm
+) {
+    uint32_t offset = megolm->counter - session->initial_ratchet.counter;
+    size_t lo = 0, hi = session->checkpoints_count, evict, i;
+
+    /* find the first checkpoint at or after this one */
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint32_t mid_offset = session->checkpoints[mid].counter
+            - session->initial_ratchet.counter;
+        if (mid_offset < offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < session->checkpoints_count
+            && session->checkpoints[lo].counter == megolm->counter) {
+        return;
+    }
+
+    if (session->checkpoints_count == session->checkpoints_max) {
+        for (evict = 0; evict < session->checkpoints_count; evict++) {
+            if (session->checkpoints[evict].counter & 0xffff) {
+                break;
+            }
+        }
+        if (megolm->counter & 0xffff) {
+            if (lo <= evict) {
+                /* the new checkpoint would be the one to go */
+                return;
+            }
+        } else if (evict == session->checkpoints_count) {
+            if (lo == 0) {
+                return;
+            }
+            evict = 0;
+        }
+        for (i = evict; i + 1 < session->checkpoints_count; i++) {
+            session->checkpoints[i] = session->checkpoints[i + 1];
+        }
+        session->checkpoints_count--;
+        _olm_unset(
+            &session->checkpoints[session->checkpoints_count], sizeof(Megolm)
+        );
+        if (evict < lo) {
+            lo--;
+        }
+    }
+
+    for (i = session->checkpoints_count; i > lo; i--) {
+        session->checkpoints[i] = session->checkpoints[i - 1];
+    }
+    session->checkpoints[lo] = *megolm;
+    session->checkpoints_count++;
+}
+
+/**
+ * Find the latest checkpoint at or before the given index, which must not be
+ * before initial_ratchet. Returns NULL if there isn't one.
+ */
+static const Megolm *_find_checkpoint(
+    const OlmInboundGroupSession *session, uint32_t message_index
+) {
+    uint32_t offset = message_index - session->initial_ratchet.counter;
+    size_t lo = 0, hi = session->checkpoints_count;
+
+    /* find the first checkpoint after the index */
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint32_t mid_offset = session->checkpoints[mid].counter
+            - session->initial_ratchet.counter;
+        if (mid_offset <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo ? &session->checkpoints[lo - 1] : NULL;
+}
+
+/** the number of checkpoints a PendingCheckpoints holds before it falls back
+ * to working them out again */
+#define PENDING_CHECKPOINTS_MAX 4
+
+/**
+ * The checkpoints reached while working out the ratchet for a message. They
+ * are only added to the table once the message has been authenticated, so that
+ * forged messages can't fill the table with checkpoints nobody needs.
+ *
+ * Decrypting messages in order crosses at most one boundary at a time. If a
+ * jump crosses more than PENDING_CHECKPOINTS_MAX of them, only the starting
+ * point is kept, and the ratchet is advanced again from there to add them.
+ */
+typedef struct PendingCheckpoints {
+    Megolm start;
+    uint32_t advance_to;
+    size_t count;
+    int overflowed;
+    Megolm checkpoints[PENDING_CHECKPOINTS_MAX];
+} PendingCheckpoints;
+
+static void _checkpoint_reached(
+    OlmInboundGroupSession *session, const Megolm *megolm,
+    PendingCheckpoints *pending
+) {
+    if (!pending) {
+        _add_checkpoint(session, megolm);
+    } else if (pending->count < PENDING_CHECKPOINTS_MAX) {
+        pending->checkpoints[pending->count++] = *megolm;
+    } else {
+        pending->overflowed = 1;
+    }
+}
+
+/**
+ * Advance the ratchet to the given index, recording checkpoints on the way,
+ * either straight into the table or, if pending is not NULL, into pending to
+ * be added by _commit_checkpoints.
+ *
+ * Rather than jumping straight there, stop at each R(1) boundary in the last
+ * R(0) period, and each R(2) boundary in the last R(1) period, before the
+ * index. This costs a few more hashes than megolm_advance_to.
+ */
+static void _advance_with_checkpoints(
+    OlmInboundGroupSession *session, Megolm *megolm, uint32_t advance_to,
+    PendingCheckpoints *pending
+) {
+    if (pending) {
+        pending->count = 0;
+        pending->overflowed = 0;
+    }
+    if (!session->checkpoints) {
+        megolm_advance_to(megolm, advance_to);
+        return;
+    }
+    if (pending) {
+        pending->start = *megolm;
+        pending->advance_to = advance_to;
+    }
+
+    if (advance_to - megolm->counter >= 0x1000000 - (megolm->counter & 0xffffff)) {
+        megolm_advance_to(megolm, advance_to & 0xff000000);
+        _checkpoint_reached(session, megolm, pending);
+    }
+    while (advance_to - megolm->counter >= 0x10000 - (megolm->counter & 0xffff)) {
+        megolm_advance_to(megolm, (megolm->counter | 0xffff) + 1);
+        _checkpoint_reached(session, megolm, pending);
+    }
+    while (advance_to - megolm->counter >= 0x100 - (megolm->counter & 0xff)) {
+        megolm_advance_to(megolm, (megolm->counter | 0xff) + 1);
+        _checkpoint_reached(session, megolm, pending);
+    }
+    megolm_advance_to(megolm, advance_to);
+}
+
+/**
+ * Add the checkpoints reached for a message that has now been authenticated
+ * to the table.
+ */
+static void _commit_checkpoints(
+    OlmInboundGroupSession *session, PendingCheckpoints *pending
+) {
+    size_t i;
+
+    if (pending->overflowed) {
+        Megolm megolm = pending->start;
+        _advance_with_checkpoints(session, &megolm, pending->advance_to, NULL);
+        _olm_unset(&megolm, sizeof(megolm));
+    } else {
+        for (i = 0; i < pending->count; i++) {
+            _add_checkpoint(session, &pending->checkpoints[i]);
+        }
+    }
+    _olm_unset(pending, sizeof(*pending));
+}
+
 #define SESSION_EXPORT_RAW_LENGTH \
     (1 + 4 + MEGOLM_RATCHET_LENGTH + ED25519_PUBLIC_KEY_LENGTH)
 
@@ -119,6 +531,17 @@ static size_t _init_group_session_keys(
 
     megolm_init(&session->initial_ratchet, ptr, counter);
     megolm_init(&session->latest_ratchet, ptr, counter);
+    _clear_key_cache(session);
+    /* set again below if the key is signed; an export isn't, so the key is
+     * only verified once a message signed with it has been decrypted */
+    session->signing_key_verified = 0;
+
+    if (session->checkpoints) {
+        _olm_unset(
+            session->checkpoints, session->checkpoints_count * sizeof(Megolm)
+        );
+    }
+    session->checkpoints_count = 0;
 
     ptr += MEGOLM_RATCHET_LENGTH;
     memcpy(
@@ -187,18 +610,88 @@ size_t olm_import_inbound_group_session(
     return result;
 }
 
+/**
+ * Which parts of latest_ratchet differ from initial_ratchet, as a bit mask
+ * with bit i for R(i). Zero means that they are the same.
+ */
+static uint8_t _latest_ratchet_parts(const OlmInboundGroupSession *session) {
+    uint8_t parts = 0;
+    int i;
+    for (i = 0; i < MEGOLM_RATCHET_PARTS; i++) {
+        if (memcmp(
+                session->initial_ratchet.data[i],
+                session->latest_ratchet.data[i],
+                MEGOLM_RATCHET_PART_LENGTH)) {
+            parts |= 1 << i;
+        }
+    }
+    /* R(3) changes on every step, so this can't really happen, but the
+     * counter has to be kept if it differs */
+    if (!parts
+            && session->initial_ratchet.counter
+                != session->latest_ratchet.counter) {
+        parts = 1 << (MEGOLM_RATCHET_PARTS - 1);
+    }
+    return parts;
+}
+
 static size_t raw_pickle_length(
     const OlmInboundGroupSession *session
 ) {
+    uint8_t parts = _latest_ratchet_parts(session);
     size_t length = 0;
+    int i;
     length += _olm_pickle_uint32_length(PICKLE_VERSION);
     length += megolm_pickle_length(&session->initial_ratchet);
-    length += megolm_pickle_length(&session->latest_ratchet);
+    /* only the parts of latest_ratchet that differ */
+    length += _olm_pickle_uint8_length(parts);
+    if (parts) {
+        length += _olm_pickle_uint32_length(session->latest_ratchet.counter);
+        for (i = 0; i < MEGOLM_RATCHET_PARTS; i++) {
+            if (parts & (1 << i)) {
+                length += MEGOLM_RATCHET_PART_LENGTH;
+            }
+        }
+    }
     length += _olm_pickle_ed25519_public_key_length(&session->signing_key);
     length += _olm_pickle_bool_length(session->signing_key_verified);
+    length += _olm_pickle_uint32_length((uint32_t)session->checkpoints_count);
+    if (session->checkpoints_count) {
+        length += session->checkpoints_count
+            * megolm_pickle_length(&session->checkpoints[0]);
+    }
     return length;
 }
 
+static uint8_t * _pickle(
+    const OlmInboundGroupSession *session, uint8_t *pos
+) {
+    uint8_t parts = _latest_ratchet_parts(session);
+    size_t i;
+
+    pos = _olm_pickle_uint32(pos, PICKLE_VERSION);
+    pos = megolm_pickle(&session->initial_ratchet, pos);
+    pos = _olm_pickle_uint8(pos, parts);
+    if (parts) {
+        pos = _olm_pickle_uint32(pos, session->latest_ratchet.counter);
+        for (i = 0; i < MEGOLM_RATCHET_PARTS; i++) {
+            if (parts & (1 << i)) {
+                pos = _olm_pickle_bytes(
+                    pos, session->latest_ratchet.data[i],
+                    MEGOLM_RATCHET_PART_LENGTH
+                );
+            }
+        }
+    }
+    pos = _olm_pickle_ed25519_public_key(pos, &session->signing_key);
+    pos = _olm_pickle_bool(pos, session->signing_key_verified);
+    pos = _olm_pickle_uint32(pos, (uint32_t)session->checkpoints_count);
+    for (i = 0; i < session->checkpoints_count; i++) {
+        pos = megolm_pickle(&session->checkpoints[i], pos);
+    }
+    return pos;
+}
+
 size_t olm_pickle_inbound_group_session_length(
     const OlmInboundGroupSession *session
 ) {
@@ -209,23 +702,71 @@ size_t olm_pickle_inbound_group_session(
     OlmInboundGroupSession *session,
     void const * key, size_t key_length,
     void * pickled, size_t pickled_length
+) {
+    OlmPickleKey pickle_key;
+    size_t result;
+    _olm_pickle_key_init(&pickle_key, key, key_length);
+    result = olm_pickle_inbound_group_session_with_key(
+        session, &pickle_key, pickled, pickled_length
+    );
+    _olm_unset(&pickle_key, sizeof(pickle_key));
+    return result;
+}
+
+size_t olm_pickle_inbound_group_session_with_key(
+    OlmInboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
 ) {
     size_t raw_length = raw_pickle_length(session);
-    uint8_t *pos;
 
     if (pickled_length < _olm_enc_output_length(raw_length)) {
         session->last_error = OLM_OUTPUT_BUFFER_TOO_SMALL;
         return (size_t)-1;
     }
 
-    pos = _olm_enc_output_pos(pickled, raw_length);
-    pos = _olm_pickle_uint32(pos, PICKLE_VERSION);
-    pos = megolm_pickle(&session->initial_ratchet, pos);
-    pos = megolm_pickle(&session->latest_ratchet, pos);
-    pos = _olm_pickle_ed25519_public_key(pos, &session->signing_key);
-    pos = _olm_pickle_bool(pos, session->signing_key_verified);
+    _pickle(session, _olm_enc_output_pos(pickled, raw_length));
+    return _olm_enc_output_with_key(pickle_key, pickled, raw_length);
+}
+
+size_t olm_pickle_inbound_group_session_binary_length(
+    const OlmInboundGroupSession *session
+) {
+    return _olm_enc_output_binary_length(raw_pickle_length(session));
+}
 
-    return _olm_enc_output(key, key_length, pickled, raw_length);
+size_t olm_pickle_inbound_group_session_binary_max_length(
+    size_t checkpoints
+) {
+    /* a pickled megolm is its data and counter */
+    size_t megolm_length = MEGOLM_RATCHET_LENGTH + _olm_pickle_uint32_length(0);
+    size_t length = 0;
+    length += _olm_pickle_uint32_length(PICKLE_VERSION);
+    length += megolm_length;
+    /* all the parts of latest_ratchet */
+    length += _olm_pickle_uint8_length(0);
+    length += megolm_length;
+    length += ED25519_PUBLIC_KEY_LENGTH;
+    length += _olm_pickle_bool_length(0);
+    length += _olm_pickle_uint32_length(0);
+    length += checkpoints * megolm_length;
+    return _olm_enc_output_binary_length(length);
+}
+
+size_t olm_pickle_inbound_group_session_binary(
+    OlmInboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+) {
+    size_t raw_length = raw_pickle_length(session);
+
+    if (pickled_length < _olm_enc_output_binary_length(raw_length)) {
+        session->last_error = OLM_OUTPUT_BUFFER_TOO_SMALL;
+        return (size_t)-1;
+    }
+
+    _pickle(session, pickled);
+    return _olm_enc_output_binary_with_key(pickle_key, pickled, raw_length);
 }
 
 size_t olm_unpickle_inbound_group_session(
@@ -233,19 +774,24 @@ size_t olm_unpickle_inbound_group_session(
     void const * key, size_t key_length,
     void * pickled, size_t pickled_length
 ) {
-    const uint8_t *pos;
-    const uint8_t *end;
-    uint32_t pickle_version;
-
-    size_t raw_length = _olm_enc_input(
-        key, key_length, pickled, pickled_length, &(session->last_error)
+    OlmPickleKey pickle_key;
+    size_t result;
+    _olm_pickle_key_init(&pickle_key, key, key_length);
+    result = olm_unpickle_inbound_group_session_with_key(
+        session, &pickle_key, pickled, pickled_length
     );
-    if (raw_length == (size_t)-1) {
-        return raw_length;
-    }
+    _olm_unset(&pickle_key, sizeof(pickle_key));
+    return result;
+}
 
-    pos = pickled;
-    end = pos + raw_length;
+/**
+ * Read a decrypted pickle. Returns 0 on success, or olm_error() on failure.
+ */
+static size_t _unpickle(
+    OlmInboundGroupSession *session,
+    const uint8_t *pos, const uint8_t *end
+) {
+    uint32_t pickle_version;
 
     pos = _olm_unpickle_uint32(pos, end, &pickle_version);
     FAIL_ON_CORRUPTED_PICKLE(pos, session);
@@ -255,11 +801,45 @@ size_t olm_unpickle_inbound_group_session(
         return (size_t)-1;
     }
 
+    /* the cached keys are not pickled, and belong to the old ratchet */
+    _clear_key_cache(session);
+
     pos = megolm_unpickle(&session->initial_ratchet, pos, end);
     FAIL_ON_CORRUPTED_PICKLE(pos, session);
 
-    pos = megolm_unpickle(&session->latest_ratchet, pos, end);
-    FAIL_ON_CORRUPTED_PICKLE(pos, session);
+    if (pickle_version < 4) {
+        pos = megolm_unpickle(&session->latest_ratchet, pos, end);
+        FAIL_ON_CORRUPTED_PICKLE(pos, session);
+    } else {
+        /* only the parts of latest_ratchet that differ from initial_ratchet
+         * are stored */
+        uint8_t parts;
+        int i;
+
+        pos = _olm_unpickle_uint8(pos, end, &parts);
+        FAIL_ON_CORRUPTED_PICKLE(pos, session);
+        if (parts >> MEGOLM_RATCHET_PARTS) {
+            session->last_error = OLM_CORRUPTED_PICKLE;
+            return (size_t)-1;
+        }
+
+        session->latest_ratchet = session->initial_ratchet;
+        if (parts) {
+            pos = _olm_unpickle_uint32(
+                pos, end, &session->latest_ratchet.counter
+            );
+            FAIL_ON_CORRUPTED_PICKLE(pos, session);
+            for (i = 0; i < MEGOLM_RATCHET_PARTS; i++) {
+                if (parts & (1 << i)) {
+                    pos = _olm_unpickle_bytes(
+                        pos, end, session->latest_ratchet.data[i],
+                        MEGOLM_RATCHET_PART_LENGTH
+                    );
+                    FAIL_ON_CORRUPTED_PICKLE(pos, session);
+                }
+            }
+        }
+    }
 
     pos = _olm_unpickle_ed25519_public_key(pos, end, &session->signing_key);
     FAIL_ON_CORRUPTED_PICKLE(pos, session);
@@ -273,21 +853,106 @@ size_t olm_unpickle_inbound_group_session(
     }
     FAIL_ON_CORRUPTED_PICKLE(pos, session);
 
+    if (session->checkpoints) {
+        _olm_unset(
+            session->checkpoints, session->checkpoints_count * sizeof(Megolm)
+        );
+    }
+    session->checkpoints_count = 0;
+
+    if (pickle_version >= 3) {
+        /* keep as many of the pickled checkpoints as the table has room
+         * for */
+        uint32_t checkpoints_count;
+        Megolm checkpoint;
+
+        pos = _olm_unpickle_uint32(pos, end, &checkpoints_count);
+        FAIL_ON_CORRUPTED_PICKLE(pos, session);
+
+        while (checkpoints_count--) {
+            pos = megolm_unpickle(&checkpoint, pos, end);
+            FAIL_ON_CORRUPTED_PICKLE(pos, session);
+            if (session->checkpoints) {
+                _add_checkpoint(session, &checkpoint);
+            }
+        }
+        _olm_unset(&checkpoint, sizeof(checkpoint));
+    }
+
     if (pos != end) {
         /* Input was longer than expected. */
         session->last_error = OLM_PICKLE_EXTRA_DATA;
         return (size_t)-1;
     }
 
+    return 0;
+}
+
+size_t olm_unpickle_inbound_group_session_with_key(
+    OlmInboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+) {
+    size_t raw_length = _olm_enc_input_with_key(
+        pickle_key, pickled, pickled_length, &(session->last_error)
+    );
+    if (raw_length == (size_t)-1) {
+        return raw_length;
+    }
+
+    if (_unpickle(session, pickled, (uint8_t *)pickled + raw_length)
+            == (size_t)-1) {
+        return (size_t)-1;
+    }
+    return pickled_length;
+}
+
+size_t olm_unpickle_inbound_group_session_binary(
+    OlmInboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+) {
+    size_t raw_length = _olm_enc_input_binary_with_key(
+        pickle_key, pickled, pickled_length, &(session->last_error)
+    );
+    if (raw_length == (size_t)-1) {
+        return raw_length;
+    }
+
+    if (_unpickle(session, pickled, (uint8_t *)pickled + raw_length)
+            == (size_t)-1) {
+        return (size_t)-1;
+    }
     return pickled_length;
 }
 
+/**
+ * get the max plaintext length from the decoded message headers
+ */
+static size_t _max_plaintext_length_from_results(
+    OlmInboundGroupSession *session,
+    const struct _OlmDecodeGroupMessageResults *decoded_results
+) {
+    if (decoded_results->version != OLM_PROTOCOL_VERSION) {
+        session->last_error = OLM_BAD_MESSAGE_VERSION;
+        return (size_t)-1;
+    }
+
+    if (!decoded_results->ciphertext) {
+        session->last_error = OLM_BAD_MESSAGE_FORMAT;
+        return (size_t)-1;
+    }
+
+    return megolm_cipher->ops->decrypt_max_plaintext_length(
+        megolm_cipher, decoded_results->ciphertext_length);
+}
+
 /**
  * get the max plaintext length in an un-base64-ed message
  */
 static size_t _decrypt_max_plaintext_length(
     OlmInboundGroupSession *session,
-    uint8_t * message, size_t message_length
+    uint8_t const * message, size_t message_length
 ) {
     struct _OlmDecodeGroupMessageResults decoded_results;
 
@@ -297,18 +962,7 @@ static size_t _decrypt_max_plaintext_length(
         ED25519_SIGNATURE_LENGTH,
         &decoded_results);
 
-    if (decoded_results.version != OLM_PROTOCOL_VERSION) {
-        session->last_error = OLM_BAD_MESSAGE_VERSION;
-        return (size_t)-1;
-    }
-
-    if (!decoded_results.ciphertext) {
-        session->last_error = OLM_BAD_MESSAGE_FORMAT;
-        return (size_t)-1;
-    }
-
-    return megolm_cipher->ops->decrypt_max_plaintext_length(
-        megolm_cipher, decoded_results.ciphertext_length);
+    return _max_plaintext_length_from_results(session, &decoded_results);
 }
 
 size_t olm_group_decrypt_max_plaintext_length(
@@ -328,17 +982,97 @@ size_t olm_group_decrypt_max_plaintext_length(
     );
 }
 
+/** how much of a base64 message to decode to find its headers; a multiple
+ * of 4 */
+#define HEADER_BASE64_LENGTH 64
+
+size_t olm_group_decrypt_max_plaintext_length_const(
+    OlmInboundGroupSession *session,
+    uint8_t const * message, size_t message_length
+) {
+    struct _OlmDecodeGroupMessageResults decoded_results;
+    uint8_t header[HEADER_BASE64_LENGTH / 4 * 3];
+    size_t raw_length, prefix_length;
+
+    raw_length = _olm_decode_base64_length(message_length);
+    if (raw_length == (size_t)-1) {
+        session->last_error = OLM_INVALID_BASE64;
+        return (size_t)-1;
+    }
+
+    /* the headers are at the start, so only decode that much */
+    prefix_length = message_length < HEADER_BASE64_LENGTH
+        ? message_length : HEADER_BASE64_LENGTH;
+    prefix_length = _olm_decode_base64(message, prefix_length, header);
+
+    _olm_decode_group_message_header(
+        header, prefix_length, raw_length,
+        megolm_cipher->ops->mac_length(megolm_cipher),
+        ED25519_SIGNATURE_LENGTH,
+        &decoded_results);
+
+    return _max_plaintext_length_from_results(session, &decoded_results);
+}
+
+/** how much of a base64 message to decode to find its index: enough for the
+ * version and the longest index; a multiple of 4 */
+#define INDEX_BASE64_LENGTH 12
+
+enum OlmErrorCode olm_group_message_peek(
+    uint8_t const * message, size_t message_length,
+    uint8_t * version, uint32_t * message_index
+) {
+    struct _OlmDecodeGroupMessageResults decoded_results;
+    uint8_t header[INDEX_BASE64_LENGTH / 4 * 3];
+    size_t raw_length, prefix_length;
+
+    raw_length = _olm_decode_base64_length(message_length);
+    if (raw_length == (size_t)-1) {
+        return OLM_INVALID_BASE64;
+    }
+
+    prefix_length = message_length < INDEX_BASE64_LENGTH
+        ? message_length : INDEX_BASE64_LENGTH;
+    prefix_length = _olm_decode_base64(message, prefix_length, header);
+
+    _olm_decode_group_message_header(
+        header, prefix_length, raw_length,
+        megolm_cipher->ops->mac_length(megolm_cipher),
+        ED25519_SIGNATURE_LENGTH,
+        &decoded_results);
+
+    if (!decoded_results.has_message_index) {
+        return OLM_BAD_MESSAGE_FORMAT;
+    }
+
+    *version = decoded_results.version;
+    *message_index = decoded_results.message_index;
+    return OLM_SUCCESS;
+}
+
+size_t olm_group_decrypt_raw_max_plaintext_length(
+    OlmInboundGroupSession *session,
+    uint8_t const * message, size_t message_length
+) {
+    return _decrypt_max_plaintext_length(session, message, message_length);
+}
+
 /**
  * get a copy of the megolm ratchet, advanced
- * to the relevant index. Returns 0 on success, -1 on error
+ * to the relevant index. Returns 0 on success, -1 on error. The checkpoints
+ * reached on the way are kept in pending, or added to the table straight away
+ * if pending is NULL.
  */
 static size_t _get_megolm(
-    OlmInboundGroupSession *session, uint32_t message_index, Megolm *result
+    OlmInboundGroupSession *session, uint32_t message_index, Megolm *result,
+    PendingCheckpoints *pending
 ) {
     /* pick a megolm instance to use. If we're at or beyond the latest ratchet
      * value, use that */
     if ((message_index - session->latest_ratchet.counter) < (1U << 31)) {
-        megolm_advance_to(&session->latest_ratchet, message_index);
+        _advance_with_checkpoints(
+            session, &session->latest_ratchet, message_index, pending
+        );
         *result = session->latest_ratchet;
         return 0;
     } else if ((message_index - session->initial_ratchet.counter) >= (1U << 31)) {
@@ -346,10 +1080,12 @@ static size_t _get_megolm(
         session->last_error = OLM_UNKNOWN_MESSAGE_INDEX;
         return (size_t)-1;
     } else {
-        /* otherwise, start from the initial megolm. Take a copy so that we
-         * don't overwrite the initial megolm */
-        *result = session->initial_ratchet;
-        megolm_advance_to(result, message_index);
+        /* otherwise, start from the latest checkpoint at or before the
+         * index, or from the initial megolm if there isn't one. Take a copy
+         * so that we don't overwrite it. */
+        const Megolm *start = _find_checkpoint(session, message_index);
+        *result = start ? *start : session->initial_ratchet;
+        _advance_with_checkpoints(session, result, message_index, pending);
         return 0;
     }
 }
@@ -359,11 +1095,12 @@ static size_t _get_megolm(
  */
 static size_t _decrypt(
     OlmInboundGroupSession *session,
-    uint8_t * message, size_t message_length,
+    uint8_t const * message, size_t message_length,
     uint8_t * plaintext, size_t max_plaintext_length,
     uint32_t * message_index
 ) {
     struct _OlmDecodeGroupMessageResults decoded_results;
+    const struct _olm_cipher_aes_sha_256_keys *keys;
     size_t max_length, r;
     Megolm megolm;
 
@@ -412,21 +1149,37 @@ static size_t _decrypt(
         return (size_t)-1;
     }
 
-    r = _get_megolm(session, decoded_results.message_index, &megolm);
-    if (r == (size_t)-1) {
-        return r;
-    }
+    /* now try checking the mac, and decrypting, with the cached keys if we
+     * have them */
+    keys = _find_cached_keys(session, decoded_results.message_index);
+    if (keys) {
+        r = _olm_cipher_aes_sha_256_decrypt_with_keys(
+            keys, message, message_length,
+            decoded_results.ciphertext, decoded_results.ciphertext_length,
+            plaintext, max_plaintext_length
+        );
+    } else {
+        PendingCheckpoints pending;
 
-    /* now try checking the mac, and decrypting */
-    r = megolm_cipher->ops->decrypt(
-        megolm_cipher,
-        megolm_get_data(&megolm), MEGOLM_RATCHET_LENGTH,
-        message, message_length,
-        decoded_results.ciphertext, decoded_results.ciphertext_length,
-        plaintext, max_plaintext_length
-    );
+        r = _get_megolm(
+            session, decoded_results.message_index, &megolm, &pending
+        );
+        if (r == (size_t)-1) {
+            return r;
+        }
+
+        r = _decrypt_with_megolm(
+            session, &megolm, message, message_length,
+            decoded_results.ciphertext, decoded_results.ciphertext_length,
+            plaintext, max_plaintext_length
+        );
+        _olm_unset(&megolm, sizeof(megolm));
+        if (r != (size_t)-1) {
+            _commit_checkpoints(session, &pending);
+        }
+        _olm_unset(&pending, sizeof(pending));
+    }
 
-    _olm_unset(&megolm, sizeof(megolm));
     if (r == (size_t)-1) {
         session->last_error = OLM_BAD_MESSAGE_MAC;
         return r;
@@ -460,6 +1213,225 @@ size_t olm_group_decrypt(
     );
 }
 
+size_t olm_group_decrypt_raw(
+    OlmInboundGroupSession *session,
+    uint8_t const * message, size_t message_length,
+    uint8_t * plaintext, size_t max_plaintext_length,
+    uint32_t * message_index
+) {
+    return _decrypt(
+        session, message, message_length,
+        plaintext, max_plaintext_length,
+        message_index
+    );
+}
+
+/** the number of messages olm_group_decrypt_batch works on at a time */
+#define DECRYPT_BATCH_MAX 32
+
+/**
+ * decrypt up to DECRYPT_BATCH_MAX messages, as _decrypt would, except that
+ * they are taken in index order with one copy of the ratchet, and their
+ * signatures are checked together.
+ */
+static size_t _decrypt_batch(
+    OlmInboundGroupSession *session, size_t count,
+    uint8_t * const * messages, size_t const * message_lengths,
+    uint8_t * const * plaintexts, size_t const * max_plaintext_lengths,
+    size_t * plaintext_lengths, uint32_t * message_indexes,
+    enum OlmErrorCode * errors
+) {
+    struct _OlmDecodeGroupMessageResults decoded[DECRYPT_BATCH_MAX];
+    size_t lengths[DECRYPT_BATCH_MAX];
+    enum OlmErrorCode results[DECRYPT_BATCH_MAX];
+    struct _olm_ed25519_verify_item items[DECRYPT_BATCH_MAX];
+    size_t item_messages[DECRYPT_BATCH_MAX];
+    uint8_t valid[DECRYPT_BATCH_MAX];
+    size_t order[DECRYPT_BATCH_MAX];
+    size_t i, j, item_count = 0, order_count = 0, decrypted = 0;
+    Megolm megolm;
+    PendingCheckpoints pending;
+    int have_megolm = 0;
+
+    for (i = 0; i < count; i++) {
+        lengths[i] = _olm_decode_base64(
+            messages[i], message_lengths[i], messages[i]
+        );
+        if (lengths[i] == (size_t)-1) {
+            results[i] = OLM_INVALID_BASE64;
+            continue;
+        }
+
+        _olm_decode_group_message(
+            messages[i], lengths[i],
+            megolm_cipher->ops->mac_length(megolm_cipher),
+            ED25519_SIGNATURE_LENGTH,
+            &decoded[i]);
+
+        if (decoded[i].version != OLM_PROTOCOL_VERSION) {
+            results[i] = OLM_BAD_MESSAGE_VERSION;
+            continue;
+        }
+
+        if (!decoded[i].has_message_index || !decoded[i].ciphertext) {
+            results[i] = OLM_BAD_MESSAGE_FORMAT;
+            continue;
+        }
+
+        if (message_indexes != NULL) {
+            message_indexes[i] = decoded[i].message_index;
+        }
+
+        lengths[i] -= ED25519_SIGNATURE_LENGTH;
+        items[item_count].key = &session->signing_key;
+        items[item_count].message = messages[i];
+        items[item_count].message_length = lengths[i];
+        items[item_count].signature = messages[i] + lengths[i];
+        item_messages[item_count++] = i;
+        results[i] = OLM_SUCCESS;
+    }
+
+    _olm_crypto_ed25519_verify_batch(items, item_count, valid);
+
+    for (j = 0; j < item_count; j++) {
+        size_t max_length;
+
+        i = item_messages[j];
+        if (!valid[j]) {
+            results[i] = OLM_BAD_SIGNATURE;
+            continue;
+        }
+
+        max_length = megolm_cipher->ops->decrypt_max_plaintext_length(
+            megolm_cipher, decoded[i].ciphertext_length
+        );
+        if (max_plaintext_lengths[i] < max_length) {
+            results[i] = OLM_OUTPUT_BUFFER_TOO_SMALL;
+            continue;
+        }
+
+        /* insert into order, sorted by index from the initial ratchet */
+        {
+            uint32_t offset = decoded[i].message_index
+                - session->initial_ratchet.counter;
+            size_t k = order_count++;
+            while (k > 0 && decoded[order[k - 1]].message_index
+                    - session->initial_ratchet.counter > offset) {
+                order[k] = order[k - 1];
+                k--;
+            }
+            order[k] = i;
+        }
+    }
+
+    for (j = 0; j < order_count; j++) {
+        const struct _olm_cipher_aes_sha_256_keys *keys;
+        uint32_t message_index;
+        size_t r;
+
+        i = order[j];
+        message_index = decoded[i].message_index;
+
+        keys = _find_cached_keys(session, message_index);
+        if (keys) {
+            r = _olm_cipher_aes_sha_256_decrypt_with_keys(
+                keys, messages[i], lengths[i],
+                decoded[i].ciphertext, decoded[i].ciphertext_length,
+                plaintexts[i], max_plaintext_lengths[i]
+            );
+        } else {
+            /* carry on from the previous message, unless the session can
+             * start from somewhere at least as close. (Messages before the
+             * initial ratchet sort last, and are left to _get_megolm to
+             * reject.) */
+            if (have_megolm
+                    && (message_index - session->latest_ratchet.counter)
+                        >= (1U << 31)
+                    && (message_index - megolm.counter) < (1U << 31)) {
+                const Megolm *start = _find_checkpoint(session, message_index);
+                if (!start || megolm.counter - start->counter < (1U << 31)) {
+                    _advance_with_checkpoints(
+                        session, &megolm, message_index, &pending
+                    );
+                    r = 0;
+                } else {
+                    r = _get_megolm(session, message_index, &megolm, &pending);
+                }
+            } else {
+                r = _get_megolm(session, message_index, &megolm, &pending);
+            }
+            if (r == (size_t)-1) {
+                results[i] = session->last_error;
+                continue;
+            }
+            have_megolm = 1;
+
+            r = _decrypt_with_megolm(
+                session, &megolm, messages[i], lengths[i],
+                decoded[i].ciphertext, decoded[i].ciphertext_length,
+                plaintexts[i], max_plaintext_lengths[i]
+            );
+            if (r != (size_t)-1) {
+                _commit_checkpoints(session, &pending);
+            }
+        }
+        if (r == (size_t)-1) {
+            results[i] = OLM_BAD_MESSAGE_MAC;
+            continue;
+        }
+
+        plaintext_lengths[i] = r;
+        decrypted++;
+    }
+    _olm_unset(&megolm, sizeof(megolm));
+    _olm_unset(&pending, sizeof(pending));
+
+    for (i = 0; i < count; i++) {
+        if (results[i] != OLM_SUCCESS) {
+            plaintext_lengths[i] = (size_t)-1;
+        }
+        if (errors != NULL) {
+            errors[i] = results[i];
+        }
+    }
+
+    if (decrypted) {
+        /* once we have successfully decrypted a message, set a flag to say
+         * the session appears valid. */
+        session->signing_key_verified = 1;
+    }
+    return decrypted;
+}
+
+size_t olm_group_decrypt_batch(
+    OlmInboundGroupSession *session,
+    size_t count,
+    uint8_t * const * messages, size_t const * message_lengths,
+    uint8_t * const * plaintexts, size_t const * max_plaintext_lengths,
+    size_t * plaintext_lengths,
+    uint32_t * message_indexes,
+    enum OlmErrorCode * errors
+) {
+    size_t decrypted = 0;
+    size_t offset;
+
+    for (offset = 0; offset < count; offset += DECRYPT_BATCH_MAX) {
+        size_t n = count - offset;
+        if (n > DECRYPT_BATCH_MAX) {
+            n = DECRYPT_BATCH_MAX;
+        }
+        decrypted += _decrypt_batch(
+            session, n,
+            messages + offset, message_lengths + offset,
+            plaintexts + offset, max_plaintext_lengths + offset,
+            plaintext_lengths + offset,
+            message_indexes ? message_indexes + offset : NULL,
+            errors ? errors + offset : NULL
+        );
+    }
+    return decrypted;
+}
+
 size_t olm_inbound_group_session_id_length(
     const OlmInboundGroupSession *session
 ) {
@@ -498,12 +1470,37 @@ size_t olm_export_inbound_group_session_length(
     return _olm_encode_base64_length(SESSION_EXPORT_RAW_LENGTH);
 }
 
+/**
+ * Write the raw export of a session at the given index, where megolm is its
+ * ratchet at that index. Returns a pointer past the end of the export.
+ */
+static uint8_t *_write_session_export(
+    const OlmInboundGroupSession *session, const Megolm *megolm,
+    uint32_t message_index, uint8_t *ptr
+) {
+    *ptr++ = SESSION_EXPORT_VERSION;
+
+    // Encode message index as a big endian 32-bit number.
+    for (unsigned i = 0; i < 4; i++) {
+        *ptr++ = 0xFF & (message_index >> 24); message_index <<= 8;
+    }
+
+    memcpy(ptr, megolm_get_data(megolm), MEGOLM_RATCHET_LENGTH);
+    ptr += MEGOLM_RATCHET_LENGTH;
+
+    memcpy(
+        ptr, session->signing_key.public_key,
+        ED25519_PUBLIC_KEY_LENGTH
+    );
+    ptr += ED25519_PUBLIC_KEY_LENGTH;
+    return ptr;
+}
+
 size_t olm_export_inbound_group_session(
     OlmInboundGroupSession *session,
     uint8_t * key, size_t key_length, uint32_t message_index
 ) {
     uint8_t *raw;
-    uint8_t *ptr;
     Megolm megolm;
     size_t r;
     size_t encoded_length = olm_export_inbound_group_session_length(session);
@@ -513,28 +1510,150 @@ size_t olm_export_inbound_group_session(
         return (size_t)-1;
     }
 
-    r = _get_megolm(session, message_index, &megolm);
+    /* the index comes from the application rather than from a message, so the
+     * checkpoints can go straight into the table */
+    r = _get_megolm(session, message_index, &megolm, NULL);
     if (r == (size_t)-1) {
         return r;
     }
 
     /* put the raw data at the end of the output buffer. */
-    raw = ptr = key + encoded_length - SESSION_EXPORT_RAW_LENGTH;
-    *ptr++ = SESSION_EXPORT_VERSION;
+    raw = key + encoded_length - SESSION_EXPORT_RAW_LENGTH;
+    _write_session_export(session, &megolm, message_index, raw);
 
-    // Encode message index as a big endian 32-bit number.
-    for (unsigned i = 0; i < 4; i++) {
-        *ptr++ = 0xFF & (message_index >> 24); message_index <<= 8;
+    return _olm_encode_base64(raw, SESSION_EXPORT_RAW_LENGTH, key);
+}
+
+/*
+ * A chunk of exported sessions is:
+ *     uint8 version
+ *     uint32 number of sessions
+ *     uint32 length of the sessions in bytes
+ *     for each session, the uint32 length of its export, then the export
+ *     the SHA-256 hash of everything before it
+ */
+#define EXPORT_CHUNK_VERSION        1
+#define EXPORT_CHUNK_HEADER_LENGTH  (1 + 4 + 4)
+#define EXPORT_CHUNK_ENTRY_LENGTH   (4 + SESSION_EXPORT_RAW_LENGTH)
+
+size_t olm_export_inbound_group_sessions_chunk_length(size_t session_count) {
+    return EXPORT_CHUNK_HEADER_LENGTH
+        + session_count * EXPORT_CHUNK_ENTRY_LENGTH
+        + SHA256_OUTPUT_LENGTH;
+}
+
+enum OlmErrorCode olm_export_inbound_group_sessions_chunk(
+    OlmInboundGroupSession * const * sessions, size_t session_count,
+    uint8_t * output, size_t output_length
+) {
+    size_t chunk_length =
+        olm_export_inbound_group_sessions_chunk_length(session_count);
+    uint8_t *pos = output;
+    size_t i;
+
+    if (output_length < chunk_length
+            || session_count > (0xffffffff - EXPORT_CHUNK_HEADER_LENGTH)
+                / EXPORT_CHUNK_ENTRY_LENGTH) {
+        return OLM_OUTPUT_BUFFER_TOO_SMALL;
     }
 
-    memcpy(ptr, megolm_get_data(&megolm), MEGOLM_RATCHET_LENGTH);
-    ptr += MEGOLM_RATCHET_LENGTH;
+    pos = _olm_pickle_uint8(pos, EXPORT_CHUNK_VERSION);
+    pos = _olm_pickle_uint32(pos, (uint32_t)session_count);
+    pos = _olm_pickle_uint32(
+        pos, (uint32_t)(session_count * EXPORT_CHUNK_ENTRY_LENGTH)
+    );
+    for (i = 0; i < session_count; i++) {
+        /* the first known index is always available */
+        const OlmInboundGroupSession *session = sessions[i];
+        pos = _olm_pickle_uint32(pos, SESSION_EXPORT_RAW_LENGTH);
+        pos = _write_session_export(
+            session, &session->initial_ratchet,
+            session->initial_ratchet.counter, pos
+        );
+    }
+    _olm_crypto_sha256(output, pos - output, pos);
+    return OLM_SUCCESS;
+}
 
-    memcpy(
-        ptr, session->signing_key.public_key,
-        ED25519_PUBLIC_KEY_LENGTH
+size_t olm_inbound_group_sessions_chunk_header_length(void) {
+    return EXPORT_CHUNK_HEADER_LENGTH;
+}
+
+enum OlmErrorCode olm_inbound_group_sessions_chunk_info(
+    uint8_t const * input, size_t input_length,
+    size_t * session_count, size_t * chunk_length
+) {
+    uint8_t const *end = input + input_length;
+    uint8_t version;
+    uint32_t count, entries_length;
+
+    if (input_length < EXPORT_CHUNK_HEADER_LENGTH) {
+        return OLM_INPUT_BUFFER_TOO_SMALL;
+    }
+    input = _olm_unpickle_uint8(input, end, &version);
+    input = _olm_unpickle_uint32(input, end, &count);
+    _olm_unpickle_uint32(input, end, &entries_length);
+
+    if (version != EXPORT_CHUNK_VERSION) {
+        return OLM_BAD_MESSAGE_VERSION;
+    }
+    /* every export in this version is the same length */
+    if ((uint64_t)count * EXPORT_CHUNK_ENTRY_LENGTH != entries_length) {
+        return OLM_BAD_MESSAGE_FORMAT;
+    }
+
+    *session_count = count;
+    *chunk_length = EXPORT_CHUNK_HEADER_LENGTH + (size_t)entries_length
+        + SHA256_OUTPUT_LENGTH;
+    return OLM_SUCCESS;
+}
+
+enum OlmErrorCode olm_import_inbound_group_sessions_chunk(
+    uint8_t const * input, size_t input_length,
+    OlmInboundGroupSession * const * sessions, size_t session_count
+) {
+    uint8_t hash[SHA256_OUTPUT_LENGTH];
+    size_t count, chunk_length, i;
+    uint8_t const *pos;
+    enum OlmErrorCode error;
+
+    error = olm_inbound_group_sessions_chunk_info(
+        input, input_length, &count, &chunk_length
     );
-    ptr += ED25519_PUBLIC_KEY_LENGTH;
+    if (error != OLM_SUCCESS) {
+        return error;
+    }
+    if (input_length < chunk_length) {
+        return OLM_INPUT_BUFFER_TOO_SMALL;
+    }
+    if (session_count < count) {
+        return OLM_OUTPUT_BUFFER_TOO_SMALL;
+    }
 
-    return _olm_encode_base64(raw, SESSION_EXPORT_RAW_LENGTH, key);
+    /* check the whole chunk before importing any of it */
+    _olm_crypto_sha256(input, chunk_length - SHA256_OUTPUT_LENGTH, hash);
+    if (memcmp(hash, input + chunk_length - SHA256_OUTPUT_LENGTH,
+               SHA256_OUTPUT_LENGTH)) {
+        return OLM_BAD_CHECKSUM;
+    }
+    pos = input + EXPORT_CHUNK_HEADER_LENGTH;
+    for (i = 0; i < count; i++, pos += EXPORT_CHUNK_ENTRY_LENGTH) {
+        uint32_t length;
+        _olm_unpickle_uint32(pos, pos + 4, &length);
+        if (length != SESSION_EXPORT_RAW_LENGTH
+                || pos[4] != SESSION_EXPORT_VERSION) {
+            return OLM_BAD_SESSION_KEY;
+        }
+    }
+
+    pos = input + EXPORT_CHUNK_HEADER_LENGTH;
+    for (i = 0; i < count; i++, pos += EXPORT_CHUNK_ENTRY_LENGTH) {
+        /* the exports were all checked above, so this only fails if
+         * _init_group_session_keys checks something more than they were */
+        if (_init_group_session_keys(sessions[i], pos + 4, 1)
+                == (size_t)-1) {
+            return sessions[i]->last_error;
+        }
+    }
+    return OLM_SUCCESS;
 }
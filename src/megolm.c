@@ -20,6 +20,7 @@
 
 #include "olm/cipher.h"
 #include "olm/crypto.h"
+#include "olm/memory.h"
 #include "olm/pickle.h"
 
 static const struct _olm_cipher_aes_sha_256 MEGOLM_CIPHER =
@@ -36,16 +37,34 @@ static uint8_t HASH_KEY_SEEDS[MEGOLM_RATCHET_PARTS][HASH_KEY_SEED_LENGTH] = {
     {0x03}
 };
 
-static void rehash_part(
+/* Replace R(rehash_to_part) with HMAC(R(rehash_from_part), seed), for each
+ * of rehash_to_part = rehash_to_last...rehash_from_part. The key is prepared
+ * once, and R(rehash_from_part) is replaced last.
+ */
+static void rehash_parts(
     uint8_t data[MEGOLM_RATCHET_PARTS][MEGOLM_RATCHET_PART_LENGTH],
-    int rehash_from_part, int rehash_to_part
+    int rehash_from_part, int rehash_to_last
 ) {
-    _olm_crypto_hmac_sha256(
-        data[rehash_from_part],
-        MEGOLM_RATCHET_PART_LENGTH,
-        HASH_KEY_SEEDS[rehash_to_part], HASH_KEY_SEED_LENGTH,
-        data[rehash_to_part]
+    struct _olm_hmac_sha256_ctx hmac;
+    struct _olm_hmac_sha256_lane lanes[MEGOLM_RATCHET_PARTS];
+    int i;
+
+    _olm_crypto_hmac_sha256_init(
+        &hmac, data[rehash_from_part], MEGOLM_RATCHET_PART_LENGTH
+    );
+    /* the parts are independent once the key has been prepared, so hash them
+     * together */
+    for (i = rehash_from_part; i <= rehash_to_last; i++) {
+        struct _olm_hmac_sha256_lane *lane = &lanes[i - rehash_from_part];
+        lane->key = &hmac;
+        lane->input = HASH_KEY_SEEDS[i];
+        lane->input_length = HASH_KEY_SEED_LENGTH;
+        lane->output = data[i];
+    }
+    _olm_crypto_hmac_sha256_lanes(
+        lanes, (size_t)(rehash_to_last - rehash_from_part + 1)
     );
+    _olm_unset(&hmac, sizeof(hmac));
 }
 
 
@@ -85,7 +104,6 @@ const uint8_t * megolm_unpickle(Megolm *megolm, const uint8_t *pos,
 void megolm_advance(Megolm *megolm) {
     uint32_t mask = 0x00FFFFFF;
     int h = 0;
-    int i;
 
     megolm->counter++;
 
@@ -98,57 +116,72 @@ void megolm_advance(Megolm *megolm) {
     }
 
     /* now update R(h)...R(3) based on R(h) */
-    for (i = MEGOLM_RATCHET_PARTS-1; i >= h; i--) {
-        rehash_part(megolm->data, h, i);
-    }
+    rehash_parts(megolm->data, h, MEGOLM_RATCHET_PARTS-1);
 }
 
 void megolm_advance_to(Megolm *megolm, uint32_t advance_to) {
+    unsigned int steps[MEGOLM_RATCHET_PARTS];
+    int first = MEGOLM_RATCHET_PARTS;
     int j;
 
-    /* starting with R0, see if we need to update each part of the hash */
+    /* work out how many times each part needs to be bumped. Starting with
+     * R(0), parts are left alone until the first one that changes; after
+     * that, every lower part starts from a freshly derived value (with a
+     * counter byte of zero), so it needs as many bumps as its byte of
+     * advance_to.
+     */
     for (j = 0; j < (int)MEGOLM_RATCHET_PARTS; j++) {
         int shift = (MEGOLM_RATCHET_PARTS-j-1) * 8;
-        uint32_t mask = (~(uint32_t)0) << shift;
-        int k;
 
-        /* how many times do we need to rehash this part?
-         *
-         * '& 0xff' ensures we handle integer wraparound correctly
+        if (first < (int)MEGOLM_RATCHET_PARTS) {
+            steps[j] = (advance_to >> shift) & 0xff;
+            continue;
+        }
+
+        /* '& 0xff' ensures we handle integer wraparound correctly */
+        steps[j] = ((advance_to >> shift) - (megolm->counter >> shift)) & 0xff;
+
+        /* deal with the edge case where megolm->counter is slightly larger
+         * than advance_to. This can only happen for R(0), and implies that
+         * advance_to has wrapped around and we need to advance R(0) 256
+         * times.
          */
-        unsigned int steps =
-            ((advance_to >> shift) - (megolm->counter >> shift)) & 0xff;
-
-        if (steps == 0) {
-            /* deal with the edge case where megolm->counter is slightly larger
-             * than advance_to. This should only happen for R(0), and implies
-             * that advance_to has wrapped around and we need to advance R(0)
-             * 256 times.
-             */
-            if (advance_to < megolm->counter) {
-                steps = 0x100;
-            } else {
-                continue;
-            }
+        if (steps[j] == 0 && advance_to < megolm->counter) {
+            steps[j] = 0x100;
+        }
+        if (steps[j] != 0) {
+            first = j;
+        }
+    }
+
+    for (j = first; j < (int)MEGOLM_RATCHET_PARTS; j++) {
+        int last;
+
+        if (steps[j] == 0) {
+            continue;
         }
 
         /* for all but the last step, we can just bump R(j) without regard
          * to R(j+1)...R(3).
          */
-        while (steps > 1) {
-            rehash_part(megolm->data, j, j);
-            steps --;
+        while (steps[j] > 1) {
+            rehash_parts(megolm->data, j, j);
+            steps[j]--;
         }
 
-        /* on the last step we also need to bump R(j+1)...R(3).
-         *
-         * (Theoretically, we could skip bumping R(j+2) if we're going to bump
-         * R(j+1) again, but the code to figure that out is a bit baroque and
-         * doesn't save us much).
+        /* on the last step we also need R(j+1)..., but only as far as the
+         * next part that will be bumped: everything below that is derived
+         * again from it anyway.
          */
-        for (k = 3; k >= j; k--) {
-            rehash_part(megolm->data, j, k);
+        last = j + 1;
+        while (last < (int)MEGOLM_RATCHET_PARTS - 1 && steps[last] == 0) {
+            last++;
         }
-        megolm->counter = advance_to & mask;
+        if (last >= (int)MEGOLM_RATCHET_PARTS) {
+            last = MEGOLM_RATCHET_PARTS - 1;
+        }
+        rehash_parts(megolm->data, j, last);
     }
+
+    megolm->counter = advance_to;
 }
@@ -404,3 +404,59 @@ void _olm_decode_group_message(
 
     results->has_message_index = (int)has_message_index;
 }
+
+
+void _olm_decode_group_message_header(
+    const uint8_t *input, size_t input_length,
+    size_t message_length, size_t mac_length, size_t signature_length,
+    struct _OlmDecodeGroupMessageResults *results
+) {
+    std::size_t trailer_length = mac_length + signature_length;
+    std::uint8_t const * pos = input;
+    std::uint8_t const * unknown = nullptr;
+
+    bool has_message_index = false;
+    results->version = 0;
+    results->message_index = 0;
+    results->has_message_index = (int)has_message_index;
+    results->ciphertext = nullptr;
+    results->ciphertext_length = 0;
+
+    if (message_length < trailer_length) return;
+    std::size_t body_length = message_length - trailer_length;
+    if (input_length > body_length) input_length = body_length;
+    std::uint8_t const * end = input + input_length;
+
+    if (pos == end) return;
+    results->version = *(pos++);
+
+    while (pos != end) {
+        unknown = pos;
+        if (pos != end && *pos == GROUP_MESSAGE_INDEX_TAG) {
+            std::uint8_t const * value_start = ++pos;
+            pos = varint_skip(pos, end);
+            /* stop if the index runs past the end of the input */
+            if (pos == value_start || (pos[-1] & 0x80)) break;
+            results->message_index =
+                varint_decode<std::uint32_t>(value_start, pos);
+            has_message_index = true;
+        }
+        if (pos != end && *pos == GROUP_CIPHERTEXT_TAG) {
+            /* the ciphertext runs past the end of the input, so stop once
+             * its length is known */
+            std::uint8_t const * len_start = ++pos;
+            pos = varint_skip(pos, end);
+            if (pos == len_start || (pos[-1] & 0x80)) break;
+            std::size_t len = varint_decode<std::size_t>(len_start, pos);
+            if (len > body_length - std::size_t(pos - input)) break;
+            results->ciphertext = pos;
+            results->ciphertext_length = len;
+            break;
+        }
+        if (unknown == pos) {
+            pos = skip_unknown(pos, end);
+        }
+    }
+
+    results->has_message_index = (int)has_message_index;
+}
@@ -14,6 +14,7 @@
  */
 #include "olm/olm.h"
 #include "olm/session.hh"
+#include "olm/session_index.hh"
 #include "olm/account.hh"
 #include "olm/cipher.h"
 #include "olm/pickle_encoding.h"
@@ -38,6 +39,10 @@ static OlmUtility * to_c(olm::Utility * utility) {
     return reinterpret_cast<OlmUtility *>(utility);
 }
 
+static OlmSessionIndex * to_c(olm::SessionIndex * index) {
+    return reinterpret_cast<OlmSessionIndex *>(index);
+}
+
 static olm::Account * from_c(OlmAccount * account) {
     return reinterpret_cast<olm::Account *>(account);
 }
@@ -54,6 +59,14 @@ static const olm::Session * from_c(OlmSession const * session) {
     return reinterpret_cast<const olm::Session *>(session);
 }
 
+static olm::SessionIndex * from_c(OlmSessionIndex * index) {
+    return reinterpret_cast<olm::SessionIndex *>(index);
+}
+
+static const olm::SessionIndex * from_c(OlmSessionIndex const * index) {
+    return reinterpret_cast<const olm::SessionIndex *>(index);
+}
+
 static olm::Utility * from_c(OlmUtility * utility) {
     return reinterpret_cast<olm::Utility *>(utility);
 }
@@ -166,6 +179,10 @@ size_t olm_account_size(void) {
 
 
 size_t olm_session_size(void) {
+    return sizeof(olm::SessionWithSkippedKeys);
+}
+
+size_t olm_compact_session_size(void) {
     return sizeof(olm::Session);
 }
 
@@ -183,9 +200,20 @@ OlmAccount * olm_account(
 
 OlmSession * olm_session(
     void * memory
+) {
+    olm::unset(memory, sizeof(olm::SessionWithSkippedKeys));
+    olm::Session * session = new(memory) olm::SessionWithSkippedKeys();
+    return to_c(session);
+}
+
+
+OlmSession * olm_compact_session(
+    void * memory, OlmAllocator const * allocator
 ) {
     olm::unset(memory, sizeof(olm::Session));
-    return to_c(new(memory) olm::Session());
+    olm::Session * session = new(memory) olm::Session();
+    session->ratchet.allocator = allocator;
+    return to_c(session);
 }
 
 
@@ -211,11 +239,22 @@ size_t olm_clear_account(
 size_t olm_clear_session(
     OlmSession * session
 ) {
+    olm::Session & object = *from_c(session);
+    /* Clear the memory backing the skipped message keys */
+    object.ratchet.release_skipped_message_keys();
     /* Clear the memory backing the session */
-    olm::unset(session, sizeof(olm::Session));
-    /* Initialise a fresh session object in case someone tries to use it */
-    new(session) olm::Session();
-    return sizeof(olm::Session);
+    if (object.embedded_skipped_keys) {
+        olm::unset(session, sizeof(olm::SessionWithSkippedKeys));
+        /* Initialise a fresh session object in case someone tries to use it */
+        new(session) olm::SessionWithSkippedKeys();
+        return sizeof(olm::SessionWithSkippedKeys);
+    } else {
+        OlmAllocator const * allocator = object.ratchet.allocator;
+        olm::unset(session, sizeof(olm::Session));
+        new(session) olm::Session();
+        object.ratchet.allocator = allocator;
+        return sizeof(olm::Session);
+    }
 }
 
 
@@ -248,6 +287,21 @@ size_t olm_pickle_account(
     OlmAccount * account,
     void const * key, size_t key_length,
     void * pickled, size_t pickled_length
+) {
+    OlmPickleKey pickle_key;
+    _olm_pickle_key_init(&pickle_key, from_c(key), key_length);
+    std::size_t result = olm_pickle_account_with_key(
+        account, &pickle_key, pickled, pickled_length
+    );
+    olm::unset(pickle_key);
+    return result;
+}
+
+
+size_t olm_pickle_account_with_key(
+    OlmAccount * account,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
 ) {
     olm::Account & object = *from_c(account);
     std::size_t raw_length = pickle_length(object);
@@ -256,7 +310,7 @@ size_t olm_pickle_account(
         return size_t(-1);
     }
     pickle(_olm_enc_output_pos(from_c(pickled), raw_length), object);
-    return _olm_enc_output(from_c(key), key_length, from_c(pickled), raw_length);
+    return _olm_enc_output_with_key(pickle_key, from_c(pickled), raw_length);
 }
 
 
@@ -264,6 +318,21 @@ size_t olm_pickle_session(
     OlmSession * session,
     void const * key, size_t key_length,
     void * pickled, size_t pickled_length
+) {
+    OlmPickleKey pickle_key;
+    _olm_pickle_key_init(&pickle_key, from_c(key), key_length);
+    std::size_t result = olm_pickle_session_with_key(
+        session, &pickle_key, pickled, pickled_length
+    );
+    olm::unset(pickle_key);
+    return result;
+}
+
+
+size_t olm_pickle_session_with_key(
+    OlmSession * session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
 ) {
     olm::Session & object = *from_c(session);
     std::size_t raw_length = pickle_length(object);
@@ -272,7 +341,7 @@ size_t olm_pickle_session(
         return size_t(-1);
     }
     pickle(_olm_enc_output_pos(from_c(pickled), raw_length), object);
-    return _olm_enc_output(from_c(key), key_length, from_c(pickled), raw_length);
+    return _olm_enc_output_with_key(pickle_key, from_c(pickled), raw_length);
 }
 
 
@@ -280,11 +349,26 @@ size_t olm_unpickle_account(
     OlmAccount * account,
     void const * key, size_t key_length,
     void * pickled, size_t pickled_length
+) {
+    OlmPickleKey pickle_key;
+    _olm_pickle_key_init(&pickle_key, from_c(key), key_length);
+    std::size_t result = olm_unpickle_account_with_key(
+        account, &pickle_key, pickled, pickled_length
+    );
+    olm::unset(pickle_key);
+    return result;
+}
+
+
+size_t olm_unpickle_account_with_key(
+    OlmAccount * account,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
 ) {
     olm::Account & object = *from_c(account);
     std::uint8_t * input = from_c(pickled);
-    std::size_t raw_length = _olm_enc_input(
-        from_c(key), key_length, input, pickled_length, &object.last_error
+    std::size_t raw_length = _olm_enc_input_with_key(
+        pickle_key, input, pickled_length, &object.last_error
     );
     if (raw_length == std::size_t(-1)) {
         return std::size_t(-1);
@@ -315,11 +399,26 @@ size_t olm_unpickle_session(
     OlmSession * session,
     void const * key, size_t key_length,
     void * pickled, size_t pickled_length
+) {
+    OlmPickleKey pickle_key;
+    _olm_pickle_key_init(&pickle_key, from_c(key), key_length);
+    std::size_t result = olm_unpickle_session_with_key(
+        session, &pickle_key, pickled, pickled_length
+    );
+    olm::unset(pickle_key);
+    return result;
+}
+
+
+size_t olm_unpickle_session_with_key(
+    OlmSession * session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
 ) {
     olm::Session & object = *from_c(session);
     std::uint8_t * input = from_c(pickled);
-    std::size_t raw_length = _olm_enc_input(
-        from_c(key), key_length, input, pickled_length, &object.last_error
+    std::size_t raw_length = _olm_enc_input_with_key(
+        pickle_key, input, pickled_length, &object.last_error
     );
     if (raw_length == std::size_t(-1)) {
         return std::size_t(-1);
@@ -637,6 +736,45 @@ int olm_session_has_received_message(
     return from_c(session)->received_message;
 }
 
+size_t olm_session_skipped_message_key_size(void) {
+    return olm::CompactRatchet::skipped_message_key_table_entry_size();
+}
+
+size_t olm_session_set_skipped_message_keys(
+    OlmSession * session,
+    void * memory, size_t memory_length
+) {
+    return from_c(session)->ratchet.set_skipped_message_key_table(
+        memory, memory_length
+    );
+}
+
+size_t olm_session_memory_usage(
+    OlmSession const * session,
+    OlmSessionMemoryUsage * usage
+) {
+    olm::Session const & object = *from_c(session);
+    olm::CompactRatchet const & ratchet = object.ratchet;
+    olm::SkippedMessageKeyTable const table = ratchet.skipped_message_keys();
+    OlmSessionMemoryUsage result;
+    result.session = sizeof(olm::Session);
+    result.embedded_skipped_message_keys = 0;
+    result.external_skipped_message_keys = table.embedded ? 0 : table.max_keys
+        * olm::CompactRatchet::skipped_message_key_table_entry_size();
+    if (object.embedded_skipped_keys) {
+        result.session = sizeof(olm::SessionWithSkippedKeys);
+        result.embedded_skipped_message_keys =
+            sizeof(olm::SkippedMessageKeyStorage);
+    }
+    result.chains = sizeof(ratchet.sender_chain)
+        + sizeof(ratchet.receiver_chains);
+    result.skipped_message_key_count = ratchet.skipped_message_key_count();
+    if (usage) {
+        *usage = result;
+    }
+    return result.session + result.external_skipped_message_keys;
+}
+
 void olm_session_describe(
     OlmSession * session, char *buf, size_t buflen
 ) {
@@ -702,6 +840,226 @@ size_t olm_remove_one_time_keys(
 }
 
 
+size_t olm_session_index_size(
+    size_t capacity
+) {
+    return olm::SessionIndex::memory_length(capacity);
+}
+
+
+size_t olm_session_index_random_length(void) {
+    return olm::SESSION_INDEX_HASH_KEY_LENGTH;
+}
+
+
+OlmSessionIndex * olm_session_index(
+    void * memory, size_t capacity,
+    void * random, size_t random_length
+) {
+    if (capacity == 0 || capacity > olm::MAX_SESSION_INDEX_CAPACITY) {
+        return NULL;
+    }
+    if (random_length < olm::SESSION_INDEX_HASH_KEY_LENGTH) {
+        return NULL;
+    }
+    olm::unset(memory, olm::SessionIndex::memory_length(capacity));
+    olm::SessionIndex * index = new(memory) olm::SessionIndex(
+        capacity, from_c(random)
+    );
+    olm::unset(random, random_length);
+    return to_c(index);
+}
+
+
+const char * olm_session_index_last_error(
+    OlmSessionIndex const * index
+) {
+    auto error = from_c(index)->last_error;
+    return _olm_error_to_string(error);
+}
+
+
+enum OlmErrorCode olm_session_index_last_error_code(
+    OlmSessionIndex const * index
+) {
+    return from_c(index)->last_error;
+}
+
+
+size_t olm_clear_session_index(
+    OlmSessionIndex * index
+) {
+    std::size_t capacity = from_c(index)->capacity;
+    std::size_t length = olm::SessionIndex::memory_length(capacity);
+    olm::unset(index, length);
+    /* Initialise a fresh index object in case someone tries to use it. It has
+     * an all zero hash key, so it should be made again with
+     * olm_session_index() before it is used. */
+    std::uint8_t hash_key[olm::SESSION_INDEX_HASH_KEY_LENGTH] = {};
+    new(index) olm::SessionIndex(capacity, hash_key);
+    return length;
+}
+
+
+size_t olm_session_index_count(
+    OlmSessionIndex const * index
+) {
+    return from_c(index)->count;
+}
+
+
+size_t olm_session_index_insert(
+    OlmSessionIndex * index,
+    OlmSession const * session,
+    uint64_t handle
+) {
+    return from_c(index)->insert(*from_c(session), handle);
+}
+
+
+size_t olm_session_index_remove(
+    OlmSessionIndex * index,
+    OlmSession const * session
+) {
+    return from_c(index)->remove(*from_c(session)) ? 1 : 0;
+}
+
+
+size_t olm_session_index_find(
+    OlmSessionIndex * index,
+    void * one_time_key_message, size_t message_length,
+    uint64_t * handle
+) {
+    std::size_t raw_length = b64_input(
+        from_c(one_time_key_message), message_length, from_c(index)->last_error
+    );
+    if (raw_length == std::size_t(-1)) {
+        return std::size_t(-1);
+    }
+    bool found = from_c(index)->find(
+        nullptr, from_c(one_time_key_message), raw_length, *handle
+    );
+    return found ? 1 : 0;
+}
+
+
+size_t olm_session_index_find_from(
+    OlmSessionIndex * index,
+    void const * their_identity_key, size_t their_identity_key_length,
+    void * one_time_key_message, size_t message_length,
+    uint64_t * handle
+) {
+    std::uint8_t const * id_key = from_c(their_identity_key);
+    std::size_t id_key_length = their_identity_key_length;
+
+    if (olm::decode_base64_length(id_key_length) != CURVE25519_KEY_LENGTH) {
+        from_c(index)->last_error = OlmErrorCode::OLM_INVALID_BASE64;
+        return std::size_t(-1);
+    }
+    _olm_curve25519_public_key identity_key;
+    olm::decode_base64(id_key, id_key_length, identity_key.public_key);
+
+    std::size_t raw_length = b64_input(
+        from_c(one_time_key_message), message_length, from_c(index)->last_error
+    );
+    if (raw_length == std::size_t(-1)) {
+        return std::size_t(-1);
+    }
+    bool found = from_c(index)->find(
+        &identity_key, from_c(one_time_key_message), raw_length, *handle
+    );
+    return found ? 1 : 0;
+}
+
+
+size_t olm_pickle_session_index_length(
+    OlmSessionIndex const * index
+) {
+    return _olm_enc_output_length(pickle_length(*from_c(index)));
+}
+
+
+size_t olm_pickle_session_index(
+    OlmSessionIndex * index,
+    void const * key, size_t key_length,
+    void * pickled, size_t pickled_length
+) {
+    OlmPickleKey pickle_key;
+    _olm_pickle_key_init(&pickle_key, from_c(key), key_length);
+    std::size_t result = olm_pickle_session_index_with_key(
+        index, &pickle_key, pickled, pickled_length
+    );
+    olm::unset(pickle_key);
+    return result;
+}
+
+
+size_t olm_pickle_session_index_with_key(
+    OlmSessionIndex * index,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+) {
+    olm::SessionIndex & object = *from_c(index);
+    std::size_t raw_length = pickle_length(object);
+    if (pickled_length < _olm_enc_output_length(raw_length)) {
+        object.last_error = OlmErrorCode::OLM_OUTPUT_BUFFER_TOO_SMALL;
+        return size_t(-1);
+    }
+    pickle(_olm_enc_output_pos(from_c(pickled), raw_length), object);
+    return _olm_enc_output_with_key(pickle_key, from_c(pickled), raw_length);
+}
+
+
+size_t olm_unpickle_session_index(
+    OlmSessionIndex * index,
+    void const * key, size_t key_length,
+    void * pickled, size_t pickled_length
+) {
+    OlmPickleKey pickle_key;
+    _olm_pickle_key_init(&pickle_key, from_c(key), key_length);
+    std::size_t result = olm_unpickle_session_index_with_key(
+        index, &pickle_key, pickled, pickled_length
+    );
+    olm::unset(pickle_key);
+    return result;
+}
+
+
+size_t olm_unpickle_session_index_with_key(
+    OlmSessionIndex * index,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
+) {
+    olm::SessionIndex & object = *from_c(index);
+    std::uint8_t * input = from_c(pickled);
+    std::size_t raw_length = _olm_enc_input_with_key(
+        pickle_key, input, pickled_length, &object.last_error
+    );
+    if (raw_length == std::size_t(-1)) {
+        return std::size_t(-1);
+    }
+
+    std::uint8_t const * pos = input;
+    std::uint8_t const * end = pos + raw_length;
+
+    pos = unpickle(pos, end, object);
+
+    if (!pos) {
+        /* Input was corrupted. */
+        if (object.last_error == OlmErrorCode::OLM_SUCCESS) {
+            object.last_error = OlmErrorCode::OLM_CORRUPTED_PICKLE;
+        }
+        return std::size_t(-1);
+    } else if (pos != end) {
+        /* Input was longer than expected. */
+        object.last_error = OlmErrorCode::OLM_PICKLE_EXTRA_DATA;
+        return std::size_t(-1);
+    }
+
+    return pickled_length;
+}
+
+
 size_t olm_encrypt_message_type(
     OlmSession const * session
 ) {
@@ -843,4 +1201,59 @@ size_t olm_ed25519_verify(
     );
 }
 
+
+size_t olm_ed25519_verify_batch(
+    OlmUtility * utility,
+    size_t count,
+    void const * const * keys, size_t const * key_lengths,
+    void const * const * messages, size_t const * message_lengths,
+    void * const * signatures, size_t const * signature_lengths,
+    uint8_t * results
+) {
+    /* decode the keys a few at a time, so that they fit on the stack */
+    static const std::size_t CHUNK_LENGTH = 16;
+    _olm_ed25519_public_key verify_keys[CHUNK_LENGTH];
+    _olm_ed25519_verify_item items[CHUNK_LENGTH];
+    std::uint8_t item_results[CHUNK_LENGTH];
+    std::size_t item_positions[CHUNK_LENGTH];
+    std::size_t valid = 0;
+    std::size_t pos = 0;
+
+    while (pos < count) {
+        std::size_t item_count = 0;
+        for (; pos < count && item_count < CHUNK_LENGTH; ++pos) {
+            results[pos] = 0;
+            if (olm::decode_base64_length(key_lengths[pos])
+                    != ED25519_PUBLIC_KEY_LENGTH) {
+                continue;
+            }
+            std::size_t raw_signature_length =
+                olm::decode_base64_length(signature_lengths[pos]);
+            if (raw_signature_length == std::size_t(-1)
+                    || raw_signature_length < ED25519_SIGNATURE_LENGTH) {
+                continue;
+            }
+            std::uint8_t * signature = from_c(signatures[pos]);
+            olm::decode_base64(signature, signature_lengths[pos], signature);
+            olm::decode_base64(
+                from_c(keys[pos]), key_lengths[pos],
+                verify_keys[item_count].public_key
+            );
+            _olm_ed25519_verify_item & item = items[item_count];
+            item.key = &verify_keys[item_count];
+            item.message = from_c(messages[pos]);
+            item.message_length = message_lengths[pos];
+            item.signature = signature;
+            item_positions[item_count++] = pos;
+        }
+        valid += from_c(utility)->ed25519_verify_batch(
+            items, item_count, item_results
+        );
+        for (std::size_t i = 0; i < item_count; ++i) {
+            results[item_positions[i]] = item_results[i];
+        }
+    }
+    return valid;
+}
+
 }
@@ -94,6 +94,21 @@ size_t olm_pickle_outbound_group_session(
     OlmOutboundGroupSession *session,
     void const * key, size_t key_length,
     void * pickled, size_t pickled_length
+) {
+    OlmPickleKey pickle_key;
+    size_t result;
+    _olm_pickle_key_init(&pickle_key, key, key_length);
+    result = olm_pickle_outbound_group_session_with_key(
+        session, &pickle_key, pickled, pickled_length
+    );
+    _olm_unset(&pickle_key, sizeof(pickle_key));
+    return result;
+}
+
+size_t olm_pickle_outbound_group_session_with_key(
+    OlmOutboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
 ) {
     size_t raw_length = raw_pickle_length(session);
     uint8_t *pos;
@@ -114,7 +129,7 @@ size_t olm_pickle_outbound_group_session(
     pos = _olm_pickle_ed25519_key_pair(pos, &(session->signing_key));
 
 #ifndef OLM_FUZZING
-    return _olm_enc_output(key, key_length, pickled, raw_length);
+    return _olm_enc_output_with_key(pickle_key, pickled, raw_length);
 #else
     return raw_length;
 #endif
@@ -124,14 +139,29 @@ size_t olm_unpickle_outbound_group_session(
     OlmOutboundGroupSession *session,
     void const * key, size_t key_length,
     void * pickled, size_t pickled_length
+) {
+    OlmPickleKey pickle_key;
+    size_t result;
+    _olm_pickle_key_init(&pickle_key, key, key_length);
+    result = olm_unpickle_outbound_group_session_with_key(
+        session, &pickle_key, pickled, pickled_length
+    );
+    _olm_unset(&pickle_key, sizeof(pickle_key));
+    return result;
+}
+
+size_t olm_unpickle_outbound_group_session_with_key(
+    OlmOutboundGroupSession *session,
+    OlmPickleKey const * pickle_key,
+    void * pickled, size_t pickled_length
 ) {
     const uint8_t *pos;
     const uint8_t *end;
     uint32_t pickle_version;
 
 #ifndef OLM_FUZZING
-    size_t raw_length = _olm_enc_input(
-        key, key_length, pickled, pickled_length, &(session->last_error)
+    size_t raw_length = _olm_enc_input_with_key(
+        pickle_key, pickled, pickled_length, &(session->last_error)
     );
 #else
     size_t raw_length = pickled_length;
@@ -200,8 +230,8 @@ size_t olm_init_outbound_group_session(
     return 0;
 }
 
-static size_t raw_message_length(
-    OlmOutboundGroupSession *session,
+static size_t raw_message_length_at(
+    uint32_t message_index,
     size_t plaintext_length)
 {
     size_t ciphertext_length, mac_length;
@@ -213,11 +243,18 @@ static size_t raw_message_length(
     mac_length = megolm_cipher->ops->mac_length(megolm_cipher);
 
     return _olm_encode_group_message_length(
-        session->ratchet.counter,
+        message_index,
         ciphertext_length, mac_length, ED25519_SIGNATURE_LENGTH
     );
 }
 
+static size_t raw_message_length(
+    OlmOutboundGroupSession *session,
+    size_t plaintext_length)
+{
+    return raw_message_length_at(session->ratchet.counter, plaintext_length);
+}
+
 size_t olm_group_encrypt_message_length(
     OlmOutboundGroupSession *session,
     size_t plaintext_length
@@ -311,6 +348,131 @@ size_t olm_group_encrypt(
     );
 }
 
+/** the number of messages olm_group_encrypt_batch works on at a time */
+#define ENCRYPT_BATCH_MAX 16
+
+/**
+ * write up to ENCRYPT_BATCH_MAX un-base64-ed messages to the buffers, as
+ * _encrypt would, deriving the keys for all of them together.
+ */
+static void _encrypt_batch(
+    OlmOutboundGroupSession *session, size_t count,
+    uint8_t const * const * plaintexts, size_t const * plaintext_lengths,
+    uint8_t * const * buffers
+) {
+    uint8_t ratchet_data[ENCRYPT_BATCH_MAX][MEGOLM_RATCHET_LENGTH];
+    uint8_t const * ratchet_ptrs[ENCRYPT_BATCH_MAX];
+    struct _olm_cipher_aes_sha_256_keys keys[ENCRYPT_BATCH_MAX];
+    uint32_t first_index = session->ratchet.counter;
+    size_t mac_length = megolm_cipher->ops->mac_length(megolm_cipher);
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        memcpy(
+            ratchet_data[i], megolm_get_data(&session->ratchet),
+            MEGOLM_RATCHET_LENGTH
+        );
+        ratchet_ptrs[i] = ratchet_data[i];
+        megolm_advance(&session->ratchet);
+    }
+
+    _olm_cipher_aes_sha_256_derive_keys_many(
+        (const struct _olm_cipher_aes_sha_256 *)megolm_cipher,
+        ratchet_ptrs, MEGOLM_RATCHET_LENGTH, keys, count
+    );
+    _olm_unset(ratchet_data, sizeof(ratchet_data));
+
+    for (i = 0; i < count; i++) {
+        size_t ciphertext_length, message_length;
+        uint8_t *ciphertext_ptr;
+
+        ciphertext_length = megolm_cipher->ops->encrypt_ciphertext_length(
+            megolm_cipher, plaintext_lengths[i]
+        );
+
+        message_length = _olm_encode_group_message(
+            OLM_PROTOCOL_VERSION,
+            first_index + (uint32_t)i,
+            ciphertext_length,
+            buffers[i],
+            &ciphertext_ptr);
+
+        message_length += mac_length;
+
+        _olm_cipher_aes_sha_256_encrypt_with_keys(
+            &keys[i],
+            plaintexts[i], plaintext_lengths[i],
+            ciphertext_ptr, ciphertext_length,
+            buffers[i], message_length
+        );
+
+        /* sign the whole thing with the ed25519 key. */
+        _olm_crypto_ed25519_sign(
+            &(session->signing_key),
+            buffers[i], message_length,
+            buffers[i] + message_length
+        );
+    }
+    _olm_unset(keys, sizeof(keys));
+}
+
+size_t olm_group_encrypt_batch(
+    OlmOutboundGroupSession *session,
+    size_t count,
+    uint8_t const * const * plaintexts, size_t const * plaintext_lengths,
+    uint8_t * const * messages, size_t const * max_message_lengths,
+    size_t * message_lengths
+) {
+    size_t rawmsglen[ENCRYPT_BATCH_MAX];
+    uint8_t *message_pos[ENCRYPT_BATCH_MAX];
+    size_t i, offset;
+
+    /* check all the buffers before encrypting anything */
+    for (i = 0; i < count; i++) {
+        message_lengths[i] = _olm_encode_base64_length(raw_message_length_at(
+            session->ratchet.counter + (uint32_t)i, plaintext_lengths[i]
+        ));
+        if (max_message_lengths[i] < message_lengths[i]) {
+            session->last_error = OLM_OUTPUT_BUFFER_TOO_SMALL;
+            return (size_t)-1;
+        }
+    }
+
+    for (offset = 0; offset < count; offset += ENCRYPT_BATCH_MAX) {
+        size_t n = count - offset;
+        if (n > ENCRYPT_BATCH_MAX) {
+            n = ENCRYPT_BATCH_MAX;
+        }
+
+        /* we construct each message at the end of its buffer, so that
+         * we have room to base64-encode it once we're done.
+         */
+        for (i = 0; i < n; i++) {
+            rawmsglen[i] = raw_message_length_at(
+                session->ratchet.counter + (uint32_t)i,
+                plaintext_lengths[offset + i]
+            );
+            message_pos[i] = messages[offset + i]
+                + message_lengths[offset + i] - rawmsglen[i];
+        }
+
+        _encrypt_batch(
+            session, n,
+            plaintexts + offset, plaintext_lengths + offset, message_pos
+        );
+
+        /* base64-encode them */
+        for (i = 0; i < n; i++) {
+            _olm_encode_base64(
+                message_pos[i], rawmsglen[i], messages[offset + i]
+            );
+        }
+    }
+
+    return count;
+}
+
+
 
 size_t olm_outbound_group_session_id_length(
     const OlmOutboundGroupSession *session
@@ -17,6 +17,7 @@
 
 #include "olm/base64.h"
 #include "olm/cipher.h"
+#include "olm/memory.h"
 #include "olm/olm.h"
 
 static const struct _olm_cipher_aes_sha_256 PICKLE_CIPHER =
@@ -41,9 +42,50 @@ uint8_t * _olm_enc_output_pos(
     return output + _olm_encode_base64_length(length) - length;
 }
 
+size_t olm_pickle_key_size(void) {
+    return sizeof(OlmPickleKey);
+}
+
+OlmPickleKey * olm_pickle_key(
+    void * memory,
+    void const * key, size_t key_length
+) {
+    OlmPickleKey *pickle_key = memory;
+    _olm_pickle_key_init(pickle_key, key, key_length);
+    return pickle_key;
+}
+
+size_t olm_clear_pickle_key(
+    OlmPickleKey * pickle_key
+) {
+    _olm_unset(pickle_key, sizeof(OlmPickleKey));
+    return sizeof(OlmPickleKey);
+}
+
+void _olm_pickle_key_init(
+    OlmPickleKey * pickle_key,
+    uint8_t const * key, size_t key_length
+) {
+    _olm_cipher_aes_sha_256_derive_keys(
+        &PICKLE_CIPHER, key, key_length, &pickle_key->keys
+    );
+}
+
 size_t _olm_enc_output(
     uint8_t const * key, size_t key_length,
     uint8_t * output, size_t raw_length
+) {
+    OlmPickleKey pickle_key;
+    size_t result;
+    _olm_pickle_key_init(&pickle_key, key, key_length);
+    result = _olm_enc_output_with_key(&pickle_key, output, raw_length);
+    _olm_unset(&pickle_key, sizeof(pickle_key));
+    return result;
+}
+
+size_t _olm_enc_output_with_key(
+    OlmPickleKey const * pickle_key,
+    uint8_t * output, size_t raw_length
 ) {
     const struct _olm_cipher *cipher = OLM_CIPHER_BASE(&PICKLE_CIPHER);
     size_t ciphertext_length = cipher->ops->encrypt_ciphertext_length(
@@ -52,9 +94,8 @@ size_t _olm_enc_output(
     size_t length = ciphertext_length + cipher->ops->mac_length(cipher);
     size_t base64_length = _olm_encode_base64_length(length);
     uint8_t * raw_output = output + base64_length - length;
-    cipher->ops->encrypt(
-        cipher,
-        key, key_length,
+    _olm_cipher_aes_sha_256_encrypt_with_keys(
+        &pickle_key->keys,
         raw_output, raw_length,
         raw_output, ciphertext_length,
         raw_output, length
@@ -67,6 +108,18 @@ size_t _olm_enc_output(
 size_t _olm_enc_input(uint8_t const * key, size_t key_length,
                       uint8_t * input, size_t b64_length,
                       enum OlmErrorCode * last_error
+) {
+    OlmPickleKey pickle_key;
+    size_t result;
+    _olm_pickle_key_init(&pickle_key, key, key_length);
+    result = _olm_enc_input_with_key(&pickle_key, input, b64_length, last_error);
+    _olm_unset(&pickle_key, sizeof(pickle_key));
+    return result;
+}
+
+size_t _olm_enc_input_with_key(OlmPickleKey const * pickle_key,
+                               uint8_t * input, size_t b64_length,
+                               enum OlmErrorCode * last_error
 ) {
     size_t enc_length = _olm_decode_base64_length(b64_length);
     if (enc_length == (size_t)-1) {
@@ -78,9 +131,8 @@ size_t _olm_enc_input(uint8_t const * key, size_t key_length,
     _olm_decode_base64(input, b64_length, input);
     const struct _olm_cipher *cipher = OLM_CIPHER_BASE(&PICKLE_CIPHER);
     size_t raw_length = enc_length - cipher->ops->mac_length(cipher);
-    size_t result = cipher->ops->decrypt(
-        cipher,
-        key, key_length,
+    size_t result = _olm_cipher_aes_sha_256_decrypt_with_keys(
+        &pickle_key->keys,
         input, enc_length,
         input, raw_length,
         input, raw_length
@@ -90,3 +142,55 @@ size_t _olm_enc_input(uint8_t const * key, size_t key_length,
     }
     return result;
 }
+
+size_t _olm_enc_output_binary_length(
+    size_t raw_length
+) {
+    const struct _olm_cipher *cipher = OLM_CIPHER_BASE(&PICKLE_CIPHER);
+    size_t length = cipher->ops->encrypt_ciphertext_length(cipher, raw_length);
+    return length + cipher->ops->mac_length(cipher);
+}
+
+size_t _olm_enc_output_binary_with_key(
+    OlmPickleKey const * pickle_key,
+    uint8_t * output, size_t raw_length
+) {
+    const struct _olm_cipher *cipher = OLM_CIPHER_BASE(&PICKLE_CIPHER);
+    size_t ciphertext_length = cipher->ops->encrypt_ciphertext_length(
+        cipher, raw_length
+    );
+    size_t length = ciphertext_length + cipher->ops->mac_length(cipher);
+    _olm_cipher_aes_sha_256_encrypt_with_keys(
+        &pickle_key->keys,
+        output, raw_length,
+        output, ciphertext_length,
+        output, length
+    );
+    return length;
+}
+
+size_t _olm_enc_input_binary_with_key(
+    OlmPickleKey const * pickle_key,
+    uint8_t * input, size_t enc_length,
+    enum OlmErrorCode * last_error
+) {
+    const struct _olm_cipher *cipher = OLM_CIPHER_BASE(&PICKLE_CIPHER);
+    size_t mac_length = cipher->ops->mac_length(cipher);
+    size_t result;
+    if (enc_length < mac_length) {
+        if (last_error) {
+            *last_error = OLM_CORRUPTED_PICKLE;
+        }
+        return (size_t)-1;
+    }
+    result = _olm_cipher_aes_sha_256_decrypt_with_keys(
+        &pickle_key->keys,
+        input, enc_length,
+        input, enc_length - mac_length,
+        input, enc_length - mac_length
+    );
+    if (result == (size_t)-1 && last_error) {
+        *last_error = OLM_BAD_ACCOUNT_KEY;
+    }
+    return result;
+}
@@ -301,6 +301,22 @@ size_t olm_pickle_pk_decryption(
     OlmPkDecryption * decryption,
     void const * key, size_t key_length,
     void *pickled, size_t pickled_length
+) {
+    OlmPickleKey pickle_key;
+    _olm_pickle_key_init(
+        &pickle_key, reinterpret_cast<std::uint8_t const *>(key), key_length
+    );
+    std::size_t result = olm_pickle_pk_decryption_with_key(
+        decryption, &pickle_key, pickled, pickled_length
+    );
+    olm::unset(pickle_key);
+    return result;
+}
+
+size_t olm_pickle_pk_decryption_with_key(
+    OlmPkDecryption * decryption,
+    OlmPickleKey const * pickle_key,
+    void *pickled, size_t pickled_length
 ) {
     OlmPkDecryption & object = *decryption;
     std::size_t raw_length = pickle_length(object);
@@ -309,9 +325,8 @@ size_t olm_pickle_pk_decryption(
         return std::size_t(-1);
     }
     pickle(_olm_enc_output_pos(reinterpret_cast<std::uint8_t *>(pickled), raw_length), object);
-    return _olm_enc_output(
-        reinterpret_cast<std::uint8_t const *>(key), key_length,
-        reinterpret_cast<std::uint8_t *>(pickled), raw_length
+    return _olm_enc_output_with_key(
+        pickle_key, reinterpret_cast<std::uint8_t *>(pickled), raw_length
     );
 }
 
@@ -320,6 +335,24 @@ size_t olm_unpickle_pk_decryption(
     void const * key, size_t key_length,
     void *pickled, size_t pickled_length,
     void *pubkey, size_t pubkey_length
+) {
+    OlmPickleKey pickle_key;
+    _olm_pickle_key_init(
+        &pickle_key, reinterpret_cast<std::uint8_t const *>(key), key_length
+    );
+    std::size_t result = olm_unpickle_pk_decryption_with_key(
+        decryption, &pickle_key, pickled, pickled_length,
+        pubkey, pubkey_length
+    );
+    olm::unset(pickle_key);
+    return result;
+}
+
+size_t olm_unpickle_pk_decryption_with_key(
+    OlmPkDecryption * decryption,
+    OlmPickleKey const * pickle_key,
+    void *pickled, size_t pickled_length,
+    void *pubkey, size_t pubkey_length
 ) {
     OlmPkDecryption & object = *decryption;
     if (pubkey != NULL && pubkey_length < olm_pk_key_length()) {
@@ -327,9 +360,8 @@ size_t olm_unpickle_pk_decryption(
         return std::size_t(-1);
     }
     std::uint8_t * const input = reinterpret_cast<std::uint8_t *>(pickled);
-    std::size_t raw_length = _olm_enc_input(
-        reinterpret_cast<std::uint8_t const *>(key), key_length,
-        input, pickled_length, &object.last_error
+    std::size_t raw_length = _olm_enc_input_with_key(
+        pickle_key, input, pickled_length, &object.last_error
     );
     if (raw_length == std::size_t(-1)) {
         return std::size_t(-1);
@@ -14,6 +14,7 @@
  */
 #include "olm/ratchet.hh"
 #include "olm/message.hh"
+#include "olm/olm.h"
 #include "olm/memory.hh"
 #include "olm/cipher.h"
 #include "olm/pickle.hh"
@@ -78,16 +79,30 @@ static void advance_chain_key(
 }
 
 
-static void create_message_keys(
-    olm::ChainKey const & chain_key,
+/**
+ * Derive the message key for the current chain key, then advance the chain
+ * key. Both are HMACs keyed by the chain key, so the key is prepared once.
+ */
+static void create_message_keys_and_advance(
+    olm::ChainKey & chain_key,
     olm::KdfInfo const & info,
-    olm::MessageKey & message_key) {
-    _olm_crypto_hmac_sha256(
-        chain_key.key, sizeof(chain_key.key),
-        MESSAGE_KEY_SEED, sizeof(MESSAGE_KEY_SEED),
+    olm::MessageKey & message_key
+) {
+    _olm_hmac_sha256_ctx hmac;
+    _olm_crypto_hmac_sha256_init(
+        &hmac, chain_key.key, sizeof(chain_key.key)
+    );
+    _olm_crypto_hmac_sha256_compute(
+        &hmac, MESSAGE_KEY_SEED, sizeof(MESSAGE_KEY_SEED),
         message_key.key
     );
     message_key.index = chain_key.index;
+    _olm_crypto_hmac_sha256_compute(
+        &hmac, CHAIN_KEY_SEED, sizeof(CHAIN_KEY_SEED),
+        chain_key.key
+    );
+    chain_key.index++;
+    olm::unset(hmac);
 }
 
 
@@ -107,11 +122,359 @@ static std::size_t verify_mac_and_decrypt(
 }
 
 
+static std::size_t const NO_SLOT = std::size_t(-1);
+
+
+/**
+ * The slot in the index of a skipped message key table at which to start
+ * looking for a key.
+ */
+static std::size_t table_home(
+    olm::SkippedMessageKeyTable const & table,
+    std::uint8_t const * ratchet_key, std::uint32_t message_index
+) {
+    std::uint32_t hash = std::uint32_t(ratchet_key[0])
+        | std::uint32_t(ratchet_key[1]) << 8
+        | std::uint32_t(ratchet_key[2]) << 16
+        | std::uint32_t(ratchet_key[3]) << 24;
+    hash ^= message_index * 0x9e3779b1u;
+    return hash % table.index_slots;
+}
+
+
+static std::size_t table_home(
+    olm::SkippedMessageKeyTable const & table,
+    olm::SkippedMessageKey const & key
+) {
+    return table_home(
+        table, key.ratchet_key.public_key, key.message_key.index
+    );
+}
+
+
+/**
+ * Find the slot in the index of a skipped message key table for a key.
+ * Returns NO_SLOT if the key isn't in the table.
+ */
+static std::size_t table_find(
+    olm::SkippedMessageKeyTable const & table,
+    std::uint8_t const * ratchet_key, std::uint32_t message_index
+) {
+    std::size_t slot = table_home(table, ratchet_key, message_index);
+    while (table.index[slot]) {
+        olm::SkippedMessageKey const & key = table.keys[table.index[slot] - 1];
+        if (key.message_key.index == message_index
+                && 0 == std::memcmp(
+                    key.ratchet_key.public_key, ratchet_key,
+                    CURVE25519_KEY_LENGTH
+                )
+        ) {
+            return slot;
+        }
+        slot = (slot + 1) % table.index_slots;
+    }
+    return NO_SLOT;
+}
+
+
+/**
+ * Is the key at the given position in the ring still in the table, rather
+ * than one that has been used?
+ */
+static bool table_is_live(
+    olm::SkippedMessageKeyTable const & table, std::size_t pos
+) {
+    std::size_t slot = table_home(table, table.keys[pos]);
+    while (table.index[slot]) {
+        if (table.index[slot] == pos + 1) {
+            return true;
+        }
+        slot = (slot + 1) % table.index_slots;
+    }
+    return false;
+}
+
+
+/**
+ * Empty a slot in the index, moving later keys in the same run back to keep
+ * them reachable from their home slots.
+ */
+static void table_empty_slot(
+    olm::SkippedMessageKeyTable & table, std::size_t slot
+) {
+    std::size_t const slots = table.index_slots;
+    table.index[slot] = 0;
+    std::size_t next = slot;
+    while (true) {
+        next = (next + 1) % slots;
+        if (!table.index[next]) {
+            return;
+        }
+        std::size_t home = table_home(table, table.keys[table.index[next] - 1]);
+        /* the key can move back if the empty slot is between its home slot
+         * and where it is now */
+        if ((slot + slots - home) % slots < (next + slots - home) % slots) {
+            table.index[slot] = table.index[next];
+            table.index[next] = 0;
+            slot = next;
+        }
+    }
+}
+
+
+/**
+ * Remove the key in the given slot of the index from the table, and drop any
+ * used keys from the start of the ring.
+ */
+static void table_remove(
+    olm::SkippedMessageKeyTable & table, std::size_t slot
+) {
+    std::size_t pos = table.index[slot] - 1;
+    table_empty_slot(table, slot);
+    olm::unset(table.keys[pos]);
+    table.size--;
+    while (table.count && !table_is_live(table, table.first)) {
+        table.first = (table.first + 1) % table.max_keys;
+        table.count--;
+    }
+}
+
+
+/**
+ * Add the key at the given position in the ring to the index, replacing any
+ * other copy of the same key.
+ */
+static void table_link(
+    olm::SkippedMessageKeyTable & table, std::size_t pos
+) {
+    olm::SkippedMessageKey const & key = table.keys[pos];
+    std::size_t old_slot = table_find(
+        table, key.ratchet_key.public_key, key.message_key.index
+    );
+    std::size_t slot = table_home(table, key);
+    while (table.index[slot]) {
+        slot = (slot + 1) % table.index_slots;
+    }
+    table.index[slot] = std::uint16_t(pos + 1);
+    table.size++;
+    if (old_slot != NO_SLOT) {
+        table_remove(table, old_slot);
+    }
+}
+
+
+/**
+ * Close up the positions left in the ring by keys that have been used, moving
+ * the keys after them back and pointing the index at where they now are.
+ */
+static void table_compact(
+    olm::SkippedMessageKeyTable & table
+) {
+    std::size_t live = 0;
+    for (std::size_t i = 0; i < table.count; i++) {
+        std::size_t pos = (table.first + i) % table.max_keys;
+        std::size_t slot = table_home(table, table.keys[pos]);
+        while (table.index[slot] && table.index[slot] != pos + 1) {
+            slot = (slot + 1) % table.index_slots;
+        }
+        if (!table.index[slot]) {
+            continue;
+        }
+        std::size_t new_pos = (table.first + live++) % table.max_keys;
+        if (new_pos != pos) {
+            table.keys[new_pos] = table.keys[pos];
+            olm::unset(table.keys[pos]);
+            table.index[slot] = std::uint16_t(new_pos + 1);
+        }
+    }
+    table.count = live;
+}
+
+
+/**
+ * Add a key to the end of the ring. If the ring is full, the oldest key is
+ * dropped if the table holds as many keys as it can, and otherwise the gaps
+ * left by used keys are closed up, so that the latest max_keys keys are
+ * always kept.
+ */
+static void table_insert(
+    olm::SkippedMessageKeyTable & table,
+    olm::SkippedMessageKey const & key
+) {
+    if (table.size == table.max_keys) {
+        std::size_t slot = table_find(
+            table, table.keys[table.first].ratchet_key.public_key,
+            table.keys[table.first].message_key.index
+        );
+        /* the first key is always live, so this drops it and any used keys
+         * after it */
+        table_remove(table, slot);
+    } else if (table.count == table.max_keys) {
+        table_compact(table);
+    }
+    std::size_t pos = (table.first + table.count) % table.max_keys;
+    table.keys[pos] = key;
+    table.count++;
+    table_link(table, pos);
+}
+
+
+/**
+ * Start an empty table in the supplied memory.
+ */
+static void table_init(
+    olm::SkippedMessageKeyTable & table,
+    void * memory, std::size_t max_keys
+) {
+    table = olm::SkippedMessageKeyTable();
+    table.keys = static_cast<olm::SkippedMessageKey *>(memory);
+    table.index = reinterpret_cast<std::uint16_t *>(table.keys + max_keys);
+    table.max_keys = max_keys;
+    table.index_slots = 2 * max_keys;
+    std::memset(table.index, 0, table.index_slots * sizeof(std::uint16_t));
+}
+
+
+static std::size_t table_memory_length(
+    olm::SkippedMessageKeyTable const & table
+) {
+    return table.max_keys * sizeof(olm::SkippedMessageKey)
+        + table.index_slots * sizeof(std::uint16_t);
+}
+
+
+/**
+ * Wipe a table, and free its memory if it came from the allocator.
+ */
+static void table_release(
+    olm::SkippedMessageKeyTable & table, OlmAllocator const * allocator
+) {
+    if (table.keys) {
+        std::size_t length = table_memory_length(table);
+        olm::unset(table.keys, length);
+        if (table.allocated) {
+            allocator->deallocate(allocator->context, table.keys, length);
+        }
+    }
+    table = olm::SkippedMessageKeyTable();
+}
+
+
+/**
+ * Allocate memory for a table of the default size, if the ratchet has an
+ * allocator. Returns false if there is no memory for the table.
+ */
+static bool table_allocate(
+    olm::SkippedMessageKeyTable & table, OlmAllocator const * allocator
+) {
+    if (!allocator) {
+        return false;
+    }
+    void * memory = allocator->allocate(
+        allocator->context, sizeof(olm::SkippedMessageKeyStorage)
+    );
+    if (!memory) {
+        return false;
+    }
+    table_init(table, memory, olm::MAX_SKIPPED_MESSAGE_KEYS);
+    table.allocated = true;
+    return true;
+}
+
+
+/**
+ * The room for skipped message keys in the object holding a ratchet.
+ */
+static void * embedded_keys(olm::CompactRatchet const & ratchet) {
+    return const_cast<std::uint8_t *>(
+        reinterpret_cast<std::uint8_t const *>(&ratchet)
+    ) + ratchet.embedded_keys_offset;
+}
+
+
+/**
+ * Point a table that uses the room for keys in the object holding a ratchet
+ * at that room, since the object may have moved since the table was last
+ * used.
+ */
+static void table_locate(
+    olm::SkippedMessageKeyTable & table, olm::CompactRatchet const & ratchet
+) {
+    if (table.embedded) {
+        table.keys = static_cast<olm::SkippedMessageKey *>(
+            embedded_keys(ratchet)
+        );
+        table.index = reinterpret_cast<std::uint16_t *>(
+            table.keys + table.max_keys
+        );
+    }
+}
+
+
+/**
+ * The table of skipped message keys of a ratchet, ready to use.
+ */
+static olm::SkippedMessageKeyTable & skipped_keys_table(
+    olm::CompactRatchet & ratchet
+) {
+    table_locate(ratchet.skipped_message_key_table, ratchet);
+    return ratchet.skipped_message_key_table;
+}
+
+
+/**
+ * Start an empty table in the room for keys in the object holding a ratchet.
+ */
+static void table_init_embedded(
+    olm::SkippedMessageKeyTable & table, olm::CompactRatchet const & ratchet
+) {
+    table_init(table, embedded_keys(ratchet), olm::MAX_SKIPPED_MESSAGE_KEYS);
+    table.embedded = true;
+}
+
+
+/**
+ * The number of skipped message keys that a ratchet keeps.
+ */
+static std::size_t skipped_key_capacity(olm::CompactRatchet const & session) {
+    if (session.skipped_message_key_table.keys
+            || session.skipped_message_key_table.embedded) {
+        return session.skipped_message_key_table.max_keys;
+    }
+    if (session.allocator) {
+        return olm::MAX_SKIPPED_MESSAGE_KEYS;
+    }
+    return 0;
+}
+
+
+/**
+ * The chain keys and message keys worked out while verifying a message, so
+ * that they can be kept once the message has been decrypted without being
+ * worked out again.
+ */
+struct ChainAdvance {
+    /** the chain key for the message after the one decrypted */
+    olm::ChainKey chain_key;
+    /** the chain key for the first of the skipped messages whose keys will be
+     * kept */
+    olm::ChainKey window_chain_key;
+    /** the message keys for the messages that were skipped over, oldest
+     * first, for as many of the latest ones as the ratchet keeps. Only up to
+     * MAX_SKIPPED_MESSAGE_KEYS are worked out here; if the ratchet keeps
+     * more, the ones before them are worked out from window_chain_key when
+     * they are stored. */
+    olm::MessageKey skipped_keys[olm::MAX_SKIPPED_MESSAGE_KEYS];
+    std::size_t skipped_count;
+};
+
+
 static std::size_t verify_mac_and_decrypt_for_existing_chain(
-    olm::Ratchet const & session,
+    olm::CompactRatchet const & session,
     olm::ChainKey const & chain,
     olm::MessageReader const & reader,
-    std::uint8_t * plaintext, std::size_t max_plaintext_length
+    std::uint8_t * plaintext, std::size_t max_plaintext_length,
+    ChainAdvance & advance
 ) {
     if (reader.counter < chain.index) {
         return std::size_t(-1);
@@ -122,32 +485,54 @@ static std::size_t verify_mac_and_decrypt_for_existing_chain(
         return std::size_t(-1);
     }
 
-    olm::ChainKey new_chain = chain;
+    std::size_t keep = reader.counter - chain.index;
+    if (keep > skipped_key_capacity(session)) {
+        keep = skipped_key_capacity(session);
+    }
+
+    advance.chain_key = chain;
+    advance.window_chain_key = chain;
+    advance.skipped_count = 0;
 
-    while (new_chain.index < reader.counter) {
-        advance_chain_key(new_chain, new_chain);
+    while (advance.chain_key.index < reader.counter) {
+        std::size_t remaining = reader.counter - advance.chain_key.index;
+        if (remaining == keep) {
+            advance.window_chain_key = advance.chain_key;
+        }
+        if (remaining <= keep && remaining <= olm::MAX_SKIPPED_MESSAGE_KEYS) {
+            create_message_keys_and_advance(
+                advance.chain_key, session.kdf_info,
+                advance.skipped_keys[advance.skipped_count++]
+            );
+        } else {
+            advance_chain_key(advance.chain_key, advance.chain_key);
+        }
     }
 
     olm::MessageKey message_key;
-    create_message_keys(new_chain, session.kdf_info, message_key);
+    create_message_keys_and_advance(
+        advance.chain_key, session.kdf_info, message_key
+    );
 
     std::size_t result = verify_mac_and_decrypt(
         session.ratchet_cipher, message_key, reader,
         plaintext, max_plaintext_length
     );
 
-    olm::unset(new_chain);
+    olm::unset(message_key);
     return result;
 }
 
 
 static std::size_t verify_mac_and_decrypt_for_new_chain(
-    olm::Ratchet const & session,
+    olm::CompactRatchet const & session,
     olm::MessageReader const & reader,
-    std::uint8_t * plaintext, std::size_t max_plaintext_length
+    std::uint8_t * plaintext, std::size_t max_plaintext_length,
+    olm::SharedKey & new_root_key,
+    ChainAdvance & advance
 ) {
-    olm::SharedKey new_root_key;
-    olm::ReceiverChain new_chain;
+    olm::ChainKey new_chain_key;
+    _olm_curve25519_public_key their_ratchet_key;
 
     /* They shouldn't move to a new chain until we've sent them a message
      * acknowledging the last one */
@@ -159,35 +544,128 @@ static std::size_t verify_mac_and_decrypt_for_new_chain(
     if (reader.counter > MAX_MESSAGE_GAP) {
         return std::size_t(-1);
     }
-    olm::load_array(new_chain.ratchet_key.public_key, reader.ratchet_key);
+    olm::load_array(their_ratchet_key.public_key, reader.ratchet_key);
 
     create_chain_key(
         session.root_key, session.sender_chain[0].ratchet_key,
-        new_chain.ratchet_key, session.kdf_info,
-        new_root_key, new_chain.chain_key
+        their_ratchet_key, session.kdf_info,
+        new_root_key, new_chain_key
     );
     std::size_t result = verify_mac_and_decrypt_for_existing_chain(
-        session, new_chain.chain_key, reader,
-        plaintext, max_plaintext_length
+        session, new_chain_key, reader,
+        plaintext, max_plaintext_length, advance
     );
-    olm::unset(new_root_key);
-    olm::unset(new_chain);
+    olm::unset(new_chain_key);
     return result;
 }
 
 } // namespace
 
 
-olm::Ratchet::Ratchet(
+bool olm::SkippedMessageKeyTable::holds(std::size_t pos) const {
+    return table_is_live(*this, pos);
+}
+
+
+olm::CompactRatchet::CompactRatchet(
     olm::KdfInfo const & kdf_info,
     _olm_cipher const * ratchet_cipher
 ) : kdf_info(kdf_info),
     ratchet_cipher(ratchet_cipher),
-    last_error(OlmErrorCode::OLM_SUCCESS) {
+    last_error(OlmErrorCode::OLM_SUCCESS),
+    skipped_message_key_table(),
+    embedded_keys_offset(0),
+    allocator(nullptr) {
+}
+
+
+olm::Ratchet::Ratchet(
+    olm::KdfInfo const & kdf_info,
+    _olm_cipher const * ratchet_cipher
+) : CompactRatchet(kdf_info, ratchet_cipher) {
+    set_embedded_skipped_message_keys(skipped_keys);
+}
+
+
+void olm::CompactRatchet::set_embedded_skipped_message_keys(
+    olm::SkippedMessageKeyStorage & storage
+) {
+    embedded_keys_offset = std::uint32_t(
+        reinterpret_cast<std::uint8_t *>(&storage)
+            - reinterpret_cast<std::uint8_t *>(this)
+    );
+    set_skipped_message_key_table(nullptr, 0);
+}
+
+
+std::size_t olm::CompactRatchet::skipped_message_key_table_entry_size() {
+    return sizeof(olm::SkippedMessageKey) + 2 * sizeof(std::uint16_t);
+}
+
+
+std::size_t olm::CompactRatchet::set_skipped_message_key_table(
+    void * memory, std::size_t memory_length
+) {
+    std::size_t max_keys = memory_length
+        / skipped_message_key_table_entry_size();
+    if (max_keys > olm::MAX_SKIPPED_MESSAGE_KEY_TABLE_SIZE) {
+        max_keys = olm::MAX_SKIPPED_MESSAGE_KEY_TABLE_SIZE;
+    }
+    if (!max_keys) {
+        memory = nullptr;
+    }
+
+    olm::SkippedMessageKeyTable old_table = skipped_keys_table(*this);
+    olm::SkippedMessageKeyTable & table = skipped_message_key_table;
+    if (!memory && embedded_keys_offset && old_table.embedded) {
+        /* already there */
+        return skipped_key_capacity(*this);
+    }
+    table = olm::SkippedMessageKeyTable();
+
+    if (memory) {
+        table_init(table, memory, max_keys);
+    } else if (embedded_keys_offset) {
+        table_init_embedded(table, *this);
+    } else if (old_table.size) {
+        table_allocate(table, allocator);
+    }
+
+    if (table.keys) {
+        for (std::size_t i = 0; i < old_table.count; i++) {
+            std::size_t pos = (old_table.first + i) % old_table.max_keys;
+            if (table_is_live(old_table, pos)) {
+                table_insert(table, old_table.keys[pos]);
+            }
+        }
+    }
+    table_release(old_table, allocator);
+
+    return skipped_key_capacity(*this);
+}
+
+
+void olm::CompactRatchet::release_skipped_message_keys() {
+    table_release(skipped_keys_table(*this), allocator);
+    if (embedded_keys_offset) {
+        table_init_embedded(skipped_message_key_table, *this);
+    }
+}
+
+
+std::size_t olm::CompactRatchet::skipped_message_key_count() const {
+    return skipped_message_key_table.size;
+}
+
+
+olm::SkippedMessageKeyTable olm::CompactRatchet::skipped_message_keys() const {
+    olm::SkippedMessageKeyTable table = skipped_message_key_table;
+    table_locate(table, *this);
+    return table;
 }
 
 
-void olm::Ratchet::initialise_as_bob(
+void olm::CompactRatchet::initialise_as_bob(
     std::uint8_t const * shared_secret, std::size_t shared_secret_length,
     _olm_curve25519_public_key const & their_ratchet_key
 ) {
@@ -208,7 +686,7 @@ void olm::Ratchet::initialise_as_bob(
 }
 
 
-void olm::Ratchet::initialise_as_alice(
+void olm::CompactRatchet::initialise_as_alice(
     std::uint8_t const * shared_secret, std::size_t shared_secret_length,
     _olm_curve25519_key_pair const & our_ratchet_key
 ) {
@@ -356,37 +834,101 @@ static std::uint8_t const * unpickle(
 
 
 std::size_t olm::pickle_length(
-    olm::Ratchet const & value
+    olm::CompactRatchet const & value
 ) {
     std::size_t length = 0;
     length += olm::OLM_SHARED_KEY_LENGTH;
     length += olm::pickle_length(value.sender_chain);
     length += olm::pickle_length(value.receiver_chains);
-    length += olm::pickle_length(value.skipped_message_keys);
+    /* a list of the skipped message keys */
+    length += olm::pickle_length(std::uint32_t(0));
+    length += value.skipped_message_key_table.size
+        * olm::pickle_length(olm::SkippedMessageKey());
     return length;
 }
 
 std::uint8_t * olm::pickle(
     std::uint8_t * pos,
-    olm::Ratchet const & value
+    olm::CompactRatchet const & value
 ) {
     pos = pickle(pos, value.root_key);
     pos = pickle(pos, value.sender_chain);
     pos = pickle(pos, value.receiver_chains);
-    pos = pickle(pos, value.skipped_message_keys);
+    olm::SkippedMessageKeyTable const table = value.skipped_message_keys();
+    /* newest first, as they were when they were kept in a list */
+    pos = pickle(pos, std::uint32_t(table.size));
+    for (std::size_t i = table.count; i--; ) {
+        std::size_t key_pos = (table.first + i) % table.max_keys;
+        if (table_is_live(table, key_pos)) {
+            pos = pickle(pos, table.keys[key_pos]);
+        }
+    }
+    return pos;
+}
+
+
+/**
+ * Read the skipped message keys, keeping as many of the newest ones as the
+ * ratchet has room for. Pickles from ratchets with large tables can have more
+ * keys than ratchets of the default size keep.
+ */
+static std::uint8_t const * unpickle_skipped_message_keys(
+    std::uint8_t const * pos, std::uint8_t const * end,
+    olm::CompactRatchet & value
+) {
+    olm::SkippedMessageKeyTable & table = skipped_keys_table(value);
+    std::uint32_t size;
+    pos = olm::unpickle(pos, end, size); UNPICKLE_OK(pos);
+
+    if (table.keys) {
+        olm::unset(table.keys, table.max_keys * sizeof(olm::SkippedMessageKey));
+        std::memset(table.index, 0, table.index_slots * sizeof(std::uint16_t));
+        table.first = 0;
+        table.count = 0;
+        table.size = 0;
+    } else if (size) {
+        table_allocate(table, value.allocator);
+    }
+    std::size_t ring_count = size < table.max_keys ? size : table.max_keys;
+
+    std::size_t kept = 0;
+    olm::SkippedMessageKey discarded;
+    while (size-- && pos != end) {
+        olm::SkippedMessageKey * key = &discarded;
+        if (kept < ring_count) {
+            /* the pickle is newest first and the ring is oldest first */
+            key = &table.keys[ring_count - 1 - kept];
+        }
+        pos = olm::unpickle(pos, end, *key);
+        olm::unset(discarded);
+        UNPICKLE_OK(pos);
+        kept++;
+    }
+
+    if (kept < ring_count) {
+        /* the pickle was cut short */
+        return nullptr;
+    }
+    table.count = ring_count;
+    for (std::size_t i = 0; i < ring_count; i++) {
+        table_link(table, i);
+    }
+    if (table.allocated && !table.size) {
+        table_release(table, value.allocator);
+    }
     return pos;
 }
 
 
 std::uint8_t const * olm::unpickle(
     std::uint8_t const * pos, std::uint8_t const * end,
-    olm::Ratchet & value,
+    olm::CompactRatchet & value,
     bool includes_chain_index
 ) {
     pos = unpickle(pos, end, value.root_key); UNPICKLE_OK(pos);
     pos = unpickle(pos, end, value.sender_chain); UNPICKLE_OK(pos);
     pos = unpickle(pos, end, value.receiver_chains); UNPICKLE_OK(pos);
-    pos = unpickle(pos, end, value.skipped_message_keys); UNPICKLE_OK(pos);
+    pos = unpickle_skipped_message_keys(pos, end, value); UNPICKLE_OK(pos);
 
     // pickle v 0x80000001 includes a chain index; pickle v1 does not.
     if (includes_chain_index) {
@@ -397,7 +939,7 @@ std::uint8_t const * olm::unpickle(
 }
 
 
-std::size_t olm::Ratchet::encrypt_output_length(
+std::size_t olm::CompactRatchet::encrypt_output_length(
     std::size_t plaintext_length
 ) const {
     std::size_t counter = 0;
@@ -414,12 +956,12 @@ std::size_t olm::Ratchet::encrypt_output_length(
 }
 
 
-std::size_t olm::Ratchet::encrypt_random_length() const {
+std::size_t olm::CompactRatchet::encrypt_random_length() const {
     return sender_chain.empty() ? CURVE25519_RANDOM_LENGTH : 0;
 }
 
 
-std::size_t olm::Ratchet::encrypt(
+std::size_t olm::CompactRatchet::encrypt(
     std::uint8_t const * plaintext, std::size_t plaintext_length,
     std::uint8_t const * random, std::size_t random_length,
     std::uint8_t * output, std::size_t max_output_length
@@ -448,8 +990,7 @@ std::size_t olm::Ratchet::encrypt(
     }
 
     MessageKey keys;
-    create_message_keys(sender_chain[0].chain_key, kdf_info, keys);
-    advance_chain_key(sender_chain[0].chain_key, sender_chain[0].chain_key);
+    create_message_keys_and_advance(sender_chain[0].chain_key, kdf_info, keys);
 
     std::size_t ciphertext_length = ratchet_cipher->ops->encrypt_ciphertext_length(
         ratchet_cipher,
@@ -482,7 +1023,7 @@ std::size_t olm::Ratchet::encrypt(
 }
 
 
-std::size_t olm::Ratchet::decrypt_max_plaintext_length(
+std::size_t olm::CompactRatchet::decrypt_max_plaintext_length(
     std::uint8_t const * input, std::size_t input_length
 ) {
     olm::MessageReader reader;
@@ -501,7 +1042,7 @@ std::size_t olm::Ratchet::decrypt_max_plaintext_length(
 }
 
 
-std::size_t olm::Ratchet::decrypt(
+std::size_t olm::CompactRatchet::decrypt(
     std::uint8_t const * input, std::size_t input_length,
     std::uint8_t * plaintext, std::size_t max_plaintext_length
 ) {
@@ -537,6 +1078,7 @@ std::size_t olm::Ratchet::decrypt(
     }
 
     ReceiverChain * chain = nullptr;
+    olm::SkippedMessageKeyTable & table = skipped_keys_table(*this);
 
     for (olm::ReceiverChain & receiver_chain : receiver_chains) {
         if (0 == std::memcmp(
@@ -549,45 +1091,46 @@ std::size_t olm::Ratchet::decrypt(
     }
 
     std::size_t result = std::size_t(-1);
+    olm::SharedKey new_root_key;
+    ChainAdvance advance;
 
     if (!chain) {
         result = verify_mac_and_decrypt_for_new_chain(
-            *this, reader, plaintext, max_plaintext_length
+            *this, reader, plaintext, max_plaintext_length,
+            new_root_key, advance
         );
     } else if (chain->chain_key.index > reader.counter) {
         /* Chain already advanced beyond the key for this message
          * Check if the message keys are in the skipped key list. */
-        for (olm::SkippedMessageKey & skipped : skipped_message_keys) {
-            if (reader.counter == skipped.message_key.index
-                    && 0 == std::memcmp(
-                        skipped.ratchet_key.public_key, reader.ratchet_key,
-                        CURVE25519_KEY_LENGTH
-                    )
-            ) {
-                /* Found the key for this message. Check the MAC. */
-
-                result = verify_mac_and_decrypt(
-                    ratchet_cipher, skipped.message_key, reader,
-                    plaintext, max_plaintext_length
-                );
-
-                if (result != std::size_t(-1)) {
-                    /* Remove the key from the skipped keys now that we've
-                     * decoded the message it corresponds to. */
-                    olm::unset(skipped);
-                    skipped_message_keys.erase(&skipped);
-                    return result;
+        std::size_t slot = NO_SLOT;
+        if (table.keys) {
+            slot = table_find(table, reader.ratchet_key, reader.counter);
+        }
+        if (slot != NO_SLOT) {
+            result = verify_mac_and_decrypt(
+                ratchet_cipher, table.keys[table.index[slot] - 1].message_key,
+                reader, plaintext, max_plaintext_length
+            );
+            if (result != std::size_t(-1)) {
+                /* Remove the key from the skipped keys now that we've
+                 * decoded the message it corresponds to. */
+                table_remove(table, slot);
+                if (table.allocated && !table.size) {
+                    table_release(table, allocator);
                 }
+                return result;
             }
         }
     } else {
         result = verify_mac_and_decrypt_for_existing_chain(
             *this, chain->chain_key,
-            reader, plaintext, max_plaintext_length
+            reader, plaintext, max_plaintext_length, advance
         );
     }
 
     if (result == std::size_t(-1)) {
+        olm::unset(new_root_key);
+        olm::unset(advance);
         last_error = OlmErrorCode::OLM_BAD_MESSAGE_MAC;
         return std::size_t(-1);
     }
@@ -600,26 +1143,37 @@ std::size_t olm::Ratchet::decrypt(
 
         chain = receiver_chains.insert();
         olm::load_array(chain->ratchet_key.public_key, reader.ratchet_key);
-
-        // TODO: we've already done this once, in
-        // verify_mac_and_decrypt_for_new_chain(). we could reuse the result.
-        create_chain_key(
-            root_key, sender_chain[0].ratchet_key, chain->ratchet_key,
-            kdf_info, root_key, chain->chain_key
-        );
+        olm::load_array(root_key, new_root_key);
 
         olm::unset(sender_chain[0]);
         sender_chain.erase(sender_chain.begin());
     }
 
-    while (chain->chain_key.index < reader.counter) {
-        olm::SkippedMessageKey & key = *skipped_message_keys.insert();
-        create_message_keys(chain->chain_key, kdf_info, key.message_key);
+    /* keep the keys worked out while verifying the message */
+    if (!table.keys && advance.skipped_count) {
+        table_allocate(table, allocator);
+    }
+    if (table.keys) {
+        olm::SkippedMessageKey key;
         key.ratchet_key = chain->ratchet_key;
-        advance_chain_key(chain->chain_key, chain->chain_key);
+        /* work out the keys before the ones that were kept while verifying */
+        std::uint32_t kept_from =
+            advance.chain_key.index - 1 - advance.skipped_count;
+        while (advance.window_chain_key.index < kept_from) {
+            create_message_keys_and_advance(
+                advance.window_chain_key, kdf_info, key.message_key
+            );
+            table_insert(table, key);
+        }
+        for (std::size_t i = 0; i < advance.skipped_count; i++) {
+            key.message_key = advance.skipped_keys[i];
+            table_insert(table, key);
+        }
+        olm::unset(key);
     }
+    chain->chain_key = advance.chain_key;
 
-    advance_chain_key(chain->chain_key, chain->chain_key);
-
+    olm::unset(new_root_key);
+    olm::unset(advance);
     return result;
 }
@@ -44,11 +44,18 @@ static const struct _olm_cipher_aes_sha_256 OLM_CIPHER =
 olm::Session::Session(
 ) : ratchet(OLM_KDF_INFO, OLM_CIPHER_BASE(&OLM_CIPHER)),
     last_error(OlmErrorCode::OLM_SUCCESS),
-    received_message(false) {
+    received_message(false),
+    embedded_skipped_keys(false) {
 
 }
 
 
+olm::SessionWithSkippedKeys::SessionWithSkippedKeys() {
+    embedded_skipped_keys = true;
+    ratchet.set_embedded_skipped_message_keys(skipped_keys);
+}
+
+
 std::size_t olm::Session::new_outbound_session_random_length() const {
     return CURVE25519_RANDOM_LENGTH * 2;
 }
@@ -455,12 +462,26 @@ void olm::Session::describe(char *describe_buffer, size_t buflen) {
     size = snprintf(describe_buffer, remaining, " skipped message keys:");
     CHECK_SIZE_AND_ADVANCE;
 
-    for (size_t i = 0; i < ratchet.skipped_message_keys.size(); ++i) {
+    SkippedMessageKeyTable const table = ratchet.skipped_message_keys();
+    if (table.max_keys > MAX_SKIPPED_MESSAGE_KEYS) {
+        /* too many to list */
         size = snprintf(
             describe_buffer, remaining,
-            " %d", ratchet.skipped_message_keys[i].message_key.index
+            " %d in table", int(ratchet.skipped_message_key_count())
         );
         CHECK_SIZE_AND_ADVANCE;
+    } else {
+        for (size_t i = table.count; i--; ) {
+            std::size_t pos = (table.first + i) % table.max_keys;
+            if (!table.holds(pos)) {
+                continue;
+            }
+            size = snprintf(
+                describe_buffer, remaining,
+                " %d", table.keys[pos].message_key.index
+            );
+            CHECK_SIZE_AND_ADVANCE;
+        }
     }
 #undef CHECK_SIZE_AND_ADVANCE
 }
@@ -0,0 +1,374 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "olm/session_index.hh"
+#include "olm/session.hh"
+#include "olm/memory.hh"
+#include "olm/message.hh"
+#include "olm/pickle.hh"
+
+#include <cstring>
+
+namespace {
+
+static const std::size_t NO_SLOT = std::size_t(-1);
+
+static const std::uint32_t SESSION_INDEX_PICKLE_VERSION = 1;
+
+static std::uint32_t load_uint32(std::uint8_t const * bytes) {
+    return std::uint32_t(bytes[0])
+        | std::uint32_t(bytes[1]) << 8
+        | std::uint32_t(bytes[2]) << 16
+        | std::uint32_t(bytes[3]) << 24;
+}
+
+/* The base key and identity key come from whoever sent the message, so they
+ * could be chosen to collide in an unkeyed hash. */
+static std::size_t home_slot(
+    olm::SessionIndex const & index,
+    std::uint8_t const * identity_key,
+    std::uint8_t const * base_key,
+    std::uint8_t const * one_time_key
+) {
+    std::uint8_t keys[3 * CURVE25519_KEY_LENGTH];
+    std::uint8_t hash[SHA256_OUTPUT_LENGTH];
+    std::memcpy(keys, identity_key, CURVE25519_KEY_LENGTH);
+    std::memcpy(keys + CURVE25519_KEY_LENGTH, base_key, CURVE25519_KEY_LENGTH);
+    std::memcpy(
+        keys + 2 * CURVE25519_KEY_LENGTH, one_time_key, CURVE25519_KEY_LENGTH
+    );
+    _olm_crypto_hmac_sha256(
+        index.hash_key, sizeof(index.hash_key), keys, sizeof(keys), hash
+    );
+    std::size_t slot = load_uint32(hash) % index.index_slots;
+    olm::unset(hash);
+    return slot;
+}
+
+static std::size_t home_slot(
+    olm::SessionIndex const & index,
+    olm::SessionIndexEntry const & entry
+) {
+    return home_slot(
+        index, entry.alice_identity_key.public_key,
+        entry.alice_base_key.public_key, entry.bob_one_time_key.public_key
+    );
+}
+
+static bool same_keys(
+    olm::SessionIndexEntry const & entry,
+    std::uint8_t const * identity_key,
+    std::uint8_t const * base_key,
+    std::uint8_t const * one_time_key
+) {
+    return 0 == std::memcmp(
+            entry.alice_base_key.public_key, base_key, CURVE25519_KEY_LENGTH
+        ) && 0 == std::memcmp(
+            entry.bob_one_time_key.public_key, one_time_key,
+            CURVE25519_KEY_LENGTH
+        ) && 0 == std::memcmp(
+            entry.alice_identity_key.public_key, identity_key,
+            CURVE25519_KEY_LENGTH
+        );
+}
+
+} // namespace
+
+
+std::size_t olm::SessionIndex::memory_length(
+    std::size_t capacity
+) {
+    return sizeof(SessionIndex)
+        + capacity * sizeof(SessionIndexEntry)
+        + 2 * capacity * sizeof(std::uint32_t);
+}
+
+
+static_assert(
+    sizeof(olm::SessionIndex) % alignof(olm::SessionIndexEntry) == 0,
+    "The entries must be aligned when they follow the index object"
+);
+
+
+olm::SessionIndex::SessionIndex(
+    std::size_t capacity, std::uint8_t const * hash_key
+) : last_error(OlmErrorCode::OLM_SUCCESS),
+    capacity(capacity), count(0), index_slots(2 * capacity) {
+    olm::load_array(this->hash_key, hash_key);
+    std::memset(index(), 0, index_slots * sizeof(std::uint32_t));
+}
+
+
+olm::SessionIndexEntry * olm::SessionIndex::entries() {
+    return reinterpret_cast<SessionIndexEntry *>(this + 1);
+}
+
+
+olm::SessionIndexEntry const * olm::SessionIndex::entries() const {
+    return reinterpret_cast<SessionIndexEntry const *>(this + 1);
+}
+
+
+std::uint32_t * olm::SessionIndex::index() {
+    return reinterpret_cast<std::uint32_t *>(entries() + capacity);
+}
+
+
+std::uint32_t const * olm::SessionIndex::index() const {
+    return reinterpret_cast<std::uint32_t const *>(entries() + capacity);
+}
+
+
+std::size_t olm::SessionIndex::find_slot(
+    std::uint8_t const * identity_key,
+    std::uint8_t const * base_key,
+    std::uint8_t const * one_time_key
+) const {
+    std::uint32_t const * slots = index();
+    SessionIndexEntry const * table = entries();
+    std::size_t slot = home_slot(*this, identity_key, base_key, one_time_key);
+    while (slots[slot]) {
+        SessionIndexEntry const & entry = table[slots[slot] - 1];
+        if (same_keys(entry, identity_key, base_key, one_time_key)) {
+            return slot;
+        }
+        slot = (slot + 1) % index_slots;
+    }
+    return NO_SLOT;
+}
+
+
+void olm::SessionIndex::empty_slot(
+    std::size_t slot
+) {
+    std::uint32_t * slots = index();
+    SessionIndexEntry const * table = entries();
+    slots[slot] = 0;
+    std::size_t next = slot;
+    while (true) {
+        next = (next + 1) % index_slots;
+        if (!slots[next]) {
+            return;
+        }
+        std::size_t home = home_slot(*this, table[slots[next] - 1]);
+        /* the entry can move back if the empty slot is between its home slot
+         * and where it is now */
+        if ((slot + index_slots - home) % index_slots
+                < (next + index_slots - home) % index_slots) {
+            slots[slot] = slots[next];
+            slots[next] = 0;
+            slot = next;
+        }
+    }
+}
+
+
+std::size_t olm::SessionIndex::insert(
+    Session const & session, std::uint64_t handle
+) {
+    return insert(
+        session.alice_identity_key.public_key,
+        session.alice_base_key.public_key,
+        session.bob_one_time_key.public_key,
+        handle
+    );
+}
+
+
+std::size_t olm::SessionIndex::insert(
+    std::uint8_t const * identity_key,
+    std::uint8_t const * base_key,
+    std::uint8_t const * one_time_key,
+    std::uint64_t handle
+) {
+    std::uint32_t * slots = index();
+    SessionIndexEntry * table = entries();
+    std::size_t slot = find_slot(identity_key, base_key, one_time_key);
+    if (slot != NO_SLOT) {
+        table[slots[slot] - 1].handle = handle;
+        return 0;
+    }
+    if (count == capacity) {
+        last_error = OlmErrorCode::OLM_OUTPUT_BUFFER_TOO_SMALL;
+        return std::size_t(-1);
+    }
+    SessionIndexEntry & entry = table[count];
+    olm::load_array(entry.alice_identity_key.public_key, identity_key);
+    olm::load_array(entry.alice_base_key.public_key, base_key);
+    olm::load_array(entry.bob_one_time_key.public_key, one_time_key);
+    entry.handle = handle;
+    slot = home_slot(*this, entry);
+    while (slots[slot]) {
+        slot = (slot + 1) % index_slots;
+    }
+    slots[slot] = ++count;
+    return 0;
+}
+
+
+bool olm::SessionIndex::remove(
+    Session const & session
+) {
+    std::uint32_t * slots = index();
+    SessionIndexEntry * table = entries();
+    std::size_t slot = find_slot(
+        session.alice_identity_key.public_key,
+        session.alice_base_key.public_key,
+        session.bob_one_time_key.public_key
+    );
+    if (slot == NO_SLOT) {
+        return false;
+    }
+    std::size_t pos = slots[slot] - 1;
+    empty_slot(slot);
+    count--;
+    if (pos != count) {
+        /* move the last entry into the gap */
+        table[pos] = table[count];
+        slot = home_slot(*this, table[pos]);
+        while (slots[slot] != count + 1) {
+            slot = (slot + 1) % index_slots;
+        }
+        slots[slot] = pos + 1;
+    }
+    olm::unset(table[count]);
+    return true;
+}
+
+
+bool olm::SessionIndex::find(
+    _olm_curve25519_public_key const * their_identity_key,
+    std::uint8_t const * pre_key_message, std::size_t message_length,
+    std::uint64_t & handle
+) const {
+    olm::PreKeyMessageReader reader;
+    decode_one_time_key_message(reader, pre_key_message, message_length);
+
+    std::uint8_t const * identity_key = nullptr;
+    if (reader.identity_key) {
+        if (reader.identity_key_length != CURVE25519_KEY_LENGTH) {
+            return false;
+        }
+        identity_key = reader.identity_key;
+    }
+    if (their_identity_key) {
+        if (identity_key && 0 != std::memcmp(
+                identity_key, their_identity_key->public_key,
+                CURVE25519_KEY_LENGTH
+        )) {
+            return false;
+        }
+        identity_key = their_identity_key->public_key;
+    }
+
+    bool ok = identity_key;
+    ok = ok && reader.message;
+    ok = ok && reader.base_key;
+    ok = ok && reader.base_key_length == CURVE25519_KEY_LENGTH;
+    ok = ok && reader.one_time_key;
+    ok = ok && reader.one_time_key_length == CURVE25519_KEY_LENGTH;
+    if (!ok) {
+        return false;
+    }
+
+    std::size_t slot = find_slot(
+        identity_key, reader.base_key, reader.one_time_key
+    );
+    if (slot == NO_SLOT) {
+        return false;
+    }
+    handle = entries()[index()[slot] - 1].handle;
+    return true;
+}
+
+
+void olm::SessionIndex::clear() {
+    olm::unset(entries(), count * sizeof(SessionIndexEntry));
+    std::memset(index(), 0, index_slots * sizeof(std::uint32_t));
+    count = 0;
+}
+
+
+std::size_t olm::pickle_length(
+    SessionIndex const & value
+) {
+    std::size_t length = 0;
+    length += olm::pickle_length(SESSION_INDEX_PICKLE_VERSION);
+    length += olm::pickle_length(value.count);
+    for (std::size_t i = 0; i < value.count; ++i) {
+        SessionIndexEntry const & entry = value.entries()[i];
+        length += olm::pickle_length(entry.alice_identity_key);
+        length += olm::pickle_length(entry.alice_base_key);
+        length += olm::pickle_length(entry.bob_one_time_key);
+        length += 2 * olm::pickle_length(std::uint32_t(0));
+    }
+    return length;
+}
+
+
+std::uint8_t * olm::pickle(
+    std::uint8_t * pos,
+    SessionIndex const & value
+) {
+    pos = olm::pickle(pos, SESSION_INDEX_PICKLE_VERSION);
+    pos = olm::pickle(pos, value.count);
+    for (std::size_t i = 0; i < value.count; ++i) {
+        SessionIndexEntry const & entry = value.entries()[i];
+        pos = olm::pickle(pos, entry.alice_identity_key);
+        pos = olm::pickle(pos, entry.alice_base_key);
+        pos = olm::pickle(pos, entry.bob_one_time_key);
+        pos = olm::pickle(pos, std::uint32_t(entry.handle >> 32));
+        pos = olm::pickle(pos, std::uint32_t(entry.handle));
+    }
+    return pos;
+}
+
+
+std::uint8_t const * olm::unpickle(
+    std::uint8_t const * pos, std::uint8_t const * end,
+    SessionIndex & value
+) {
+    std::uint32_t pickle_version;
+    pos = olm::unpickle(pos, end, pickle_version); UNPICKLE_OK(pos);
+    if (pickle_version != SESSION_INDEX_PICKLE_VERSION) {
+        value.last_error = OlmErrorCode::OLM_UNKNOWN_PICKLE_VERSION;
+        return nullptr;
+    }
+
+    std::uint32_t count;
+    pos = olm::unpickle(pos, end, count); UNPICKLE_OK(pos);
+    if (count > value.capacity) {
+        value.last_error = OlmErrorCode::OLM_OUTPUT_BUFFER_TOO_SMALL;
+        return nullptr;
+    }
+
+    value.clear();
+    SessionIndexEntry entry;
+    while (count--) {
+        std::uint32_t high, low;
+        pos = olm::unpickle(pos, end, entry.alice_identity_key); UNPICKLE_OK(pos);
+        pos = olm::unpickle(pos, end, entry.alice_base_key); UNPICKLE_OK(pos);
+        pos = olm::unpickle(pos, end, entry.bob_one_time_key); UNPICKLE_OK(pos);
+        pos = olm::unpickle(pos, end, high); UNPICKLE_OK(pos);
+        pos = olm::unpickle(pos, end, low); UNPICKLE_OK(pos);
+        value.insert(
+            entry.alice_identity_key.public_key,
+            entry.alice_base_key.public_key,
+            entry.bob_one_time_key.public_key,
+            std::uint64_t(high) << 32 | low
+        );
+    }
+
+    return pos;
+}
@@ -0,0 +1,232 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "olm/sha256_hw.h"
+#include "olm/cpu_features.h"
+
+#if defined(OLM_CPU_X86) && (defined(__GNUC__) || defined(_MSC_VER))
+#  define OLM_SHA256_HW_X86 1
+#  include <emmintrin.h>
+#  include <tmmintrin.h>
+#  include <smmintrin.h>
+#  include <immintrin.h>
+#  if defined(__GNUC__)
+#    define TARGET_SHA __attribute__((target("sha,sse4.1,ssse3,sse2")))
+#  else
+#    define TARGET_SHA
+#  endif
+#elif defined(OLM_CPU_AARCH64) \
+    && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+#  define OLM_SHA256_HW_ARM 1
+#  include <arm_neon.h>
+#endif
+
+#define SHA256_BLOCK_LENGTH 64
+
+static int sha256_hw_enabled = 1;
+
+int _olm_sha256_hw_supported(void) {
+#if defined(OLM_SHA256_HW_X86) || defined(OLM_SHA256_HW_ARM)
+    return _olm_cpu_has_sha256();
+#else
+    return 0;
+#endif
+}
+
+int _olm_sha256_hw_active(void) {
+    return sha256_hw_enabled && _olm_sha256_hw_supported();
+}
+
+int _olm_sha256_hw_enable(int enable) {
+    int previous = sha256_hw_enabled;
+    sha256_hw_enabled = enable != 0;
+    return previous;
+}
+
+#if defined(OLM_SHA256_HW_X86) || defined(OLM_SHA256_HW_ARM)
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#endif
+
+#if defined(OLM_SHA256_HW_X86)
+
+/* The message schedule is kept as four vectors of four words, W(i) holding
+ * words 4i..4i+3, and W(i) for i >= 4 is derived from W(i-4)..W(i-1).
+ *
+ * The SHA rounds instruction wants the state as ABEF/CDGH rather than
+ * ABCD/EFGH, so it is shuffled on the way in and out.
+ */
+
+#define LOAD(p) _mm_loadu_si128((__m128i const *)(p))
+#define STORE(p, v) _mm_storeu_si128((__m128i *)(p), (v))
+
+#define ROUNDS(w, i) do { \
+        __m128i msg = _mm_add_epi32((w), LOAD(&K[4 * (i)])); \
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg); \
+        msg = _mm_shuffle_epi32(msg, 0x0E); \
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg); \
+    } while (0)
+
+/* w0 = W(i-4), w1 = W(i-3), w2 = W(i-2), w3 = W(i-1); replaces w0 with W(i) */
+#define SCHEDULE(w0, w1, w2, w3) do { \
+        __m128i tmp = _mm_sha256msg1_epu32((w0), (w1)); \
+        tmp = _mm_add_epi32(tmp, _mm_alignr_epi8((w3), (w2), 4)); \
+        (w0) = _mm_sha256msg2_epu32(tmp, (w3)); \
+    } while (0)
+
+TARGET_SHA
+void _olm_sha256_hw_compress(
+    uint32_t state[8],
+    uint8_t const *data, size_t blocks
+) {
+    const __m128i byteswap = _mm_set_epi64x(
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL
+    );
+    __m128i state0, state1, tmp;
+
+    tmp = _mm_shuffle_epi32(LOAD(&state[0]), 0xB1);    /* CDAB */
+    state1 = _mm_shuffle_epi32(LOAD(&state[4]), 0x1B); /* EFGH */
+    state0 = _mm_alignr_epi8(tmp, state1, 8);          /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);       /* CDGH */
+
+    while (blocks--) {
+        __m128i abef_save = state0;
+        __m128i cdgh_save = state1;
+        __m128i w0, w1, w2, w3;
+        int i;
+
+        w0 = _mm_shuffle_epi8(LOAD(data), byteswap);
+        w1 = _mm_shuffle_epi8(LOAD(data + 16), byteswap);
+        w2 = _mm_shuffle_epi8(LOAD(data + 32), byteswap);
+        w3 = _mm_shuffle_epi8(LOAD(data + 48), byteswap);
+
+        ROUNDS(w0, 0);
+        ROUNDS(w1, 1);
+        ROUNDS(w2, 2);
+        ROUNDS(w3, 3);
+
+        for (i = 4; i < 16; i += 4) {
+            SCHEDULE(w0, w1, w2, w3);
+            ROUNDS(w0, i);
+            SCHEDULE(w1, w2, w3, w0);
+            ROUNDS(w1, i + 1);
+            SCHEDULE(w2, w3, w0, w1);
+            ROUNDS(w2, i + 2);
+            SCHEDULE(w3, w0, w1, w2);
+            ROUNDS(w3, i + 3);
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+        data += SHA256_BLOCK_LENGTH;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);       /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xB1);    /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0); /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);    /* HGFE */
+    STORE(&state[0], state0);
+    STORE(&state[4], state1);
+}
+
+#elif defined(OLM_SHA256_HW_ARM)
+
+#define ROUNDS(w, i) do { \
+        uint32x4_t msg = vaddq_u32((w), vld1q_u32(&K[4 * (i)])); \
+        uint32x4_t save = state0; \
+        state0 = vsha256hq_u32(state0, state1, msg); \
+        state1 = vsha256h2q_u32(state1, save, msg); \
+    } while (0)
+
+/* w0 = W(i-4), w1 = W(i-3), w2 = W(i-2), w3 = W(i-1); replaces w0 with W(i) */
+#define SCHEDULE(w0, w1, w2, w3) \
+    (w0) = vsha256su1q_u32(vsha256su0q_u32((w0), (w1)), (w2), (w3))
+
+#define LOAD_BE(p) vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)))
+
+void _olm_sha256_hw_compress(
+    uint32_t state[8],
+    uint8_t const *data, size_t blocks
+) {
+    uint32x4_t state0 = vld1q_u32(&state[0]);
+    uint32x4_t state1 = vld1q_u32(&state[4]);
+
+    while (blocks--) {
+        uint32x4_t abcd_save = state0;
+        uint32x4_t efgh_save = state1;
+        uint32x4_t w0, w1, w2, w3;
+        int i;
+
+        w0 = LOAD_BE(data);
+        w1 = LOAD_BE(data + 16);
+        w2 = LOAD_BE(data + 32);
+        w3 = LOAD_BE(data + 48);
+
+        ROUNDS(w0, 0);
+        ROUNDS(w1, 1);
+        ROUNDS(w2, 2);
+        ROUNDS(w3, 3);
+
+        for (i = 4; i < 16; i += 4) {
+            SCHEDULE(w0, w1, w2, w3);
+            ROUNDS(w0, i);
+            SCHEDULE(w1, w2, w3, w0);
+            ROUNDS(w1, i + 1);
+            SCHEDULE(w2, w3, w0, w1);
+            ROUNDS(w2, i + 2);
+            SCHEDULE(w3, w0, w1, w2);
+            ROUNDS(w3, i + 3);
+        }
+
+        state0 = vaddq_u32(state0, abcd_save);
+        state1 = vaddq_u32(state1, efgh_save);
+        data += SHA256_BLOCK_LENGTH;
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+
+#else
+
+/* No hardware support on this platform: _olm_sha256_hw_supported() always
+ * returns 0, so this is never called.
+ */
+void _olm_sha256_hw_compress(
+    uint32_t state[8],
+    uint8_t const *data, size_t blocks
+) {
+    (void)state; (void)data; (void)blocks;
+}
+
+#endif
@@ -0,0 +1,274 @@
+/* Copyright 2026 The Matrix.org Foundation C.I.C.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "olm/sha256_mb.h"
+#include "olm/cpu_features.h"
+#include "olm/memory.h"
+
+#include <string.h>
+
+#if defined(OLM_CPU_X86) && (defined(__GNUC__) || defined(_MSC_VER))
+
+#  define OLM_SHA256_MB 1
+#  include <immintrin.h>
+#  if defined(__GNUC__)
+#    define TARGET_SIMD __attribute__((target("avx2")))
+#  else
+#    define TARGET_SIMD
+#  endif
+
+#  define LANES 8
+typedef __m256i vec;
+#  define ADD(a, b) _mm256_add_epi32((a), (b))
+#  define XOR(a, b) _mm256_xor_si256((a), (b))
+#  define AND(a, b) _mm256_and_si256((a), (b))
+/* (~a) & b */
+#  define ANDNOT(a, b) _mm256_andnot_si256((a), (b))
+#  define SHR(x, n) _mm256_srli_epi32((x), (n))
+#  define ROTR(x, n) \
+    _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#  define SPLAT(k) _mm256_set1_epi32((int)(k))
+#  define LOADV(p) _mm256_loadu_si256((__m256i const *)(p))
+#  define STOREV(p, v) _mm256_storeu_si256((__m256i *)(p), (v))
+
+static int simd_supported(void) {
+    return _olm_cpu_has_avx2();
+}
+
+#elif defined(OLM_CPU_AARCH64) && defined(__ARM_NEON)
+
+#  define OLM_SHA256_MB 1
+#  include <arm_neon.h>
+#  define TARGET_SIMD
+
+#  define LANES 4
+typedef uint32x4_t vec;
+#  define ADD(a, b) vaddq_u32((a), (b))
+#  define XOR(a, b) veorq_u32((a), (b))
+#  define AND(a, b) vandq_u32((a), (b))
+/* (~a) & b */
+#  define ANDNOT(a, b) vbicq_u32((b), (a))
+#  define SHR(x, n) vshrq_n_u32((x), (n))
+#  define ROTR(x, n) vsliq_n_u32(vshrq_n_u32((x), (n)), (x), 32 - (n))
+#  define SPLAT(k) vdupq_n_u32((k))
+#  define LOADV(p) vld1q_u32((p))
+#  define STOREV(p, v) vst1q_u32((p), (v))
+
+static int simd_supported(void) {
+    return 1;
+}
+
+#endif
+
+static int sha256_mb_enabled = 1;
+
+size_t _olm_sha256_mb_supported(void) {
+#if defined(OLM_SHA256_MB)
+    return simd_supported() ? LANES : 0;
+#else
+    return 0;
+#endif
+}
+
+int _olm_sha256_mb_active(void) {
+    return sha256_mb_enabled && _olm_sha256_mb_supported();
+}
+
+int _olm_sha256_mb_enable(int enable) {
+    int previous = sha256_mb_enabled;
+    sha256_mb_enabled = enable != 0;
+    return previous;
+}
+
+#if defined(OLM_SHA256_MB)
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define CH(x, y, z) XOR(AND((x), (y)), ANDNOT((x), (z)))
+#define MAJ(x, y, z) XOR(XOR(AND((x), (y)), AND((x), (z))), AND((y), (z)))
+#define EP0(x) XOR(XOR(ROTR((x), 2), ROTR((x), 13)), ROTR((x), 22))
+#define EP1(x) XOR(XOR(ROTR((x), 6), ROTR((x), 11)), ROTR((x), 25))
+#define SIG0(x) XOR(XOR(ROTR((x), 7), ROTR((x), 18)), SHR((x), 3))
+#define SIG1(x) XOR(XOR(ROTR((x), 17), ROTR((x), 19)), SHR((x), 10))
+
+/* One round, t + i. Rather than shuffling the working variables along
+ * after each round, the callers rotate the names. */
+#define ROUND(a, b, c, d, e, f, g, h, i) do { \
+    vec t1 = ADD( \
+        ADD(ADD((h), EP1(e)), ADD(CH((e), (f), (g)), SPLAT(K[t + (i)]))), \
+        w[i] \
+    ); \
+    vec t2 = ADD(EP0(a), MAJ((a), (b), (c))); \
+    (d) = ADD((d), t1); \
+    (h) = ADD(t1, t2); \
+} while (0)
+
+/* Extend the message schedule by the next 16 words, overwriting the oldest
+ * ones: w[i] held word t - 16 + i and now holds word t + i. */
+#define SCHEDULE(i) (w[i] = ADD( \
+    ADD(SIG1(w[((i) + 14) & 15]), w[((i) + 9) & 15]), \
+    ADD(SIG0(w[((i) + 1) & 15]), w[i]) \
+))
+#define SCHEDULE16() do { \
+    SCHEDULE(0); SCHEDULE(1); SCHEDULE(2); SCHEDULE(3); \
+    SCHEDULE(4); SCHEDULE(5); SCHEDULE(6); SCHEDULE(7); \
+    SCHEDULE(8); SCHEDULE(9); SCHEDULE(10); SCHEDULE(11); \
+    SCHEDULE(12); SCHEDULE(13); SCHEDULE(14); SCHEDULE(15); \
+} while (0)
+
+/* Compress exactly LANES blocks. Each vector holds the same word of every
+ * lane's state or message schedule, so the inputs are transposed on the way
+ * in and out.
+ */
+TARGET_SIMD
+static void compress_lanes(
+    uint32_t * const * states,
+    uint8_t const * const * blocks
+) {
+    uint32_t words[16][LANES];
+    uint32_t state[8][LANES];
+    vec w[16];
+    vec a, b, c, d, e, f, g, h;
+    int lane, t;
+
+    for (lane = 0; lane < LANES; lane++) {
+        uint8_t const *block = blocks[lane];
+        for (t = 0; t < 16; t++) {
+            words[t][lane] = ((uint32_t)block[4 * t] << 24)
+                | ((uint32_t)block[4 * t + 1] << 16)
+                | ((uint32_t)block[4 * t + 2] << 8)
+                | ((uint32_t)block[4 * t + 3]);
+        }
+        for (t = 0; t < 8; t++) {
+            state[t][lane] = states[lane][t];
+        }
+    }
+
+    for (t = 0; t < 16; t++) {
+        w[t] = LOADV(words[t]);
+    }
+    a = LOADV(state[0]);
+    b = LOADV(state[1]);
+    c = LOADV(state[2]);
+    d = LOADV(state[3]);
+    e = LOADV(state[4]);
+    f = LOADV(state[5]);
+    g = LOADV(state[6]);
+    h = LOADV(state[7]);
+
+    for (t = 0; t < 64; t += 16) {
+        if (t) {
+            SCHEDULE16();
+        }
+        ROUND(a, b, c, d, e, f, g, h, 0);
+        ROUND(h, a, b, c, d, e, f, g, 1);
+        ROUND(g, h, a, b, c, d, e, f, 2);
+        ROUND(f, g, h, a, b, c, d, e, 3);
+        ROUND(e, f, g, h, a, b, c, d, 4);
+        ROUND(d, e, f, g, h, a, b, c, 5);
+        ROUND(c, d, e, f, g, h, a, b, 6);
+        ROUND(b, c, d, e, f, g, h, a, 7);
+        ROUND(a, b, c, d, e, f, g, h, 8);
+        ROUND(h, a, b, c, d, e, f, g, 9);
+        ROUND(g, h, a, b, c, d, e, f, 10);
+        ROUND(f, g, h, a, b, c, d, e, 11);
+        ROUND(e, f, g, h, a, b, c, d, 12);
+        ROUND(d, e, f, g, h, a, b, c, 13);
+        ROUND(c, d, e, f, g, h, a, b, 14);
+        ROUND(b, c, d, e, f, g, h, a, 15);
+    }
+
+    STOREV(state[0], ADD(a, LOADV(state[0])));
+    STOREV(state[1], ADD(b, LOADV(state[1])));
+    STOREV(state[2], ADD(c, LOADV(state[2])));
+    STOREV(state[3], ADD(d, LOADV(state[3])));
+    STOREV(state[4], ADD(e, LOADV(state[4])));
+    STOREV(state[5], ADD(f, LOADV(state[5])));
+    STOREV(state[6], ADD(g, LOADV(state[6])));
+    STOREV(state[7], ADD(h, LOADV(state[7])));
+
+    for (lane = 0; lane < LANES; lane++) {
+        for (t = 0; t < 8; t++) {
+            states[lane][t] = state[t][lane];
+        }
+    }
+}
+
+void _olm_sha256_mb_compress(
+    uint32_t * const * states,
+    uint8_t const * const * blocks,
+    size_t count
+) {
+    while (count >= LANES) {
+        compress_lanes(states, blocks);
+        states += LANES;
+        blocks += LANES;
+        count -= LANES;
+    }
+
+    if (count) {
+        /* fill the unused lanes with copies of the first one, and throw
+         * away the results */
+        uint32_t spare_states[LANES][8];
+        uint32_t *lane_states[LANES];
+        uint8_t const *lane_blocks[LANES];
+        size_t i;
+
+        for (i = 0; i < LANES; i++) {
+            if (i < count) {
+                lane_states[i] = states[i];
+                lane_blocks[i] = blocks[i];
+            } else {
+                memcpy(spare_states[i], states[0], sizeof(spare_states[i]));
+                lane_states[i] = spare_states[i];
+                lane_blocks[i] = blocks[0];
+            }
+        }
+        compress_lanes(lane_states, lane_blocks);
+        _olm_unset(spare_states, sizeof(spare_states));
+    }
+}
+
+#else
+
+/* No multi-buffer support on this platform: _olm_sha256_mb_supported()
+ * always returns 0, so this is never called.
+ */
+void _olm_sha256_mb_compress(
+    uint32_t * const * states,
+    uint8_t const * const * blocks,
+    size_t count
+) {
+    (void)states; (void)blocks; (void)count;
+}
+
+#endif
@@ -55,3 +55,11 @@ size_t olm::Utility::ed25519_verify(
     }
     return std::size_t(0);
 }
+
+
+size_t olm::Utility::ed25519_verify_batch(
+    _olm_ed25519_verify_item const * items, std::size_t count,
+    std::uint8_t * results
+) {
+    return _olm_crypto_ed25519_verify_batch(items, count, results);
+}
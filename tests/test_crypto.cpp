@@ -16,6 +16,23 @@
 
 #include "testing.hh"
 
+#include <cstring>
+
+#if defined(OLM_TEST_CURVE25519_DONNA)
+/* The vendored curve25519-donna implementations, built into this test under
+ * their own names by tests/CMakeLists.txt */
+extern "C" {
+int curve25519_donna_32(
+    unsigned char *output, const unsigned char *a, const unsigned char *b
+);
+#if defined(OLM_TEST_CURVE25519_DONNA_C64)
+int curve25519_donna_c64(
+    unsigned char *output, const unsigned char *a, const unsigned char *b
+);
+#endif
+}
+#endif
+
 
 /* Curve25529 Test Case 1 */
 
@@ -80,6 +97,60 @@ CHECK_EQ_SIZE(expected_agreement, actual_agreement, 32);
 
 } /* Curve25529 Test Case 1 */
 
+#if defined(OLM_TEST_CURVE25519_DONNA)
+
+TEST_CASE("Curve25519 implementations agree") {
+
+std::uint8_t private_key[32];
+std::uint8_t public_key[32];
+for (std::size_t i = 0; i < 32; ++i) {
+    private_key[i] = i * 37 + 5;
+    public_key[i] = i * 11 + 200;
+}
+
+for (unsigned round = 0; round < 64; ++round) {
+    CAPTURE(round);
+    _olm_curve25519_key_pair our_pair;
+    _olm_curve25519_public_key their_key;
+    std::uint8_t library[32], donna_32[32];
+
+    _olm_crypto_curve25519_generate_key(private_key, &our_pair);
+    /* key generation uses the ed25519 base point tables rather than the
+     * ladder */
+    static const std::uint8_t BASEPOINT[32] = {9};
+    std::uint8_t expected_public[32];
+    curve25519_donna_32(expected_public, private_key, BASEPOINT);
+    CHECK_EQ_SIZE(expected_public, our_pair.public_key.public_key, 32);
+
+    /* alternate between points on the curve, and arbitrary bytes with and
+     * without the top bit set */
+    if (round % 2) {
+        _olm_curve25519_key_pair their_pair;
+        _olm_crypto_curve25519_generate_key(public_key, &their_pair);
+        std::memcpy(their_key.public_key, their_pair.public_key.public_key, 32);
+    } else {
+        std::memcpy(their_key.public_key, public_key, 32);
+        their_key.public_key[31] ^= (round & 2) << 6;
+    }
+
+    _olm_crypto_curve25519_shared_secret(&our_pair, &their_key, library);
+    curve25519_donna_32(donna_32, private_key, their_key.public_key);
+    CHECK_EQ_SIZE(donna_32, library, 32);
+#if defined(OLM_TEST_CURVE25519_DONNA_C64)
+    std::uint8_t donna_c64[32];
+    curve25519_donna_c64(donna_c64, private_key, their_key.public_key);
+    CHECK_EQ_SIZE(donna_32, donna_c64, 32);
+#endif
+
+    /* feed the outputs back in as the next inputs */
+    std::memcpy(private_key, library, 32);
+    std::memcpy(public_key, our_pair.public_key.public_key, 32);
+}
+
+}
+
+#endif
+
 
 TEST_CASE("Ed25519 Signature Test Case 1") {
 std::uint8_t private_key[33] = "This key is a string of 32 bytes";
@@ -108,6 +179,256 @@ CHECK(!result);
 }
 
 
+/* RFC 8032 section 7.1, tests 1 and 2 */
+
+TEST_CASE("Ed25519 Signature Test Case 2") {
+static const std::uint8_t SEEDS[2][32] = {{
+    0x9D, 0x61, 0xB1, 0x9D, 0xEF, 0xFD, 0x5A, 0x60,
+    0xBA, 0x84, 0x4A, 0xF4, 0x92, 0xEC, 0x2C, 0xC4,
+    0x44, 0x49, 0xC5, 0x69, 0x7B, 0x32, 0x69, 0x19,
+    0x70, 0x3B, 0xAC, 0x03, 0x1C, 0xAE, 0x7F, 0x60
+}, {
+    0x4C, 0xCD, 0x08, 0x9B, 0x28, 0xFF, 0x96, 0xDA,
+    0x9D, 0xB6, 0xC3, 0x46, 0xEC, 0x11, 0x4E, 0x0F,
+    0x5B, 0x8A, 0x31, 0x9F, 0x35, 0xAB, 0xA6, 0x24,
+    0xDA, 0x8C, 0xF6, 0xED, 0x4F, 0xB8, 0xA6, 0xFB
+}};
+std::uint8_t PUBLIC_KEYS[2][32] = {{
+    0xD7, 0x5A, 0x98, 0x01, 0x82, 0xB1, 0x0A, 0xB7,
+    0xD5, 0x4B, 0xFE, 0xD3, 0xC9, 0x64, 0x07, 0x3A,
+    0x0E, 0xE1, 0x72, 0xF3, 0xDA, 0xA6, 0x23, 0x25,
+    0xAF, 0x02, 0x1A, 0x68, 0xF7, 0x07, 0x51, 0x1A
+}, {
+    0x3D, 0x40, 0x17, 0xC3, 0xE8, 0x43, 0x89, 0x5A,
+    0x92, 0xB7, 0x0A, 0xA7, 0x4D, 0x1B, 0x7E, 0xBC,
+    0x9C, 0x98, 0x2C, 0xCF, 0x2E, 0xC4, 0x96, 0x8C,
+    0xC0, 0xCD, 0x55, 0xF1, 0x2A, 0xF4, 0x66, 0x0C
+}};
+static const std::uint8_t MESSAGES[2][1] = {{0}, {0x72}};
+static const std::size_t MESSAGE_LENGTHS[2] = {0, 1};
+std::uint8_t SIGNATURES[2][64] = {{
+    0xE5, 0x56, 0x43, 0x00, 0xC3, 0x60, 0xAC, 0x72,
+    0x90, 0x86, 0xE2, 0xCC, 0x80, 0x6E, 0x82, 0x8A,
+    0x84, 0x87, 0x7F, 0x1E, 0xB8, 0xE5, 0xD9, 0x74,
+    0xD8, 0x73, 0xE0, 0x65, 0x22, 0x49, 0x01, 0x55,
+    0x5F, 0xB8, 0x82, 0x15, 0x90, 0xA3, 0x3B, 0xAC,
+    0xC6, 0x1E, 0x39, 0x70, 0x1C, 0xF9, 0xB4, 0x6B,
+    0xD2, 0x5B, 0xF5, 0xF0, 0x59, 0x5B, 0xBE, 0x24,
+    0x65, 0x51, 0x41, 0x43, 0x8E, 0x7A, 0x10, 0x0B
+}, {
+    0x92, 0xA0, 0x09, 0xA9, 0xF0, 0xD4, 0xCA, 0xB8,
+    0x72, 0x0E, 0x82, 0x0B, 0x5F, 0x64, 0x25, 0x40,
+    0xA2, 0xB2, 0x7B, 0x54, 0x16, 0x50, 0x3F, 0x8F,
+    0xB3, 0x76, 0x22, 0x23, 0xEB, 0xDB, 0x69, 0xDA,
+    0x08, 0x5A, 0xC1, 0xE4, 0x3E, 0x15, 0x99, 0x6E,
+    0x45, 0x8F, 0x36, 0x13, 0xD0, 0xF1, 0x1D, 0x8C,
+    0x38, 0x7B, 0x2E, 0xAE, 0xB4, 0x30, 0x2A, 0xEE,
+    0xB0, 0x0D, 0x29, 0x16, 0x12, 0xBB, 0x0C, 0x00
+}};
+
+for (unsigned i = 0; i < 2; ++i) {
+    CAPTURE(i);
+    _olm_ed25519_key_pair key_pair;
+    _olm_crypto_ed25519_generate_key(SEEDS[i], &key_pair);
+    CHECK_EQ_SIZE(PUBLIC_KEYS[i], key_pair.public_key.public_key, 32);
+
+    std::uint8_t signature[64];
+    _olm_crypto_ed25519_sign(
+        &key_pair, MESSAGES[i], MESSAGE_LENGTHS[i], signature
+    );
+    CHECK_EQ_SIZE(SIGNATURES[i], signature, 64);
+}
+}
+
+
+TEST_CASE("Ed25519 signatures from many keys verify") {
+/* signing uses its own fixed-base multiplication, so check it against the
+ * verifier, which does not */
+std::uint8_t seed[32];
+std::uint8_t message[64];
+for (std::size_t i = 0; i < 32; ++i) {
+    seed[i] = i * 29 + 3;
+}
+for (std::size_t i = 0; i < sizeof(message); ++i) {
+    message[i] = i * 7 + 1;
+}
+
+for (unsigned round = 0; round < 64; ++round) {
+    CAPTURE(round);
+    _olm_ed25519_key_pair key_pair;
+    _olm_crypto_ed25519_generate_key(seed, &key_pair);
+
+    std::uint8_t signature[64];
+    _olm_crypto_ed25519_sign(&key_pair, message, round, signature);
+    CHECK(_olm_crypto_ed25519_verify(
+        &key_pair.public_key, message, round, signature
+    ));
+
+    /* feed the outputs back in as the next inputs */
+    std::memcpy(seed, signature, 32);
+    std::memcpy(message, signature + 32, 32);
+}
+}
+
+
+/* Add the point of order 2, (0, -1), to an encoded point (x, y), giving
+ * (-x, -y). */
+static void add_order_two_point(std::uint8_t * point) {
+    /* -y = p - y with p = 2^255 - 19, ignoring the sign bit of x */
+    std::uint8_t sign = point[31] & 0x80;
+    int borrow = 0;
+    for (std::size_t i = 0; i < 32; ++i) {
+        int p_byte = i == 0 ? 0xed : i == 31 ? 0x7f : 0xff;
+        int y_byte = i == 31 ? point[i] & 0x7f : point[i];
+        int difference = p_byte - y_byte - borrow;
+        borrow = difference < 0;
+        point[i] = std::uint8_t(difference + (borrow ? 256 : 0));
+    }
+    point[31] |= sign ^ 0x80;
+}
+
+
+TEST_CASE("Ed25519 batch verification with small-order errors") {
+
+/* A signer who puts a point of order 2 into their public key, A' = A + T,
+ * makes signatures with S * B - h * A' = R - h * T. These pass single
+ * verification when h is even and fail it when h is odd. A cofactored batch
+ * equation would accept them all, and a cofactorless one lets two odd errors
+ * cancel, so the batch must give the same answers as single verification
+ * however they are grouped. */
+std::uint8_t seed[32];
+for (std::size_t j = 0; j < sizeof(seed); ++j) seed[j] = 7 * j + 3;
+_olm_ed25519_key_pair key_pair;
+_olm_crypto_ed25519_generate_key(seed, &key_pair);
+add_order_two_point(key_pair.public_key.public_key);
+
+static const std::size_t COUNT = 4;
+std::uint8_t messages[COUNT][8];
+std::uint8_t signatures[COUNT][64];
+_olm_ed25519_verify_item items[COUNT];
+
+/* two signatures with odd h, which single verification rejects, and one
+ * with even h, which it accepts */
+std::uint8_t next = 0;
+for (std::size_t i = 0; i < 3; ++i) {
+    int want_valid = i == 2;
+    do {
+        std::memset(messages[i], next++, sizeof(messages[i]));
+        _olm_crypto_ed25519_sign(
+            &key_pair, messages[i], sizeof(messages[i]), signatures[i]
+        );
+    } while (want_valid != _olm_crypto_ed25519_verify(
+        &key_pair.public_key, messages[i], sizeof(messages[i]), signatures[i]
+    ));
+    items[i].key = &key_pair.public_key;
+    items[i].message = messages[i];
+    items[i].message_length = sizeof(messages[i]);
+    items[i].signature = signatures[i];
+}
+
+/* and a signature that is simply wrong */
+std::memset(messages[3], 0xff, sizeof(messages[3]));
+_olm_crypto_ed25519_sign(
+    &key_pair, messages[3], sizeof(messages[3]), signatures[3]
+);
+signatures[3][40] ^= 1;
+items[3] = items[0];
+items[3].message = messages[3];
+items[3].signature = signatures[3];
+
+static const std::uint8_t EXPECTED[COUNT] = {0, 0, 1, 0};
+std::uint8_t results[COUNT];
+
+/* checked together */
+CHECK_EQ(std::size_t(0), _olm_crypto_ed25519_verify_batch(items, 2, results));
+CHECK_EQ(0, results[0]);
+CHECK_EQ(0, results[1]);
+
+CHECK_EQ(std::size_t(1), _olm_crypto_ed25519_verify_batch(items, COUNT, results));
+for (std::size_t i = 0; i < COUNT; ++i) {
+    CAPTURE(i);
+    CHECK_EQ(EXPECTED[i], results[i]);
+}
+
+/* checked on their own */
+for (std::size_t i = 0; i < COUNT; ++i) {
+    CAPTURE(i);
+    CHECK_EQ(std::size_t(EXPECTED[i]), _olm_crypto_ed25519_verify_batch(
+        &items[i], 1, &results[i]
+    ));
+}
+
+}
+
+
+TEST_CASE("Ed25519 batch verification matches single verification") {
+
+static const std::size_t COUNT = 40;
+_olm_ed25519_key_pair key_pairs[COUNT];
+std::uint8_t messages[COUNT][20];
+std::uint8_t signatures[COUNT][64];
+_olm_ed25519_verify_item items[COUNT];
+
+for (std::size_t i = 0; i < COUNT; ++i) {
+    std::uint8_t seed[32];
+    for (std::size_t j = 0; j < sizeof(seed); ++j) seed[j] = i * 31 + j;
+    /* a few signers sign more than one message */
+    _olm_crypto_ed25519_generate_key(seed, &key_pairs[i]);
+    for (std::size_t j = 0; j < sizeof(messages[i]); ++j) messages[i][j] = i + j;
+    _olm_crypto_ed25519_sign(
+        &key_pairs[i % 30], messages[i], sizeof(messages[i]), signatures[i]
+    );
+    items[i].key = &key_pairs[i % 30].public_key;
+    items[i].message = messages[i];
+    items[i].message_length = sizeof(messages[i]);
+    items[i].signature = signatures[i];
+}
+
+std::uint8_t results[COUNT];
+
+SUBCASE("all valid") {
+    for (std::size_t count : {0, 1, 2, 16, 17, 40}) {
+        CAPTURE(count);
+        std::memset(results, 0xff, sizeof(results));
+        CHECK_EQ(count, _olm_crypto_ed25519_verify_batch(items, count, results));
+        for (std::size_t i = 0; i < count; ++i) {
+            CHECK_EQ(1, results[i]);
+        }
+    }
+}
+
+SUBCASE("some invalid") {
+    /* a different message */
+    messages[3][0] ^= 1;
+    /* a bad R, and a bad S */
+    signatures[10][5] ^= 0x40;
+    signatures[20][40] ^= 0x02;
+    /* S out of range */
+    signatures[25][63] |= 0x80;
+    /* the wrong key */
+    items[33].key = &key_pairs[0].public_key;
+
+    std::size_t expected_valid = 0;
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        expected_valid += _olm_crypto_ed25519_verify(
+            items[i].key, items[i].message, items[i].message_length,
+            items[i].signature
+        ) ? 1 : 0;
+    }
+    CHECK_EQ(COUNT - 5, expected_valid);
+
+    CHECK_EQ(
+        expected_valid, _olm_crypto_ed25519_verify_batch(items, COUNT, results)
+    );
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        CAPTURE(i);
+        bool bad = i == 3 || i == 10 || i == 20 || i == 25 || i == 33;
+        CHECK_EQ(bad ? 0 : 1, results[i]);
+    }
+}
+
+}
+
 /* AES Test Case 1 */
 
 TEST_CASE("AES Test Case 1") {
@@ -126,6 +447,9 @@ std::uint8_t expected[32] = {
 std::size_t length = _olm_crypto_aes_encrypt_cbc_length(sizeof(input));
 CHECK_EQ(std::size_t(32), length);
 
+for (int use_hw = 0; use_hw <= _olm_crypto_aes_hw_available(); ++use_hw) {
+CAPTURE(use_hw);
+int previous = _olm_crypto_aes_hw_enable(use_hw);
 
 std::uint8_t actual[32] = {};
 
@@ -136,9 +460,126 @@ length = _olm_crypto_aes_decrypt_cbc(&key, &iv, expected, sizeof(expected), actu
 CHECK_EQ(std::size_t(16), length);
 CHECK_EQ_SIZE(input, actual, length);
 
+_olm_crypto_aes_hw_enable(previous);
+}
+
 } /* AES Test Case 1 */
 
 
+/* AES Test Case 2: NIST SP 800-38A F.2.5, CBC-AES256 */
+
+TEST_CASE("AES Test Case 2") {
+
+_olm_aes256_key key = {{
+    0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe,
+    0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+    0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7,
+    0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4
+}};
+
+_olm_aes256_iv iv = {{
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+}};
+
+std::uint8_t input[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+    0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+    0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+    0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+    0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+
+std::uint8_t expected[64] = {
+    0xf5, 0x8c, 0x4c, 0x04, 0xd6, 0xe5, 0xf1, 0xba,
+    0x77, 0x9e, 0xab, 0xfb, 0x5f, 0x7b, 0xfb, 0xd6,
+    0x9c, 0xfc, 0x4e, 0x96, 0x7e, 0xdb, 0x80, 0x8d,
+    0x67, 0x9f, 0x77, 0x7b, 0xc6, 0x70, 0x2c, 0x7d,
+    0x39, 0xf2, 0x33, 0x69, 0xa9, 0xd9, 0xba, 0xcf,
+    0xa5, 0x30, 0xe2, 0x63, 0x04, 0x23, 0x14, 0x61,
+    0xb2, 0xeb, 0x05, 0xe2, 0xc3, 0x9b, 0xe9, 0xfc,
+    0xda, 0x6c, 0x19, 0x07, 0x8c, 0x6a, 0x9d, 0x1b
+};
+
+for (int use_hw = 0; use_hw <= _olm_crypto_aes_hw_available(); ++use_hw) {
+CAPTURE(use_hw);
+int previous = _olm_crypto_aes_hw_enable(use_hw);
+
+/* the output has an extra block of padding after the NIST ciphertext */
+std::uint8_t actual[80] = {};
+
+_olm_crypto_aes_encrypt_cbc(&key, &iv, input, sizeof(input), actual);
+CHECK_EQ_SIZE(expected, actual, 64);
+
+std::uint8_t decrypted[80] = {};
+std::size_t length = _olm_crypto_aes_decrypt_cbc(
+    &key, &iv, actual, sizeof(actual), decrypted
+);
+CHECK_EQ(std::size_t(64), length);
+CHECK_EQ_SIZE(input, decrypted, 64);
+
+_olm_crypto_aes_hw_enable(previous);
+}
+
+} /* AES Test Case 2 */
+
+
+TEST_CASE("AES hardware and software implementations agree") {
+
+if (!_olm_crypto_aes_hw_available()) {
+    MESSAGE("no hardware AES on this machine");
+    return;
+}
+
+_olm_aes256_key key;
+_olm_aes256_iv iv;
+/* long enough to go round the 8-block decryption loop more than once */
+std::uint8_t input[300];
+for (std::size_t i = 0; i < sizeof(key.key); ++i) key.key[i] = i * 7 + 1;
+for (std::size_t i = 0; i < sizeof(iv.iv); ++i) iv.iv[i] = i * 13 + 5;
+for (std::size_t i = 0; i < sizeof(input); ++i) input[i] = i * 31 + 3;
+
+int previous = _olm_crypto_aes_hw_enable(1);
+
+for (std::size_t input_length = 0; input_length <= sizeof(input); ++input_length) {
+    CAPTURE(input_length);
+    std::size_t length = _olm_crypto_aes_encrypt_cbc_length(input_length);
+    std::uint8_t software[320], hardware[320];
+    std::uint8_t software_plain[320], hardware_plain[320];
+
+    _olm_crypto_aes_hw_enable(0);
+    _olm_crypto_aes_encrypt_cbc(&key, &iv, input, input_length, software);
+    std::size_t software_length = _olm_crypto_aes_decrypt_cbc(
+        &key, &iv, software, length, software_plain
+    );
+
+    _olm_crypto_aes_hw_enable(1);
+    _olm_crypto_aes_encrypt_cbc(&key, &iv, input, input_length, hardware);
+    std::size_t hardware_length = _olm_crypto_aes_decrypt_cbc(
+        &key, &iv, software, length, hardware_plain
+    );
+
+    CHECK_EQ_SIZE(software, hardware, length);
+    CHECK_EQ(input_length, software_length);
+    CHECK_EQ(input_length, hardware_length);
+    CHECK_EQ_SIZE(input, hardware_plain, input_length);
+
+    /* decrypting in place, as the pickle code does */
+    hardware_length = _olm_crypto_aes_decrypt_cbc(
+        &key, &iv, hardware, length, hardware
+    );
+    CHECK_EQ(input_length, hardware_length);
+    CHECK_EQ_SIZE(input, hardware, input_length);
+}
+
+_olm_crypto_aes_hw_enable(previous);
+
+}
+
+
 /* SHA 256 Test Case 1 */
 
 TEST_CASE("SHA 256 Test Case 1") {
@@ -155,14 +596,86 @@ std::uint8_t expected[32] = {
     0xA4, 0x95, 0x99, 0x1B, 0x78, 0x52, 0xB8, 0x55
 };
 
+for (int use_hw = 0; use_hw <= _olm_crypto_sha256_hw_available(); ++use_hw) {
+CAPTURE(use_hw);
+int previous = _olm_crypto_sha256_hw_enable(use_hw);
+
 std::uint8_t actual[32];
 
 _olm_crypto_sha256(input, 0, actual);
 
 CHECK_EQ_SIZE(expected, actual, 32);
 
+_olm_crypto_sha256_hw_enable(previous);
+}
+
 } /* SHA 256 Test Case 1 */
 
+/* SHA 256 Test Case 2: FIPS 180-2 two block message */
+
+TEST_CASE("SHA 256 Test Case 2") {
+
+std::uint8_t input[] =
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+std::uint8_t expected[32] = {
+    0x24, 0x8D, 0x6A, 0x61, 0xD2, 0x06, 0x38, 0xB8,
+    0xE5, 0xC0, 0x26, 0x93, 0x0C, 0x3E, 0x60, 0x39,
+    0xA3, 0x3C, 0xE4, 0x59, 0x64, 0xFF, 0x21, 0x67,
+    0xF6, 0xEC, 0xED, 0xD4, 0x19, 0xDB, 0x06, 0xC1
+};
+
+for (int use_hw = 0; use_hw <= _olm_crypto_sha256_hw_available(); ++use_hw) {
+CAPTURE(use_hw);
+int previous = _olm_crypto_sha256_hw_enable(use_hw);
+
+std::uint8_t actual[32];
+
+_olm_crypto_sha256(input, sizeof(input) - 1, actual);
+
+CHECK_EQ_SIZE(expected, actual, 32);
+
+_olm_crypto_sha256_hw_enable(previous);
+}
+
+} /* SHA 256 Test Case 2 */
+
+
+TEST_CASE("SHA 256 hardware and software implementations agree") {
+
+if (!_olm_crypto_sha256_hw_available()) {
+    MESSAGE("no hardware SHA-256 on this machine");
+    return;
+}
+
+std::uint8_t input[300];
+for (std::size_t i = 0; i < sizeof(input); ++i) input[i] = i * 29 + 11;
+
+int previous = _olm_crypto_sha256_hw_enable(1);
+
+for (std::size_t length = 0; length <= sizeof(input); ++length) {
+    CAPTURE(length);
+    std::uint8_t software[32], hardware[32];
+
+    _olm_crypto_sha256_hw_enable(0);
+    _olm_crypto_sha256(input, length, software);
+    _olm_crypto_sha256_hw_enable(1);
+    _olm_crypto_sha256(input, length, hardware);
+    CHECK_EQ_SIZE(software, hardware, 32);
+
+    /* keys longer than a block get hashed, shorter ones get padded */
+    std::size_t key_length = length % 100;
+    _olm_crypto_sha256_hw_enable(0);
+    _olm_crypto_hmac_sha256(input, key_length, input, length, software);
+    _olm_crypto_sha256_hw_enable(1);
+    _olm_crypto_hmac_sha256(input, key_length, input, length, hardware);
+    CHECK_EQ_SIZE(software, hardware, 32);
+}
+
+_olm_crypto_sha256_hw_enable(previous);
+
+}
+
 /* HMAC Test Case 1 */
 
 TEST_CASE("HMAC Test Case 1") {
@@ -179,14 +692,144 @@ std::uint8_t expected[32] = {
     0xc6, 0xc7, 0x12, 0x14, 0x42, 0x92, 0xc5, 0xad
 };
 
+for (int use_hw = 0; use_hw <= _olm_crypto_sha256_hw_available(); ++use_hw) {
+CAPTURE(use_hw);
+int previous = _olm_crypto_sha256_hw_enable(use_hw);
+
 std::uint8_t actual[32];
 
 _olm_crypto_hmac_sha256(input, 0, input, 0, actual);
 
 CHECK_EQ_SIZE(expected, actual, 32);
 
+_olm_crypto_sha256_hw_enable(previous);
+}
+
 } /* HMAC Test Case 1 */
 
+TEST_CASE("HMAC context gives the same MACs as one-shot HMAC") {
+
+std::uint8_t key[100];
+std::uint8_t input[100];
+for (std::size_t i = 0; i < sizeof(key); ++i) key[i] = i * 3 + 7;
+for (std::size_t i = 0; i < sizeof(input); ++i) input[i] = i * 5 + 1;
+
+/* keys shorter than, the same length as and longer than a block */
+static const std::size_t KEY_LENGTHS[] = {0, 32, 64, 65, 100};
+
+for (std::size_t key_length : KEY_LENGTHS) {
+    CAPTURE(key_length);
+    _olm_hmac_sha256_ctx hmac;
+    _olm_crypto_hmac_sha256_init(&hmac, key, key_length);
+
+    /* the context can be used for any number of messages */
+    for (std::size_t input_length = 0; input_length <= sizeof(input); input_length += 9) {
+        CAPTURE(input_length);
+        std::uint8_t expected[32], actual[32];
+        _olm_crypto_hmac_sha256(key, key_length, input, input_length, expected);
+        _olm_crypto_hmac_sha256_compute(&hmac, input, input_length, actual);
+        CHECK_EQ_SIZE(expected, actual, 32);
+    }
+}
+
+}
+
+TEST_CASE("HMAC lanes give the same MACs as one lane at a time") {
+
+std::uint8_t key[3][40];
+std::uint8_t input[20][80];
+for (std::size_t i = 0; i < sizeof(key); ++i) key[i / 40][i % 40] = i * 3 + 7;
+for (std::size_t i = 0; i < sizeof(input); ++i) input[i / 80][i % 80] = i * 5 + 1;
+
+_olm_hmac_sha256_ctx hmac[3];
+for (std::size_t i = 0; i < 3; ++i) {
+    _olm_crypto_hmac_sha256_init(&hmac[i], key[i], 8 + 16 * i);
+}
+
+/* the multi-buffer code is only used when the SHA instructions aren't */
+int previous_hw = _olm_crypto_sha256_hw_enable(0);
+int previous_mb = _olm_crypto_sha256_mb_enable(1);
+
+for (int use_mb = 0; use_mb <= _olm_crypto_sha256_mb_available(); ++use_mb) {
+    CAPTURE(use_mb);
+    _olm_crypto_sha256_mb_enable(use_mb);
+
+    /* enough lanes for a partial group after a full one, with some inputs
+     * too long to fit in one block mixed in */
+    for (std::size_t count = 0; count <= 20; ++count) {
+        CAPTURE(count);
+        _olm_hmac_sha256_lane lanes[20];
+        std::uint8_t expected[20][32], actual[20][32];
+        for (std::size_t i = 0; i < count; ++i) {
+            lanes[i].key = &hmac[i % 3];
+            lanes[i].input = input[i];
+            lanes[i].input_length = (i * 13) % 80;
+            lanes[i].output = actual[i];
+            _olm_crypto_hmac_sha256_compute(
+                lanes[i].key, lanes[i].input, lanes[i].input_length,
+                expected[i]
+            );
+        }
+        _olm_crypto_hmac_sha256_lanes(lanes, count);
+        for (std::size_t i = 0; i < count; ++i) {
+            CAPTURE(i);
+            CHECK_EQ_SIZE(expected[i], actual[i], 32);
+        }
+    }
+}
+
+_olm_crypto_sha256_mb_enable(previous_mb);
+_olm_crypto_sha256_hw_enable(previous_hw);
+
+}
+
+TEST_CASE("HKDF lanes give the same keys as one HKDF at a time") {
+
+std::uint8_t input[20][32];
+std::uint8_t info[40];
+for (std::size_t i = 0; i < sizeof(input); ++i) input[i / 32][i % 32] = i * 7 + 3;
+for (std::size_t i = 0; i < sizeof(info); ++i) info[i] = i + 0x40;
+
+int previous_hw = _olm_crypto_sha256_hw_enable(0);
+int previous_mb = _olm_crypto_sha256_mb_enable(1);
+
+for (int use_mb = 0; use_mb <= _olm_crypto_sha256_mb_available(); ++use_mb) {
+    CAPTURE(use_mb);
+    _olm_crypto_sha256_mb_enable(use_mb);
+
+    /* a short info is expanded in lanes, a long one falls back */
+    for (std::size_t info_length : {std::size_t(11), sizeof(info)}) {
+        CAPTURE(info_length);
+        for (std::size_t count = 0; count <= 20; ++count) {
+            CAPTURE(count);
+            std::uint8_t expected[20][80], actual[20][80];
+            std::uint8_t const * inputs[20];
+            std::uint8_t * outputs[20];
+            for (std::size_t i = 0; i < count; ++i) {
+                inputs[i] = input[i];
+                outputs[i] = actual[i];
+                _olm_crypto_hkdf_sha256(
+                    input[i], sizeof(input[i]), nullptr, 0,
+                    info, info_length, expected[i], sizeof(expected[i])
+                );
+            }
+            _olm_crypto_hkdf_sha256_lanes(
+                inputs, sizeof(input[0]), info, info_length,
+                outputs, sizeof(actual[0]), count
+            );
+            for (std::size_t i = 0; i < count; ++i) {
+                CAPTURE(i);
+                CHECK_EQ_SIZE(expected[i], actual[i], 80);
+            }
+        }
+    }
+}
+
+_olm_crypto_sha256_mb_enable(previous_mb);
+_olm_crypto_sha256_hw_enable(previous_hw);
+
+}
+
 /* HDKF Test Case 1 */
 
 TEST_CASE("HDKF Test Case 1") {
@@ -214,6 +857,10 @@ std::uint8_t hmac_expected_output[32] = {
     0x22, 0xec, 0x84, 0x4a, 0xd7, 0xc2, 0xb3, 0xe5,
 };
 
+for (int use_hw = 0; use_hw <= _olm_crypto_sha256_hw_available(); ++use_hw) {
+CAPTURE(use_hw);
+int previous = _olm_crypto_sha256_hw_enable(use_hw);
+
 std::uint8_t hmac_actual_output[32] = {};
 
 _olm_crypto_hmac_sha256(
@@ -244,5 +891,8 @@ _olm_crypto_hkdf_sha256(
 
 CHECK_EQ_SIZE(hkdf_expected_output, hkdf_actual_output, 42);
 
+_olm_crypto_sha256_hw_enable(previous);
+}
+
 } /* HDKF Test Case 1 */
 
@@ -12,11 +12,17 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include "olm/base64.h"
+#include "olm/crypto.h"
+#include "olm/group_session_store.h"
 #include "olm/inbound_group_session.h"
+#include "olm/message.h"
 #include "olm/outbound_group_session.h"
+#include "olm/pickle_encoding.h"
 #include "testing.hh"
 #include "utils.hh"
 
+#include <algorithm>
 #include <vector>
 
 TEST_CASE("Pickle outbound group session") {
@@ -128,6 +134,258 @@ TEST_CASE("Pickle inbound group session") {
                   olm_inbound_group_session_last_error_code(session));
 }
 
+TEST_CASE("Pickle group sessions with a pickle key") {
+
+    uint8_t random_bytes[] =
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF";
+
+    std::vector<uint8_t> pickle_key_memory(olm_pickle_key_size());
+    OlmPickleKey *pickle_key = olm_pickle_key(
+        pickle_key_memory.data(), "secret_key", 10
+    );
+
+    std::vector<uint8_t> outbound_memory(olm_outbound_group_session_size());
+    OlmOutboundGroupSession *outbound = olm_outbound_group_session(
+        outbound_memory.data()
+    );
+    olm_init_outbound_group_session(
+        outbound, random_bytes, sizeof(random_bytes)
+    );
+
+    size_t session_key_len = olm_outbound_group_session_key_length(outbound);
+    std::vector<uint8_t> session_key(session_key_len);
+    olm_outbound_group_session_key(outbound, session_key.data(), session_key_len);
+
+    std::vector<uint8_t> inbound_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *inbound = olm_inbound_group_session(
+        inbound_memory.data()
+    );
+    olm_init_inbound_group_session(inbound, session_key.data(), session_key_len);
+
+    /* the pickles are the same as the ones made with the key itself */
+    size_t pickle_length = olm_pickle_outbound_group_session_length(outbound);
+    std::vector<uint8_t> pickle1(pickle_length), pickle2(pickle_length);
+    CHECK_EQ(pickle_length, olm_pickle_outbound_group_session(
+        outbound, "secret_key", 10, pickle1.data(), pickle_length
+    ));
+    CHECK_EQ(pickle_length, olm_pickle_outbound_group_session_with_key(
+        outbound, pickle_key, pickle2.data(), pickle_length
+    ));
+    CHECK_EQ_SIZE(pickle1.data(), pickle2.data(), pickle_length);
+
+    std::vector<uint8_t> outbound_memory2(olm_outbound_group_session_size());
+    OlmOutboundGroupSession *outbound2 = olm_outbound_group_session(
+        outbound_memory2.data()
+    );
+    CHECK_NE((size_t)-1, olm_unpickle_outbound_group_session_with_key(
+        outbound2, pickle_key, pickle1.data(), pickle_length
+    ));
+    CHECK_EQ(pickle_length, olm_pickle_outbound_group_session(
+        outbound2, "secret_key", 10, pickle1.data(), pickle_length
+    ));
+    CHECK_EQ_SIZE(pickle2.data(), pickle1.data(), pickle_length);
+
+    pickle_length = olm_pickle_inbound_group_session_length(inbound);
+    pickle1.resize(pickle_length);
+    pickle2.resize(pickle_length);
+    CHECK_EQ(pickle_length, olm_pickle_inbound_group_session(
+        inbound, "secret_key", 10, pickle1.data(), pickle_length
+    ));
+    CHECK_EQ(pickle_length, olm_pickle_inbound_group_session_with_key(
+        inbound, pickle_key, pickle2.data(), pickle_length
+    ));
+    CHECK_EQ_SIZE(pickle1.data(), pickle2.data(), pickle_length);
+
+    std::vector<uint8_t> inbound_memory2(olm_inbound_group_session_size());
+    OlmInboundGroupSession *inbound2 = olm_inbound_group_session(
+        inbound_memory2.data()
+    );
+    CHECK_NE((size_t)-1, olm_unpickle_inbound_group_session_with_key(
+        inbound2, pickle_key, pickle1.data(), pickle_length
+    ));
+    CHECK_EQ(pickle_length, olm_pickle_inbound_group_session(
+        inbound2, "secret_key", 10, pickle1.data(), pickle_length
+    ));
+    CHECK_EQ_SIZE(pickle2.data(), pickle1.data(), pickle_length);
+
+    /* a pickle key from a different key is rejected */
+    std::vector<uint8_t> other_key_memory(olm_pickle_key_size());
+    OlmPickleKey *other_key = olm_pickle_key(
+        other_key_memory.data(), "secret_kez", 10
+    );
+    CHECK_EQ((size_t)-1, olm_unpickle_inbound_group_session_with_key(
+        inbound2, other_key, pickle2.data(), pickle_length
+    ));
+    CHECK_EQ(OLM_BAD_ACCOUNT_KEY,
+                  olm_inbound_group_session_last_error_code(inbound2));
+
+    olm_clear_pickle_key(other_key);
+    olm_clear_pickle_key(pickle_key);
+}
+
+TEST_CASE("Unpickle inbound group session from version 2") {
+
+    /* version, initial ratchet and counter, latest ratchet and counter,
+     * signing key, verified flag */
+    std::vector<uint8_t> raw;
+    raw.insert(raw.end(), {0, 0, 0, 2});
+    for (int i = 0; i < 128; i++) raw.push_back(i);
+    raw.insert(raw.end(), {0, 0, 1, 0});
+    for (int i = 0; i < 128; i++) raw.push_back(i < 96 ? i : 255 - i);
+    raw.insert(raw.end(), {0, 0, 1, 5});
+    for (int i = 0; i < 32; i++) raw.push_back(0x40 + i);
+    raw.push_back(1);
+
+    std::vector<uint8_t> pickle(_olm_enc_output_length(raw.size()));
+    std::copy(
+        raw.begin(), raw.end(),
+        _olm_enc_output_pos(pickle.data(), raw.size())
+    );
+    size_t pickle_length = _olm_enc_output(
+        (uint8_t const *)"secret_key", 10, pickle.data(), raw.size()
+    );
+
+    std::vector<uint8_t> memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *session = olm_inbound_group_session(memory.data());
+    CHECK_EQ(pickle_length, olm_unpickle_inbound_group_session(
+        session, "secret_key", 10, pickle.data(), pickle_length
+    ));
+    CHECK_EQ(0x100U, olm_inbound_group_session_first_known_index(session));
+    CHECK_EQ(1, olm_inbound_group_session_is_verified(session));
+
+    /* exporting at the two counters gives back the two ratchets */
+    std::vector<uint8_t> expected;
+    for (uint32_t index : {0x100U, 0x105U}) {
+        CAPTURE(index);
+        size_t export_length = olm_export_inbound_group_session_length(session);
+        std::vector<uint8_t> exported(export_length);
+        CHECK_EQ(export_length, olm_export_inbound_group_session(
+            session, exported.data(), export_length, index
+        ));
+        exported.resize(_olm_decode_base64(
+            exported.data(), export_length, exported.data()
+        ));
+        expected.assign({1, 0, 0, 1, uint8_t(index)});
+        expected.insert(
+            expected.end(),
+            raw.begin() + (index == 0x100 ? 4 : 136),
+            raw.begin() + (index == 0x100 ? 132 : 264)
+        );
+        expected.insert(expected.end(), raw.begin() + 268, raw.begin() + 300);
+        CHECK_EQ_SIZE(expected.data(), exported.data(), expected.size());
+    }
+
+    /* the session is pickled again in the compact format, which only keeps
+     * the last part of the latest ratchet */
+    size_t compact_length = olm_pickle_inbound_group_session_length(session);
+    CHECK_EQ(
+        _olm_enc_output_length(raw.size() - 128 + 1 + 4 + 32 + 4),
+        compact_length
+    );
+    std::vector<uint8_t> compact(compact_length);
+    CHECK_EQ(compact_length, olm_pickle_inbound_group_session(
+        session, "secret_key", 10, compact.data(), compact_length
+    ));
+
+    std::vector<uint8_t> memory2(olm_inbound_group_session_size());
+    OlmInboundGroupSession *session2 = olm_inbound_group_session(memory2.data());
+    CHECK_EQ(compact_length, olm_unpickle_inbound_group_session(
+        session2, "secret_key", 10, compact.data(), compact_length
+    ));
+    for (uint32_t index : {0x100U, 0x105U, 0x1000U}) {
+        CAPTURE(index);
+        size_t export_length = olm_export_inbound_group_session_length(session);
+        std::vector<uint8_t> exported1(export_length), exported2(export_length);
+        olm_export_inbound_group_session(
+            session, exported1.data(), export_length, index
+        );
+        olm_export_inbound_group_session(
+            session2, exported2.data(), export_length, index
+        );
+        CHECK_EQ_SIZE(exported1.data(), exported2.data(), export_length);
+    }
+}
+
+TEST_CASE("Pickle inbound group session as binary") {
+
+    uint8_t session_key[] =
+        "AgAAAAAwMTIzNDU2Nzg5QUJERUYwMTIzNDU2Nzg5QUJDREVGMDEyMzQ1Njc4OUFCREVGM"
+        "DEyMzQ1Njc4OUFCQ0RFRjAxMjM0NTY3ODlBQkRFRjAxMjM0NTY3ODlBQkNERUYwMTIzND"
+        "U2Nzg5QUJERUYwMTIzNDU2Nzg5QUJDREVGMDEyMw0bdg1BDq4Px/slBow06q8n/B9WBfw"
+        "WYyNOB8DlUmXGGwrFmaSb9bR/eY8xgERrxmP07hFmD9uqA2p8PMHdnV5ysmgufE6oLZ5+"
+        "8/mWQOW3VVTnDIlnwd8oHUYRuk8TCQ";
+
+    std::vector<uint8_t> memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *session = olm_inbound_group_session(memory.data());
+    std::vector<uint8_t> key_copy(session_key, session_key + sizeof(session_key) - 1);
+    CHECK_EQ((size_t)0, olm_init_inbound_group_session(
+        session, key_copy.data(), key_copy.size()
+    ));
+
+    /* a fresh session doesn't store the latest ratchet at all; moving it on
+     * stores the parts that changed */
+    size_t fresh_length = olm_pickle_inbound_group_session_length(session);
+    size_t export_length = olm_export_inbound_group_session_length(session);
+    std::vector<uint8_t> exported(export_length);
+    olm_export_inbound_group_session(session, exported.data(), export_length, 0x10203);
+    CHECK_LT(fresh_length, olm_pickle_inbound_group_session_length(session));
+
+    std::vector<uint8_t> pickle_key_memory(olm_pickle_key_size());
+    OlmPickleKey *pickle_key = olm_pickle_key(
+        pickle_key_memory.data(), "secret_key", 10
+    );
+
+    size_t length = olm_pickle_inbound_group_session_length(session);
+    size_t binary_length = olm_pickle_inbound_group_session_binary_length(session);
+    CHECK_LT(binary_length, length);
+    std::vector<uint8_t> binary(binary_length);
+    CHECK_EQ(binary_length, olm_pickle_inbound_group_session_binary(
+        session, pickle_key, binary.data(), binary_length
+    ));
+    CHECK_EQ((size_t)-1, olm_pickle_inbound_group_session_binary(
+        session, pickle_key, binary.data(), binary_length - 1
+    ));
+    CHECK_EQ(OLM_OUTPUT_BUFFER_TOO_SMALL,
+             olm_inbound_group_session_last_error_code(session));
+
+    /* the binary pickle holds the same session as the base64 one */
+    std::vector<uint8_t> memory2(olm_inbound_group_session_size());
+    OlmInboundGroupSession *session2 = olm_inbound_group_session(memory2.data());
+    std::vector<uint8_t> binary_copy(binary);
+    CHECK_EQ(binary_length, olm_unpickle_inbound_group_session_binary(
+        session2, pickle_key, binary_copy.data(), binary_length
+    ));
+    std::vector<uint8_t> pickle1(length), pickle2(length);
+    olm_pickle_inbound_group_session(
+        session, "secret_key", 10, pickle1.data(), length
+    );
+    CHECK_EQ(length, olm_pickle_inbound_group_session(
+        session2, "secret_key", 10, pickle2.data(), length
+    ));
+    CHECK_EQ_SIZE(pickle1.data(), pickle2.data(), length);
+
+    /* tampering is caught by the MAC */
+    binary_copy = binary;
+    binary_copy[10] ^= 1;
+    CHECK_EQ((size_t)-1, olm_unpickle_inbound_group_session_binary(
+        session2, pickle_key, binary_copy.data(), binary_length
+    ));
+    CHECK_EQ(OLM_BAD_ACCOUNT_KEY,
+             olm_inbound_group_session_last_error_code(session2));
+    CHECK_EQ((size_t)-1, olm_unpickle_inbound_group_session_binary(
+        session2, pickle_key, binary_copy.data(), 3
+    ));
+    CHECK_EQ(OLM_CORRUPTED_PICKLE,
+             olm_inbound_group_session_last_error_code(session2));
+
+    olm_clear_pickle_key(pickle_key);
+}
+
 TEST_CASE("Group message send/receive") {
 
     uint8_t random_bytes[] =
@@ -216,6 +474,200 @@ TEST_CASE("Group message send/receive") {
     CHECK_EQ(message_index, uint32_t(0));
 }
 
+TEST_CASE("Group message decryption leaving the input untouched") {
+
+    uint8_t random_bytes[] =
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF";
+
+    std::vector<uint8_t> outbound_memory(olm_outbound_group_session_size());
+    OlmOutboundGroupSession *outbound =
+        olm_outbound_group_session(outbound_memory.data());
+    olm_init_outbound_group_session(outbound, random_bytes, sizeof(random_bytes));
+
+    size_t session_key_len = olm_outbound_group_session_key_length(outbound);
+    std::vector<uint8_t> session_key(session_key_len);
+    olm_outbound_group_session_key(outbound, session_key.data(), session_key_len);
+
+    std::vector<uint8_t> inbound_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *inbound =
+        olm_inbound_group_session(inbound_memory.data());
+    olm_init_inbound_group_session(inbound, session_key.data(), session_key_len);
+
+    /* short and long messages, and some broken ones */
+    std::vector<std::vector<uint8_t>> messages;
+    for (size_t plaintext_length : {0, 1, 15, 16, 17, 100, 1000}) {
+        std::vector<uint8_t> plaintext(plaintext_length, 'x');
+        size_t msglen = olm_group_encrypt_message_length(
+            outbound, plaintext_length
+        );
+        std::vector<uint8_t> message(msglen);
+        olm_group_encrypt(
+            outbound, plaintext.data(), plaintext_length,
+            message.data(), msglen
+        );
+        messages.push_back(message);
+    }
+    messages.push_back(messages[1]);
+    messages.back()[0] = 'B';
+    messages.push_back(std::vector<uint8_t>(
+        messages[6].begin(), messages[6].end() - 200
+    ));
+    messages.push_back(std::vector<uint8_t>(
+        messages[6].begin(), messages[6].begin() + 10
+    ));
+    messages.push_back(std::vector<uint8_t>(
+        messages[6].begin(), messages[6].end() - 1
+    ));
+    messages.push_back(std::vector<uint8_t>());
+
+    for (size_t i = 0; i < messages.size(); i++) {
+        CAPTURE(i);
+        std::vector<uint8_t> & message = messages[i];
+
+        std::vector<uint8_t> copy(message);
+        size_t expected_max = olm_group_decrypt_max_plaintext_length(
+            inbound, copy.data(), copy.size()
+        );
+        OlmErrorCode expected_error =
+            olm_inbound_group_session_last_error_code(inbound);
+
+        std::vector<uint8_t> untouched(message);
+        size_t actual = olm_group_decrypt_max_plaintext_length_const(
+            inbound, untouched.data(), untouched.size()
+        );
+        CHECK_EQ(expected_max, actual);
+        if (actual == (size_t)-1) {
+            CHECK_EQ(
+                expected_error,
+                olm_inbound_group_session_last_error_code(inbound)
+            );
+        }
+        CHECK_EQ_SIZE(message.data(), untouched.data(), message.size());
+
+        /* decrypting the base64-decoded message gives the same results */
+        copy = message;
+        std::vector<uint8_t> expected_plaintext(message.size());
+        uint32_t expected_index = 0xffffffff, actual_index = 0xffffffff;
+        size_t expected = olm_group_decrypt(
+            inbound, copy.data(), copy.size(),
+            expected_plaintext.data(), expected_plaintext.size(),
+            &expected_index
+        );
+        expected_error = olm_inbound_group_session_last_error_code(inbound);
+        if (expected == (size_t)-1 && expected_error == OLM_INVALID_BASE64) {
+            continue;
+        }
+
+        std::vector<uint8_t> raw(message.size());
+        raw.resize(
+            _olm_decode_base64(message.data(), message.size(), raw.data())
+        );
+        untouched = raw;
+        CHECK_EQ(expected_max, olm_group_decrypt_raw_max_plaintext_length(
+            inbound, untouched.data(), untouched.size()
+        ));
+
+        std::vector<uint8_t> actual_plaintext(message.size());
+        actual = olm_group_decrypt_raw(
+            inbound, untouched.data(), untouched.size(),
+            actual_plaintext.data(), actual_plaintext.size(), &actual_index
+        );
+        CHECK_EQ(expected, actual);
+        CHECK_EQ(expected_index, actual_index);
+        if (actual == (size_t)-1) {
+            CHECK_EQ(
+                expected_error,
+                olm_inbound_group_session_last_error_code(inbound)
+            );
+        } else {
+            CHECK_EQ_SIZE(
+                expected_plaintext.data(), actual_plaintext.data(), actual
+            );
+        }
+        CHECK_EQ_SIZE(raw.data(), untouched.data(), raw.size());
+    }
+}
+
+TEST_CASE("Group message peek") {
+
+    /* messages with indexes whose varints take from one to five bytes; the
+     * signature isn't checked, so it doesn't have to be valid */
+    for (uint32_t index : {0U, 127U, 128U, 0x4000U, 0x1fffffU, 0xffffffffU}) {
+        for (uint8_t version : {3, 4}) {
+            CAPTURE(index);
+            CAPTURE(version);
+            size_t raw_length = _olm_encode_group_message_length(
+                index, 32, 8, 64
+            );
+            std::vector<uint8_t> raw(raw_length, 0x55);
+            uint8_t *ciphertext;
+            _olm_encode_group_message(
+                version, index, 32, raw.data(), &ciphertext
+            );
+            std::vector<uint8_t> message(
+                _olm_encode_base64_length(raw_length)
+            );
+            _olm_encode_base64(raw.data(), raw_length, message.data());
+            std::vector<uint8_t> copy(message);
+
+            uint8_t peeked_version = 0;
+            uint32_t peeked_index = 0;
+            CHECK_EQ(OLM_SUCCESS, olm_group_message_peek(
+                message.data(), message.size(),
+                &peeked_version, &peeked_index
+            ));
+            CHECK_EQ(version, peeked_version);
+            CHECK_EQ(index, peeked_index);
+            CHECK_EQ_SIZE(copy.data(), message.data(), message.size());
+
+            /* cut short, the index is there but it is too short to be a
+             * message */
+            CHECK_EQ(OLM_BAD_MESSAGE_FORMAT, olm_group_message_peek(
+                message.data(), 16, &peeked_version, &peeked_index
+            ));
+        }
+    }
+
+    uint8_t version;
+    uint32_t index;
+    uint8_t bad_length[] = "AwgAEhA";
+    CHECK_EQ(OLM_INVALID_BASE64, olm_group_message_peek(
+        bad_length, 5, &version, &index
+    ));
+    CHECK_EQ(OLM_BAD_MESSAGE_FORMAT, olm_group_message_peek(
+        bad_length, 0, &version, &index
+    ));
+
+    /* a real message */
+    uint8_t random_bytes[] =
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF";
+    std::vector<uint8_t> outbound_memory(olm_outbound_group_session_size());
+    OlmOutboundGroupSession *outbound =
+        olm_outbound_group_session(outbound_memory.data());
+    olm_init_outbound_group_session(outbound, random_bytes, sizeof(random_bytes));
+    for (uint32_t i = 0; i < 3; i++) {
+        uint8_t plaintext[] = "Message";
+        size_t msglen = olm_group_encrypt_message_length(outbound, 7);
+        std::vector<uint8_t> message(msglen);
+        olm_group_encrypt(outbound, plaintext, 7, message.data(), msglen);
+        CHECK_EQ(OLM_SUCCESS, olm_group_message_peek(
+            message.data(), msglen, &version, &index
+        ));
+        CHECK_EQ(3, version);
+        CHECK_EQ(i, index);
+    }
+}
+
 TEST_CASE("Inbound group session export/import") {
 
     uint8_t session_key[] =
@@ -294,6 +746,976 @@ TEST_CASE("Inbound group session export/import") {
     CHECK_EQ(1, olm_inbound_group_session_is_verified(session2));
 }
 
+TEST_CASE("Inbound group session bulk export/import") {
+
+    /* five sessions at different indexes, imported from exports made by
+     * hand */
+    const size_t count = 5;
+    std::vector<std::vector<uint8_t>> memories, exports;
+    std::vector<OlmInboundGroupSession *> sessions;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t raw[1 + 4 + 128 + 32] = {1, 0, 0, 0, uint8_t(7 * i)};
+        for (size_t j = 5; j < sizeof(raw); j++) {
+            raw[j] = uint8_t(i * 31 + j);
+        }
+        std::vector<uint8_t> encoded(_olm_encode_base64_length(sizeof(raw)));
+        _olm_encode_base64(raw, sizeof(raw), encoded.data());
+
+        memories.emplace_back(olm_inbound_group_session_size());
+        sessions.push_back(olm_inbound_group_session(memories.back().data()));
+        CHECK_EQ((size_t)0, olm_import_inbound_group_session(
+            sessions.back(), encoded.data(), encoded.size()
+        ));
+        exports.push_back(encoded);
+    }
+
+    /* a stream of two chunks */
+    size_t length1 = olm_export_inbound_group_sessions_chunk_length(3);
+    size_t length2 = olm_export_inbound_group_sessions_chunk_length(2);
+    std::vector<uint8_t> stream(length1 + length2);
+    CHECK_EQ(OLM_OUTPUT_BUFFER_TOO_SMALL, olm_export_inbound_group_sessions_chunk(
+        sessions.data(), 3, stream.data(), length1 - 1
+    ));
+    CHECK_EQ(OLM_SUCCESS, olm_export_inbound_group_sessions_chunk(
+        sessions.data(), 3, stream.data(), length1
+    ));
+    CHECK_EQ(OLM_SUCCESS, olm_export_inbound_group_sessions_chunk(
+        sessions.data() + 3, 2, stream.data() + length1, length2
+    ));
+
+    /* split it up from the chunk headers, and import each chunk */
+    std::vector<std::vector<uint8_t>> new_memories;
+    std::vector<OlmInboundGroupSession *> new_sessions;
+    for (size_t i = 0; i < count; i++) {
+        new_memories.emplace_back(olm_inbound_group_session_size());
+        new_sessions.push_back(
+            olm_inbound_group_session(new_memories.back().data())
+        );
+    }
+    /* importing replaces whatever was in a session before, including
+     * whether its key was verified */
+    uint8_t session_key[] =
+        "AgAAAAAwMTIzNDU2Nzg5QUJERUYwMTIzNDU2Nzg5QUJDREVGMDEyMzQ1Njc4OUFCREVGM"
+        "DEyMzQ1Njc4OUFCQ0RFRjAxMjM0NTY3ODlBQkRFRjAxMjM0NTY3ODlBQkNERUYwMTIzND"
+        "U2Nzg5QUJERUYwMTIzNDU2Nzg5QUJDREVGMDEyMw0bdg1BDq4Px/slBow06q8n/B9WBfw"
+        "WYyNOB8DlUmXGGwrFmaSb9bR/eY8xgERrxmP07hFmD9uqA2p8PMHdnV5ysmgufE6oLZ5+"
+        "8/mWQOW3VVTnDIlnwd8oHUYRuk8TCQ";
+    CHECK_EQ((size_t)0, olm_init_inbound_group_session(
+        new_sessions[1], session_key, sizeof(session_key) - 1
+    ));
+    CHECK_EQ(1, olm_inbound_group_session_is_verified(new_sessions[1]));
+
+    std::vector<uint8_t> copy(stream);
+    size_t header_length = olm_inbound_group_sessions_chunk_header_length();
+    size_t pos = 0, imported = 0;
+    while (pos < stream.size()) {
+        size_t session_count, chunk_length;
+        CHECK_EQ(OLM_SUCCESS, olm_inbound_group_sessions_chunk_info(
+            stream.data() + pos, header_length, &session_count, &chunk_length
+        ));
+        CHECK_EQ(olm_export_inbound_group_sessions_chunk_length(session_count),
+                 chunk_length);
+        CHECK_EQ(OLM_SUCCESS, olm_import_inbound_group_sessions_chunk(
+            stream.data() + pos, chunk_length,
+            new_sessions.data() + imported, session_count
+        ));
+        pos += chunk_length;
+        imported += session_count;
+    }
+    CHECK_EQ(count, imported);
+    CHECK_EQ_SIZE(copy.data(), stream.data(), stream.size());
+
+    for (size_t i = 0; i < count; i++) {
+        CAPTURE(i);
+        CHECK_EQ(0, olm_inbound_group_session_is_verified(new_sessions[i]));
+        CHECK_EQ(uint32_t(7 * i),
+                 olm_inbound_group_session_first_known_index(new_sessions[i]));
+        std::vector<uint8_t> exported(exports[i].size());
+        olm_export_inbound_group_session(
+            new_sessions[i], exported.data(), exported.size(), 7 * i
+        );
+        CHECK_EQ_SIZE(exports[i].data(), exported.data(), exported.size());
+    }
+
+    size_t session_count, chunk_length;
+    CHECK_EQ(OLM_INPUT_BUFFER_TOO_SMALL, olm_inbound_group_sessions_chunk_info(
+        stream.data(), header_length - 1, &session_count, &chunk_length
+    ));
+    CHECK_EQ(OLM_INPUT_BUFFER_TOO_SMALL, olm_import_inbound_group_sessions_chunk(
+        stream.data(), length1 - 1, new_sessions.data(), 3
+    ));
+    CHECK_EQ(OLM_OUTPUT_BUFFER_TOO_SMALL, olm_import_inbound_group_sessions_chunk(
+        stream.data(), length1, new_sessions.data(), 2
+    ));
+
+    /* a corrupted chunk isn't imported at all */
+    size_t before = olm_pickle_inbound_group_session_length(new_sessions[0]);
+    std::vector<uint8_t> pickle_before(before);
+    olm_pickle_inbound_group_session(
+        new_sessions[0], "", 0, pickle_before.data(), before
+    );
+    stream[length1 - 40] ^= 1;
+    CHECK_EQ(OLM_BAD_CHECKSUM, olm_import_inbound_group_sessions_chunk(
+        stream.data(), length1, new_sessions.data(), 3
+    ));
+    std::vector<uint8_t> pickle_after(before);
+    olm_pickle_inbound_group_session(
+        new_sessions[0], "", 0, pickle_after.data(), before
+    );
+    CHECK_EQ_SIZE(pickle_before.data(), pickle_after.data(), before);
+
+    stream[0] = 2;
+    CHECK_EQ(OLM_BAD_MESSAGE_VERSION, olm_inbound_group_sessions_chunk_info(
+        stream.data(), header_length, &session_count, &chunk_length
+    ));
+    stream[0] = 1;
+    stream[8] ^= 1;
+    CHECK_EQ(OLM_BAD_MESSAGE_FORMAT, olm_inbound_group_sessions_chunk_info(
+        stream.data(), header_length, &session_count, &chunk_length
+    ));
+}
+
+TEST_CASE("Inbound group session checkpoints") {
+
+    uint8_t session_key[] =
+        "AgAAAAAwMTIzNDU2Nzg5QUJERUYwMTIzNDU2Nzg5QUJDREVGMDEyMzQ1Njc4OUFCREVGM"
+        "DEyMzQ1Njc4OUFCQ0RFRjAxMjM0NTY3ODlBQkRFRjAxMjM0NTY3ODlBQkNERUYwMTIzND"
+        "U2Nzg5QUJERUYwMTIzNDU2Nzg5QUJDREVGMDEyMw0bdg1BDq4Px/slBow06q8n/B9WBfw"
+        "WYyNOB8DlUmXGGwrFmaSb9bR/eY8xgERrxmP07hFmD9uqA2p8PMHdnV5ysmgufE6oLZ5+"
+        "8/mWQOW3VVTnDIlnwd8oHUYRuk8TCQ";
+
+    /* one session without checkpoints, and one with a small table */
+    std::size_t size = olm_inbound_group_session_size();
+    std::vector<uint8_t> plain_memory(size), checkpointed_memory(size);
+    OlmInboundGroupSession *plain =
+        olm_inbound_group_session(plain_memory.data());
+    OlmInboundGroupSession *checkpointed =
+        olm_inbound_group_session(checkpointed_memory.data());
+
+    std::vector<uint32_t> table(
+        8 * olm_inbound_group_session_checkpoint_size() / sizeof(uint32_t)
+    );
+    CHECK_EQ((size_t)8, olm_inbound_group_session_set_checkpoints(
+        checkpointed, table.data(), table.size() * sizeof(uint32_t)
+    ));
+
+    std::vector<uint8_t> key_copy(session_key, session_key + sizeof(session_key) - 1);
+    CHECK_EQ((size_t)0, olm_init_inbound_group_session(
+        plain, key_copy.data(), key_copy.size()
+    ));
+    key_copy.assign(session_key, session_key + sizeof(session_key) - 1);
+    CHECK_EQ((size_t)0, olm_init_inbound_group_session(
+        checkpointed, key_copy.data(), key_copy.size()
+    ));
+
+    /* jump ahead, then go back and forth over the boundaries we passed */
+    static const uint32_t indexes[] = {
+        70000, 69999, 65536, 65535, 300, 256, 255, 66000, 1000, 70001,
+        0x1000100, 0x10000ff, 0x1000000, 0xffffff, 69000, 0
+    };
+    size = olm_export_inbound_group_session_length(plain);
+    std::vector<uint8_t> expected(size), actual(size);
+    for (uint32_t index : indexes) {
+        CAPTURE(index);
+        CHECK_EQ(size, olm_export_inbound_group_session(
+            plain, expected.data(), size, index
+        ));
+        CHECK_EQ(size, olm_export_inbound_group_session(
+            checkpointed, actual.data(), size, index
+        ));
+        CHECK_EQ_SIZE(expected.data(), actual.data(), size);
+    }
+
+    /* the checkpoints survive pickling */
+    size_t pickle_length = olm_pickle_inbound_group_session_length(checkpointed);
+    std::vector<uint8_t> pickle1(pickle_length), pickle2(pickle_length);
+    CHECK_EQ(pickle_length, olm_pickle_inbound_group_session(
+        checkpointed, "secret_key", 10, pickle1.data(), pickle_length
+    ));
+    CHECK_NE(pickle_length, olm_pickle_inbound_group_session_length(plain));
+
+    std::vector<uint8_t> unpickled_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *unpickled =
+        olm_inbound_group_session(unpickled_memory.data());
+    std::vector<uint32_t> table2(table.size());
+    olm_inbound_group_session_set_checkpoints(
+        unpickled, table2.data(), table2.size() * sizeof(uint32_t)
+    );
+    pickle2 = pickle1;
+    CHECK_NE((size_t)-1, olm_unpickle_inbound_group_session(
+        unpickled, "secret_key", 10, pickle2.data(), pickle_length
+    ));
+    CHECK_EQ(pickle_length, olm_pickle_inbound_group_session(
+        unpickled, "secret_key", 10, pickle2.data(), pickle_length
+    ));
+    CHECK_EQ_SIZE(pickle1.data(), pickle2.data(), pickle_length);
+
+    /* moving to a smaller table keeps the session working */
+    std::vector<uint32_t> table3(
+        2 * olm_inbound_group_session_checkpoint_size() / sizeof(uint32_t)
+    );
+    CHECK_EQ((size_t)2, olm_inbound_group_session_set_checkpoints(
+        unpickled, table3.data(), table3.size() * sizeof(uint32_t)
+    ));
+    for (uint32_t index : indexes) {
+        CAPTURE(index);
+        olm_export_inbound_group_session(plain, expected.data(), size, index);
+        olm_export_inbound_group_session(unpickled, actual.data(), size, index);
+        CHECK_EQ_SIZE(expected.data(), actual.data(), size);
+    }
+
+    /* and so does moving the table along inside the same buffer, where the
+     * new table overlaps the old one */
+    size_t checkpoint_words =
+        olm_inbound_group_session_checkpoint_size() / sizeof(uint32_t);
+    std::vector<uint32_t> shared(12 * checkpoint_words);
+    CHECK_EQ((size_t)8, olm_inbound_group_session_set_checkpoints(
+        unpickled, shared.data(), 8 * checkpoint_words * sizeof(uint32_t)
+    ));
+    for (uint32_t index : indexes) {
+        olm_export_inbound_group_session(unpickled, actual.data(), size, index);
+    }
+    CHECK_EQ((size_t)8, olm_inbound_group_session_set_checkpoints(
+        unpickled, shared.data() + 4 * checkpoint_words,
+        8 * checkpoint_words * sizeof(uint32_t)
+    ));
+    for (uint32_t index : indexes) {
+        CAPTURE(index);
+        olm_export_inbound_group_session(plain, expected.data(), size, index);
+        olm_export_inbound_group_session(unpickled, actual.data(), size, index);
+        CHECK_EQ_SIZE(expected.data(), actual.data(), size);
+    }
+
+    olm_clear_inbound_group_session(unpickled);
+    olm_clear_inbound_group_session(checkpointed);
+    olm_clear_inbound_group_session(plain);
+}
+
+TEST_CASE("Inbound group session checkpoints need an authenticated message") {
+
+    uint8_t random_bytes[] =
+        "0123456789ABDEF0123456789ABCDEF";
+
+    /* a session whose signing key we hold, so that we can sign messages with
+     * a bad MAC */
+    struct _olm_ed25519_key_pair signing_key;
+    _olm_crypto_ed25519_generate_key(random_bytes, &signing_key);
+
+    uint8_t exported[1 + 4 + 128 + ED25519_PUBLIC_KEY_LENGTH] = {1};
+    memset(exported + 5, 'x', 128);
+    memcpy(
+        exported + 5 + 128, signing_key.public_key.public_key,
+        ED25519_PUBLIC_KEY_LENGTH
+    );
+    std::vector<uint8_t> session_key(_olm_encode_base64_length(sizeof(exported)));
+    _olm_encode_base64(exported, sizeof(exported), session_key.data());
+
+    std::vector<uint8_t> memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *session = olm_inbound_group_session(memory.data());
+    std::vector<uint32_t> table(
+        8 * olm_inbound_group_session_checkpoint_size() / sizeof(uint32_t)
+    );
+    olm_inbound_group_session_set_checkpoints(
+        session, table.data(), table.size() * sizeof(uint32_t)
+    );
+    CHECK_EQ((size_t)0, olm_import_inbound_group_session(
+        session, session_key.data(), session_key.size()
+    ));
+    auto table_is_empty = [&table]() {
+        return std::all_of(
+            table.begin(), table.end(), [](uint32_t word) { return !word; }
+        );
+    };
+
+    /* a correctly signed message far ahead, with a MAC that doesn't match */
+    size_t raw_length = _olm_encode_group_message_length(70000, 16, 8, 64);
+    std::vector<uint8_t> raw(raw_length);
+    uint8_t *ciphertext;
+    _olm_encode_group_message(3, 70000, 16, raw.data(), &ciphertext);
+    memset(ciphertext, 0, 16 + 8);
+    _olm_crypto_ed25519_sign(
+        &signing_key, raw.data(), raw_length - 64, raw.data() + raw_length - 64
+    );
+    std::vector<uint8_t> message(_olm_encode_base64_length(raw_length));
+    _olm_encode_base64(raw.data(), raw_length, message.data());
+
+    std::vector<uint8_t> copy(message), plaintext(64);
+    uint32_t message_index;
+    CHECK_EQ((size_t)-1, olm_group_decrypt(
+        session, copy.data(), copy.size(),
+        plaintext.data(), plaintext.size(), &message_index
+    ));
+    CHECK_EQ(std::string("BAD_MESSAGE_MAC"),
+             std::string(olm_inbound_group_session_last_error(session)));
+    CHECK(table_is_empty());
+
+    copy = message;
+    uint8_t *message_ptr = copy.data(), *plaintext_ptr = plaintext.data();
+    size_t message_length = copy.size(), max_plaintext_length = 64, length;
+    enum OlmErrorCode error;
+    CHECK_EQ((size_t)0, olm_group_decrypt_batch(
+        session, 1, &message_ptr, &message_length,
+        &plaintext_ptr, &max_plaintext_length, &length, NULL, &error
+    ));
+    CHECK_EQ(OLM_BAD_MESSAGE_MAC, error);
+    CHECK(table_is_empty());
+
+    /* the application asking for the index does add them */
+    std::vector<uint8_t> key(olm_export_inbound_group_session_length(session));
+    CHECK_EQ(key.size(), olm_export_inbound_group_session(
+        session, key.data(), key.size(), 140000
+    ));
+    CHECK_FALSE(table_is_empty());
+
+    olm_clear_inbound_group_session(session);
+}
+
+TEST_CASE("Group message batch encryption") {
+
+    uint8_t random_bytes[] =
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF";
+
+    /* two copies of the same session */
+    std::vector<uint8_t> single_memory(olm_outbound_group_session_size());
+    std::vector<uint8_t> batch_memory(olm_outbound_group_session_size());
+    OlmOutboundGroupSession *single =
+        olm_outbound_group_session(single_memory.data());
+    OlmOutboundGroupSession *batch =
+        olm_outbound_group_session(batch_memory.data());
+    std::vector<uint8_t> random(random_bytes, random_bytes + sizeof(random_bytes));
+    olm_init_outbound_group_session(single, random.data(), random.size());
+    random.assign(random_bytes, random_bytes + sizeof(random_bytes));
+    olm_init_outbound_group_session(batch, random.data(), random.size());
+
+    /* enough messages for the index to need another byte */
+    const size_t count = 150;
+    std::vector<std::vector<uint8_t>> plaintexts(count);
+    std::vector<std::vector<uint8_t>> expected(count), messages(count);
+    std::vector<const uint8_t *> plaintext_ptrs(count);
+    std::vector<size_t> plaintext_lengths(count);
+    std::vector<uint8_t *> message_ptrs(count);
+    std::vector<size_t> max_message_lengths(count), message_lengths(count);
+    for (size_t i = 0; i < count; i++) {
+        plaintexts[i].assign(i % 40, 'a' + i % 26);
+        size_t msglen = olm_group_encrypt_message_length(
+            single, plaintexts[i].size()
+        );
+        expected[i].resize(msglen);
+        CHECK_EQ(msglen, olm_group_encrypt(
+            single, plaintexts[i].data(), plaintexts[i].size(),
+            expected[i].data(), msglen
+        ));
+
+        plaintext_ptrs[i] = plaintexts[i].data();
+        plaintext_lengths[i] = plaintexts[i].size();
+        messages[i].resize(msglen);
+        message_ptrs[i] = messages[i].data();
+        max_message_lengths[i] = msglen;
+    }
+
+    /* a buffer that is too small leaves the session alone */
+    max_message_lengths[130]--;
+    CHECK_EQ((size_t)-1, olm_group_encrypt_batch(
+        batch, count,
+        plaintext_ptrs.data(), plaintext_lengths.data(),
+        message_ptrs.data(), max_message_lengths.data(),
+        message_lengths.data()
+    ));
+    CHECK_EQ(OLM_OUTPUT_BUFFER_TOO_SMALL,
+             olm_outbound_group_session_last_error_code(batch));
+    CHECK_EQ(0U, olm_outbound_group_session_message_index(batch));
+    max_message_lengths[130]++;
+
+    CHECK_EQ(count, olm_group_encrypt_batch(
+        batch, count,
+        plaintext_ptrs.data(), plaintext_lengths.data(),
+        message_ptrs.data(), max_message_lengths.data(),
+        message_lengths.data()
+    ));
+    CHECK_EQ(olm_outbound_group_session_message_index(single),
+             olm_outbound_group_session_message_index(batch));
+    for (size_t i = 0; i < count; i++) {
+        CAPTURE(i);
+        CHECK_EQ(expected[i].size(), message_lengths[i]);
+        CHECK_EQ_SIZE(expected[i].data(), messages[i].data(), message_lengths[i]);
+    }
+}
+
+TEST_CASE("Group message batch decryption") {
+
+    uint8_t random_bytes[] =
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF";
+
+    std::vector<uint8_t> outbound_memory(olm_outbound_group_session_size());
+    OlmOutboundGroupSession *outbound =
+        olm_outbound_group_session(outbound_memory.data());
+    olm_init_outbound_group_session(outbound, random_bytes, sizeof(random_bytes));
+
+    size_t session_key_len = olm_outbound_group_session_key_length(outbound);
+    std::vector<uint8_t> session_key(session_key_len);
+    olm_outbound_group_session_key(outbound, session_key.data(), session_key_len);
+
+    /* a session that only knows the messages from index 5 on */
+    std::vector<uint8_t> full_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *full = olm_inbound_group_session(full_memory.data());
+    olm_init_inbound_group_session(full, session_key.data(), session_key_len);
+    size_t export_len = olm_export_inbound_group_session_length(full);
+    std::vector<uint8_t> exported(export_len);
+    olm_export_inbound_group_session(full, exported.data(), export_len, 5);
+
+    /* more messages than are handled at once, out of order, with a repeat
+     * and some broken ones */
+    const size_t count = 45;
+    std::vector<std::vector<uint8_t>> messages;
+    for (size_t i = 0; i < 40; i++) {
+        uint8_t plaintext[32];
+        size_t plaintext_length = 1 + i % 20;
+        memset(plaintext, 'a' + i % 26, plaintext_length);
+        size_t msglen = olm_group_encrypt_message_length(
+            outbound, plaintext_length
+        );
+        std::vector<uint8_t> message(msglen);
+        CHECK_EQ(msglen, olm_group_encrypt(
+            outbound, plaintext, plaintext_length, message.data(), msglen
+        ));
+        messages.push_back(message);
+    }
+    for (size_t i = 0; i < 20; i++) {
+        std::swap(messages[i], messages[(i * 7 + 3) % 40]);
+    }
+    messages.push_back(messages[10]);
+    messages.push_back(messages[20]);
+    messages.back()[10] ^= 1;
+    messages.push_back(messages[30]);
+    messages.back()[messages.back().size() - 5] ^= 1;
+    messages.push_back(messages[31]);
+    messages.back()[0] = '!';
+    messages.push_back(std::vector<uint8_t>(messages[32].begin(), messages[32].end() - 4));
+
+    /* decrypt one at a time */
+    std::vector<uint8_t> single_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *single =
+        olm_inbound_group_session(single_memory.data());
+    std::vector<uint8_t> exported_copy(exported);
+    olm_import_inbound_group_session(single, exported_copy.data(), export_len);
+
+    std::vector<size_t> expected_lengths(count);
+    std::vector<uint32_t> expected_indexes(count);
+    std::vector<OlmErrorCode> expected_errors(count);
+    std::vector<std::vector<uint8_t>> expected_plaintexts(count);
+    for (size_t i = 0; i < count; i++) {
+        std::vector<uint8_t> message(messages[i]);
+        expected_plaintexts[i].resize(message.size());
+        expected_indexes[i] = 0xffffffff;
+        expected_lengths[i] = olm_group_decrypt(
+            single, message.data(), message.size(),
+            expected_plaintexts[i].data(), expected_plaintexts[i].size(),
+            &expected_indexes[i]
+        );
+        expected_errors[i] = expected_lengths[i] == (size_t)-1
+            ? olm_inbound_group_session_last_error_code(single) : OLM_SUCCESS;
+    }
+
+    /* and all together */
+    std::vector<uint8_t> batch_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *batch =
+        olm_inbound_group_session(batch_memory.data());
+    exported_copy = exported;
+    olm_import_inbound_group_session(batch, exported_copy.data(), export_len);
+
+    std::vector<std::vector<uint8_t>> inputs(messages.begin(), messages.end());
+    std::vector<std::vector<uint8_t>> plaintexts(count);
+    std::vector<uint8_t *> message_ptrs(count), plaintext_ptrs(count);
+    std::vector<size_t> message_lengths(count), max_plaintext_lengths(count);
+    for (size_t i = 0; i < count; i++) {
+        plaintexts[i].resize(inputs[i].size());
+        message_ptrs[i] = inputs[i].data();
+        message_lengths[i] = inputs[i].size();
+        plaintext_ptrs[i] = plaintexts[i].data();
+        max_plaintext_lengths[i] = plaintexts[i].size();
+    }
+    /* one buffer too small */
+    max_plaintext_lengths[12] = 0;
+    expected_lengths[12] = (size_t)-1;
+    expected_errors[12] = OLM_OUTPUT_BUFFER_TOO_SMALL;
+
+    std::vector<size_t> lengths(count);
+    std::vector<uint32_t> indexes(count, 0xffffffff);
+    std::vector<OlmErrorCode> errors(count);
+    size_t expected_decrypted = 0;
+    for (size_t i = 0; i < count; i++) {
+        expected_decrypted += expected_errors[i] == OLM_SUCCESS;
+    }
+    CHECK_EQ(expected_decrypted, olm_group_decrypt_batch(
+        batch, count,
+        message_ptrs.data(), message_lengths.data(),
+        plaintext_ptrs.data(), max_plaintext_lengths.data(),
+        lengths.data(), indexes.data(), errors.data()
+    ));
+
+    for (size_t i = 0; i < count; i++) {
+        CAPTURE(i);
+        CHECK_EQ(expected_errors[i], errors[i]);
+        CHECK_EQ(expected_lengths[i], lengths[i]);
+        CHECK_EQ(expected_indexes[i], indexes[i]);
+        if (errors[i] == OLM_SUCCESS) {
+            CHECK_EQ_SIZE(
+                expected_plaintexts[i].data(), plaintexts[i].data(), lengths[i]
+            );
+        }
+    }
+    CHECK_EQ(1, olm_inbound_group_session_is_verified(batch));
+}
+
+/* Add the point of order 2, (0, -1), to an encoded point (x, y), giving
+ * (-x, -y). */
+static void add_order_two_point(uint8_t *point) {
+    /* -y = p - y with p = 2^255 - 19, ignoring the sign bit of x */
+    uint8_t sign = point[31] & 0x80;
+    int borrow = 0;
+    for (size_t i = 0; i < 32; ++i) {
+        int p_byte = i == 0 ? 0xed : i == 31 ? 0x7f : 0xff;
+        int y_byte = i == 31 ? point[i] & 0x7f : point[i];
+        int difference = p_byte - y_byte - borrow;
+        borrow = difference < 0;
+        point[i] = uint8_t(difference + (borrow ? 256 : 0));
+    }
+    point[31] |= sign ^ 0x80;
+}
+
+TEST_CASE("Group message batch decryption agrees with single decryption") {
+
+    uint8_t random_bytes[] =
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF";
+
+    std::vector<uint8_t> outbound_memory(olm_outbound_group_session_size());
+    OlmOutboundGroupSession *outbound =
+        olm_outbound_group_session(outbound_memory.data());
+    olm_init_outbound_group_session(outbound, random_bytes, sizeof(random_bytes));
+
+    size_t session_key_len = olm_outbound_group_session_key_length(outbound);
+    std::vector<uint8_t> session_key(session_key_len);
+    olm_outbound_group_session_key(outbound, session_key.data(), session_key_len);
+
+    std::vector<uint8_t> full_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *full = olm_inbound_group_session(full_memory.data());
+    olm_init_inbound_group_session(full, session_key.data(), session_key_len);
+    size_t export_len = olm_export_inbound_group_session_length(full);
+    std::vector<uint8_t> exported(export_len);
+    olm_export_inbound_group_session(full, exported.data(), export_len, 0);
+
+    /* swap the signing key in the export for one with a point of order 2
+     * added. An import doesn't check the key, so nothing stops a sender from
+     * handing this out. */
+    _olm_ed25519_key_pair signing_key;
+    _olm_crypto_ed25519_generate_key(random_bytes, &signing_key);
+    add_order_two_point(signing_key.public_key.public_key);
+    std::vector<uint8_t> raw_export(_olm_decode_base64_length(export_len));
+    _olm_decode_base64(exported.data(), export_len, raw_export.data());
+    memcpy(
+        raw_export.data() + raw_export.size() - ED25519_PUBLIC_KEY_LENGTH,
+        signing_key.public_key.public_key, ED25519_PUBLIC_KEY_LENGTH
+    );
+    _olm_encode_base64(raw_export.data(), raw_export.size(), exported.data());
+
+    /* messages signed with that key, which single verification accepts or
+     * rejects depending on the parity of their hash */
+    const size_t count = 16;
+    std::vector<std::vector<uint8_t>> messages;
+    int accepted = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t plaintext[] = "message";
+        size_t msglen = olm_group_encrypt_message_length(outbound, 7);
+        std::vector<uint8_t> message(msglen);
+        CHECK_EQ(msglen, olm_group_encrypt(
+            outbound, plaintext, 7, message.data(), msglen
+        ));
+        std::vector<uint8_t> raw(_olm_decode_base64_length(msglen));
+        _olm_decode_base64(message.data(), msglen, raw.data());
+        size_t signed_length = raw.size() - ED25519_SIGNATURE_LENGTH;
+        _olm_crypto_ed25519_sign(
+            &signing_key, raw.data(), signed_length, raw.data() + signed_length
+        );
+        accepted += _olm_crypto_ed25519_verify(
+            &signing_key.public_key, raw.data(), signed_length,
+            raw.data() + signed_length
+        );
+        _olm_encode_base64(raw.data(), raw.size(), message.data());
+        messages.push_back(message);
+    }
+    /* both kinds are there */
+    REQUIRE(accepted > 0);
+    REQUIRE(accepted < (int)count);
+
+    std::vector<uint8_t> single_memory(olm_inbound_group_session_size());
+    std::vector<uint8_t> batch_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *single =
+        olm_inbound_group_session(single_memory.data());
+    OlmInboundGroupSession *batch =
+        olm_inbound_group_session(batch_memory.data());
+    std::vector<uint8_t> key_copy(exported);
+    REQUIRE_EQ((size_t)0, olm_import_inbound_group_session(
+        single, key_copy.data(), key_copy.size()
+    ));
+    key_copy = exported;
+    REQUIRE_EQ((size_t)0, olm_import_inbound_group_session(
+        batch, key_copy.data(), key_copy.size()
+    ));
+
+    std::vector<std::vector<uint8_t>> copies(messages);
+    std::vector<std::vector<uint8_t>> plaintexts(count, std::vector<uint8_t>(64));
+    std::vector<uint8_t *> message_ptrs(count), plaintext_ptrs(count);
+    std::vector<size_t> message_lengths(count), max_plaintext_lengths(count, 64);
+    std::vector<size_t> plaintext_lengths(count);
+    std::vector<enum OlmErrorCode> errors(count);
+    for (size_t i = 0; i < count; i++) {
+        message_ptrs[i] = copies[i].data();
+        message_lengths[i] = copies[i].size();
+        plaintext_ptrs[i] = plaintexts[i].data();
+    }
+    CHECK_EQ((size_t)accepted, olm_group_decrypt_batch(
+        batch, count, message_ptrs.data(), message_lengths.data(),
+        plaintext_ptrs.data(), max_plaintext_lengths.data(),
+        plaintext_lengths.data(), NULL, errors.data()
+    ));
+
+    for (size_t i = 0; i < count; i++) {
+        CAPTURE(i);
+        std::vector<uint8_t> copy(messages[i]), plaintext(64);
+        uint32_t message_index;
+        size_t length = olm_group_decrypt(
+            single, copy.data(), copy.size(),
+            plaintext.data(), plaintext.size(), &message_index
+        );
+        enum OlmErrorCode error = length == (size_t)-1
+            ? olm_inbound_group_session_last_error_code(single) : OLM_SUCCESS;
+        CHECK_EQ(error, errors[i]);
+        CHECK_EQ(length, plaintext_lengths[i]);
+    }
+    CHECK_EQ(
+        olm_inbound_group_session_is_verified(single),
+        olm_inbound_group_session_is_verified(batch)
+    );
+
+    olm_clear_inbound_group_session(batch);
+    olm_clear_inbound_group_session(single);
+    olm_clear_inbound_group_session(full);
+}
+
+TEST_CASE("Group message key cache") {
+
+    uint8_t random_bytes[] =
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF"
+        "0123456789ABDEF0123456789ABCDEF";
+
+    std::vector<uint8_t> outbound_memory(olm_outbound_group_session_size());
+    OlmOutboundGroupSession *outbound =
+        olm_outbound_group_session(outbound_memory.data());
+    olm_init_outbound_group_session(outbound, random_bytes, sizeof(random_bytes));
+
+    size_t session_key_len = olm_outbound_group_session_key_length(outbound);
+    std::vector<uint8_t> session_key(session_key_len);
+    olm_outbound_group_session_key(outbound, session_key.data(), session_key_len);
+
+    std::vector<std::vector<uint8_t>> messages;
+    for (size_t i = 0; i < 4; i++) {
+        uint8_t plaintext[] = "Message 0";
+        plaintext[8] += i;
+        size_t msglen = olm_group_encrypt_message_length(outbound, 9);
+        std::vector<uint8_t> message(msglen);
+        olm_group_encrypt(outbound, plaintext, 9, message.data(), msglen);
+        messages.push_back(message);
+    }
+
+    std::vector<uint8_t> inbound_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *inbound =
+        olm_inbound_group_session(inbound_memory.data());
+    olm_init_inbound_group_session(inbound, session_key.data(), session_key_len);
+
+    std::vector<uint64_t> cache(
+        3 * olm_inbound_group_session_key_cache_entry_size() / sizeof(uint64_t)
+    );
+    CHECK_EQ((size_t)3, olm_inbound_group_session_set_key_cache(
+        inbound, cache.data(), cache.size() * sizeof(uint64_t)
+    ));
+
+    /* fill the cache, use the first again, then push out the least recently
+     * used ones */
+    static const uint32_t order[] = {0, 1, 2, 0, 3, 1, 0, 2};
+    static const size_t hits[] = {0, 0, 0, 1, 1, 1, 2, 2};
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+        CAPTURE(i);
+        std::vector<uint8_t> message(messages[order[i]]);
+        uint8_t plaintext[64];
+        uint32_t message_index;
+        CHECK_EQ((size_t)9, olm_group_decrypt(
+            inbound, message.data(), message.size(),
+            plaintext, sizeof(plaintext), &message_index
+        ));
+        CHECK_EQ(order[i], message_index);
+        CHECK_EQ('0' + order[i], plaintext[8]);
+        CHECK_EQ(hits[i], olm_inbound_group_session_key_cache_hits(inbound));
+        CHECK_EQ(
+            i + 1 - hits[i], olm_inbound_group_session_key_cache_misses(inbound)
+        );
+    }
+
+    /* the batch decryption uses the cache too */
+    std::vector<std::vector<uint8_t>> inputs(messages);
+    uint8_t plaintexts[4][64];
+    uint8_t *message_ptrs[4], *plaintext_ptrs[4];
+    size_t message_lengths[4], max_plaintext_lengths[4], lengths[4];
+    for (size_t i = 0; i < 4; i++) {
+        message_ptrs[i] = inputs[i].data();
+        message_lengths[i] = inputs[i].size();
+        plaintext_ptrs[i] = plaintexts[i];
+        max_plaintext_lengths[i] = sizeof(plaintexts[i]);
+    }
+    CHECK_EQ((size_t)4, olm_group_decrypt_batch(
+        inbound, 4, message_ptrs, message_lengths,
+        plaintext_ptrs, max_plaintext_lengths, lengths, NULL, NULL
+    ));
+    for (size_t i = 0; i < 4; i++) {
+        CHECK_EQ((size_t)9, lengths[i]);
+        CHECK_EQ('0' + i, plaintexts[i][8]);
+    }
+    CHECK_EQ((size_t)5, olm_inbound_group_session_key_cache_hits(inbound));
+    CHECK_EQ((size_t)7, olm_inbound_group_session_key_cache_misses(inbound));
+
+    /* clearing the session wipes the cache */
+    olm_clear_inbound_group_session(inbound);
+    for (uint64_t word : cache) {
+        CHECK_EQ((uint64_t)0, word);
+    }
+}
+
+TEST_CASE("Group session store") {
+
+    std::vector<uint8_t> pickle_key_memory(olm_pickle_key_size());
+    OlmPickleKey *pickle_key = olm_pickle_key(
+        pickle_key_memory.data(), "secret_key", 10
+    );
+
+    /* three sessions, with their ids */
+    std::vector<std::vector<uint8_t>> memories, ids;
+    std::vector<OlmInboundGroupSession *> sessions;
+    for (size_t i = 0; i < 3; i++) {
+        uint8_t random_bytes[] =
+            "0123456789ABDEF0123456789ABCDEF"
+            "0123456789ABDEF0123456789ABCDEF"
+            "0123456789ABDEF0123456789ABCDEF"
+            "0123456789ABDEF0123456789ABCDEF"
+            "0123456789ABDEF0123456789ABCDEF"
+            "0123456789ABDEF0123456789ABCDEF";
+        random_bytes[0] += i;
+        random_bytes[128] += i;
+        std::vector<uint8_t> outbound_memory(olm_outbound_group_session_size());
+        OlmOutboundGroupSession *outbound =
+            olm_outbound_group_session(outbound_memory.data());
+        olm_init_outbound_group_session(
+            outbound, random_bytes, sizeof(random_bytes)
+        );
+        size_t session_key_len = olm_outbound_group_session_key_length(outbound);
+        std::vector<uint8_t> session_key(session_key_len);
+        olm_outbound_group_session_key(
+            outbound, session_key.data(), session_key_len
+        );
+
+        memories.emplace_back(olm_inbound_group_session_size());
+        sessions.push_back(olm_inbound_group_session(memories.back().data()));
+        olm_init_inbound_group_session(
+            sessions.back(), session_key.data(), session_key_len
+        );
+        ids.emplace_back(olm_inbound_group_session_id_length(sessions.back()));
+        olm_inbound_group_session_id(
+            sessions.back(), ids.back().data(), ids.back().size()
+        );
+    }
+
+    size_t record_size = olm_group_session_store_record_size(0);
+    std::vector<uint8_t> scratch(record_size);
+    std::vector<uint8_t> store_memory(
+        olm_group_session_store_length(record_size, 4)
+    );
+    std::vector<uint8_t> random(olm_group_session_store_init_random_length());
+    std::fill(random.begin(), random.end(), 'r');
+    CHECK_EQ((OlmGroupSessionStore *)NULL, olm_group_session_store_init(
+        store_memory.data(), store_memory.size() - 1, record_size, 4,
+        random.data(), random.size()
+    ));
+    CHECK_EQ((OlmGroupSessionStore *)NULL, olm_group_session_store_init(
+        store_memory.data(), store_memory.size(), 20, 1,
+        random.data(), random.size()
+    ));
+    CHECK_EQ((OlmGroupSessionStore *)NULL, olm_group_session_store_init(
+        store_memory.data(), store_memory.size(), record_size, 4,
+        random.data(), random.size() - 1
+    ));
+    OlmGroupSessionStore *store = olm_group_session_store_init(
+        store_memory.data(), store_memory.size(), record_size, 4,
+        random.data(), random.size()
+    );
+    REQUIRE(store != NULL);
+    /* the random bytes are wiped once they are in the store */
+    CHECK(std::all_of(
+        random.begin(), random.end(), [](uint8_t byte) { return !byte; }
+    ));
+    CHECK_EQ((size_t)4, olm_group_session_store_capacity(store));
+
+    for (OlmInboundGroupSession *session : sessions) {
+        CHECK_EQ(OLM_SUCCESS, olm_group_session_store_put(
+            store, pickle_key, session, scratch.data(), scratch.size()
+        ));
+    }
+    CHECK_EQ((size_t)3, olm_group_session_store_session_count(store));
+    CHECK_EQ((size_t)3, olm_group_session_store_record_count(store));
+
+    /* each session comes back as it went in */
+    std::vector<uint8_t> loaded_memory(olm_inbound_group_session_size());
+    OlmInboundGroupSession *loaded =
+        olm_inbound_group_session(loaded_memory.data());
+    auto check_loaded = [&](
+        const OlmGroupSessionStore *from, size_t i, uint32_t index
+    ) {
+        CAPTURE(i);
+        CHECK_EQ(OLM_SUCCESS, olm_group_session_store_get(
+            from, pickle_key, ids[i].data(), ids[i].size(),
+            loaded, scratch.data(), scratch.size()
+        ));
+        size_t export_length = olm_export_inbound_group_session_length(loaded);
+        std::vector<uint8_t> expected(export_length), exported(export_length);
+        olm_export_inbound_group_session(
+            sessions[i], expected.data(), export_length, index
+        );
+        olm_export_inbound_group_session(
+            loaded, exported.data(), export_length, index
+        );
+        CHECK_EQ_SIZE(expected.data(), exported.data(), export_length);
+        CHECK_EQ(
+            olm_pickle_inbound_group_session_length(sessions[i]),
+            olm_pickle_inbound_group_session_length(loaded)
+        );
+    };
+    for (size_t i = 0; i < 3; i++) {
+        check_loaded(store, i, 0);
+    }
+
+    /* the records are encrypted, and the scratch buffer is wiped */
+    std::vector<uint8_t> zeros(record_size);
+    CHECK_EQ_SIZE(zeros.data(), scratch.data(), record_size);
+    std::vector<uint8_t> smaller_scratch(record_size - 1);
+    CHECK_EQ(OLM_OUTPUT_BUFFER_TOO_SMALL, olm_group_session_store_get(
+        store, pickle_key, ids[0].data(), ids[0].size(),
+        loaded, smaller_scratch.data(), smaller_scratch.size()
+    ));
+    std::vector<uint8_t> wrong_key_memory(olm_pickle_key_size());
+    OlmPickleKey *wrong_key = olm_pickle_key(
+        wrong_key_memory.data(), "wrong_key", 9
+    );
+    CHECK_EQ(OLM_BAD_ACCOUNT_KEY, olm_group_session_store_get(
+        store, wrong_key, ids[0].data(), ids[0].size(),
+        loaded, scratch.data(), scratch.size()
+    ));
+
+    /* storing a session again uses a new record */
+    size_t export_length = olm_export_inbound_group_session_length(sessions[0]);
+    std::vector<uint8_t> exported(export_length);
+    olm_export_inbound_group_session(
+        sessions[0], exported.data(), export_length, 300
+    );
+    CHECK_EQ(OLM_SUCCESS, olm_group_session_store_put(
+        store, pickle_key, sessions[0], scratch.data(), scratch.size()
+    ));
+    CHECK_EQ((size_t)3, olm_group_session_store_session_count(store));
+    CHECK_EQ((size_t)4, olm_group_session_store_record_count(store));
+    check_loaded(store, 0, 300);
+    CHECK_EQ(OLM_OUTPUT_BUFFER_TOO_SMALL, olm_group_session_store_put(
+        store, pickle_key, sessions[1], scratch.data(), scratch.size()
+    ));
+
+    CHECK_EQ(OLM_SUCCESS, olm_group_session_store_remove(
+        store, ids[1].data(), ids[1].size()
+    ));
+    CHECK_EQ((size_t)2, olm_group_session_store_session_count(store));
+    CHECK_EQ(OLM_UNKNOWN_GROUP_SESSION, olm_group_session_store_remove(
+        store, ids[1].data(), ids[1].size()
+    ));
+    CHECK_EQ(OLM_UNKNOWN_GROUP_SESSION, olm_group_session_store_get(
+        store, pickle_key, ids[1].data(), ids[1].size(),
+        loaded, scratch.data(), scratch.size()
+    ));
+    CHECK_EQ(OLM_INVALID_BASE64, olm_group_session_store_get(
+        store, pickle_key, ids[1].data(), 5,
+        loaded, scratch.data(), scratch.size()
+    ));
+
+    /* the store can be opened again from its memory */
+    std::vector<uint8_t> copy(store_memory);
+    CHECK_EQ((OlmGroupSessionStore *)NULL, olm_group_session_store_open(
+        copy.data(), copy.size() - 1
+    ));
+    OlmGroupSessionStore *reopened = olm_group_session_store_open(
+        copy.data(), copy.size()
+    );
+    REQUIRE(reopened != NULL);
+    check_loaded(reopened, 2, 0);
+    copy[0] ^= 1;
+    CHECK_EQ((OlmGroupSessionStore *)NULL, olm_group_session_store_open(
+        copy.data(), copy.size()
+    ));
+
+    /* compact a record at a time into a store with only room for the
+     * sessions that are left */
+    std::vector<uint8_t> compact_memory(
+        olm_group_session_store_length(record_size, 2)
+    );
+    /* with a different hash key, so the sessions go in different slots */
+    std::fill(random.begin(), random.end(), 's');
+    OlmGroupSessionStore *compacted = olm_group_session_store_init(
+        compact_memory.data(), compact_memory.size(), record_size, 2,
+        random.data(), random.size()
+    );
+    REQUIRE(compacted != NULL);
+    size_t position = 0, steps = 0;
+    while (position < olm_group_session_store_record_count(store)) {
+        CHECK_EQ(OLM_SUCCESS, olm_group_session_store_compact(
+            store, compacted, &position, 1
+        ));
+        steps++;
+    }
+    CHECK_EQ((size_t)4, steps);
+    CHECK_EQ((size_t)2, olm_group_session_store_session_count(compacted));
+    CHECK_EQ((size_t)2, olm_group_session_store_record_count(compacted));
+    check_loaded(compacted, 0, 300);
+    check_loaded(compacted, 2, 0);
+    CHECK_EQ(OLM_UNKNOWN_GROUP_SESSION, olm_group_session_store_get(
+        compacted, pickle_key, ids[1].data(), ids[1].size(),
+        loaded, scratch.data(), scratch.size()
+    ));
+
+    olm_clear_pickle_key(wrong_key);
+    olm_clear_pickle_key(pickle_key);
+}
+
 TEST_CASE("Invalid signature group message") {
 
     uint8_t plaintext[] = "Message";
@@ -87,3 +87,66 @@ for (auto item : test_list) {
 CHECK_EQ(3, i);
 
 }
+
+
+/** RingList insert beginning test **/
+TEST_CASE("RingList insert beginning") {
+
+olm::RingList<int, 4> test_list;
+
+CHECK_EQ(std::size_t(0), test_list.size());
+
+for (int i = 0; i < 6; ++i) {
+    test_list.insert(test_list.begin(), i);
+}
+
+/* the oldest items fall off the end */
+CHECK_EQ(std::size_t(4), test_list.size());
+
+int i = 6;
+for (auto item : test_list) {
+    CHECK_EQ(--i, item);
+}
+CHECK_EQ(2, i);
+
+test_list.insert(test_list.end(), 9);
+CHECK_EQ(9, test_list[3]);
+
+test_list.erase(&test_list[3]);
+test_list.erase(test_list.begin());
+CHECK_EQ(std::size_t(2), test_list.size());
+CHECK_EQ(4, test_list[0]);
+CHECK_EQ(3, test_list[1]);
+
+}
+
+
+/** RingList matches List test **/
+TEST_CASE("RingList matches List") {
+
+olm::List<int, 5> list;
+olm::RingList<int, 5> ring;
+
+std::uint32_t state = 1;
+for (int step = 0; step < 1000; ++step) {
+    state = state * 1103515245 + 12345;
+    std::size_t index = (state >> 8) % (list.size() + 1);
+    if ((state >> 20) % 3 || list.empty()) {
+        list.insert(list.begin() + index, step);
+        ring.insert(ring.begin() + index, step);
+    } else {
+        index %= list.size();
+        list.erase(list.begin() + index);
+        ring.erase(ring.begin() + index);
+    }
+
+    CAPTURE(step);
+    REQUIRE_EQ(list.size(), ring.size());
+    auto ring_pos = ring.begin();
+    for (int item : list) {
+        CHECK_EQ(item, *ring_pos);
+        ++ring_pos;
+    }
+}
+
+}
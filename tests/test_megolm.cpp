@@ -13,10 +13,14 @@
  * limitations under the License.
  */
 #include "olm/megolm.h"
+#include "olm/crypto.h"
 #include "olm/memory.hh"
 
 #include "testing.hh"
 
+#include <utility>
+#include <vector>
+
 
 std::uint8_t random_bytes[] =
     "0123456789ABCDEF0123456789ABCDEF"
@@ -124,3 +128,97 @@ TEST_CASE("Megolm::advance overflow") {
 
     CHECK_EQ_SIZE(megolm_get_data(&mr2), megolm_get_data(&mr1), MEGOLM_RATCHET_LENGTH);
 }
+
+/* The ratchet advance as it was first written: every bump of R(j) on its last
+ * step also rederives all of R(j+1)...R(3). */
+static void reference_rehash_parts(
+    std::uint8_t data[MEGOLM_RATCHET_PARTS][MEGOLM_RATCHET_PART_LENGTH],
+    int from_part, int to_part
+) {
+    for (int i = to_part; i >= from_part; i--) {
+        std::uint8_t seed = i;
+        _olm_crypto_hmac_sha256(
+            data[from_part], MEGOLM_RATCHET_PART_LENGTH, &seed, 1, data[i]
+        );
+    }
+}
+
+static void reference_advance_to(Megolm *megolm, std::uint32_t advance_to) {
+    for (int j = 0; j < (int)MEGOLM_RATCHET_PARTS; j++) {
+        int shift = (MEGOLM_RATCHET_PARTS - j - 1) * 8;
+        std::uint32_t mask = (~(std::uint32_t)0) << shift;
+        unsigned int steps =
+            ((advance_to >> shift) - (megolm->counter >> shift)) & 0xff;
+        if (steps == 0) {
+            if (advance_to < megolm->counter) {
+                steps = 0x100;
+            } else {
+                continue;
+            }
+        }
+        while (steps > 1) {
+            reference_rehash_parts(megolm->data, j, j);
+            steps--;
+        }
+        reference_rehash_parts(megolm->data, j, MEGOLM_RATCHET_PARTS - 1);
+        megolm->counter = advance_to & mask;
+    }
+}
+
+TEST_CASE("Megolm::advance matches the reference advance") {
+
+    std::uint32_t state = 0x2545f491;
+    auto next_random = [&]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> pairs;
+    /* counters on and next to part boundaries, both ways round */
+    std::uint32_t edges[] = {
+        0x0, 0x1, 0xff, 0x100, 0xffff, 0x10000, 0xffffff, 0x1000000,
+        0x1ffffff, 0x7fffffff, 0x80000000, 0xfeffffff, 0xffffff00,
+        0xfffffffe, 0xffffffff
+    };
+    for (std::uint32_t from : edges) {
+        for (std::uint32_t to : edges) {
+            pairs.emplace_back(from, to);
+        }
+    }
+    for (int i = 0; i < 500; i++) {
+        std::uint32_t from = next_random();
+        std::uint32_t to;
+        switch (i % 4) {
+        case 0: to = next_random(); break;
+        /* nearby counters, which only differ in the lower parts */
+        case 1: to = from + (next_random() & 0xffff); break;
+        case 2: to = from + (next_random() & 0xff); break;
+        /* wrapping around past 0xffffffff */
+        default: from |= 0xff000000; to = next_random() & 0x00ffffff; break;
+        }
+        pairs.emplace_back(from, to);
+    }
+
+    for (auto const & pair : pairs) {
+        CAPTURE(pair.first);
+        CAPTURE(pair.second);
+        std::uint8_t seed[MEGOLM_RATCHET_LENGTH];
+        for (std::size_t i = 0; i < sizeof(seed); i++) {
+            seed[i] = next_random();
+        }
+
+        Megolm expected, actual;
+        megolm_init(&expected, seed, pair.first);
+        megolm_init(&actual, seed, pair.first);
+        reference_advance_to(&expected, pair.second);
+        megolm_advance_to(&actual, pair.second);
+
+        CHECK_EQ(expected.counter, actual.counter);
+        CHECK_EQ_SIZE(
+            megolm_get_data(&expected), megolm_get_data(&actual),
+            MEGOLM_RATCHET_LENGTH
+        );
+    }
+}
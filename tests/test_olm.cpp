@@ -1,9 +1,11 @@
 #include "olm/olm.h"
+#include "olm/base64.hh"
 
 #include "testing.hh"
 #include "utils.hh"
 
 #include <cstddef>
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <vector>
@@ -86,6 +88,51 @@ CHECK_EQ(OLM_PICKLE_EXTRA_DATA, olm_account_last_error_code(account));
 }
 
 
+TEST_CASE("Pickle account with a pickle key test") {
+MockRandom mock_random('P');
+
+std::vector<std::uint8_t> account_buffer(::olm_account_size());
+::OlmAccount *account = ::olm_account(account_buffer.data());
+std::vector<std::uint8_t> random(::olm_create_account_random_length(account));
+mock_random(random.data(), random.size());
+::olm_create_account(account, random.data(), random.size());
+
+std::vector<std::uint8_t> pickle_key_buffer(::olm_pickle_key_size());
+::OlmPickleKey *pickle_key = ::olm_pickle_key(
+    pickle_key_buffer.data(), "secret_key", 10
+);
+
+/* the pickle is the same as the one made with the key itself */
+std::size_t pickle_length = ::olm_pickle_account_length(account);
+std::vector<std::uint8_t> pickle1(pickle_length);
+std::vector<std::uint8_t> pickle2(pickle_length);
+CHECK_EQ(pickle_length, ::olm_pickle_account(
+    account, "secret_key", 10, pickle1.data(), pickle_length
+));
+CHECK_EQ(pickle_length, ::olm_pickle_account_with_key(
+    account, pickle_key, pickle2.data(), pickle_length
+));
+CHECK_EQ_SIZE(pickle1.data(), pickle2.data(), pickle_length);
+
+std::vector<std::uint8_t> account_buffer2(::olm_account_size());
+::OlmAccount *account2 = ::olm_account(account_buffer2.data());
+CHECK_NE(std::size_t(-1), ::olm_unpickle_account_with_key(
+    account2, pickle_key, pickle1.data(), pickle_length
+));
+CHECK_EQ(pickle_length, ::olm_pickle_account(
+    account2, "secret_key", 10, pickle1.data(), pickle_length
+));
+CHECK_EQ_SIZE(pickle2.data(), pickle1.data(), pickle_length);
+
+CHECK_EQ(std::size_t(-1), ::olm_pickle_account_with_key(
+    account, pickle_key, pickle1.data(), pickle_length - 1
+));
+CHECK_EQ(OLM_OUTPUT_BUFFER_TOO_SMALL, ::olm_account_last_error_code(account));
+
+::olm_clear_pickle_key(pickle_key);
+}
+
+
     TEST_CASE("Old account unpickle test") {
 
     // this uses the old pickle format, which did not use enough space
@@ -321,6 +368,252 @@ CHECK_EQ_SIZE(a_session_id.data(), b_session_id.data(), b_session_id.size());
 
 }
 
+TEST_CASE("Session index test") {
+MockRandom mock_random_a('A', 0x00);
+MockRandom mock_random_b('B', 0x80);
+
+std::vector<std::uint8_t> a_account_buffer(::olm_account_size());
+::OlmAccount *a_account = ::olm_account(a_account_buffer.data());
+std::vector<std::uint8_t> a_random(::olm_create_account_random_length(a_account));
+mock_random_a(a_random.data(), a_random.size());
+::olm_create_account(a_account, a_random.data(), a_random.size());
+
+std::vector<std::uint8_t> b_account_buffer(::olm_account_size());
+::OlmAccount *b_account = ::olm_account(b_account_buffer.data());
+std::vector<std::uint8_t> b_random(::olm_create_account_random_length(b_account));
+mock_random_b(b_random.data(), b_random.size());
+::olm_create_account(b_account, b_random.data(), b_random.size());
+std::vector<std::uint8_t> o_random(::olm_account_generate_one_time_keys_random_length(
+        b_account, 1
+));
+mock_random_b(o_random.data(), o_random.size());
+::olm_account_generate_one_time_keys(b_account, 1, o_random.data(), o_random.size());
+
+std::vector<std::uint8_t> a_id_keys(::olm_account_identity_keys_length(a_account));
+::olm_account_identity_keys(a_account, a_id_keys.data(), a_id_keys.size());
+
+std::vector<std::uint8_t> b_id_keys(::olm_account_identity_keys_length(b_account));
+std::vector<std::uint8_t> b_ot_keys(::olm_account_one_time_keys_length(b_account));
+::olm_account_identity_keys(b_account, b_id_keys.data(), b_id_keys.size());
+::olm_account_one_time_keys(b_account, b_ot_keys.data(), b_ot_keys.size());
+
+/* Four sessions from A to B, each with its own base key */
+std::vector<std::vector<std::uint8_t>> messages;
+std::vector<std::vector<std::uint8_t>> b_session_buffers;
+std::vector<::OlmSession *> b_sessions;
+for (unsigned i = 0; i < 4; ++i) {
+    std::vector<std::uint8_t> a_session_buffer(::olm_session_size());
+    ::OlmSession *a_session = ::olm_session(a_session_buffer.data());
+    std::vector<std::uint8_t> a_rand(::olm_create_outbound_session_random_length(a_session));
+    mock_random_a(a_rand.data(), a_rand.size());
+    REQUIRE_NE(std::size_t(-1), ::olm_create_outbound_session(
+        a_session, a_account,
+        b_id_keys.data() + 15, 43,
+        b_ot_keys.data() + 25, 43,
+        a_rand.data(), a_rand.size()
+    ));
+
+    std::uint8_t plaintext[] = "Hello, World";
+    std::vector<std::uint8_t> message(::olm_encrypt_message_length(a_session, 12));
+    std::vector<std::uint8_t> a_message_random(::olm_encrypt_random_length(a_session));
+    mock_random_a(a_message_random.data(), a_message_random.size());
+    REQUIRE_NE(std::size_t(-1), ::olm_encrypt(
+        a_session,
+        plaintext, 12,
+        a_message_random.data(), a_message_random.size(),
+        message.data(), message.size()
+    ));
+    messages.push_back(message);
+
+    b_session_buffers.emplace_back(::olm_session_size());
+    b_sessions.push_back(::olm_session(b_session_buffers.back().data()));
+    REQUIRE_NE(std::size_t(-1), ::olm_create_inbound_session(
+        b_sessions.back(), b_account, message.data(), message.size()
+    ));
+}
+
+MockRandom mock_random_index('I');
+std::vector<std::uint8_t> index_random(::olm_session_index_random_length());
+mock_random_index(index_random.data(), index_random.size());
+
+CHECK_EQ(static_cast<::OlmSessionIndex *>(NULL), ::olm_session_index(
+    NULL, 0, index_random.data(), index_random.size()
+));
+
+std::vector<std::uint64_t> index_buffer(
+    (::olm_session_index_size(3) + 7) / 8
+);
+CHECK_EQ(static_cast<::OlmSessionIndex *>(NULL), ::olm_session_index(
+    index_buffer.data(), 3, index_random.data(), index_random.size() - 1
+));
+::OlmSessionIndex *index = ::olm_session_index(
+    index_buffer.data(), 3, index_random.data(), index_random.size()
+);
+REQUIRE_NE(static_cast<::OlmSessionIndex *>(NULL), index);
+/* The random bytes are wiped once they have been used */
+CHECK_EQ(
+    index_random.end(),
+    std::find_if(index_random.begin(), index_random.end(), [](std::uint8_t b) {
+        return b != 0;
+    })
+);
+
+for (unsigned i = 0; i < 3; ++i) {
+    CHECK_EQ(std::size_t(0), ::olm_session_index_insert(
+        index, b_sessions[i], 0x100000000ULL + i
+    ));
+}
+CHECK_EQ(std::size_t(3), ::olm_session_index_count(index));
+
+/* The index is full */
+CHECK_EQ(std::size_t(-1), ::olm_session_index_insert(index, b_sessions[3], 3));
+CHECK_EQ(OLM_OUTPUT_BUFFER_TOO_SMALL, ::olm_session_index_last_error_code(index));
+
+/* Each message finds the session it started */
+for (unsigned i = 0; i < 3; ++i) {
+    std::vector<std::uint8_t> tmp(messages[i]);
+    std::uint64_t handle = 0;
+    CHECK_EQ(std::size_t(1), ::olm_session_index_find(
+        index, tmp.data(), tmp.size(), &handle
+    ));
+    CHECK_EQ(0x100000000ULL + i, handle);
+
+    tmp = messages[i];
+    CHECK_EQ(std::size_t(1), ::olm_session_index_find_from(
+        index, a_id_keys.data() + 15, 43, tmp.data(), tmp.size(), &handle
+    ));
+
+    tmp = messages[i];
+    CHECK_EQ(std::size_t(0), ::olm_session_index_find_from(
+        index, b_id_keys.data() + 15, 43, tmp.data(), tmp.size(), &handle
+    ));
+}
+
+std::vector<std::uint8_t> tmp(messages[3]);
+std::uint64_t handle = 0;
+CHECK_EQ(std::size_t(0), ::olm_session_index_find(
+    index, tmp.data(), tmp.size(), &handle
+));
+
+/* Like olm_matches_inbound_session(), a message without an identity key
+ * only matches a session if the sender's identity key is given */
+std::uint8_t a_identity_key[32];
+olm::decode_base64(a_id_keys.data() + 15, 43, a_identity_key);
+std::vector<std::uint8_t> no_identity(
+    olm::decode_base64_length(messages[1].size())
+);
+olm::decode_base64(
+    messages[1].data(), messages[1].size(), no_identity.data()
+);
+auto identity_pos = std::search(
+    no_identity.begin(), no_identity.end(),
+    a_identity_key, a_identity_key + 32
+);
+REQUIRE_NE(no_identity.end(), identity_pos);
+/* the key and the field's tag and length */
+no_identity.erase(identity_pos - 2, identity_pos + 32);
+std::vector<std::uint8_t> no_identity_message(
+    olm::encode_base64_length(no_identity.size())
+);
+olm::encode_base64(
+    no_identity.data(), no_identity.size(), no_identity_message.data()
+);
+
+tmp = no_identity_message;
+CHECK_EQ(std::size_t(0), ::olm_matches_inbound_session(
+    b_sessions[1], tmp.data(), tmp.size()
+));
+tmp = no_identity_message;
+CHECK_EQ(std::size_t(0), ::olm_session_index_find(
+    index, tmp.data(), tmp.size(), &handle
+));
+tmp = no_identity_message;
+CHECK_EQ(std::size_t(1), ::olm_matches_inbound_session_from(
+    b_sessions[1], a_id_keys.data() + 15, 43, tmp.data(), tmp.size()
+));
+tmp = no_identity_message;
+CHECK_EQ(std::size_t(1), ::olm_session_index_find_from(
+    index, a_id_keys.data() + 15, 43, tmp.data(), tmp.size(), &handle
+));
+CHECK_EQ(0x100000001ULL, handle);
+
+/* Removing a session moves the last one into its place */
+CHECK_EQ(std::size_t(1), ::olm_session_index_remove(index, b_sessions[0]));
+CHECK_EQ(std::size_t(0), ::olm_session_index_remove(index, b_sessions[0]));
+CHECK_EQ(std::size_t(2), ::olm_session_index_count(index));
+tmp = messages[0];
+CHECK_EQ(std::size_t(0), ::olm_session_index_find(
+    index, tmp.data(), tmp.size(), &handle
+));
+tmp = messages[2];
+CHECK_EQ(std::size_t(1), ::olm_session_index_find(
+    index, tmp.data(), tmp.size(), &handle
+));
+CHECK_EQ(0x100000002ULL, handle);
+CHECK_EQ(std::size_t(0), ::olm_session_index_insert(index, b_sessions[3], 3));
+
+std::vector<std::uint8_t> pickle(::olm_pickle_session_index_length(index));
+CHECK_EQ(pickle.size(), ::olm_pickle_session_index(
+    index, "secret_key", 10, pickle.data(), pickle.size()
+));
+
+/* An index too small for the pickle */
+std::vector<std::uint64_t> small_buffer((::olm_session_index_size(2) + 7) / 8);
+mock_random_index(index_random.data(), index_random.size());
+::OlmSessionIndex *small = ::olm_session_index(
+    small_buffer.data(), 2, index_random.data(), index_random.size()
+);
+std::vector<std::uint8_t> tmp_pickle(pickle);
+CHECK_EQ(std::size_t(-1), ::olm_unpickle_session_index(
+    small, "secret_key", 10, tmp_pickle.data(), tmp_pickle.size()
+));
+CHECK_EQ(OLM_OUTPUT_BUFFER_TOO_SMALL, ::olm_session_index_last_error_code(small));
+
+std::vector<std::uint64_t> index2_buffer((::olm_session_index_size(8) + 7) / 8);
+mock_random_index(index_random.data(), index_random.size());
+::OlmSessionIndex *index2 = ::olm_session_index(
+    index2_buffer.data(), 8, index_random.data(), index_random.size()
+);
+tmp_pickle = pickle;
+CHECK_EQ(pickle.size(), ::olm_unpickle_session_index(
+    index2, "secret_key", 10, tmp_pickle.data(), tmp_pickle.size()
+));
+CHECK_EQ(std::size_t(3), ::olm_session_index_count(index2));
+for (unsigned i = 1; i < 4; ++i) {
+    tmp = messages[i];
+    handle = 0;
+    CHECK_EQ(std::size_t(1), ::olm_session_index_find(
+        index2, tmp.data(), tmp.size(), &handle
+    ));
+    CHECK_EQ(i == 3 ? 3 : 0x100000000ULL + i, handle);
+}
+
+/* The index can be moved to other memory as a whole */
+std::vector<std::uint64_t> moved_buffer(index2_buffer);
+::OlmSessionIndex *moved =
+    reinterpret_cast<::OlmSessionIndex *>(moved_buffer.data());
+CHECK_EQ(::olm_session_index_size(8), ::olm_clear_session_index(index2));
+CHECK_EQ(std::size_t(0), ::olm_session_index_count(index2));
+
+CHECK_EQ(std::size_t(3), ::olm_session_index_count(moved));
+for (unsigned i = 1; i < 4; ++i) {
+    tmp = messages[i];
+    handle = 0;
+    CHECK_EQ(std::size_t(1), ::olm_session_index_find(
+        moved, tmp.data(), tmp.size(), &handle
+    ));
+    CHECK_EQ(i == 3 ? 3 : 0x100000000ULL + i, handle);
+}
+CHECK_EQ(std::size_t(1), ::olm_session_index_remove(moved, b_sessions[1]));
+tmp = messages[3];
+CHECK_EQ(std::size_t(1), ::olm_session_index_find(
+    moved, tmp.data(), tmp.size(), &handle
+));
+CHECK_EQ(std::size_t(3), handle);
+CHECK_EQ(std::size_t(0), ::olm_session_index_count(index2));
+::olm_clear_session_index(moved);
+}
+
 /** More messages test */
 
 TEST_CASE("More messages test") {
@@ -87,3 +87,84 @@ free(message);
 
 }
 
+
+TEST_CASE("Batch signing test") {
+
+static const std::size_t COUNT = 3;
+void * account_buffers[COUNT];
+::OlmAccount * accounts[COUNT];
+std::uint8_t * id_keys[COUNT];
+std::uint8_t * signatures[COUNT];
+void const * key_ptrs[COUNT];
+std::size_t key_lengths[COUNT];
+void const * message_ptrs[COUNT];
+std::size_t message_lengths[COUNT];
+void * signature_ptrs[COUNT];
+std::size_t signature_lengths[COUNT];
+
+std::uint8_t message[] = "Hello, World";
+
+for (std::size_t i = 0; i < COUNT; ++i) {
+    MockRandom mock_random('A' + i, 0x00);
+    account_buffers[i] = check_malloc(::olm_account_size());
+    accounts[i] = ::olm_account(account_buffers[i]);
+
+    std::size_t random_size = ::olm_create_account_random_length(accounts[i]);
+    void * random = check_malloc(random_size);
+    mock_random(random, random_size);
+    ::olm_create_account(accounts[i], random, random_size);
+    ::free(random);
+
+    std::size_t signature_size = ::olm_account_signature_length(accounts[i]);
+    signatures[i] = check_malloc(signature_size);
+    CHECK_NE(std::size_t(-1), ::olm_account_sign(
+        accounts[i], message, 12, signatures[i], signature_size
+    ));
+
+    std::size_t id_keys_size = ::olm_account_identity_keys_length(accounts[i]);
+    id_keys[i] = check_malloc(id_keys_size);
+    CHECK_NE(std::size_t(-1), ::olm_account_identity_keys(
+        accounts[i], id_keys[i], id_keys_size
+    ));
+
+    key_ptrs[i] = id_keys[i] + 71;
+    key_lengths[i] = 43;
+    message_ptrs[i] = message;
+    message_lengths[i] = 12;
+    signature_ptrs[i] = signatures[i];
+    signature_lengths[i] = signature_size;
+}
+
+/* sign the message with the wrong account for the last one, and give the
+ * second one a key of the wrong length */
+::olm_account_sign(
+    accounts[0], message, 12, signatures[2], signature_lengths[2]
+);
+key_lengths[1] = 42;
+
+void * utility_buffer = check_malloc(::olm_utility_size());
+::OlmUtility * utility = ::olm_utility(utility_buffer);
+
+std::uint8_t results[COUNT];
+CHECK_EQ(std::size_t(1), ::olm_ed25519_verify_batch(
+    utility, COUNT,
+    key_ptrs, key_lengths,
+    message_ptrs, message_lengths,
+    signature_ptrs, signature_lengths,
+    results
+));
+CHECK_EQ(1, results[0]);
+CHECK_EQ(0, results[1]);
+CHECK_EQ(0, results[2]);
+
+olm_clear_utility(utility);
+free(utility_buffer);
+
+for (std::size_t i = 0; i < COUNT; ++i) {
+    olm_clear_account(accounts[i]);
+    free(account_buffers[i]);
+    free(id_keys[i]);
+    free(signatures[i]);
+}
+
+}
@@ -206,3 +206,159 @@ free(plaintext);
 
 }
 
+
+
+struct CountingAllocator {
+    static void * allocate(void * context, std::size_t length) {
+        static_cast<CountingAllocator *>(context)->allocated += length;
+        return ::malloc(length);
+    }
+    static void deallocate(
+        void * context, void * memory, std::size_t length
+    ) {
+        static_cast<CountingAllocator *>(context)->allocated -= length;
+        ::free(memory);
+    }
+    std::size_t allocated = 0;
+};
+
+
+/** Compact session test */
+
+TEST_CASE("Compact session test") {
+MockRandom mock_random_a('A', 0x00);
+MockRandom mock_random_b('B', 0x80);
+
+CountingAllocator counter;
+OlmAllocator allocator = {
+    CountingAllocator::allocate, CountingAllocator::deallocate, &counter
+};
+
+CHECK_LT(::olm_compact_session_size(), ::olm_session_size() / 2);
+
+void * a_account_buffer = check_malloc(::olm_account_size());
+::OlmAccount *a_account = ::olm_account(a_account_buffer);
+std::size_t a_random_size = ::olm_create_account_random_length(a_account);
+void * a_random = check_malloc(a_random_size);
+mock_random_a(a_random, a_random_size);
+::olm_create_account(a_account, a_random, a_random_size);
+free(a_random);
+
+void * b_account_buffer = check_malloc(::olm_account_size());
+::OlmAccount *b_account = ::olm_account(b_account_buffer);
+std::size_t b_random_size = ::olm_create_account_random_length(b_account);
+void * b_random = check_malloc(b_random_size);
+mock_random_b(b_random, b_random_size);
+::olm_create_account(b_account, b_random, b_random_size);
+free(b_random);
+
+std::size_t o_random_size = ::olm_account_generate_one_time_keys_random_length(
+    b_account, 1
+);
+void * o_random = check_malloc(o_random_size);
+mock_random_b(o_random, o_random_size);
+::olm_account_generate_one_time_keys(b_account, 1, o_random, o_random_size);
+free(o_random);
+
+std::size_t b_id_keys_size = ::olm_account_identity_keys_length(b_account);
+std::size_t b_ot_keys_size = ::olm_account_one_time_keys_length(b_account);
+std::uint8_t * b_id_keys = (std::uint8_t *) check_malloc(b_id_keys_size);
+std::uint8_t * b_ot_keys = (std::uint8_t *) check_malloc(b_ot_keys_size);
+::olm_account_identity_keys(b_account, b_id_keys, b_id_keys_size);
+::olm_account_one_time_keys(b_account, b_ot_keys, b_ot_keys_size);
+
+void * a_session_buffer = check_malloc(::olm_session_size());
+::OlmSession *a_session = ::olm_session(a_session_buffer);
+std::size_t a_rand_size = ::olm_create_outbound_session_random_length(a_session);
+void * a_rand = check_malloc(a_rand_size);
+mock_random_a(a_rand, a_rand_size);
+CHECK_NE(std::size_t(-1), ::olm_create_outbound_session(
+    a_session, a_account,
+    b_id_keys + 15, 43,
+    b_ot_keys + 25, 43,
+    a_rand, a_rand_size
+));
+free(b_id_keys);
+free(b_ot_keys);
+free(a_rand);
+
+/* Alice sends Bob some messages, which all carry the pre-key */
+std::uint8_t plaintext[] = "Hello, World";
+std::uint8_t messages[7][512];
+std::size_t message_size = ::olm_encrypt_message_length(a_session, 12);
+REQUIRE_LE(message_size, sizeof(messages[0]));
+for (auto & message : messages) {
+    CHECK_NE(std::size_t(-1), ::olm_encrypt(
+        a_session, plaintext, 12, NULL, 0, message, message_size
+    ));
+}
+
+auto decrypt = [&](::OlmSession * session, std::uint8_t const * message) {
+    std::uint8_t tmp[512], output[512];
+    std::memcpy(tmp, message, message_size);
+    return ::olm_decrypt(
+        session, OLM_MESSAGE_TYPE_PRE_KEY,
+        tmp, message_size, output, sizeof(output)
+    );
+};
+
+void * b_session_buffer = check_malloc(::olm_compact_session_size());
+::OlmSession *b_session = ::olm_compact_session(b_session_buffer, &allocator);
+std::uint8_t tmp[512];
+std::memcpy(tmp, messages[0], message_size);
+CHECK_NE(std::size_t(-1), ::olm_create_inbound_session(
+    b_session, b_account, tmp, message_size
+));
+CHECK_EQ(std::size_t(12), decrypt(b_session, messages[0]));
+
+OlmSessionMemoryUsage usage;
+CHECK_EQ(
+    ::olm_compact_session_size(),
+    ::olm_session_memory_usage(b_session, &usage)
+);
+CHECK_EQ(std::size_t(0), usage.external_skipped_message_keys);
+CHECK_EQ(std::size_t(0), counter.allocated);
+
+/* the keys for skipped messages are allocated while they are needed */
+CHECK_EQ(std::size_t(12), decrypt(b_session, messages[4]));
+CHECK_EQ(
+    ::olm_compact_session_size() + counter.allocated,
+    ::olm_session_memory_usage(b_session, &usage)
+);
+CHECK_EQ(std::size_t(3), usage.skipped_message_key_count);
+CHECK_EQ(
+    40 * ::olm_session_skipped_message_key_size(),
+    usage.external_skipped_message_keys
+);
+CHECK_EQ(usage.external_skipped_message_keys, counter.allocated);
+
+CHECK_EQ(std::size_t(12), decrypt(b_session, messages[2]));
+CHECK_EQ(std::size_t(12), decrypt(b_session, messages[1]));
+CHECK_NE(std::size_t(0), counter.allocated);
+CHECK_EQ(std::size_t(12), decrypt(b_session, messages[3]));
+CHECK_EQ(std::size_t(0), counter.allocated);
+
+/* and freed when the session is cleared */
+CHECK_EQ(std::size_t(12), decrypt(b_session, messages[6]));
+CHECK_NE(std::size_t(0), counter.allocated);
+
+/* a session from olm_session() has room for the keys in the object */
+CHECK_EQ(::olm_session_size(), ::olm_session_memory_usage(a_session, &usage));
+CHECK_EQ(
+    40 * ::olm_session_skipped_message_key_size(),
+    usage.embedded_skipped_message_keys
+);
+CHECK_EQ(std::size_t(0), usage.external_skipped_message_keys);
+
+::olm_clear_account(a_account);
+::olm_clear_account(b_account);
+::olm_clear_session(a_session);
+CHECK_EQ(::olm_compact_session_size(), ::olm_clear_session(b_session));
+CHECK_EQ(std::size_t(0), counter.allocated);
+
+free(a_account_buffer);
+free(b_account_buffer);
+free(a_session_buffer);
+free(b_session_buffer);
+
+}
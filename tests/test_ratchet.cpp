@@ -16,6 +16,7 @@
 #include "olm/cipher.h"
 #include "testing.hh"
 
+#include <cstring>
 #include <vector>
 
 std::uint8_t root_info[] = "Olm";
@@ -220,3 +221,178 @@ random[31]++;
 
 }
 
+
+TEST_CASE("Olm Skipped Messages") {
+
+olm::Ratchet alice(kdf_info, cipher);
+olm::Ratchet bob(kdf_info, cipher);
+
+alice.initialise_as_alice(shared_secret, sizeof(shared_secret) - 1, alice_key);
+bob.initialise_as_bob(shared_secret, sizeof(shared_secret) - 1, alice_key.public_key);
+
+std::uint8_t plaintext[] = "Message 00";
+std::uint8_t random[] = "This is a random 32 byte string";
+
+auto send = [&](olm::Ratchet & from, unsigned count) {
+    std::vector<std::vector<std::uint8_t>> messages;
+    for (unsigned i = 0; i < count; ++i) {
+        plaintext[8] = '0' + i / 10;
+        plaintext[9] = '0' + i % 10;
+        std::vector<std::uint8_t> msg(from.encrypt_output_length(10));
+        from.encrypt(plaintext, 10, random, 32, msg.data(), msg.size());
+        messages.push_back(msg);
+    }
+    random[31]++;
+    return messages;
+};
+
+auto receive = [&](olm::Ratchet & to, std::vector<std::uint8_t> msg) {
+    std::vector<std::uint8_t> output(
+        to.decrypt_max_plaintext_length(msg.data(), msg.size())
+    );
+    std::size_t length = to.decrypt(
+        msg.data(), msg.size(), output.data(), output.size()
+    );
+    if (length == std::size_t(-1)) {
+        return std::string();
+    }
+    return std::string(output.begin(), output.begin() + length);
+};
+
+/* once on an existing chain, then on a new one */
+for (unsigned turn = 0; turn < 2; ++turn) {
+    CAPTURE(turn);
+    std::vector<std::vector<std::uint8_t>> messages = send(alice, 60);
+
+    CHECK_EQ(std::string("Message 59"), receive(bob, messages[59]));
+    CHECK_EQ(olm::MAX_SKIPPED_MESSAGE_KEYS, bob.skipped_message_key_count());
+
+    /* only the keys for the latest skipped messages are kept */
+    CHECK_EQ(std::string(), receive(bob, messages[18]));
+    CHECK_EQ(std::string("Message 19"), receive(bob, messages[19]));
+    CHECK_EQ(std::string("Message 58"), receive(bob, messages[58]));
+    CHECK_EQ(std::string(), receive(bob, messages[58]));
+    CHECK_EQ(
+        olm::MAX_SKIPPED_MESSAGE_KEYS - 2, bob.skipped_message_key_count()
+    );
+
+    /* the chain carries on from the message after the latest one */
+    std::vector<std::vector<std::uint8_t>> more = send(alice, 1);
+    CHECK_EQ(std::string("Message 00"), receive(bob, more[0]));
+
+    std::vector<std::vector<std::uint8_t>> reply = send(bob, 1);
+    CHECK_EQ(std::string("Message 00"), receive(alice, reply[0]));
+}
+
+}
+
+
+TEST_CASE("Olm Skipped Message Key Table") {
+
+olm::Ratchet alice(kdf_info, cipher);
+olm::Ratchet bob(kdf_info, cipher);
+
+alice.initialise_as_alice(shared_secret, sizeof(shared_secret) - 1, alice_key);
+bob.initialise_as_bob(shared_secret, sizeof(shared_secret) - 1, alice_key.public_key);
+
+std::vector<std::uint32_t> table(
+    100 * olm::Ratchet::skipped_message_key_table_entry_size() / 4
+);
+CHECK_EQ(
+    std::size_t(100),
+    bob.set_skipped_message_key_table(table.data(), table.size() * 4)
+);
+
+std::uint8_t plaintext[] = "Message 000";
+std::uint8_t random[] = "This is a random 32 byte string";
+
+auto send = [&](olm::Ratchet & from, unsigned count) {
+    std::vector<std::vector<std::uint8_t>> messages;
+    for (unsigned i = 0; i < count; ++i) {
+        plaintext[8] = '0' + i / 100;
+        plaintext[9] = '0' + i / 10 % 10;
+        plaintext[10] = '0' + i % 10;
+        std::vector<std::uint8_t> msg(from.encrypt_output_length(11));
+        from.encrypt(plaintext, 11, random, 32, msg.data(), msg.size());
+        messages.push_back(msg);
+    }
+    random[31]++;
+    return messages;
+};
+
+auto receive = [&](olm::Ratchet & to, std::vector<std::uint8_t> msg) {
+    std::vector<std::uint8_t> output(
+        to.decrypt_max_plaintext_length(msg.data(), msg.size())
+    );
+    std::size_t length = to.decrypt(
+        msg.data(), msg.size(), output.data(), output.size()
+    );
+    if (length == std::size_t(-1)) {
+        return std::string();
+    }
+    return std::string(output.begin(), output.begin() + length);
+};
+
+std::vector<std::vector<std::uint8_t>> first = send(alice, 150);
+
+CHECK_EQ(std::string("Message 149"), receive(bob, first[149]));
+CHECK_EQ(std::size_t(100), bob.skipped_message_key_count());
+
+/* the table keeps the keys for the latest 100 skipped messages */
+CHECK_EQ(std::string(), receive(bob, first[48]));
+CHECK_EQ(std::string("Message 049"), receive(bob, first[49]));
+CHECK_EQ(std::string("Message 148"), receive(bob, first[148]));
+CHECK_EQ(std::string("Message 100"), receive(bob, first[100]));
+CHECK_EQ(std::string(), receive(bob, first[100]));
+CHECK_EQ(std::size_t(97), bob.skipped_message_key_count());
+
+/* keys from a new chain push the oldest ones out, once the gaps left by the
+ * keys that were used are filled */
+std::vector<std::vector<std::uint8_t>> reply = send(bob, 1);
+CHECK_EQ(std::string("Message 000"), receive(alice, reply[0]));
+std::vector<std::vector<std::uint8_t>> second = send(alice, 10);
+CHECK_EQ(std::string("Message 009"), receive(bob, second[9]));
+CHECK_EQ(std::size_t(100), bob.skipped_message_key_count());
+CHECK_EQ(std::string(), receive(bob, first[55]));
+CHECK_EQ(std::string("Message 056"), receive(bob, first[56]));
+CHECK_EQ(std::string("Message 000"), receive(bob, second[0]));
+CHECK_EQ(std::size_t(98), bob.skipped_message_key_count());
+
+/* going back to the room in the ratchet keeps the latest 40 keys */
+CHECK_EQ(
+    olm::MAX_SKIPPED_MESSAGE_KEYS,
+    bob.set_skipped_message_key_table(nullptr, 0)
+);
+CHECK_EQ(olm::MAX_SKIPPED_MESSAGE_KEYS, bob.skipped_message_key_count());
+for (std::uint32_t word : table) {
+    CHECK_EQ(std::uint32_t(0), word);
+}
+CHECK_EQ(std::string(), receive(bob, first[115]));
+CHECK_EQ(std::string("Message 116"), receive(bob, first[116]));
+CHECK_EQ(std::string("Message 008"), receive(bob, second[8]));
+CHECK_EQ(std::string("Message 010"), receive(bob, send(alice, 11)[10]));
+
+/* a key used from the middle of a full table of the default size leaves room
+ * for one more, and the oldest key is kept */
+olm::Ratchet carol(kdf_info, cipher);
+olm::Ratchet dave(kdf_info, cipher);
+carol.initialise_as_alice(shared_secret, sizeof(shared_secret) - 1, alice_key);
+dave.initialise_as_bob(shared_secret, sizeof(shared_secret) - 1, alice_key.public_key);
+
+std::vector<std::vector<std::uint8_t>> third = send(carol, 43);
+CHECK_EQ(std::string("Message 040"), receive(dave, third[40]));
+CHECK_EQ(std::string("Message 005"), receive(dave, third[5]));
+CHECK_EQ(std::string("Message 042"), receive(dave, third[42]));
+CHECK_EQ(olm::MAX_SKIPPED_MESSAGE_KEYS, dave.skipped_message_key_count());
+CHECK_EQ(std::string("Message 000"), receive(dave, third[0]));
+
+/* the room for the keys is found from where the ratchet is, so the ratchet
+ * can be moved */
+alignas(olm::Ratchet) std::uint8_t moved_memory[sizeof(olm::Ratchet)];
+std::memcpy(moved_memory, &dave, sizeof(dave));
+std::memset(&dave.skipped_keys, 0, sizeof(dave.skipped_keys));
+olm::Ratchet & moved = *reinterpret_cast<olm::Ratchet *>(moved_memory);
+CHECK_EQ(std::string("Message 041"), receive(moved, third[41]));
+CHECK_EQ(std::string("Message 039"), receive(moved, third[39]));
+
+}
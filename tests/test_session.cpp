@@ -53,7 +53,7 @@ void check_session(const olm::Session &session) {
 
     CHECK_EQ(
         std::size_t(0),
-        session.ratchet.skipped_message_keys.size()
+        session.ratchet.skipped_message_key_count()
     );
 
     CHECK_EQ(OLM_SUCCESS, session.last_error);
@@ -133,3 +133,89 @@ TEST_CASE("V2 session pickle") {
 
     check_session(session);
 }
+
+TEST_CASE("Pickle session with a skipped message key table") {
+    std::uint8_t shared_secret[] = "A secret";
+    std::uint8_t random[] = "This is a random 32 byte string";
+    _olm_curve25519_key_pair alice_key;
+    _olm_crypto_curve25519_generate_key(random, &alice_key);
+
+    olm::Session alice, bob;
+    alice.ratchet.initialise_as_alice(
+        shared_secret, sizeof(shared_secret) - 1, alice_key
+    );
+    bob.ratchet.initialise_as_bob(
+        shared_secret, sizeof(shared_secret) - 1, alice_key.public_key
+    );
+
+    std::size_t key_size = olm::Ratchet::skipped_message_key_table_entry_size();
+    std::vector<std::uint32_t> bob_table(200 * key_size / 4);
+    bob.ratchet.set_skipped_message_key_table(
+        bob_table.data(), bob_table.size() * 4
+    );
+
+    std::uint8_t plaintext[] = "Hello";
+    std::vector<std::vector<std::uint8_t>> messages;
+    for (unsigned i = 0; i < 100; ++i) {
+        std::vector<std::uint8_t> msg(alice.ratchet.encrypt_output_length(5));
+        alice.ratchet.encrypt(plaintext, 5, random, 32, msg.data(), msg.size());
+        messages.push_back(msg);
+    }
+
+    auto receive = [&](olm::Session & to, std::vector<std::uint8_t> msg) {
+        std::vector<std::uint8_t> output(
+            to.ratchet.decrypt_max_plaintext_length(msg.data(), msg.size())
+        );
+        return to.ratchet.decrypt(
+            msg.data(), msg.size(), output.data(), output.size()
+        ) != std::size_t(-1);
+    };
+
+    CHECK(receive(bob, messages[99]));
+    CHECK_EQ(std::size_t(99), bob.ratchet.skipped_message_key_count());
+
+    std::vector<std::uint8_t> pickled(olm::pickle_length(bob));
+    CHECK_EQ(
+        pickled.data() + pickled.size(), olm::pickle(pickled.data(), bob)
+    );
+    std::uint8_t const * end = pickled.data() + pickled.size();
+
+    /* a session with a large enough table gets all of the keys back */
+    olm::Session copy;
+    std::vector<std::uint32_t> copy_table(200 * key_size / 4);
+    copy.ratchet.set_skipped_message_key_table(
+        copy_table.data(), copy_table.size() * 4
+    );
+    CHECK_EQ(end, olm::unpickle(pickled.data(), end, copy));
+    CHECK_EQ(std::size_t(99), copy.ratchet.skipped_message_key_count());
+    CHECK(receive(copy, messages[0]));
+    CHECK(receive(copy, messages[98]));
+
+    /* one with a smaller table gets the latest ones */
+    olm::Session small;
+    std::vector<std::uint32_t> small_table(50 * key_size / 4);
+    small.ratchet.set_skipped_message_key_table(
+        small_table.data(), small_table.size() * 4
+    );
+    CHECK_EQ(end, olm::unpickle(pickled.data(), end, small));
+    CHECK_EQ(std::size_t(50), small.ratchet.skipped_message_key_count());
+    CHECK_FALSE(receive(small, messages[48]));
+    CHECK(receive(small, messages[49]));
+
+    /* and one with the default room keeps as many as that holds */
+    olm::SessionWithSkippedKeys plain;
+    CHECK_EQ(end, olm::unpickle(pickled.data(), end, plain));
+    CHECK_EQ(
+        olm::MAX_SKIPPED_MESSAGE_KEYS, plain.ratchet.skipped_message_key_count()
+    );
+    CHECK_FALSE(receive(plain, messages[58]));
+    CHECK(receive(plain, messages[59]));
+
+    /* its pickle can be read back into a table */
+    pickled.resize(olm::pickle_length(plain));
+    olm::pickle(pickled.data(), plain);
+    end = pickled.data() + pickled.size();
+    CHECK_EQ(end, olm::unpickle(pickled.data(), end, copy));
+    CHECK_EQ(std::size_t(39), copy.ratchet.skipped_message_key_count());
+    CHECK(receive(copy, messages[98]));
+}